@@ -10,10 +10,16 @@ protected:
 	Animation* animation;
 	Animation* turn;
 	
+	float frame;
+	lalge::Scalar angle;
+	
 	unsigned int switch_time;
 	bool side;
 public:
 	int hp;
+	
+	/// @brief Acceleration from outside, added to the ship's own
+	lalge::R2Vector gravity;
 protected:
 	lalge::R2Vector v;
 	lalge::R2Vector a;
@@ -21,6 +27,8 @@ protected:
 	lalge::Scalar omega;
 	
 	lalge::Scalar acceleration;
+	
+	bool camera;
 public:
 	AccObject (
 		const lalge::R2Vector& r,
@@ -33,11 +41,25 @@ public:
 	
 	virtual void update ();
 	
-	virtual void render ();
+	virtual void snapshot (RenderSnapshot& snap) const;
 	
 	virtual GameObject* clone () const;
 	
+	virtual lalge::Scalar extent () const;
+	
 	void setAnimation (Animation* animation);
+	
+	void connect ();
+	void disconnect ();
+	
+	/// Holds the thrust and the turn (-1, 0 or 1) as the keys would, for a
+	/// ship without a player.
+	void steer (bool thrust, int turn);
+	
+	/// Whether the camera follows the ship, as by default.
+	void setCamera (bool camera);
+	
+	const lalge::R2Vector& velocity () const;
 protected:
 	virtual void handleKeyDown ();
 	virtual void handleKeyUp ();
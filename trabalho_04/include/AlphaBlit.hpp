@@ -0,0 +1,54 @@
+#ifndef ALPHABLIT_HPP
+#define ALPHABLIT_HPP
+
+#include "SDL.h"
+
+// Rows of a surface with per pixel alpha in the top byte blended over a
+// surface without alpha, with the same red, green and blue masks, which is
+// what SDL_DisplayFormatAlpha makes for a 32-bit screen. The result is the
+// one of the blitters SDL picks for those formats, bit for bit, on every
+// kernel; groups of pixels that are all opaque are copied and groups that
+// are all clear are skipped. The kernel is picked for the CPU when the
+// program starts.
+class AlphaBlit
+{
+public:
+	enum Kernel
+	{
+		SCALAR,
+		SSE2,
+		AVX2,
+		KERNELS
+	};
+	
+	typedef void (*Row)(const Uint32* src, Uint32* dst, int w);
+private:
+	static Kernel kernel_;
+	static Row straight_;
+	static Row premultiplied_;
+	
+	static Kernel best();
+public:
+	static bool fits(const SDL_PixelFormat* src, const SDL_PixelFormat* dst);
+	
+	// dst = dst + ( src - dst ) * alpha / 256, rounded down, for each
+	// channel; opaque pixels are copied
+	static void blend(const Uint32* src, Uint32* dst, int w);
+	
+	// for sources whose channels were already multiplied by their alpha,
+	// which SDL can't draw: dst = src + dst * ( 255 - alpha ) / 255,
+	// rounded down, the same on every kernel
+	static void blendPremultiplied(const Uint32* src, Uint32* dst, int w);
+	
+	// multiplies the channels of each pixel by its alpha, in place
+	static void premultiply(SDL_Surface* surface);
+	
+	static Kernel kernel();
+	static bool supported(Kernel kernel);
+	static const char* name(Kernel kernel);
+	
+	// for the benchmarks, false if the CPU can't run it
+	static bool use(Kernel kernel);
+};
+
+#endif
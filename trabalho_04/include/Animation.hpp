@@ -26,14 +26,35 @@ public:
 		int line = 0
 	);
 	
+	Animation (
+		const Atlas::Region& region,
+		int frame,
+		int framesize,
+		int rows,
+		int cols,
+		bool matrix = false,
+		int line = 0
+	);
+	
 	void update ();
+	
+	float advance (float frame) const;
+	
+	// draws a frame without changing the current one
+	void renderFrame (int frame, int x, int y);
 private:
+	void init_ (int frame, int framesize);
+	
 	void update_ ();
 	
+	SDL_Rect frameRect (int frame) const;
+	
 	int frameAmount () const;
 public:
 	int getFrame () const;
 	int getFrameSize () const;
+	int frameW () const;
+	int frameH () const;
 	
 	void setFrame (int frame);
 	void setFrameSize (int framesize);
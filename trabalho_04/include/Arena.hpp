@@ -0,0 +1,75 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Linear allocator for objects that live as long as their owner (a State).
+// Memory is handed out by bumping a pointer inside big chunks and is only
+// given back all at once by release(). Objects that need their destructors
+// to run (SDL surfaces, sounds, ...) must be registered with track().
+class Arena
+{
+private:
+	struct Chunk
+	{
+		char* data;
+		size_t size;
+		size_t used;
+	};
+	
+	struct Finalizer
+	{
+		void* object;
+		void (*destroy)(void* object);
+	};
+	
+	std::vector< Chunk > chunks;
+	std::vector< Finalizer > finalizers;
+	
+	size_t chunksize;
+	size_t current;
+	
+	size_t used_;
+	size_t peak_;
+	size_t objects_;
+	
+	template <class T>
+	static void destroy(void* object)
+	{
+		( (T*) object )->~T();
+	}
+	
+	// non-copyable
+	Arena(const Arena&);
+	Arena& operator=(const Arena&);
+public:
+	Arena(size_t chunksize = 16384);
+	~Arena();
+	
+	void* alloc(size_t size);
+	
+	template <class T>
+	T* track(T* object)
+	{
+		Finalizer f;
+		
+		f.object = object;
+		f.destroy = &Arena::destroy< T >;
+		finalizers.push_back( f );
+		
+		return object;
+	}
+	
+	void release();
+	
+	size_t used() const;
+	size_t peak() const;
+	size_t reserved() const;
+	size_t objects() const;
+};
+
+void* operator new(size_t size, Arena& arena);
+void operator delete(void* ptr, Arena& arena);
+
+#endif
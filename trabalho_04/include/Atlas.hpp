@@ -0,0 +1,97 @@
+#ifndef ATLAS_HPP
+#define ATLAS_HPP
+
+#include <string>
+#include <vector>
+
+#include "SDLBase.hpp"
+
+// Packs many images into a few big display format surfaces, the pages. The
+// images are grouped by opacity, so each page keeps the cheapest blit of its
+// images, and placed with a skyline packer: the tallest images first, each
+// one at the lowest spot of the skyline where it fits. The packed pages can
+// be saved to a cache file, which is used instead of the image files while
+// none of them changes.
+class Atlas
+{
+public:
+	// piece of a page with one of the images
+	struct Region
+	{
+		SDL_Surface* page;
+		SDL_Rect rect;
+	};
+private:
+	struct Image
+	{
+		std::string filename;
+		long int mtime;
+		
+		// 32-bit copy with alpha, only while building
+		SDL_Surface* pixels;
+		SDLBase::Opacity opacity;
+		
+		int page;
+		SDL_Rect rect;
+	};
+	
+	// top edges of the packed images, from left to right
+	class Skyline
+	{
+	private:
+		struct Segment
+		{
+			int x, y, w;
+		};
+		
+		int w, h;
+		std::vector< Segment > segments;
+	public:
+		Skyline(int w, int h);
+		
+		// lowest place for a w x h image, or false if it doesn't fit
+		bool insert(int w, int h, SDL_Rect& rect);
+	private:
+		int fit(unsigned int i, int w) const;
+	};
+	
+	int pagew, pageh;
+	
+	std::vector< Image > images;
+	std::vector< SDL_Surface* > pages;
+	
+	// non-copyable
+	Atlas(const Atlas&);
+	Atlas& operator=(const Atlas&);
+public:
+	Atlas(int pagew = 1024, int pageh = 1024);
+	~Atlas();
+	
+	// queues an image to be packed, returning its id
+	int add(const std::string& filename);
+	
+	// packs the queued images, or reads them from the cache when it's up to
+	// date. An empty path doesn't use any cache.
+	void build(const std::string& cache = "");
+	
+	Region region(int id) const;
+	
+	// id of the image, or -1
+	int find(const std::string& filename) const;
+	
+	int size() const;
+	int pageCount() const;
+private:
+	void pack(std::vector< SDL_Surface* >& raw, std::vector< int >& classes);
+	
+	bool restore(const std::string& cache);
+	void save(
+		const std::string& cache,
+		const std::vector< SDL_Surface* >& raw,
+		const std::vector< int >& classes
+	) const;
+	
+	void release();
+};
+
+#endif
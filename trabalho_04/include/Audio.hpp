@@ -3,17 +3,15 @@
 
 #include <string>
 
-#include "SDL_mixer.h"
+#include "AudioBank.hpp"
 
 class Audio
 {
 private:
-	std::string filename;
-	Mix_Chunk* sound;
-	Mix_Music* music;
+	AudioBank::Sound* sound;
 	int channel;
 public:
-	Audio(const std::string& filename);
+	Audio(const std::string& filename, int maxvoices = 0, int priority = 0);
 	~Audio();
 	
 	void play(int n = 0);
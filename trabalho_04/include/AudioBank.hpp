@@ -0,0 +1,80 @@
+#ifndef AUDIOBANK_HPP
+#define AUDIOBANK_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "SDL_mixer.h"
+
+// Cache of decoded sounds and musics, shared by every Audio object and kept
+// across state changes, so each file is decoded only once while some state
+// uses it; the unused ones are freed after a state is closed. It also owns the
+// mixing channels: each sound may be limited to a number of simultaneous
+// voices (the oldest one is stolen when the limit is reached), a sound with
+// higher priority may steal a channel when all of them are busy, and the
+// triggers of the same sound in the same frame are collapsed into one.
+class AudioBank
+{
+public:
+	struct Sound
+	{
+		std::string filename;
+		Mix_Chunk* chunk;
+		Mix_Music* music;
+		int refs;
+		
+		int maxvoices;
+		int priority;
+		
+		unsigned int lastframe;
+		int lastchannel;
+		std::vector< int > voices;
+	};
+	
+	struct Stats
+	{
+		unsigned int decoded;
+		unsigned int hits;
+		unsigned int plays;
+		unsigned int collapsed;
+		unsigned int stolen;
+		unsigned int refused;
+		int channels;
+		int busy;
+		int peak;
+	};
+private:
+	struct Channel
+	{
+		Sound* sound;
+		unsigned int serial;
+	};
+	
+	static std::map< std::string, Sound* > sounds;
+	static std::vector< Channel > channels;
+	static unsigned int frame;
+	static unsigned int serial;
+	static Stats stats_;
+	
+	static void prune(Sound* sound);
+	static int steal(int priority);
+public:
+	static void init(int nchannels = 16);
+	static void close();
+	
+	static Sound* acquire(const std::string& filename);
+	static void release(Sound* sound);
+	static void purge();
+	
+	static void limit(Sound* sound, int maxvoices, int priority = 0);
+	
+	static int play(Sound* sound, int loops);
+	static void stop(Sound* sound, int channel, int fade = 0);
+	
+	static void nextFrame();
+	
+	static const Stats& stats();
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef CHUNKSTREAM_HPP
+#define CHUNKSTREAM_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "SDL_thread.h"
+
+class TileMap;
+
+// Tiles of a map file split in square chunks, loaded on demand by a thread
+// of their own into a cache of bounded size, where the chunks unused for
+// longest are dropped first. Nothing waits for the disk except fetch; a
+// chunk asked for before it's loaded is simply missing.
+//
+// File: "TMCHUNK1", then int32 layers and chunk side, int32 width and
+// height of each layer, and a uint32 pair (low, high) with the offset of
+// each chunk, row by row, layer by layer, 0 for a chunk of empty tiles.
+// Each chunk is side * side int16 tiles, row by row, -1 for an empty one,
+// the ones beyond the edges of the map included.
+class ChunkStream
+{
+public:
+	struct Stats
+	{
+		unsigned int requested;
+		unsigned int loaded;
+		unsigned int hits;
+		unsigned int misses;
+		unsigned int evicted;
+		unsigned int blocking;
+	};
+private:
+	struct Chunk
+	{
+		std::vector< int >* tiles;
+		unsigned int used;
+	};
+	
+	int fd;
+	
+	int layers_;
+	int side_;
+	std::vector< int > w, h;
+	
+	// chunks of each layer and index of the first one
+	std::vector< int > cols, rows;
+	std::vector< int > first;
+	
+	std::vector< off_t > offsets;
+	std::vector< char > state;
+	
+	std::map< int, Chunk > cache;
+	unsigned int capacity;
+	unsigned int clock;
+	unsigned int arrivals_;
+	
+	std::vector< int > empty;
+	
+	// asked for and read by the loader, guarded by the lock, like the
+	// cache
+	std::vector< int > requests;
+	std::vector< std::pair< int, std::vector< int >* > > done;
+	
+	SDL_Thread* loader;
+	SDL_mutex* lock;
+	SDL_cond* wake;
+	bool quit;
+	
+	static Stats stats_;
+public:
+	ChunkStream(const std::string& path, unsigned int capacity);
+	~ChunkStream();
+	
+	static bool isChunked(const std::string& path);
+	static void write(const std::string& path, TileMap& map, int side);
+	
+	int layers() const;
+	int side() const;
+	int width(int layer) const;
+	int height(int layer) const;
+	
+	// chunks over the tiles from ( i0, j0 ) to ( i1, j1 ), loaded in the
+	// background; the last ones asked for are loaded first
+	void request(int layer, int i0, int j0, int i1, int j1);
+	
+	// takes the chunks loaded since the last update into the cache and
+	// drops the oldest ones over the capacity, never the ones used since
+	// the last update
+	void update();
+	
+	// with the cache locked: the tiles of a chunk, or NULL if it isn't
+	// loaded yet
+	void lockCache();
+	void unlockCache();
+	const int* chunk(int layer, int ci, int cj);
+	
+	// the tiles of a chunk, loaded right away if needed; they stay valid
+	// until the next update drops them
+	int* fetch(int layer, int ci, int cj);
+	
+	// copies the tiles of a chunk if it's loaded, without waiting for the
+	// disk or counting as a use of the chunk
+	bool peek(int layer, int ci, int cj, std::vector< int >& tiles);
+	
+	// chunks taken into the cache so far, so a change means peek may find
+	// more of them
+	unsigned int arrivals() const;
+	
+	static const Stats& stats();
+	static void resetStats();
+private:
+	static int run(void* data);
+	void work();
+	
+	int index(int layer, int ci, int cj) const;
+	std::vector< int >* read(int index) const;
+	bool readAt(void* buffer, size_t size, off_t offset) const;
+	void close();
+};
+
+#endif
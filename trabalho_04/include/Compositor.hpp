@@ -0,0 +1,124 @@
+#ifndef COMPOSITOR_HPP
+#define COMPOSITOR_HPP
+
+#include <vector>
+
+#include "SDL.h"
+
+#include "linearalgebra.hpp"
+
+// Records the blits and fills of a frame and draws them at once, splitting
+// the target in horizontal bands that are rasterized in parallel by the job
+// system. Every band runs the whole draw list in order, clipped to its own
+// rows, so the bands write to disjoint memory and the result is the same for
+// any number of threads. The compositor draws 32-bit surfaces by itself; a
+// frame with anything else is handed to SDL serially, in the same order.
+class Compositor
+{
+public:
+	enum Filter
+	{
+		NEAREST,
+		BILINEAR
+	};
+private:
+	struct Command
+	{
+		// NULL for fills
+		SDL_Surface* src;
+		
+		// already clipped to the source and to the target, except for the
+		// transformed blits, whose source rectangle is the whole image and
+		// whose destination is the clipped bounding box
+		SDL_Rect srcrect;
+		SDL_Rect dstrect;
+		
+		Uint32 color;
+		
+		// channels already multiplied by their alpha
+		bool premultiplied;
+		
+		// for the transformed blits, the point of the source under the
+		// center of the pixel (0, 0) of the target, in pixels of the source
+		// rectangle, and how much it moves for each pixel in x and in y
+		bool transformed;
+		Filter filter;
+		double u;
+		double v;
+		double dudx;
+		double dvdx;
+		double dudy;
+		double dvdy;
+	};
+	
+	class Bands
+	{
+	private:
+		const Compositor* compositor;
+	public:
+		Bands(const Compositor* compositor);
+		
+		void operator()(int beg, int end) const;
+	};
+	
+	SDL_Surface* target;
+	int bandheight;
+	
+	std::vector< Command > commands;
+	
+	// whether the target and every recorded source can be drawn by the
+	// compositor
+	bool native;
+	bool drawable;
+public:
+	Compositor(SDL_Surface* target, int bandheight = 16);
+	~Compositor();
+	
+	// same clipping rules and arguments of SDL_BlitSurface and SDL_FillRect
+	void blit(SDL_Surface* src, SDL_Rect* srcrect, SDL_Rect* dstrect);
+	void fill(SDL_Rect* dstrect, Uint32 color);
+	
+	// the same as blit, for a source whose channels were multiplied by its
+	// alpha (see AlphaBlit::premultiply); false if the source or the target
+	// aren't the formats AlphaBlit blends, so the caller has to draw it
+	// somehow else
+	bool blitPremultiplied(SDL_Surface* src, SDL_Rect* srcrect, SDL_Rect* dstrect);
+	
+	// draws the piece srcrect of src through the linear operator op, with
+	// the center of the piece at the point (x, y) of the target, sampling
+	// the source straight into the target; false if the compositor can't
+	// read the source this way, so the caller has to draw it somehow else
+	bool transform(
+		SDL_Surface* src,
+		const SDL_Rect& srcrect,
+		const lalge::R2LinearOp& op,
+		double x, double y,
+		Filter filter = BILINEAR
+	);
+	
+	// draws everything recorded since the last flush, on the workers of the
+	// job system or only on the calling thread
+	void flush(bool parallel = true);
+	
+	// forgets the recorded commands without drawing them
+	void discard();
+	
+	unsigned int size() const;
+	int bands() const;
+private:
+	void record(
+		SDL_Surface* src,
+		SDL_Rect* srcrect,
+		SDL_Rect* dstrect,
+		bool premultiplied
+	);
+	
+	static bool canDraw(SDL_Surface* surface);
+	bool canTransform(SDL_Surface* surface) const;
+	
+	void rasterize(int y0, int y1) const;
+	void draw(const Command& command, int y0, int y1) const;
+	void drawTransformed(const Command& command, int y0, int y1) const;
+};
+
+#endif
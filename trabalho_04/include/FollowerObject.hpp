@@ -1,11 +1,10 @@
 #ifndef FOLLOWEROBJECT_HPP
 #define FOLLOWEROBJECT_HPP
 
-#include <queue>
-#include <list>
-
 #include "Geometry.hpp"
 #include "Sprite.hpp"
+#include "RingBuffer.hpp"
+#include "PathFinder.hpp"
 
 class FollowerObject : public Circle
 {
@@ -14,7 +13,10 @@ protected:
 	lalge::R2Vector v;
 	lalge::R2Vector dest;
 	
-	std::queue< lalge::R2Vector, std::list< lalge::R2Vector > > path;
+	RingBuffer< lalge::R2Vector > path;
+	
+	PathFinder* finder;
+	lalge::Scalar finderdepth;
 public:
 	FollowerObject (
 		const lalge::R2Vector& r = lalge::R2Vector (),
@@ -25,15 +27,26 @@ public:
 	
 	virtual void update ();
 	
-	virtual void render ();
+	virtual void snapshot (RenderSnapshot& snap) const;
 	
 	virtual GameObject* clone () const;
 	
 	void setSprite (Sprite* sprite);
+	
+	/// The waypoints go around the obstacles of a tile layer, drawn with
+	/// the given depth constant, instead of straight to each click.
+	void setPathFinder (PathFinder* finder, const lalge::Scalar& depth);
+	
+	/// Adds a leg to the path, as a right click does.
+	void moveTo (const lalge::R2Vector& target);
+	
+	/// @return Whether it has stopped and has nowhere to go.
+	bool idle () const;
+	
+	void connect ();
+	void disconnect ();
 private:
 	void handleMouseDownRight ();
-public:
-	void renderLines ();
 };
 
 #endif
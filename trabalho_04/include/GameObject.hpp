@@ -3,6 +3,8 @@
 
 #include "linearalgebra.hpp"
 
+#include "RenderSnapshot.hpp"
+
 class GameObject
 {
 public:
@@ -18,10 +20,14 @@ public:
 	
 	virtual void update () = 0;
 	
-	virtual void render () = 0;
+	virtual void snapshot (RenderSnapshot& snap) const;
 	
 	virtual GameObject* clone () const = 0;
 	
+	/// @return Half the side of a square around r that holds everything
+	/// the object draws.
+	virtual lalge::Scalar extent () const;
+	
 	lalge::R2Vector range (const lalge::R2Vector& param) const;
 };
 
@@ -2,6 +2,8 @@
 #define GAMESTATES_HPP
 
 #include <list>
+#include <string>
+#include <vector>
 
 #include "linearalgebra.hpp"
 
@@ -13,30 +15,45 @@
 #include "AccObject.hpp"
 #include "TileMap.hpp"
 #include "Timer.hpp"
+#include "ParticleSystem.hpp"
+#include "Gravity.hpp"
+#include "SpatialGrid.hpp"
 
 // game states
 enum
 {
+	STATEPOP = -2,
 	STATEQUIT = -1,
 	NOSTATE,
 	STATESPLASH,
 	STATEGAME,
-	STATEWINLOSE
+	STATEWINLOSE,
+	STATESTRESS
 };
 
+// or'ed with a state, suspends the current state instead of unloading it
+#define STATEPUSH	0x100
+
 // first game state
 class StateSplash : public State
 {
 private:
 	Audio* bgm;
 public:
+	const char* name() const;
+	int id() const;
+	
 	void load(MainArgs* args, StateArgs* st_args = 0);
 	StateArgs* unload();
 	
+	void suspend();
+	void resume();
+	
 	int input();
 	int update();
-	void render();
+	void snapshot(RenderSnapshot& snap) const;
 private:
+	void connect();
 	void renderMenu();
 	
 	void handleQuit();
@@ -49,6 +66,11 @@ private:
 	Audio* bgm;
 	Audio* sfx;
 	
+	// explosions of the last step, heard when its snapshot is presented
+	int booms;
+	
+	Atlas* atlas;
+	
 	Sprite* spr_bg;
 	Sprite* spr_redplanet;
 	Sprite* spr_earth;
@@ -57,9 +79,10 @@ private:
 	
 	Animation* anim_ship;
 	Animation* anim_shipturn;
-	Animation* anim_boom;
 	
-	lalge::R2Vector boom_r;
+	ParticleSystem* particles;
+	int fx_boom;
+	int fx_debris;
 	
 	std::list< Planet* > planets;
 	
@@ -72,25 +95,40 @@ private:
 	
 	TileSet* tileset;
 	TileMap* tilemap;
+	PathFinder* pathfinder;
+	
+	Gravity* gravity;
+	SpatialGrid* grid;
 	
 	Timer gameover;
 	Timer newplanet;
 public:
+	const char* name() const;
+	int id() const;
+	
 	void load(MainArgs* args, StateArgs* st_args = 0);
 	StateArgs* unload();
 	
+	void suspend();
+	void resume();
+	
 	int input();
 	int update();
-	void render();
+	void snapshot(RenderSnapshot& snap) const;
 private:
+	void connect();
 	void handleQuit();
 	void handleKeyDown();
 	void addPlanet();
 	
 	void showFPS();
 	
+	void pull();
+	
 	void checkCollision();
 	void checkGameOver();
+	
+	void explode(const lalge::R2Vector& r);
 };
 
 class StateWinLose : public State
@@ -98,17 +136,94 @@ class StateWinLose : public State
 private:
 	Audio* bgm;
 public:
+	const char* name() const;
+	int id() const;
+	
 	void load(MainArgs* args, StateArgs* st_args = 0);
 	StateArgs* unload();
 	
+	void suspend();
+	void resume();
+	
 	int input();
 	int update();
-	void render();
+	void snapshot(RenderSnapshot& snap) const;
 private:
+	void connect();
 	void renderMenu(StateArgs* st_args);
 	
 	void handleQuit();
 	void handleKeyDown();
 };
 
+// runs the scenarios of a configuration file, each a number of frames of
+// spawned objects over a generated map, and prints how long the frames took
+class StateStress : public State
+{
+private:
+	struct Scenario
+	{
+		std::string name;
+		int planets;
+		int followers;
+		int ships;
+		int map_w;
+		int map_h;
+		int layers;
+		int density;
+		int frames;
+		int warmup;
+		unsigned int seed;
+	};
+	
+	std::vector< Scenario > scenarios;
+	unsigned int current;
+	
+	Sprite* spr_planet;
+	Sprite* spr_follower;
+	
+	Animation* anim_ship;
+	Animation* anim_shipturn;
+	
+	TileSet* tileset;
+	TileMap* tilemap;
+	PathFinder* pathfinder;
+	SpatialGrid* grid;
+	
+	std::vector< Planet* > planets;
+	std::vector< FollowerObject* > followers;
+	std::vector< AccObject* > ships;
+	std::vector< GameObject* > objects;
+	
+	// frames done in the current run, negative while warming up
+	int frame;
+	int tiles;
+	unsigned long int collisions;
+	
+	double last;
+	double update_ms;
+	double frame_ms;
+	double worst_ms;
+public:
+	const char* name() const;
+	int id() const;
+	
+	void load(MainArgs* args, StateArgs* st_args = 0);
+	StateArgs* unload();
+	
+	int input();
+	int update();
+	void snapshot(RenderSnapshot& snap) const;
+private:
+	void connect();
+	void handleQuit();
+	
+	void begin();
+	void end();
+	void report() const;
+	
+	void steer();
+	void checkCollision();
+};
+
 #endif
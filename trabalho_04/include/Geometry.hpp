@@ -63,6 +63,8 @@ public:
 	
 	void setRadius (const lalge::Scalar& radius);
 	
+	virtual lalge::Scalar extent () const;
+	
 	lalge::Scalar length () const;
 	lalge::Scalar area () const;
 	
@@ -0,0 +1,93 @@
+#ifndef GRAVITY_HPP
+#define GRAVITY_HPP
+
+#include <vector>
+
+#include "linearalgebra.hpp"
+
+// Barnes-Hut gravity: the bodies are put in a quadtree each step and each
+// body is pulled by the nodes far enough from it as if their mass were at
+// their center of mass, so a step costs O(n log n) instead of O(n^2). A
+// node is far enough when its side over its distance to the body is below
+// the opening angle; 0 makes every pull exact, around 1 is rough but fast.
+// The pulls are softened, so bodies passing through each other don't fly
+// away.
+class Gravity
+{
+public:
+	struct Stats
+	{
+		unsigned int nodes;
+		int depth;
+		unsigned long int interactions;
+	};
+private:
+	struct Node
+	{
+		// square cell
+		float x0, y0, side;
+		
+		// center of mass
+		float cx, cy, mass;
+		
+		// first of the four children, or -1 for a leaf
+		int child;
+		
+		// bodies of a leaf, linked through next
+		int body;
+		int count;
+	};
+	
+	std::vector< float > x, y, mass;
+	std::vector< float > ax, ay;
+	std::vector< int > next;
+	
+	std::vector< Node > nodes;
+	
+	float opening;
+	float constant;
+	float softening;
+	
+	Stats stats_;
+public:
+	Gravity(float theta = 0.5f, float g = 1, float softening = 1);
+	
+	void setTheta(float theta);
+	float theta() const;
+	
+	// removes every body
+	void clear();
+	
+	// returns the index of the body, which keeps it until the next clear
+	int add(const lalge::R2Vector& r, float mass);
+	int add(float x, float y, float mass);
+	
+	int size() const;
+	
+	// puts the bodies added since the last clear in a new tree
+	void build();
+	
+	// accelerations from the tree, of every body or of [beg, end), which
+	// may run in parallel once the tree is built; returns the pulls summed
+	void solve(bool parallel = false);
+	unsigned long int solve(int beg, int end);
+	
+	// exact accelerations, pulled by every other body
+	void brute(bool parallel = false);
+	unsigned long int brute(int beg, int end);
+	
+	lalge::R2Vector acceleration(int i) const;
+	float accelX(int i) const;
+	float accelY(int i) const;
+	
+	const Stats& stats() const;
+	void resetStats();
+private:
+	void insert(int body);
+	void split(int node);
+	void accumulate();
+	
+	void pull(float dx, float dy, float m, float& sx, float& sy) const;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef IMAGECACHE_HPP
+#define IMAGECACHE_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "SDLBase.hpp"
+
+// Directory of images already converted to the display format, one raw blob
+// per image, named after its path and the pixel format of the screen. A blob
+// is used while the image file keeps its modification time and size: it's
+// mapped into memory and its pixels become a surface as they are, without
+// decoding nor converting anything. The images that aren't in the cache can
+// be decoded in parallel ahead of the loads, which then just take them.
+class ImageCache
+{
+public:
+	struct Stats
+	{
+		unsigned int hits;
+		unsigned int misses;
+		unsigned int prefetched;
+		unsigned int written;
+	};
+private:
+	// surface over a mapped blob, held until nobody else uses it
+	struct Mapping
+	{
+		SDL_Surface* surface;
+		void* data;
+		size_t size;
+	};
+	
+	struct Ready
+	{
+		SDL_Surface* surface;
+		SDLBase::ImageInfo info;
+	};
+	
+	static std::string dir;
+	static std::vector< Mapping > mappings;
+	static std::map< std::string, Ready > ready;
+	static Stats stats_;
+	
+	static std::string blob(const std::string& filename);
+	static bool fresh(const std::string& filename);
+	static void collect();
+public:
+	// an empty directory turns off the blobs, but not the prefetching
+	static void init(const std::string& dir);
+	static void close();
+	
+	// decodes in parallel the images that aren't in the cache, converting
+	// and writing them to it, for the next loads of each one
+	static void prefetch(const std::vector< std::string >& filenames);
+	
+	// display formatted image, or NULL if it must be decoded. The color keys
+	// of the blobs come without RLE acceleration.
+	static SDL_Surface* load(const std::string& filename, SDLBase::ImageInfo& info);
+	
+	// writes the image to the cache, if it's on
+	static void save(const std::string& filename, SDL_Surface* surface, const SDLBase::ImageInfo& info);
+	
+	// removes every blob of the directory
+	static void clear();
+	
+	static const Stats& stats();
+	static void resetStats();
+};
+
+#endif
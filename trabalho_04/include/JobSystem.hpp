@@ -0,0 +1,109 @@
+#ifndef JOBSYSTEM_HPP
+#define JOBSYSTEM_HPP
+
+#include <deque>
+#include <vector>
+
+#include "SDL_thread.h"
+
+// Unit of work of the job system. A job runs only after every job it
+// depends on has finished, and must stay alive until it's waited for.
+class Job
+{
+private:
+	friend class JobSystem;
+	
+	// unfinished dependencies, plus one until the job is submitted
+	int pending;
+	bool done;
+	std::vector< Job* > successors;
+public:
+	Job();
+	virtual ~Job();
+	
+	virtual void run() = 0;
+};
+
+// Work-stealing scheduler: each worker thread has its own deque of ready
+// jobs, runs the newest of them first and, when it has nothing to do,
+// steals the oldest job of another worker. The thread that runs the game
+// (the main one, or the simulation thread when pipelined) is worker 0 and
+// runs jobs while it waits for them.
+class JobSystem
+{
+private:
+	struct Worker
+	{
+		SDL_Thread* thread;
+		Uint32 id;
+		SDL_mutex* lock;
+		std::deque< Job* > jobs;
+		double busy;
+		unsigned int executed;
+	};
+	
+	template <class F>
+	class RangeJob : public Job
+	{
+	private:
+		F* f;
+		int beg, end;
+	public:
+		RangeJob(F* f, int beg, int end) : f( f ), beg( beg ), end( end ) {}
+		
+		void run()
+		{
+			( *f )( beg, end );
+		}
+	};
+	
+	static std::vector< Worker* > workers;
+	static SDL_mutex* graph;
+	static SDL_cond* finished;
+	static SDL_sem* available;
+	static bool quit;
+	static double since;
+	
+	static int work(void* data);
+	static int self();
+	static void push(int worker, Job* job);
+	static Job* take(int worker);
+	static void execute(int worker, Job* job);
+	static double now();
+public:
+	static void init(int nworkers = -1);
+	static void close();
+	
+	static int size();
+	
+	static void depend(Job* job, Job* dependency);
+	static void submit(Job* job);
+	static void wait(Job* job);
+	
+	// calls f( beg, end ) for consecutive ranges of [0, n) of up to "grain"
+	// indexes, in parallel, returning when all of them are done
+	template <class F>
+	static void parallelFor(int n, int grain, F& f)
+	{
+		if( n <= 0 )
+			return;
+		if( grain < 1 )
+			grain = 1;
+		
+		std::vector< RangeJob< F > > jobs;
+		jobs.reserve( ( n + grain - 1 ) / grain );
+		for( int beg = 0; beg < n; beg += grain )
+			jobs.push_back( RangeJob< F >( &f, beg, ( beg + grain < n ) ? beg + grain : n ) );
+		
+		for( unsigned int i = 0; i < jobs.size(); i++ )
+			submit( &jobs[i] );
+		for( unsigned int i = 0; i < jobs.size(); i++ )
+			wait( &jobs[i] );
+	}
+	
+	static double utilization(int worker);
+	static unsigned int executed(int worker);
+	static void resetStats();
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef PARTICLESYSTEM_HPP
+#define PARTICLESYSTEM_HPP
+
+#include <string>
+#include <vector>
+
+#include "linearalgebra.hpp"
+#include "configfile.hpp"
+
+class Animation;
+class RenderSnapshot;
+
+// How a burst of particles is born and what they look like. The particles
+// play the whole sprite sheet once during their lifetime.
+struct Emitter
+{
+	std::string name;
+	
+	// sprite sheet, none for headless runs
+	std::string image;
+	int rows, cols;
+	
+	// particles per burst
+	int count;
+	
+	// seconds, pixels per second, degrees and pixels per second squared
+	float life, lifevar;
+	float speed, speedvar;
+	float spread;
+	float gravity;
+	
+	Animation* sheet;
+};
+
+// Particles stored as a structure of arrays, so the update runs on packed
+// floats, in a ring of fixed capacity: bursts are appended at the head, the
+// dead particles are dropped from the tail and, when the ring is full, the
+// oldest particles are overwritten by the new ones.
+class ParticleSystem
+{
+private:
+	std::vector< Emitter > emitters;
+	
+	std::vector< float > x, y;
+	std::vector< float > vx, vy;
+	std::vector< float > ax, ay;
+	std::vector< float > age, life;
+	
+	// frame index and frames per second of age
+	std::vector< float > frame, rate;
+	
+	std::vector< int > kind;
+	
+	int capacity;
+	int head, tail;
+	int used;
+	
+	unsigned int emitted_;
+	unsigned int overwritten_;
+	
+	// non-copyable
+	ParticleSystem(const ParticleSystem&);
+	ParticleSystem& operator=(const ParticleSystem&);
+public:
+	ParticleSystem(int capacity);
+	~ParticleSystem();
+	
+	// one emitter per sub-configuration, loading its sheet unless headless
+	void load(const Configuration& conf, bool headless = false);
+	int add(const Emitter& emitter);
+	
+	// index of the emitter, or -1
+	int find(const std::string& name) const;
+	
+	void emit(int emitter, const lalge::R2Vector& r);
+	
+	// seconds
+	void update(float dt);
+	
+	// the particles are drawn at their position minus the offset
+	void snapshot(RenderSnapshot& snap, const lalge::R2Vector& offset) const;
+	
+	// particles in the ring, alive or waiting for the tail
+	int size() const;
+	int alive() const;
+	
+	unsigned int emitted() const;
+	unsigned int overwritten() const;
+private:
+	void integrate(int beg, int end, float dt);
+	bool dead(int i) const;
+};
+
+#endif
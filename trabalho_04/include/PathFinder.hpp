@@ -0,0 +1,115 @@
+#ifndef PATHFINDER_HPP
+#define PATHFINDER_HPP
+
+#include <vector>
+
+#include "linearalgebra.hpp"
+#include "RingBuffer.hpp"
+#include "TileMap.hpp"
+
+// A* over a grid of tiles, moving in eight directions without cutting the
+// corners of blocked tiles, guided by the octile distance. With jumps on,
+// it's a jump point search: the straight and diagonal runs where the path
+// can't turn are skipped, and only the tiles where it may turn are opened.
+// The results of the last queries are kept until some tile changes.
+class PathFinder
+{
+public:
+	struct Stats
+	{
+		unsigned int queries;
+		unsigned int hits;
+		unsigned int failures;
+		unsigned long int expanded;
+	};
+private:
+	struct Node
+	{
+		float g;
+		int parent;
+		unsigned int visit;
+		bool closed;
+	};
+	
+	struct Entry
+	{
+		int from, to;
+		unsigned int used;
+		bool found;
+		std::vector< int > cells;
+	};
+	
+	// layer of the map with the obstacles, or none
+	TileMap* map;
+	int layer;
+	unsigned int revision;
+	
+	int w, h;
+	int tilew, tileh;
+	std::vector< char > blocked;
+	
+	// chunks of a streamed map already in blocked, and the chunks the map
+	// had loaded when they were looked for
+	std::vector< char > filled;
+	unsigned int arrivals;
+	
+	bool jumps;
+	
+	std::vector< Node > nodes;
+	unsigned int visit;
+	
+	// f and cell of the open nodes, as a heap
+	std::vector< std::pair< float, int > > open;
+	
+	std::vector< Entry > cache;
+	unsigned int clock;
+	
+	Stats stats_;
+public:
+	// every non-empty tile of the layer is an obstacle
+	PathFinder(TileMap* map, int layer, bool jumps = true);
+	PathFinder(int w, int h, int tilew, int tileh, bool jumps = true);
+	
+	void setBlocked(int i, int j, bool blocked);
+	
+	// the tiles out of the grid are blocked
+	bool isBlocked(int i, int j) const;
+	
+	void setJumps(bool jumps);
+	void clearCache();
+	
+	// cells ( i * width + j ) where the path from one cell to the other
+	// turns, both ends included
+	bool search(int from, int to, std::vector< int >& cells);
+	
+	// appends to the path the centers of the tiles where the way from one
+	// point to the other turns, ending at the target itself, all moved by
+	// the offset. Points out of the grid are joined by a straight line.
+	// Nothing is appended when there's no way or it doesn't fit in the path.
+	bool find(
+		const lalge::R2Vector& from,
+		const lalge::R2Vector& to,
+		RingBuffer< lalge::R2Vector >& path,
+		const lalge::R2Vector& offset = lalge::R2Vector()
+	);
+	
+	int width() const;
+	int height() const;
+	
+	const Stats& stats() const;
+	void resetStats();
+private:
+	void refresh();
+	void fill();
+	void reset();
+	bool passable(int i, int j) const;
+	
+	void expand(int cell, int goal);
+	void relax(int cell, int next, int goal);
+	int jump(int i, int j, int di, int dj, int goal) const;
+	
+	float distance(int a, int b) const;
+	void trace(int goal, std::vector< int >& cells) const;
+};
+
+#endif
@@ -29,7 +29,7 @@ public:
 	
 	virtual void update () = 0;
 	
-	virtual void render ();
+	virtual void snapshot (RenderSnapshot& snap) const;
 	
 	virtual GameObject* clone () const = 0;
 	
@@ -41,6 +41,9 @@ public:
 class RedPlanet : public Planet
 {
 public:
+	lalge::R2Vector v;
+	lalge::R2Vector a;
+	
 	RedPlanet (
 		const lalge::R2Vector& r = lalge::R2Vector (),
 		const lalge::Scalar& depthconst = 1,
@@ -58,6 +61,7 @@ class Earth : public Planet
 {
 public:
 	lalge::Scalar omega;
+	lalge::Scalar angle;
 	
 	Earth (
 		const lalge::R2Vector& r = lalge::R2Vector (),
@@ -69,7 +73,11 @@ public:
 	
 	virtual void update ();
 	
+	virtual void snapshot (RenderSnapshot& snap) const;
+	
 	virtual GameObject* clone () const;
+	
+	virtual lalge::Scalar extent () const;
 };
 
 class Moon : public Planet
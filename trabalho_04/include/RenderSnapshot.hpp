@@ -0,0 +1,135 @@
+#ifndef RENDERSNAPSHOT_HPP
+#define RENDERSNAPSHOT_HPP
+
+#include <vector>
+
+#include "linearalgebra.hpp"
+
+class Sprite;
+class Animation;
+class TileMap;
+class Audio;
+
+// Everything needed to draw one frame, recorded by the simulation and drawn
+// later by the main thread, the only one that may call SDL. The simulation
+// never touches the sprites, so the angles and the animation frames travel
+// in the snapshot and are applied to the sprites when it's presented. The
+// mixer is SDL too, so the sounds started in the step travel the same way.
+class RenderSnapshot
+{
+private:
+	enum
+	{
+		SPRITE,
+		LAYER,
+		LINE,
+		PARTICLES
+	};
+	
+	struct Item
+	{
+		int kind;
+		
+		Sprite* sprite;
+		Animation* animation;
+		TileMap* tilemap;
+		
+		// animation frame, tilemap layer or first particle
+		int index;
+		unsigned int count;
+		
+		bool centered;
+		bool rotozoomed;
+		
+		lalge::R2Vector r;
+		lalge::R2Vector end;
+		
+		float angle;
+		float zoomx;
+		float zoomy;
+		
+		int rgb;
+		unsigned int spacing;
+	};
+	
+	std::vector< Item > items;
+public:
+	struct Particle
+	{
+		float x, y;
+		int frame;
+	};
+private:
+	std::vector< Particle > particles;
+	
+	struct Cue
+	{
+		Audio* audio;
+		int n;
+	};
+	
+	std::vector< Cue > cues;
+public:
+	// camera position when the snapshot was taken
+	lalge::R2Vector camera;
+	
+	// time when the simulation step that recorded the snapshot began
+	unsigned int tick;
+	
+	// game time of that step, which picks the frames of the animated tiles
+	unsigned int clock;
+	
+	RenderSnapshot();
+	
+	void clear();
+	
+	// top left corner at ( x, y )
+	void drawSprite( Sprite* sprite, int x, int y );
+	
+	// centered at r, optionally rotated and zoomed
+	void drawSprite( Sprite* sprite, const lalge::R2Vector& r );
+	void drawSprite(
+		Sprite* sprite,
+		const lalge::R2Vector& r,
+		float angle,
+		float zoomx = 1, float zoomy = 1
+	);
+	
+	// a frame of the animation centered at r, optionally rotated
+	void drawFrame( Animation* animation, int frame, const lalge::R2Vector& r );
+	void drawFrame(
+		Animation* animation,
+		int frame,
+		const lalge::R2Vector& r,
+		float angle
+	);
+	
+	void drawLayer( TileMap* tilemap, int layer, float cameraX, float cameraY );
+	
+	void drawLine(
+		const lalge::R2Vector& beg,
+		const lalge::R2Vector& end,
+		int rgb,
+		unsigned int spacing = 0
+	);
+	
+	// n frames of the same sheet, each centered at its own position. The
+	// caller fills the returned particles before drawing anything else.
+	Particle* drawParticles( Animation* sheet, unsigned int n );
+	
+	// plays the sound n times, or forever if n is 0, when the snapshot is
+	// presented
+	void playAudio( Audio* audio, int n = 0 );
+	
+	// takes the sounds of a snapshot that will never be presented
+	void takeAudio( RenderSnapshot& dropped );
+	
+	// main thread only
+	void present();
+	
+	unsigned int size() const;
+private:
+	Item& push( int kind );
+};
+
+#endif
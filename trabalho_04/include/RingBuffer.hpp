@@ -0,0 +1,81 @@
+#ifndef RINGBUFFER_HPP
+#define RINGBUFFER_HPP
+
+#include <vector>
+
+// FIFO of fixed capacity over a single allocation. Elements are indexed from
+// the oldest one, so the whole buffer can be read in place; pushing to a
+// full buffer fails and leaves it unchanged.
+template <class T>
+class RingBuffer
+{
+private:
+	std::vector< T > data;
+	unsigned int head;
+	unsigned int count;
+public:
+	RingBuffer(unsigned int capacity) : data( capacity ), head( 0 ), count( 0 ) {}
+	
+	bool push(const T& value)
+	{
+		if( count == data.size() )
+			return false;
+		
+		data[ ( head + count ) % data.size() ] = value;
+		count++;
+		return true;
+	}
+	
+	void pop()
+	{
+		if( !count )
+			return;
+		
+		head = ( head + 1 ) % data.size();
+		count--;
+	}
+	
+	void clear()
+	{
+		head = 0;
+		count = 0;
+	}
+	
+	// i-th oldest element
+	const T& operator[](unsigned int i) const
+	{
+		return data[ ( head + i ) % data.size() ];
+	}
+	
+	const T& front() const
+	{
+		return data[ head ];
+	}
+	
+	const T& back() const
+	{
+		return ( *this )[ count - 1 ];
+	}
+	
+	unsigned int size() const
+	{
+		return count;
+	}
+	
+	unsigned int capacity() const
+	{
+		return data.size();
+	}
+	
+	bool empty() const
+	{
+		return ( !count );
+	}
+	
+	bool full() const
+	{
+		return ( count == data.size() );
+	}
+};
+
+#endif
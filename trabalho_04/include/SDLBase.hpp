@@ -11,27 +11,113 @@
 #define SDLBASE_HPP
 
 #include <string>
+#include <vector>
 
 #include "linearalgebra.hpp"
 
 #include "SDL.h"
 
+class Compositor;
+class Upscaler;
+
 /// Made to ease the use of SDL, this class encapsulates some of the features of
 /// this library.
 /// @brief Class to encapsulate some of SDL features
 class SDLBase
 {
+public:
+	/// @brief How the pixels of an image, or of a piece of it, cover what is
+	/// behind them
+	enum Opacity
+	{
+		/// @brief Every pixel is transparent
+		EMPTY,
+		
+		/// @brief Every pixel is opaque
+		OPAQUE,
+		
+		/// @brief Every pixel is either opaque or transparent
+		BINARY,
+		
+		/// @brief Some pixel is partially transparent
+		TRANSLUCENT
+	};
+	
+	/// @brief Record of an image loaded from disk
+	struct ImageInfo
+	{
+		/// @brief Path to the image file
+		std::string filename;
+		
+		int w, h;
+		
+		/// @brief Opacity of the whole image
+		Opacity opacity;
+		
+		/// @brief Amount of tiles of each opacity, when used as a tileset
+		int tiles[4];
+	};
+	
+	/// @brief Time spent showing the frames, in milliseconds
+	struct FrameStats
+	{
+		/// @brief Frames shown
+		unsigned int frames;
+		
+		/// @brief Rasterizing the draw list of the compositor
+		double draw;
+		
+		/// @brief Scaling the screen up to the window
+		double upscale;
+		
+		/// @brief Handing the window to SDL_Flip
+		double flip;
+	};
 private:
-	/// @brief Pointer to the main SDL surface: the screen
+	/// @brief Pointer to the main SDL surface: the screen, where the game is
+	/// drawn
 	static SDL_Surface* screen_;
 	
+	/// @brief Pointer to the surface of the video mode, the screen itself
+	/// unless the game is drawn smaller and scaled up
+	static SDL_Surface* window_;
+	
+	/// @brief Draw list of the screen, rasterized in parallel when the
+	/// screen is updated, or NULL to blit directly
+	static Compositor* compositor_;
+	
+	/// @brief Scaler of the screen to the window, or NULL if they're the
+	/// same
+	static Upscaler* upscaler_;
+	
+	static FrameStats frames_;
+	
 	/// @brief Delta-time of the last frame
 	static unsigned int dt_;
 	
+	/// @brief Fixed delta-time of every frame, or 0 for the real one
+	static unsigned int step_;
+	
+	/// @brief Sum of the delta-times of the frames so far
+	static unsigned int elapsed_;
+	
 	/// @brief Frames-per-second rate
 	static unsigned int fps;
+	
+	/// @brief Images loaded since the last call to clearImages
+	static std::vector< ImageInfo > images_;
 public:
-	static void initSDL(const std::string& confpath);
+	/// This method reads the configuration, sets the video mode and starts
+	/// the libraries. With a scale above 1 the window keeps the size of the
+	/// configuration and the game is drawn in a screen that many times
+	/// smaller.
+	/// @param confpath Path to the SDL configuration file.
+	/// @param scale Integer scale of the screen to the window, or 0 to take
+	/// the one of the configuration.
+	/// @throw mexception Thrown if SDL was already on, or if it was not
+	/// possible to start it.
+	/// @brief Starts SDL
+	static void initSDL(const std::string& confpath, int scale = 0);
 	
 	/// This method closes the entire library and frees the memory.
 	/// @throw mexception Thrown if the SDL system was already off.
@@ -43,8 +129,19 @@ public:
 	/// @brief Access method to screen
 	static SDL_Surface* screen();
 	
+	/// @return How many times the window is bigger than the screen.
+	/// @brief Access method to the scale
+	static int scale();
+	
+	/// This method maps a point of the window, like the mouse, to the
+	/// screen where the game is drawn.
+	/// @param x Position in x axis, replaced by the one in the screen.
+	/// @param y Position in y axis, replaced by the one in the screen.
+	/// @brief Maps a point of the window to the screen
+	static void windowToScreen(int& x, int& y);
+	
 	/// This method loads an image file from disk and returns its display
-	/// formatted surface.
+	/// formatted surface, taken from the image cache when it's there.
 	/// @param filename Path to the image file.
 	/// @return Surface with display formatted image.
 	/// @throw mexception Thrown if SDL wasn't initialized yet, or if it was
@@ -52,18 +149,86 @@ public:
 	/// @brief Load an image from disk
 	static SDL_Surface* loadIMG(const std::string& filename);
 	
-	/// This method paste the source image in the screen.
+	/// This method finds out whether the pixels of a surface are all
+	/// opaque, all transparent, only one or the other, or blended. Color
+	/// keyed pixels count as transparent.
+	/// @param surface Surface to be classified.
+	/// @param rect Piece of the surface to be classified, or NULL for the
+	/// whole surface.
+	/// @return Opacity of the pixels.
+	/// @brief Classifies the pixels of a surface
+	static Opacity classify(SDL_Surface* surface, SDL_Rect* rect = NULL);
+	
+	/// This method converts a surface to the cheapest display format that
+	/// can draw it: opaque surfaces lose their alpha channel, binary ones
+	/// get a color key instead of it (RLE accelerated when the screen isn't
+	/// drawn by the compositor) and only the translucent ones keep it.
+	/// @param surface Surface to be converted. It isn't modified.
+	/// @param opacity Opacity of the surface, as given by classify.
+	/// @return New surface in display format.
+	/// @throw mexception Thrown if the surface couldn't be converted.
+	/// @brief Converts a surface to display format
+	static SDL_Surface* displayFormat(SDL_Surface* surface, Opacity opacity);
+	
+	/// @return Images loaded since the last call to clearImages.
+	/// @brief Access method to the loaded images
+	static const std::vector< ImageInfo >& images();
+	
+	/// @brief Forgets the loaded images
+	static void clearImages();
+	
+	/// This method counts one more tile of some opacity in the last loaded
+	/// image with the given filename.
+	/// @param filename Path to the image file.
+	/// @param opacity Opacity of the tile.
+	/// @brief Records the opacity of a tile
+	static void noteTile(const std::string& filename, Opacity opacity);
+	
+	/// @return Name of the opacity.
+	/// @brief Converts an opacity to a string
+	static const char* opacityName(Opacity opacity);
+	
+	/// This method paste the source image in the screen. With the
+	/// compositor on, the blit is only recorded, and drawn when the screen
+	/// is updated.
 	/// @param src Image to be pasted in the screen.
 	/// @param srcrect Rectangle in the image that will be pasted in the
 	/// screen.
 	/// @param dstrect Source position in the screen.
+	/// @param premultiplied Whether the channels of the image were
+	/// multiplied by its alpha (see AlphaBlit::premultiply), which SDL
+	/// can't blend, so the image is drawn by AlphaBlit, with or without
+	/// the compositor, when it's in the display format.
 	/// @throw mexception Thrown if SDL wasn't initialized yet, or if it was
 	/// not possible to blit the surface.
 	/// @brief Blit a surface in the screen
 	static void renderSurface(
 		SDL_Surface* src,
 		SDL_Rect* srcrect = NULL,
-		SDL_Rect* dstrect = NULL
+		SDL_Rect* dstrect = NULL,
+		bool premultiplied = false
+	);
+	
+	/// This method samples the piece of the image through the operator
+	/// straight into the screen, without intermediate surfaces.
+	/// @param src Image to be pasted in the screen.
+	/// @param srcrect Piece of the image, turned around its center.
+	/// @param op Operator from the piece to the screen, like a rotation
+	/// times a scale.
+	/// @param x Position in x axis of the center of the piece in the
+	/// screen.
+	/// @param y Position in y axis of the center of the piece in the
+	/// screen.
+	/// @param smooth Whether the pixels are filtered or just the nearest.
+	/// @return False if it can't be drawn this way, without the compositor
+	/// or for an image it can't read, and the caller has to rotozoom it.
+	/// @brief Blit a transformed surface in the screen
+	static bool renderTransformed(
+		SDL_Surface* src,
+		const SDL_Rect& srcrect,
+		const lalge::R2LinearOp& op,
+		double x, double y,
+		bool smooth = true
 	);
 	
 	/// This method delays a frame to control frames-per-second rate, or
@@ -75,18 +240,38 @@ public:
 	/// @brief Access method to frame delta-time
 	static unsigned int dt();
 	
+	/// @return Milliseconds of game time so far, the sum of the
+	/// delta-times, which the animated tiles follow
+	/// @brief Access method to the game clock
+	static unsigned int elapsed();
+	
 	/// @return The real frames-per-second rate that's being reached
 	/// @brief Access method to frame delta-time
 	static float FPS();
 	
 	static void setFPS(unsigned int fps);
 	
-	/// This method shows in the screen what is the screen SDL surface.
+	/// This method makes every frame last the same time, without waiting
+	/// for it, so headless runs are repeatable and as fast as possible.
+	/// @param step Milliseconds of each frame, or 0 to go back to real
+	/// time.
+	/// @brief Fixes the delta-time of the frames
+	static void setStep(unsigned int step);
+	
+	/// This method shows in the screen what is the screen SDL surface,
+	/// scaled up to the window when it's smaller.
 	/// @throw mexception Thrown if SDL wasn't initialized yet, or if it was
 	/// not possible to update the screen.
 	/// @brief Shows the screen
 	static void updateScreen();
 	
+	/// @return Time spent showing the frames since the last reset.
+	/// @brief Access method to the frame statistics
+	static const FrameStats& frameStats();
+	
+	/// @brief Zeroes the frame statistics
+	static void resetFrameStats();
+	
 	static SDL_Surface* rotozoom(
 		SDL_Surface* src, float angle, float zoomx = 1, float zoomy = 1
 	);
@@ -0,0 +1,46 @@
+#ifndef SPATIALGRID_HPP
+#define SPATIALGRID_HPP
+
+#include <vector>
+
+// Boxes of the plane put in square cells of a uniform grid, so a query
+// only looks at the boxes of the cells it overlaps. The cells are hashed
+// into a fixed number of buckets, so the plane has no bounds; the boxes of
+// other cells that share a bucket are told apart by the exact test. Meant
+// to be cleared and filled again each frame.
+class SpatialGrid
+{
+private:
+	struct Entry
+	{
+		int id;
+		float x0, y0, x1, y1;
+	};
+	
+	float cell;
+	
+	std::vector< Entry > entries;
+	std::vector< std::vector< int > > buckets;
+	
+	// the query that last found each entry, so none is found twice
+	std::vector< unsigned int > seen;
+	unsigned int query_;
+	std::vector< int > found;
+public:
+	SpatialGrid(float cell = 256, int buckets = 1024);
+	
+	void clear();
+	
+	// box from ( x0, y0 ) to ( x1, y1 ), both included
+	void insert(int id, float x0, float y0, float x1, float y1);
+	
+	// ids of the boxes overlapping the given one, in the order they were
+	// inserted
+	void query(float x0, float y0, float x1, float y1, std::vector< int >& ids);
+	
+	int size() const;
+private:
+	int bucket(int i, int j) const;
+};
+
+#endif
@@ -11,6 +11,7 @@
 #define SPRITE_HPP
 
 #include "SDLBase.hpp"
+#include "Atlas.hpp"
 
 /// Class to hold SDL surfaces and rectangles and to render those surfaces in
 /// the screen.
@@ -21,8 +22,16 @@ protected:
 	/// @brief Pointer to the SDL surface
 	SDL_Surface* src;
 private:
+	/// @brief Rotated and zoomed copy of the clipped surface, made only when
+	/// the screen can't be drawn straight from the surface
 	SDL_Surface* rotozoomed;
+	
+	bool transformed;
 protected:
+	/// @brief Piece of the surface with the image, the whole surface unless
+	/// it's shared with other sprites in an atlas
+	SDL_Rect region_;
+	
 	/// @brief Clipping SDL rectangle
 	SDL_Rect srcrect_;
 private:
@@ -40,6 +49,11 @@ public:
 	/// @brief Loading constructor
 	Sprite (const std::string& filename);
 	
+	/// This method calls load_ to share the page of an atlas.
+	/// @param region Piece of the atlas with the image.
+	/// @brief Sharing constructor
+	Sprite (const Atlas::Region& region);
+	
 	/// This method calls unload to free the SDL surface.
 	/// @brief Unloading constructor
 	virtual ~Sprite ();
@@ -48,6 +62,11 @@ public:
 	/// @param filename Path to the image file.
 	/// @brief Load an image
 	void load (const std::string& filename);
+	
+	/// This method calls unload and then load_.
+	/// @param region Piece of an atlas with the image.
+	/// @brief Share an image of an atlas
+	void load (const Atlas::Region& region);
 private:
 	/// This method takes the surface from SDLBase method and sets the
 	/// rectangle to take the whole image.
@@ -56,14 +75,20 @@ private:
 	/// @brief Load an image
 	void load_ (const std::string& filename);
 	
+	/// This method keeps a reference to the atlas page and sets the
+	/// rectangle to take the piece with the image.
+	/// @param region Piece of an atlas with the image.
+	/// @brief Share an image of an atlas
+	void load_ (const Atlas::Region& region);
+	
 	/// This method frees the memory used by the surface and set its pointer
 	/// to NULL.
 	/// @brief Frees the memory used by the surface
 	void unload ();
 public:
-	/// This method sets the rectangle to take a piece of the surface.
-	/// @param x Position in x axis of the surface.
-	/// @param y Position in y axis of the surface.
+	/// This method sets the rectangle to take a piece of the image.
+	/// @param x Position in x axis of the image.
+	/// @param y Position in y axis of the image.
 	/// @param w Rectangle width.
 	/// @param h Rectangle height.
 	/// @brief Clip the surface with the rectangle
@@ -77,6 +102,14 @@ public:
 	
 	int srcH () const;
 	
+	/// @return Pointer to the whole surface, ignoring the rectangle.
+	/// @brief Access method to the surface
+	SDL_Surface* surface () const;
+	
+	/// @return A reference to the piece of the surface with the image.
+	/// @brief Access method to the image region
+	const SDL_Rect& region () const;
+	
 	/// @return A reference to the surface width.
 	/// @brief Access method to the surface width
 	int rectW () const;
@@ -95,6 +128,14 @@ public:
 	
 	virtual void update ();
 	
+	/// This method only keeps the angle and the zooms, the surface is
+	/// transformed when it's rendered.
+	/// @param angle Degrees, counterclockwise.
+	/// @param zoomx Scale in x axis.
+	/// @param zoomy Scale in y axis.
+	/// @param force Whether the rotated copy is made again even if nothing
+	/// changed.
+	/// @brief Rotate and zoom the clipped surface
 	void rotozoom (
 		float angle,
 		float zoomx = 1, float zoomy = 1,
@@ -102,6 +143,7 @@ public:
 	);
 private:
 	void rotozoom ();
+	void discard ();
 public:
 	void restore ();
 	
@@ -3,23 +3,48 @@
 
 #include "simplestructures.hpp"
 
-class StateArgs {};
+#include "Arena.hpp"
+#include "RenderSnapshot.hpp"
+
+class StateArgs
+{
+public:
+	virtual ~StateArgs();
+};
 
 class State
 {
 protected:
 	MainArgs* args;
 	int newstate;
+	
+	// storage for everything that lives as long as the state is loaded
+	Arena arena;
 public:
 	State();
 	virtual ~State();
 	
+	virtual const char* name() const = 0;
+	virtual int id() const = 0;
+	
 	virtual void load(MainArgs* args, StateArgs* st_args = 0) = 0;
 	virtual StateArgs* unload() = 0;
 	
+	// a suspended state keeps its resources and its world, but gets no
+	// input and its timers stop until it's resumed
+	virtual void suspend();
+	virtual void resume();
+	
 	virtual int input() = 0;
 	virtual int update() = 0;
-	virtual void render() = 0;
+	
+	// records the frame to be drawn; it may run away from the main thread,
+	// so it must not call SDL
+	virtual void snapshot(RenderSnapshot& snap) const = 0;
+	
+	void release();
+	
+	const Arena& memory() const;
 };
 
 #endif
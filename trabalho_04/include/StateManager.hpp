@@ -1,9 +1,14 @@
 #ifndef STATEMANAGER_HPP
 #define STATEMANAGER_HPP
 
+#include <vector>
+
+#include "SDL_thread.h"
+
 #include "simplestructures.hpp"
 
 #include "State.hpp"
+#include "RenderSnapshot.hpp"
 
 class StateManager
 {
@@ -11,6 +16,29 @@ private:
 	MainArgs args;
 	bool quit;
 	State* state;
+	
+	// states suspended below the current one, the oldest first
+	std::vector< State* > suspended;
+	
+	// the simulation fills one snapshot while the main thread draws another,
+	// and the last complete one waits in the middle
+	RenderSnapshot snapshots[ 3 ];
+	int building, ready, presenting;
+	bool fresh;
+	
+	// "-pipeline" runs the simulation on its own thread
+	SDL_Thread* simulation;
+	SDL_mutex* world;
+	SDL_mutex* mailbox;
+	SDL_cond* published;
+	bool simulating;
+	int pending;
+	
+	// from the start of a simulation step until its frame is on the screen
+	unsigned int presented;
+	unsigned int dropped;
+	double latency;
+	unsigned int maxlatency;
 public:
 	StateManager(const MainArgs& args);
 	~StateManager();
@@ -19,16 +47,30 @@ private:
 	void initState();
 	
 	void closeState();
+	StateArgs* unloadState(State* which);
+	void releaseState(State* which);
 	void closeThirdParty();
 public:
 	void run();
 private:
+	void runPipelined();
+	
 	void input();
 	void update();
-	void render();
+	void render(unsigned int tick);
+	
+	void startSimulation();
+	static int simulationThread(void* data);
+	void simulate();
+	void publish();
+	
+	void present(RenderSnapshot& snap);
 	
-	template <typename newstate_t> void changeState_();
+	State* createState(int id);
 	void changeState(int newstate);
+	void pushState(int id);
+	void popState();
+	void replaceState(int id);
 };
 
 #endif
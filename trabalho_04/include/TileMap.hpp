@@ -3,6 +3,8 @@
 
 #include "TileSet.hpp"
 
+class ChunkStream;
+
 class TileMap
 {
 private:
@@ -14,17 +16,83 @@ public:
 private:
 	Layer** data;
 	
+	/// @brief Chunks of a map too big to be read at once, or NULL
+	ChunkStream* stream;
+	
 	int map_layers;
+	
+	unsigned int revision_;
 public:
 	TileMap (TileSet* tileset = NULL, const std::string& map_path = "");
 	~TileMap ();
 private:
 	void clear ();
+	void renderChunks (int layer, float cameraX, float cameraY);
 public:
+	/// A text map is read at once, a chunked one (see ChunkStream) is
+	/// read as its chunks are needed.
 	void load (const std::string& map_path);
 	void reload ();
 	
-	int& at (int layer, int i, int j);
+	/// Writes the map as chunks of side x side tiles.
+	void save (const std::string& path, int side = 32);
+	
+	/// Asks for the chunks over the screen and the ones where the camera
+	/// is going, for a chunked map, and takes the ones already loaded.
+	/// @param cameraX Position of the camera, as given to render.
+	/// @param cameraY Position of the camera, as given to render.
+	/// @param vx Velocity of the camera, in pixels per second.
+	/// @param vy Velocity of the camera, in pixels per second.
+	void prefetch (float cameraX, float cameraY, float vx, float vy);
+	
+	/// @return Whether the map is read as its chunks are needed.
+	bool streamed () const;
+	
+	/// @return Side of the chunks of a streamed map, or 0.
+	int chunkSide () const;
+	
+	/// Copies the tiles of a chunk of a streamed map, row by row, if the
+	/// chunk is loaded; it never waits for the disk.
+	/// @return Whether the chunk was loaded.
+	bool peekChunk (int layer, int ci, int cj, std::vector< int >& tiles);
+	
+	/// @return Chunks of a streamed map loaded so far.
+	unsigned int chunkArrivals () const;
+	
+	/// Replaces the map by empty layers of the given size.
+	void resize (int layers, int w, int h);
+	
+	/// Tile of the map, read and written as an int, so a layer that's
+	/// mostly empty can keep only the spans of tiles that aren't. Writing
+	/// such a layer encodes the row again, and may turn the whole layer
+	/// back into plain tiles once it's no longer mostly empty.
+	class TileRef
+	{
+	private:
+		Layer* layer;
+		int i;
+		int j;
+		
+		/// @brief The tile itself, when it's kept as it is
+		int* tile;
+	public:
+		TileRef (Layer* layer, int i, int j, int* tile);
+		
+		operator int () const;
+		TileRef& operator= (int tile);
+		TileRef& operator= (const TileRef& other);
+	};
+	
+	/// A chunked map is read from the disk here when the chunk isn't in
+	/// the cache, and the changes are lost when the chunk is dropped.
+	TileRef at (int layer, int i, int j);
+	
+	/// Changes a tile and, unlike a write through at, makes a new revision.
+	void set (int layer, int i, int j, int tile);
+	unsigned int revision () const;
+	
+	/// Picks the frames of the animated tiles for the given game time.
+	void tick (unsigned int time);
 	
 	void render (float cameraX, float cameraY);
 	void renderLayer (int layer, float cameraX, float cameraY);
@@ -32,6 +100,9 @@ public:
 	int width (int layer) const;
 	int height (int layer) const;
 	int layers () const;
+	
+	/// @return Memory taken by the tiles of a map read at once.
+	unsigned long bytes () const;
 };
 
 #endif
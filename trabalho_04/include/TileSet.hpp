@@ -5,6 +5,8 @@
 
 #include "Sprite.hpp"
 
+#include "configfile.hpp"
+
 class TileSet
 {
 private:
@@ -15,11 +17,36 @@ private:
 	
 	Sprite* tileset;
 	
+	// copies of the tileset without alpha channel and with a color key, for
+	// the tiles that don't need it
+	SDL_Surface* opaque;
+	SDL_Surface* keyed;
+	
+	std::vector< SDLBase::Opacity > opacity;
+	
 	std::vector< Sprite* >* tiles;
 	
 	SDL_Rect* dstrect;
 	
 	bool using_single_file;
+	
+	/// @brief Frames shown in turn by an animated tile
+	struct Animated
+	{
+		int tile;
+		std::vector< int > frames;
+		unsigned int duration;
+	};
+	
+	std::vector< Animated > animations;
+	
+	/// @brief Tile drawn for each tile of the map in this frame, and
+	/// whether it's not the one drawn in the frame before
+	std::vector< int > remap;
+	std::vector< bool > changed_;
+	
+	/// @brief Game time of the frames in the remap
+	unsigned int time_;
 public:
 	TileSet (const std::string& filename, int tile_w, int tile_h);
 	TileSet (int rows, int cols, const std::string& filename);
@@ -27,13 +54,39 @@ public:
 	~TileSet ();
 	
 	void addTile (const std::string& filename);
-	
+	void addTile (const Atlas::Region& region);
+private:
+	void classify (const std::string& filename);
+public:	
 	void render (int index, float posX, float posY);
 	
+	/// Makes a tile show the given ones in turn, each for duration
+	/// milliseconds, instead of itself.
+	void animate (int tile, const std::vector< int >& frames, unsigned int duration);
+	
+	/// Reads the animated tiles, one sub-configuration each, with the tile,
+	/// the frames (separated by spaces) and the duration of each frame.
+	void load (const Configuration& conf);
+	
+	/// Picks the frame of every animated tile, once per game time, so the
+	/// tiles of a map are drawn through a table instead of each keeping its
+	/// own animation.
+	/// @return Whether any animated tile shows another frame now.
+	bool tick (unsigned int time);
+	
+	bool animated (int tile) const;
+	
+	/// @return Whether the tile shows another frame since the tick before,
+	/// so a cache of drawn tiles only has to redraw the ones with it.
+	bool changed (int tile) const;
+	
 	bool usingSingleFile () const;
 	
 	int tileW () const;
 	int tileH () const;
+	
+	/// @return Amount of tiles.
+	int size () const;
 };
 
 #endif
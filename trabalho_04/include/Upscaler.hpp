@@ -0,0 +1,48 @@
+#ifndef UPSCALER_HPP
+#define UPSCALER_HPP
+
+#include "SDL.h"
+
+// Presents a small surface, where the game is drawn, on a bigger one with
+// the same pixel format, each pixel becoming a square of factor x factor
+// pixels, centered. Each row of the source is widened once and copied to
+// the other rows of its square, and the rows are split among the workers of
+// the job system.
+class Upscaler
+{
+private:
+	class Rows
+	{
+	private:
+		const Upscaler* upscaler;
+	public:
+		Rows(const Upscaler* upscaler);
+		
+		void operator()(int beg, int end) const;
+	};
+	
+	SDL_Surface* src;
+	SDL_Surface* dst;
+	int factor_;
+	
+	// where the scaled image starts in the target
+	int x0;
+	int y0;
+public:
+	Upscaler(SDL_Surface* src, SDL_Surface* dst, int factor);
+	
+	// draws the source onto the target, on the workers of the job system or
+	// only on the calling thread
+	void flush(bool parallel = true);
+	
+	// from the pixels of the target to the ones of the source, clamped to
+	// the source, for the mouse
+	int mapX(int x) const;
+	int mapY(int y) const;
+	
+	int factor() const;
+private:
+	void widen(int beg, int end) const;
+};
+
+#endif
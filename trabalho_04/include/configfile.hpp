@@ -15,12 +15,17 @@
 #include <list>
 #include <fstream>
 
+/// Interned variable name, shared by every configuration instance.
+/// @brief Interned variable name
+class ConfigKey;
+
 /// Strong class with a system to manage and access configuration variables
 /// for the client application, with the capacity of loading files and parsing
 /// its words to generate those variables.
 /// @brief Strong class to manage configuration variables
 class Configuration
 {
+	friend class Parser;
 public:
 	// =====================================================================
 	// Configuration Exceptions
@@ -47,21 +52,26 @@ private:
 	class Variable
 	{
 	private:
-		/// @brief Variable's name
-		std::string name_;
+		/// @brief Variable's interned name
+		const ConfigKey* key_;
 		
 		/// @brief Variable's value
 		T value_;
 	public:
 		/// Constructor assigning both the name and the value.
-		/// @param name Variable's name.
+		/// @param key Variable's interned name.
 		/// @param value Variable's value.
 		/// @brief Constructor
-		Variable (const std::string& name, const T& value);
+		Variable (const ConfigKey* key, const T& value);
 		
 		/// @brief Empty destructor
 		~Variable ();
 		
+		/// Returns the variable's interned name.
+		/// @return Variable's interned name.
+		/// @brief Access method to variable's interned name
+		const ConfigKey* key () const;
+		
 		/// Returns the variable's name.
 		/// @return Variable's name.
 		/// @brief Access method to variable's name
@@ -78,6 +88,142 @@ private:
 		void set (const T& value);
 	};
 	
+	// =====================================================================
+	// Configuration Class Member (Value)
+	// =====================================================================
+	
+	/// Value of a data variable: the non-parsed string, plus the values
+	/// parsed from it, each one cached on its first access. Conversions
+	/// that fail are cached too, so they aren't tried again.
+	/// @brief Data variable's value
+	class Value
+	{
+	private:
+		/// @brief Conversions already tried
+		enum
+		{
+			STR = 1,
+			REAL = 2,
+			INT = 4,
+			CHAR = 8
+		};
+		
+		/// @brief Non-parsed value
+		std::string raw_;
+		
+		/// @brief Conversions already tried and succeeded (bit masks)
+		mutable unsigned char tried_, valid_;
+		
+		/// @brief Cached parsed string
+		mutable std::string str_;
+		
+		/// @brief Cached real number
+		mutable long double real_;
+		
+		/// @brief Cached integer number
+		mutable long int int_;
+		
+		/// @brief Cached character
+		mutable char char_;
+	public:
+		/// @brief Constructor from the non-parsed value
+		Value (const std::string& raw);
+		
+		/// @brief Access method to the non-parsed value
+		const std::string& raw () const;
+		
+		/// @return The parsed string.
+		/// @throw mexception If the value isn't a valid string.
+		/// @see parseOutStr
+		/// @brief Access method to the string value
+		const std::string& str () const;
+		
+		/// @return The real number, or NULL if the value isn't one.
+		/// @see parseOutReal
+		/// @brief Access method to the real number value
+		const long double* real () const;
+		
+		/// @return The integer number, or NULL if the value isn't one.
+		/// @see parseOutInt
+		/// @brief Access method to the integer number value
+		const long int* integer () const;
+		
+		/// @return The character, or NULL if the value isn't one.
+		/// @see parseOutChar
+		/// @brief Access method to the character value
+		const char* character () const;
+	};
+	
+	// =====================================================================
+	// Configuration Class Member (Table)
+	// =====================================================================
+	
+	/// Set of variables of the same type, stored in insertion order, with a
+	/// hash index over the interned names for constant time lookups and a
+	/// lazily sorted side index for prefix queries and ordered iteration.
+	/// @tparam T Variables' type.
+	/// @brief Indexed set of configuration variables
+	template <class T>
+	class Table
+	{
+	private:
+		/// @brief Variables in insertion order
+		std::vector< Variable< T > > vars_;
+		
+		/// @brief Open addressing hash index (positions in vars_, or -1)
+		std::vector< long int > slots_;
+		
+		/// @brief Positions in vars_ sorted by name
+		mutable std::vector< size_t > order_;
+		
+		/// @brief Whether order_ is up to date
+		mutable bool ordered_;
+		
+		/// @brief Rebuilds the hash index with "size" slots
+		void rehash (size_t size);
+		
+		/// @brief Puts the variable at "pos" in the hash index
+		void place (size_t pos);
+	public:
+		/// @brief Empty constructor
+		Table ();
+		
+		/// Searches a variable by its interned name.
+		/// @param key Interned name, or NULL for names never interned.
+		/// @return The position of the variable, or -1 if it's not present.
+		/// @brief Searches a variable
+		long int find (const ConfigKey* key) const;
+		
+		/// @brief Appends a new variable, which must not be present yet
+		void insert (const ConfigKey* key, const T& value);
+		
+		/// @brief Erases the variable at "pos"
+		void erase (size_t pos);
+		
+		/// @brief Erases all variables
+		void clear ();
+		
+		/// @brief Amount of variables
+		size_t size () const;
+		
+		/// @brief Access method to the variable at "pos"
+		Variable< T >& operator[] (size_t pos);
+		
+		/// @brief Access method to the variable at "pos"
+		const Variable< T >& operator[] (size_t pos) const;
+		
+		/// @return Positions of the variables sorted by name.
+		/// @brief Access method to the ordered side index
+		const std::vector< size_t >& order () const;
+		
+		/// Finds the variables whose names start with "prefix".
+		/// @param prefix Prefix of the names.
+		/// @param beg Storage for the first matching index in order ().
+		/// @param end Storage for one past the last matching index.
+		/// @brief Range query over the ordered side index
+		void range (const std::string& prefix, size_t& beg, size_t& end) const;
+	};
+	
 	// =====================================================================
 	// Configuration Class Members (Specialized variables)
 	// =====================================================================
@@ -89,22 +235,80 @@ private:
 	
 	/// Class for configuration variables of "primitive" types.
 	/// @see Variable
+	/// @see Value
 	/// @brief Class for "primitive" types
-	typedef Variable< std::string > DataVariable;
+	typedef Variable< Value > DataVariable;
 	
 	// =====================================================================
 	// Configuration Attributes
 	// =====================================================================
 	
-	/// Set of all configuration variables.
+	/// Tables of all configuration and data variables, shared by the
+	/// copies of a configuration instance and only copied when one of them
+	/// is modified (copy-on-write), so nested configurations are copied in
+	/// constant time.
 	/// @see ConfigVariable
-	/// @brief Vector of configuration variables
-	std::vector< ConfigVariable > cvars;
+	/// @see DataVariable
+	/// @brief Shared, reference counted variables
+	class Node;
 	
-	/// Set of all configuration variables.
-	/// @see ConfigVariable
-	/// @brief Vector of configuration variables
-	std::vector< DataVariable > vars;
+	/// @brief Variables of the configuration instance
+	Node* node_;
+	
+	/// @brief Amount of bytes copied by copy-on-write so far
+	static unsigned long int copied_;
+	
+	/// @brief Whether text files are read by the stream parser
+	static bool streamed_;
+	
+	/// Makes the variables exclusive to this configuration instance,
+	/// copying them if they are shared, before some modification.
+	/// @return The exclusive variables.
+	/// @brief Detaches the shared variables
+	Node* mutate ();
+public:
+	// =====================================================================
+	// Configuration Iterator
+	// =====================================================================
+	
+	/// Iterates, in alphabetical order, over the variables of a
+	/// configuration instance whose names start with some prefix, without
+	/// copying any of them. It's invalidated by any modification of the
+	/// configuration instance.
+	/// @brief Iterator over prefix matches
+	class Iterator
+	{
+	private:
+		friend class Configuration;
+		
+		/// @brief Configuration instance being iterated
+		const Configuration* conf_;
+		
+		/// @brief Whether configuration type variables are iterated
+		bool sub_;
+		
+		/// @brief Current and end indexes in the ordered side index
+		size_t pos_, end_;
+		
+		/// @brief Constructor used by Configuration
+		Iterator (const Configuration* conf, bool sub, size_t beg, size_t end);
+	public:
+		/// @return Whether the iterator points to some variable.
+		/// @brief Checks the end of the iteration
+		bool valid () const;
+		
+		/// @brief Goes to the next matching variable
+		void next ();
+		
+		/// @return Name of the current variable.
+		/// @brief Access method to the current variable's name
+		const std::string& name () const;
+		
+		/// @return Value of the current configuration type variable.
+		/// @throw VarNotFound If iterating over data variables.
+		/// @brief Access method to the current configuration
+		const Configuration& config () const;
+	};
 public:
 	// =====================================================================
 	// Configuration Methods
@@ -113,8 +317,35 @@ public:
 	/// @brief Empty constructor
 	Configuration ();
 	
-	/// @brief Empty destructor
+	/// Copy constructor, sharing the variables until one of the instances
+	/// is modified.
+	/// @brief Copy constructor, in constant time
+	Configuration (const Configuration& param);
+	
+	/// @brief Releases the shared variables
 	~Configuration ();
+	
+	/// @brief Assignment, in constant time
+	Configuration& operator= (const Configuration& param);
+	
+	/// Exchanges the variables of two configuration instances, without
+	/// copying or sharing anything.
+	/// @param param The other configuration instance.
+	/// @brief Swaps two configuration instances
+	void swap (Configuration& param);
+	
+	/// Returns the amount of bytes copied when shared variables were
+	/// detached for modification, since the program started.
+	/// @return Amount of bytes copied by copy-on-write.
+	/// @brief Copy-on-write statistics
+	static unsigned long int copiedBytes ();
+	
+	/// Makes readTxt read the text files a character at a time from the
+	/// stream, as it did before scanning them in memory. Only meant to
+	/// compare both in the benchmarks.
+	/// @param streamed Whether the stream parser is used.
+	/// @brief Chooses the text file parser
+	static void streamedParsing (bool streamed);
 public:
 	/// Method to load a configuration text file into the configuration
 	/// instance, calling the parser's method.
@@ -189,19 +420,7 @@ public:
 	/// @return The amount of variables in the configuration instance.
 	/// @brief Returns the number of all existing variables
 	size_t size () const;
-private:
-	/// Makes a binary search for any variable, named with the "name"
-	/// parameter, assigning the position to the storage pointed by "mid"
-	/// parameter, returning code of success.
-	/// @param mid Storage which will hold the returned position.
-	/// @param vec Reference to the std::vector in which the var. will be sought.
-	/// @param name String with the variable's name.
-	/// @throw VarNotFound If the variable is not present in the
-	/// configuration instance.
-	/// @brief Searches a variable in the configuration instance
-	template <class T>
-	void find (long int& mid, const std::vector< T >& vec, const std::string& name) const;
-public:
+	
 	/// Method to insert a new variable of configuration type in the
 	/// configuration instance, checking the validity of the name with the
 	/// parser's method.
@@ -273,12 +492,27 @@ public:
 	/// @return The value of the required configuration type variable.
 	/// @brief Access method to a configuration type variable
 	Configuration getConfig (const std::string& name) const;
+	
+	/// Returns a reference to a configuration of some existing variable in
+	/// the configuration instance, without copying it. The reference is
+	/// invalidated by any modification of the configuration instance.
+	/// @param name String with the variable's name.
+	/// @return The value of the required configuration type variable.
+	/// @throw VarNotFound If the variable is not present.
+	/// @brief Access method to a configuration type variable, without copy
+	const Configuration& getConfigRef (const std::string& name) const;
 private:
-	/// Returns the "true" (non-parsed) value of an existing variable.
+	/// Returns the value of an existing data variable.
+	/// @param name String with the variable's name.
+	/// @return Variable's value, with its cached conversions.
+	/// @throw VarNotFound If the variable is not present.
+	/// @brief Returns a data variable's value
+	const Value& get (const std::string& name) const;
+	
 	/// @param name String with the variable's name.
-	/// @return Non-parsed variable's value.
-	/// @brief Returns non-parsed variable value
-	const std::string& get (const std::string& name) const;
+	/// @return Variable's value, or NULL if it's not present.
+	/// @brief Returns a data variable's value, without throwing
+	const Value* find (const std::string& name) const;
 public:
 	/// Returns a std::string value of some existing variable in the
 	/// configuration instance using the std::string source and the parser's
@@ -319,6 +553,26 @@ public:
 	/// @see parseOutChar
 	/// @brief Access method to a character variable
 	char getChar (const std::string& name) const;
+	
+	/// Returns a std::string value of some variable, or a default value if
+	/// the variable is not present or is not a valid string. Never throws.
+	/// @param name String with the variable's name.
+	/// @param def Default value.
+	/// @return The value of the variable, or "def".
+	/// @brief Access method to a std::string variable, with default
+	std::string getStr (const std::string& name, const std::string& def) const;
+	
+	/// @see getStr
+	/// @brief Access method to a real number variable, with default
+	long double getReal (const std::string& name, long double def) const;
+	
+	/// @see getStr
+	/// @brief Access method to an integer number variable, with default
+	long int getInt (const std::string& name, long int def) const;
+	
+	/// @see getStr
+	/// @brief Access method to a character variable, with default
+	char getChar (const std::string& name, char def) const;
 private:
 	template <class var_type>
 	class getvar
@@ -331,7 +585,7 @@ private:
 	std::list< var_type > getList (
 		const std::string& name,
 		typename getvar< var_type >::type access_method,
-		const std::vector< vec_type >& vec
+		const Table< vec_type >& vec
 	) const;
 public:
 	std::list< Configuration > getConfigList (const std::string& name) const;
@@ -341,6 +595,20 @@ public:
 	std::list< long int > getIntList (const std::string& name) const;
 	std::list< char > getCharList (const std::string& name) const;
 	
+	/// Iterates over the configuration type variables whose names start
+	/// with "prefix", in alphabetical order.
+	/// @param prefix Prefix of the names (empty for all variables).
+	/// @return Iterator to the first match.
+	/// @brief Prefix query over the configuration type variables
+	Iterator beginConfigs (const std::string& prefix = "") const;
+	
+	/// Iterates over the data variables whose names start with "prefix",
+	/// in alphabetical order.
+	/// @param prefix Prefix of the names (empty for all variables).
+	/// @return Iterator to the first match.
+	/// @brief Prefix query over the data variables
+	Iterator beginVars (const std::string& prefix = "") const;
+	
 	/// Sets the value with "val" parameter of config. type variable named
 	/// with "name" parameter.
 	/// @param name String with the variable's name.
@@ -391,4 +659,139 @@ public:
 	void erase (const std::string& name);
 };
 
+// =============================================================================
+// Configuration Binding
+// =============================================================================
+
+/// Binds the data variables of a configuration to the members of a plain
+/// settings struct, so the whole struct is filled in one pass, each member
+/// with its default value if its variable is not present or is not
+/// convertible. Never throws, so the bindings can be loaded from any
+/// configuration, even an empty one.
+/// @tparam S Settings struct.
+/// @brief Binding of configuration variables to struct members
+template <class S>
+class ConfigBinding
+{
+private:
+	/// @brief Binding of one member
+	class Field
+	{
+	public:
+		/// @brief Variable's name
+		std::string name;
+		
+		Field (const std::string& name) : name ( name ) {}
+		virtual ~Field () {}
+		
+		/// @brief Assigns the member of "dest" with the variable's value
+		virtual void load (const Configuration& conf, S& dest) const = 0;
+	};
+	
+	/// @tparam M Member's type.
+	/// @brief Binding of a member of some type
+	template <class M>
+	class Member : public Field
+	{
+	private:
+		M S::* member_;
+		M def_;
+	public:
+		Member (const std::string& name, M S::* member, const M& def) :
+		Field ( name ), member_ ( member ), def_ ( def ) {}
+		
+		void load (const Configuration& conf, S& dest) const
+		{
+			read ( conf, this->name, def_, dest.*member_ );
+		}
+	};
+	
+	/// @brief Bound members, in binding order
+	std::vector< Field* > fields_;
+	
+	/// @name Conversions to each supported member type
+	/// @{
+	static void read (const Configuration& conf, const std::string& name, const std::string& def, std::string& dest)
+	{
+		dest = conf.getStr ( name, def );
+	}
+	static void read (const Configuration& conf, const std::string& name, const long double& def, long double& dest)
+	{
+		dest = conf.getReal ( name, def );
+	}
+	static void read (const Configuration& conf, const std::string& name, const double& def, double& dest)
+	{
+		dest = conf.getReal ( name, def );
+	}
+	static void read (const Configuration& conf, const std::string& name, const float& def, float& dest)
+	{
+		dest = conf.getReal ( name, def );
+	}
+	static void read (const Configuration& conf, const std::string& name, const long int& def, long int& dest)
+	{
+		dest = conf.getInt ( name, def );
+	}
+	static void read (const Configuration& conf, const std::string& name, const int& def, int& dest)
+	{
+		dest = conf.getInt ( name, def );
+	}
+	static void read (const Configuration& conf, const std::string& name, const unsigned int& def, unsigned int& dest)
+	{
+		dest = conf.getInt ( name, def );
+	}
+	static void read (const Configuration& conf, const std::string& name, const short& def, short& dest)
+	{
+		dest = conf.getInt ( name, def );
+	}
+	static void read (const Configuration& conf, const std::string& name, const unsigned short& def, unsigned short& dest)
+	{
+		dest = conf.getInt ( name, def );
+	}
+	static void read (const Configuration& conf, const std::string& name, const bool& def, bool& dest)
+	{
+		dest = conf.getInt ( name, def );
+	}
+	static void read (const Configuration& conf, const std::string& name, const char& def, char& dest)
+	{
+		dest = conf.getChar ( name, def );
+	}
+	/// @}
+	
+	ConfigBinding (const ConfigBinding&);
+	ConfigBinding& operator= (const ConfigBinding&);
+public:
+	/// @brief Empty constructor
+	ConfigBinding () {}
+	
+	/// @brief Destructor
+	~ConfigBinding ()
+	{
+		for ( size_t i = 0; i < fields_.size (); i++ )
+			delete fields_[i];
+	}
+	
+	/// Binds a data variable to a member.
+	/// @param name String with the variable's name.
+	/// @param member Pointer to the member.
+	/// @param def Member's default value.
+	/// @return The binding itself, so calls can be chained.
+	/// @brief Binds a data variable to a member
+	template <class M, class D>
+	ConfigBinding& bind (const std::string& name, M S::* member, const D& def)
+	{
+		fields_.push_back ( new Member< M > ( name, member, M ( def ) ) );
+		return *this;
+	}
+	
+	/// Fills all the bound members of "dest".
+	/// @param conf Configuration with the variables.
+	/// @param dest Struct to be filled.
+	/// @brief Fills a settings struct
+	void load (const Configuration& conf, S& dest) const
+	{
+		for ( size_t i = 0; i < fields_.size (); i++ )
+			fields_[i]->load ( conf, dest );
+	}
+};
+
 #endif
@@ -0,0 +1,162 @@
+/// @ingroup MOD_CONFIGFILE
+/// @file configview.hpp
+/// @brief Read-only view of memory mapped binary configuration files
+/// @author Matheus Pimenta
+
+#ifndef CONFIGVIEW_HPP
+#define CONFIGVIEW_HPP
+
+#include <string>
+
+#include "configfile.hpp"
+
+/// Read-only configuration queried directly from a memory mapped binary
+/// file, with no parsing or copying when the file is opened: every node of
+/// the file has a hash table over its variables' names, and data variables
+/// are stored already unescaped and, when possible, already converted to
+/// integer, real and character values.
+/// Views of nested configurations share the mapping of the file, which is
+/// unmapped when the last view is destroyed.
+/// @brief Read-only view of a binary configuration file
+class ConfigView
+{
+public:
+	/// @brief Exception for files with unknown format or version
+	class InvalidFormat {};
+	
+	/// @brief Current version of the binary layout
+	static const unsigned int VERSION = 1;
+private:
+	/// @brief Mapped (or read) file, shared by all the views of it
+	struct Mapping;
+	
+	/// @brief Entry of a node's table
+	struct Entry;
+	
+	/// @brief Builder of binary files
+	class Writer;
+	
+	/// @brief Shared file
+	Mapping* map_;
+	
+	/// @brief Offset of the current node in the file
+	unsigned int node_;
+	
+	/// Searches a variable in the current node.
+	/// @param name String with the variable's name.
+	/// @param config Whether a configuration type variable is sought.
+	/// @return The variable's entry, or NULL.
+	/// @brief Searches a variable
+	const Entry* find (const std::string& name, bool config) const;
+	
+	/// @brief Same as find, throwing Configuration::VarNotFound
+	const Entry* get (const std::string& name, bool config) const;
+	
+	/// @brief Pointer to some offset of the file
+	const char* at (unsigned int offset) const;
+	
+	/// Checks the nodes reachable from the root of a file whose header
+	/// was already checked.
+	/// @param data Contents of the file.
+	/// @param size Size of the file.
+	/// @return Whether every node, entry and string offset is inside the
+	/// file.
+	/// @brief Checks the offsets of a file
+	static bool valid (const char* data, size_t size);
+public:
+	/// @brief Empty view
+	ConfigView ();
+	
+	/// Opens a binary configuration file.
+	/// @param filename Path to the file.
+	/// @throw Configuration::FileNotFound If it was not possible to open it.
+	/// @throw InvalidFormat If the file has a different format or version.
+	/// @brief Opening constructor
+	ConfigView (const std::string& filename);
+	
+	/// Opens a binary configuration file, or its text version.
+	/// @param binfile Path to the binary file.
+	/// @param txtfile Path to the text file.
+	/// @see open
+	/// @brief Opening constructor with a fallback
+	ConfigView (const std::string& binfile, const std::string& txtfile);
+	
+	/// @brief Copy constructor, sharing the mapping
+	ConfigView (const ConfigView& param);
+	
+	/// @brief Unmaps the file, if it's the last view of it
+	~ConfigView ();
+	
+	/// @brief Assignment, sharing the mapping
+	ConfigView& operator= (const ConfigView& param);
+	
+	/// Opens a binary configuration file, closing the current one.
+	/// @param filename Path to the file.
+	/// @throw Configuration::FileNotFound If it was not possible to open it.
+	/// @throw InvalidFormat If the file has a different format or version.
+	/// @brief Opens a binary configuration file
+	void open (const std::string& filename);
+	
+	/// Opens a binary configuration file, closing the current one. If it's
+	/// missing, truncated or corrupted, the text file is parsed and laid out
+	/// in memory instead.
+	/// @param binfile Path to the binary file.
+	/// @param txtfile Path to the text file.
+	/// @throw Configuration::FileNotFound If neither file could be opened.
+	/// @brief Opens a binary configuration file or its text version
+	void open (const std::string& binfile, const std::string& txtfile);
+	
+	/// @brief Closes the view
+	void close ();
+	
+	/// @return The amount of variables in the current node.
+	/// @brief Returns the number of all existing variables
+	size_t size () const;
+	
+	/// @brief Checks if a configuration type variable exists
+	bool hasConfig (const std::string& name) const;
+	
+	/// @brief Checks if a data variable exists
+	bool has (const std::string& name) const;
+	
+	/// @param name String with the variable's name.
+	/// @return View of the nested configuration, sharing the mapping.
+	/// @throw Configuration::VarNotFound If the variable isn't present.
+	/// @brief Access method to a configuration type variable
+	ConfigView getConfig (const std::string& name) const;
+	
+	/// @param name String with the variable's name.
+	/// @return Null terminated string, pointing into the mapped file.
+	/// @throw Configuration::VarNotFound If the variable isn't present.
+	/// @brief Access method to a string variable, without copy
+	const char* getCStr (const std::string& name) const;
+	
+	/// @brief Access method to a string variable
+	std::string getStr (const std::string& name) const;
+	
+	/// @throw mexception If the value isn't a real number.
+	/// @brief Access method to a real number variable
+	long double getReal (const std::string& name) const;
+	
+	/// @throw mexception If the value isn't an integer number.
+	/// @brief Access method to an integer number variable
+	long int getInt (const std::string& name) const;
+	
+	/// @throw mexception If the value isn't a character.
+	/// @brief Access method to a character variable
+	char getChar (const std::string& name) const;
+	
+	/// Writes a configuration in the binary layout read by ConfigView.
+	/// @param src Configuration to be written.
+	/// @param filename Path to the binary file.
+	/// @brief Writes a binary configuration file
+	static void write (const Configuration& src, const std::string& filename);
+	
+	/// Converts a text configuration file to the binary layout.
+	/// @param txtfile Path to the text file.
+	/// @param binfile Path to the binary file.
+	/// @brief Converts a text configuration file
+	static void convert (const std::string& txtfile, const std::string& binfile);
+};
+
+#endif
@@ -212,17 +212,17 @@ public:
 				std::list< Observer* >::iterator it;
 				bool found = false;
 				
-				for (
-					it = observers[i].begin ();
-					( it != observers[i].end () ) && ( !found );
-					++it
-				)
+				it = observers[i].begin ();
+				while ( ( it != observers[i].end () ) && ( !found ) )
 				{
 					if ( ( (ObserverDerived< obs_type >*) (*it) )->observer == observer )
 					{
 						found = true;
-						observers[i].erase ( it );
+						delete *it;
+						it = observers[i].erase ( it );
 					}
+					else
+						++it;
 				}
 			}
 		}
@@ -236,17 +236,17 @@ public:
 			std::list< Observer* >::iterator it;
 			bool found = false;
 			
-			for (
-				it = observers[ event_type ].begin ();
-				( it != observers[ event_type ].end () ) && ( !found );
-				++it
-			)
+			it = observers[ event_type ].begin ();
+			while ( ( it != observers[ event_type ].end () ) && ( !found ) )
 			{
 				if ( ( (ObserverDerived< obs_type >*) (*it) )->observer == observer )
 				{
 					found = true;
-					observers[ event_type ].erase ( it );
+					delete *it;
+					it = observers[ event_type ].erase ( it );
 				}
+				else
+					++it;
 			}
 		}
 	}
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "AccObject.hpp"
 
 #include "InputManager.hpp"
@@ -7,6 +9,7 @@
 #define OMEGA		180
 #define AIR_RESISTANCE	0.3
 #define STRONG_FRICTION	2.0
+#define SQRT2	1.41421356
 
 using namespace lalge;
 
@@ -17,9 +20,20 @@ AccObject::AccObject (
 	Animation* turn,
 	int hp
 ) :
-Circle ( r, depthconst, animation->rectW () / 2 ),
-animation ( animation ), turn ( turn ), switch_time ( 0 ), hp ( hp ),
-omega ( 0 ), acceleration ( 0 )
+Circle ( r, depthconst, animation->frameW () / 2 ),
+animation ( animation ), turn ( turn ),
+frame ( animation->getFrame () ), angle ( 0 ), switch_time ( 0 ), hp ( hp ),
+omega ( 0 ), acceleration ( 0 ), camera ( true )
+{
+	connect ();
+}
+
+AccObject::~AccObject ()
+{
+	InputManager::instance ()->disconnect ( this );
+}
+
+void AccObject::connect ()
 {
 	InputManager::instance ()->connect (
 		InputManager::KEYDOWN,
@@ -33,57 +47,58 @@ omega ( 0 ), acceleration ( 0 )
 	);
 }
 
-AccObject::~AccObject ()
+void AccObject::disconnect ()
 {
 	InputManager::instance ()->disconnect ( this );
+	
+	// the keys released meanwhile won't be seen, so none is held anymore
+	acceleration = 0;
+	omega = 0;
+	animation->setFrameSize ( 2000 );
 }
 
 void AccObject::update ()
 {
 	Scalar dt = ( (Scalar) SDLBase::dt () ) / 1000;
 	
-	animation->update ();
-	animation->rotozoom ( animation->angle () + omega * dt );
+	frame = animation->advance ( frame );
+	angle += omega * dt;
 	
 	try {
 		a = rotate (
-			- ( animation->angle () + omega * dt ),
+			- ( angle + omega * dt ),
 			r2vec ( 0, acceleration )
 		);
 		a += ( -v * ( omega ? STRONG_FRICTION : AIR_RESISTANCE ) );
 	} catch (RotationNotDefined& e) {
 		a = ( -v * ( omega ? STRONG_FRICTION : AIR_RESISTANCE ) );
 	}
+	a += gravity;
 	r += ( ( v * dt ) + ( a * ( dt * dt / 2 ) ) );
 	v += ( a * dt );
 	
-	Camera::r = (
-		r -
-		( r2vec ( SDLBase::screen ()->w, SDLBase::screen ()->h ) / 2 )
-	) / depthconst;
+	if ( camera )
+	{
+		Camera::r = (
+			r -
+			( r2vec ( SDLBase::screen ()->w, SDLBase::screen ()->h ) / 2 )
+		) / depthconst;
+	}
 }
 
-void AccObject::render ()
+void AccObject::snapshot (RenderSnapshot& snap) const
 {
+	R2Vector pos = r - snap.camera * depthconst;
+	
 	if ( ( omega ) || ( SDL_GetTicks () < switch_time ) )
 	{
 		if ( SDL_GetTicks () >= switch_time )
-			turn->setFrame ( side ? 0 : 3 );
+			snap.drawFrame ( turn, side ? 0 : 3, pos, angle );
 		else
-			turn->setFrame ( side ? 1 : 2 );
-		turn->rotozoom ( animation->angle () );
-		turn->render (
-			r.x ( 0 ) - animation->rectW () / 2 - Camera::r.x ( 0 ) * depthconst,
-			r.x ( 1 ) - animation->rectH () / 2 - Camera::r.x ( 1 ) * depthconst
-		);
+			snap.drawFrame ( turn, side ? 1 : 2, pos, angle );
 	}
 	else
-	{
-		animation->render (
-			r.x ( 0 ) - animation->rectW () / 2 - Camera::r.x ( 0 ) * depthconst,
-			r.x ( 1 ) - animation->rectH () / 2 - Camera::r.x ( 1 ) * depthconst
-		);
-	}
+		snap.drawFrame ( animation, int ( frame ), pos, angle );
 }
 
 GameObject* AccObject::clone () const
@@ -91,11 +106,17 @@ GameObject* AccObject::clone () const
 	return new AccObject ( *this );
 }
 
+Scalar AccObject::extent () const
+{
+	// the frames are turned by any angle
+	return ( std::max ( animation->frameW (), animation->frameH () ) * SQRT2 / 2 );
+}
+
 void AccObject::setAnimation (Animation* animation)
 {
 	this->animation = animation;
 	
-	setRadius ( animation->rectW () / 2 );
+	setRadius ( animation->frameW () / 2 );
 }
 
 void AccObject::handleKeyDown ()
@@ -142,6 +163,28 @@ void AccObject::handleKeyUp ()
 	}
 }
 
+void AccObject::steer (bool thrust, int turn)
+{
+	acceleration = ( thrust ? -ACCELERATION : 0 );
+	
+	if ( omega != turn * OMEGA )
+	{
+		omega = 0;
+		if ( turn )
+			setSide ( turn * OMEGA );
+	}
+}
+
+void AccObject::setCamera (bool camera)
+{
+	this->camera = camera;
+}
+
+const R2Vector& AccObject::velocity () const
+{
+	return v;
+}
+
 void AccObject::setSide (Scalar omega_value)
 {
 	if ( omega )
@@ -0,0 +1,356 @@
+#include "AlphaBlit.hpp"
+
+// the vector kernels are built for their own instruction set, whatever the
+// flags of the rest of the game, and only run where the CPU has it
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define ALPHABLIT_X86
+#include <immintrin.h>
+#endif
+
+#define ALPHABLIT_OPAQUE	0xFF000000u
+#define ALPHABLIT_RGB	0x00FFFFFFu
+
+namespace
+{
+	// floor( p / 255 ) for 0 <= p <= 255 * 255
+	inline int div255(int p)
+	{
+		return ( ( p + 1 + ( p >> 8 ) ) >> 8 );
+	}
+	
+	// the arithmetic of the blitters SDL picks for this format, which
+	// shift instead of dividing by 255: floor( ( s - d ) * a / 256 ) + d.
+	// The bias keeps the shift away from negative numbers.
+	inline Uint32 mix(Uint32 s, Uint32 d, int a)
+	{
+		Uint32 out = d & ALPHABLIT_OPAQUE;
+		
+		for( int shift = 0; shift < 24; shift += 8 )
+		{
+			int sc = ( s >> shift ) & 0xFF, dc = ( d >> shift ) & 0xFF;
+			int c = ( ( ( sc - dc ) * a + 0x10000 ) >> 8 ) - 0x100 + dc;
+			out |= Uint32( c ) << shift;
+		}
+		
+		return out;
+	}
+	
+	// s + floor( d * ( 255 - a ) / 255 ), which SDL has nothing like
+	inline Uint32 over(Uint32 s, Uint32 d, int a)
+	{
+		Uint32 out = d & ALPHABLIT_OPAQUE;
+		
+		for( int shift = 0; shift < 24; shift += 8 )
+		{
+			int sc = ( s >> shift ) & 0xFF, dc = ( d >> shift ) & 0xFF;
+			out |= Uint32( sc + div255( dc * ( 255 - a ) ) ) << shift;
+		}
+		
+		return out;
+	}
+	
+	// the opaque pixels are copied, since the shift would leave them a
+	// little short of the source; the top byte of the target is kept
+	template < bool premultiplied >
+	void rowScalar(const Uint32* src, Uint32* dst, int w)
+	{
+		for( int i = 0; i < w; i++ )
+		{
+			int a = src[i] >> 24;
+			
+			if( a == SDL_ALPHA_OPAQUE )
+				dst[i] = ( src[i] & ALPHABLIT_RGB ) | ( dst[i] & ALPHABLIT_OPAQUE );
+			else if( ( a ) && ( premultiplied ) )
+				dst[i] = over( src[i], dst[i], a );
+			else if( a )
+				dst[i] = mix( src[i], dst[i], a );
+		}
+	}
+
+#ifdef ALPHABLIT_X86
+	// two pixels widened to 16 bits per channel, and the alpha of each
+	// pixel spread over its channels
+	#define SPREAD( v ) _mm_shufflehi_epi16( _mm_shufflelo_epi16( v, 0xFF ), 0xFF )
+	#define SPREAD256( v ) _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( v, 0xFF ), 0xFF )
+	
+	// ( s - d ) * a doesn't fit in 16 bits, but its low half shifted and
+	// added to d wraps to the same byte as the floor does
+	__attribute__(( target( "sse2" ) ))
+	inline __m128i mixSSE2(__m128i s, __m128i d, __m128i a)
+	{
+		__m128i q = _mm_srli_epi16( _mm_mullo_epi16( _mm_sub_epi16( s, d ), a ), 8 );
+		
+		return _mm_and_si128( _mm_add_epi16( d, q ), _mm_set1_epi16( 0xFF ) );
+	}
+	
+	// d * ( 255 - a ) fits in 16 bits without sign, and so does div255
+	__attribute__(( target( "sse2" ) ))
+	inline __m128i overSSE2(__m128i s, __m128i d, __m128i a)
+	{
+		__m128i p = _mm_mullo_epi16( d, _mm_sub_epi16( _mm_set1_epi16( 255 ), a ) );
+		__m128i q = _mm_srli_epi16(
+			_mm_add_epi16( _mm_add_epi16( p, _mm_set1_epi16( 1 ) ), _mm_srli_epi16( p, 8 ) ), 8
+		);
+		
+		return _mm_add_epi16( s, q );
+	}
+	
+	template < bool premultiplied >
+	__attribute__(( target( "sse2" ) ))
+	void rowSSE2(const Uint32* src, Uint32* dst, int w)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i opaque = _mm_set1_epi32( ALPHABLIT_OPAQUE );
+		const __m128i rgb = _mm_set1_epi32( ALPHABLIT_RGB );
+		
+		int i = 0;
+		for( ; i + 4 <= w; i += 4 )
+		{
+			__m128i s = _mm_loadu_si128( (const __m128i*) ( src + i ) );
+			__m128i alpha = _mm_and_si128( s, opaque );
+			__m128i clear = _mm_cmpeq_epi32( alpha, zero );
+			__m128i solid = _mm_cmpeq_epi32( alpha, opaque );
+			
+			if( _mm_movemask_epi8( clear ) == 0xFFFF )
+				continue;
+			
+			__m128i d = _mm_loadu_si128( (const __m128i*) ( dst + i ) );
+			__m128i out;
+			
+			if( _mm_movemask_epi8( solid ) == 0xFFFF )
+				out = s;
+			else
+			{
+				__m128i slo = _mm_unpacklo_epi8( s, zero ), shi = _mm_unpackhi_epi8( s, zero );
+				__m128i dlo = _mm_unpacklo_epi8( d, zero ), dhi = _mm_unpackhi_epi8( d, zero );
+				__m128i lo, hi;
+				
+				if( premultiplied )
+				{
+					lo = overSSE2( slo, dlo, SPREAD( slo ) );
+					hi = overSSE2( shi, dhi, SPREAD( shi ) );
+				}
+				else
+				{
+					lo = mixSSE2( slo, dlo, SPREAD( slo ) );
+					hi = mixSSE2( shi, dhi, SPREAD( shi ) );
+				}
+				
+				// the opaque pixels are copied and the clear ones are left
+				// as they were
+				out = _mm_packus_epi16( lo, hi );
+				out = _mm_or_si128( _mm_and_si128( solid, s ), _mm_andnot_si128( solid, out ) );
+				out = _mm_or_si128( _mm_and_si128( clear, d ), _mm_andnot_si128( clear, out ) );
+			}
+			
+			out = _mm_or_si128( _mm_and_si128( out, rgb ), _mm_and_si128( d, opaque ) );
+			_mm_storeu_si128( (__m128i*) ( dst + i ), out );
+		}
+		
+		rowScalar< premultiplied >( src + i, dst + i, w - i );
+	}
+	
+	__attribute__(( target( "avx2" ) ))
+	inline __m256i mixAVX2(__m256i s, __m256i d, __m256i a)
+	{
+		__m256i q = _mm256_srli_epi16( _mm256_mullo_epi16( _mm256_sub_epi16( s, d ), a ), 8 );
+		
+		return _mm256_and_si256( _mm256_add_epi16( d, q ), _mm256_set1_epi16( 0xFF ) );
+	}
+	
+	__attribute__(( target( "avx2" ) ))
+	inline __m256i overAVX2(__m256i s, __m256i d, __m256i a)
+	{
+		__m256i p = _mm256_mullo_epi16( d, _mm256_sub_epi16( _mm256_set1_epi16( 255 ), a ) );
+		__m256i q = _mm256_srli_epi16(
+			_mm256_add_epi16( _mm256_add_epi16( p, _mm256_set1_epi16( 1 ) ), _mm256_srli_epi16( p, 8 ) ), 8
+		);
+		
+		return _mm256_add_epi16( s, q );
+	}
+	
+	// the same as rowSSE2, on 8 pixels; the unpacks work within each half
+	// of the register, which is all a pixel needs
+	template < bool premultiplied >
+	__attribute__(( target( "avx2" ) ))
+	void rowAVX2(const Uint32* src, Uint32* dst, int w)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i opaque = _mm256_set1_epi32( ALPHABLIT_OPAQUE );
+		const __m256i rgb = _mm256_set1_epi32( ALPHABLIT_RGB );
+		
+		int i = 0;
+		for( ; i + 8 <= w; i += 8 )
+		{
+			__m256i s = _mm256_loadu_si256( (const __m256i*) ( src + i ) );
+			__m256i alpha = _mm256_and_si256( s, opaque );
+			__m256i clear = _mm256_cmpeq_epi32( alpha, zero );
+			__m256i solid = _mm256_cmpeq_epi32( alpha, opaque );
+			
+			if( _mm256_movemask_epi8( clear ) == -1 )
+				continue;
+			
+			__m256i d = _mm256_loadu_si256( (const __m256i*) ( dst + i ) );
+			__m256i out;
+			
+			if( _mm256_movemask_epi8( solid ) == -1 )
+				out = s;
+			else
+			{
+				__m256i slo = _mm256_unpacklo_epi8( s, zero ), shi = _mm256_unpackhi_epi8( s, zero );
+				__m256i dlo = _mm256_unpacklo_epi8( d, zero ), dhi = _mm256_unpackhi_epi8( d, zero );
+				__m256i lo, hi;
+				
+				if( premultiplied )
+				{
+					lo = overAVX2( slo, dlo, SPREAD256( slo ) );
+					hi = overAVX2( shi, dhi, SPREAD256( shi ) );
+				}
+				else
+				{
+					lo = mixAVX2( slo, dlo, SPREAD256( slo ) );
+					hi = mixAVX2( shi, dhi, SPREAD256( shi ) );
+				}
+				
+				out = _mm256_packus_epi16( lo, hi );
+				out = _mm256_or_si256( _mm256_and_si256( solid, s ), _mm256_andnot_si256( solid, out ) );
+				out = _mm256_or_si256( _mm256_and_si256( clear, d ), _mm256_andnot_si256( clear, out ) );
+			}
+			
+			out = _mm256_or_si256( _mm256_and_si256( out, rgb ), _mm256_and_si256( d, opaque ) );
+			_mm256_storeu_si256( (__m256i*) ( dst + i ), out );
+		}
+		
+		rowSSE2< premultiplied >( src + i, dst + i, w - i );
+	}
+#endif
+
+	const AlphaBlit::Row straights[ AlphaBlit::KERNELS ] = {
+		rowScalar< false >,
+#ifdef ALPHABLIT_X86
+		rowSSE2< false >,
+		rowAVX2< false >
+#else
+		rowScalar< false >,
+		rowScalar< false >
+#endif
+	};
+	
+	const AlphaBlit::Row premultiplieds[ AlphaBlit::KERNELS ] = {
+		rowScalar< true >,
+#ifdef ALPHABLIT_X86
+		rowSSE2< true >,
+		rowAVX2< true >
+#else
+		rowScalar< true >,
+		rowScalar< true >
+#endif
+	};
+}
+
+AlphaBlit::Kernel AlphaBlit::kernel_ = AlphaBlit::best();
+AlphaBlit::Row AlphaBlit::straight_ = straights[ AlphaBlit::kernel_ ];
+AlphaBlit::Row AlphaBlit::premultiplied_ = premultiplieds[ AlphaBlit::kernel_ ];
+
+AlphaBlit::Kernel AlphaBlit::best()
+{
+	// before main, so the CPU isn't known yet
+#ifdef ALPHABLIT_X86
+	__builtin_cpu_init();
+#endif
+
+	if( supported( AVX2 ) )
+		return AVX2;
+	if( supported( SSE2 ) )
+		return SSE2;
+	return SCALAR;
+}
+
+bool AlphaBlit::supported(Kernel kernel)
+{
+	switch( kernel )
+	{
+	case SCALAR:
+		return true;
+
+#ifdef ALPHABLIT_X86
+	case SSE2:
+		return __builtin_cpu_supports( "sse2" );
+	
+	case AVX2:
+		return __builtin_cpu_supports( "avx2" );
+#endif
+
+	default:
+		return false;
+	}
+}
+
+bool AlphaBlit::fits(const SDL_PixelFormat* src, const SDL_PixelFormat* dst)
+{
+	return (
+		( src->BytesPerPixel == 4 ) && ( dst->BytesPerPixel == 4 ) &&
+		( src->Amask == ALPHABLIT_OPAQUE ) && ( !dst->Amask ) &&
+		( src->Rmask == dst->Rmask ) && ( src->Gmask == dst->Gmask ) &&
+		( src->Bmask == dst->Bmask ) &&
+		( ( src->Rmask | src->Gmask | src->Bmask ) == ALPHABLIT_RGB )
+	);
+}
+
+void AlphaBlit::blend(const Uint32* src, Uint32* dst, int w)
+{
+	straight_( src, dst, w );
+}
+
+void AlphaBlit::blendPremultiplied(const Uint32* src, Uint32* dst, int w)
+{
+	premultiplied_( src, dst, w );
+}
+
+void AlphaBlit::premultiply(SDL_Surface* surface)
+{
+	if( SDL_MUSTLOCK( surface ) )
+		SDL_LockSurface( surface );
+	
+	for( int y = 0; y < surface->h; y++ )
+	{
+		Uint32* row = (Uint32*) ( (Uint8*) surface->pixels + y * surface->pitch );
+		
+		for( int x = 0; x < surface->w; x++ )
+		{
+			int a = row[x] >> 24;
+			Uint32 out = row[x] & ALPHABLIT_OPAQUE;
+			
+			for( int shift = 0; shift < 24; shift += 8 )
+				out |= Uint32( div255( ( ( row[x] >> shift ) & 0xFF ) * a ) ) << shift;
+			row[x] = out;
+		}
+	}
+	
+	if( SDL_MUSTLOCK( surface ) )
+		SDL_UnlockSurface( surface );
+}
+
+AlphaBlit::Kernel AlphaBlit::kernel()
+{
+	return kernel_;
+}
+
+const char* AlphaBlit::name(Kernel kernel)
+{
+	static const char* names[ KERNELS ] = { "scalar", "sse2", "avx2" };
+	
+	return ( ( kernel >= 0 ) && ( kernel < KERNELS ) ) ? names[ kernel ] : "?";
+}
+
+bool AlphaBlit::use(Kernel kernel)
+{
+	if( !supported( kernel ) )
+		return false;
+	
+	kernel_ = kernel;
+	straight_ = straights[ kernel ];
+	premultiplied_ = premultiplieds[ kernel ];
+	
+	return true;
+}
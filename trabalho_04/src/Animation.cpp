@@ -16,8 +16,28 @@ Animation::Animation (
 {
 	load ( filename );
 	
+	init_ ( frame, framesize );
+}
+
+Animation::Animation (
+	const Atlas::Region& region,
+	int frame,
+	int framesize,
+	int rows,
+	int cols,
+	bool matrix,
+	int line
+) : rows ( rows ), cols ( cols ), matrix ( matrix ), line ( line )
+{
+	load ( region );
+	
+	init_ ( frame, framesize );
+}
+
+void Animation::init_ (int frame, int framesize)
+{
 	if ( ( matrix ) && ( frame >= cols ) )
-		frame = 0;
+		this->frame = 0;
 	else
 		this->frame = float ( frame );
 	setFrameSize ( framesize );
@@ -26,25 +46,52 @@ Animation::Animation (
 }
 
 void Animation::update ()
+{
+	frame = advance ( frame );
+	
+	update_ ();
+}
+
+float Animation::advance (float frame) const
 {
 	float dt = float ( SDLBase::dt () ) / 1000;
 	
-	frame = ( ( frame + fps * dt ) - float (
+	return ( ( frame + fps * dt ) - float (
 		( int ( frame + fps * dt ) / frameAmount() ) * frameAmount()
 	) );
+}
+
+void Animation::renderFrame (int frame, int x, int y)
+{
+	SDL_Rect srcrect = frameRect ( frame );
+	SDL_Rect dstrect;
 	
-	update_ ();
+	srcrect.x += region_.x;
+	srcrect.y += region_.y;
+	
+	dstrect.x = x;
+	dstrect.y = y;
+	
+	SDLBase::renderSurface ( src, &srcrect, &dstrect );
 }
 
 void Animation::update_ ()
 {
-	clip (
-		( int ( frame ) % cols ) * ( src->w / cols ),
-		(	( ( !matrix ) * ( int ( frame ) / cols ) + matrix * line ) *
-			( src->h / rows )	),
-		( src->w / cols ),
-		( src->h / rows )
-	);
+	SDL_Rect rect = frameRect ( int ( frame ) );
+	
+	clip ( rect.x, rect.y, rect.w, rect.h );
+}
+
+SDL_Rect Animation::frameRect (int frame) const
+{
+	SDL_Rect rect;
+	
+	rect.x = ( frame % cols ) * frameW ();
+	rect.y = ( ( !matrix ) * ( frame / cols ) + matrix * line ) * frameH ();
+	rect.w = frameW ();
+	rect.h = frameH ();
+	
+	return rect;
 }
 
 int Animation::frameAmount () const
@@ -62,6 +109,16 @@ int Animation::getFrameSize () const
 	return int ( 1000.0f / fps );
 }
 
+int Animation::frameW () const
+{
+	return ( srcW () / cols );
+}
+
+int Animation::frameH () const
+{
+	return ( srcH () / rows );
+}
+
 void Animation::setFrame (int frame)
 {
 	if( ( !matrix ) || ( frame < cols ) )
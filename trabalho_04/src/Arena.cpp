@@ -0,0 +1,136 @@
+#include <cstdlib>
+
+#include "simplestructures.hpp"
+
+#include "Arena.hpp"
+
+using std::vector;
+
+namespace
+{
+
+// strictest alignment among the fundamental types
+struct AlignProbe
+{
+	char c;
+	union
+	{
+		long double ld;
+		double d;
+		long l;
+		void* p;
+	} u;
+};
+
+const size_t ALIGN = offsetof( AlignProbe, u );
+
+size_t align(size_t size)
+{
+	return ( ( size + ALIGN - 1 ) / ALIGN ) * ALIGN;
+}
+
+}
+
+Arena::Arena(size_t chunksize) :
+chunksize(chunksize), current(0), used_(0), peak_(0), objects_(0)
+{
+}
+
+Arena::~Arena()
+{
+	release();
+	
+	for( size_t i = 0; i < chunks.size(); ++i )
+		free( chunks[i].data );
+}
+
+void* Arena::alloc(size_t size)
+{
+	size = align( size ? size : 1 );
+	
+	// looks for room in the current chunk, then in the following ones
+	while( ( current < chunks.size() ) &&
+		( chunks[ current ].used + size > chunks[ current ].size ) )
+	{
+		++current;
+	}
+	
+	if( current == chunks.size() )
+	{
+		Chunk chunk;
+		
+		chunk.size = ( ( size > chunksize ) ? size : chunksize );
+		chunk.data = (char*) malloc( chunk.size );
+		chunk.used = 0;
+		if( !chunk.data )
+			throw( mexception( "Arena allocation error" ) );
+		
+		chunks.push_back( chunk );
+	}
+	
+	Chunk& chunk = chunks[ current ];
+	void* ret = chunk.data + chunk.used;
+	chunk.used += size;
+	
+	used_ += size;
+	if( used_ > peak_ )
+		peak_ = used_;
+	++objects_;
+	
+	return ret;
+}
+
+void Arena::release()
+{
+	// objects are destroyed in the reverse order of their creation
+	while( finalizers.size() )
+	{
+		Finalizer f = finalizers.back();
+		finalizers.pop_back();
+		
+		f.destroy( f.object );
+	}
+	
+	for( size_t i = 0; i < chunks.size(); ++i )
+		chunks[i].used = 0;
+	
+	current = 0;
+	used_ = 0;
+	objects_ = 0;
+}
+
+size_t Arena::used() const
+{
+	return used_;
+}
+
+size_t Arena::peak() const
+{
+	return peak_;
+}
+
+size_t Arena::reserved() const
+{
+	size_t ret = 0;
+	
+	for( size_t i = 0; i < chunks.size(); ++i )
+		ret += chunks[i].size;
+	
+	return ret;
+}
+
+size_t Arena::objects() const
+{
+	return objects_;
+}
+
+void* operator new(size_t size, Arena& arena)
+{
+	return arena.alloc( size );
+}
+
+void operator delete(void*, Arena&)
+{
+	// only called when a constructor throws: the memory goes back to the
+	// arena on Arena::release
+}
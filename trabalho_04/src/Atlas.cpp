@@ -0,0 +1,542 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <sys/stat.h>
+
+#include "SDL_image.h"
+
+#include "Atlas.hpp"
+
+#include "simplestructures.hpp"
+
+#define ATLAS_MAGIC	"ATLAS1"
+
+using std::fstream;
+using std::string;
+using std::vector;
+
+namespace
+{
+	// tallest first, then widest, then in the order they were added
+	class Taller
+	{
+	private:
+		const vector< SDL_Surface* >* surfaces;
+	public:
+		Taller(const vector< SDL_Surface* >* surfaces) : surfaces( surfaces ) {}
+		
+		bool operator()(int a, int b) const
+		{
+			const SDL_Surface* sa = ( *surfaces )[a];
+			const SDL_Surface* sb = ( *surfaces )[b];
+			
+			if( sa->h != sb->h )
+				return ( sa->h > sb->h );
+			if( sa->w != sb->w )
+				return ( sa->w > sb->w );
+			return ( a < b );
+		}
+	};
+	
+	long int modified(const string& filename)
+	{
+		struct stat st;
+		if( stat( filename.c_str(), &st ) )
+			return -1;
+		
+		return st.st_mtime;
+	}
+	
+	template <class T>
+	void put(fstream& f, const T& value)
+	{
+		f.write( (const char*) &value, sizeof( T ) );
+	}
+	
+	template <class T>
+	bool get(fstream& f, T& value)
+	{
+		f.read( (char*) &value, sizeof( T ) );
+		return f.good();
+	}
+}
+
+Atlas::Skyline::Skyline(int w, int h) : w( w ), h( h )
+{
+	Segment floor;
+	floor.x = 0;
+	floor.y = 0;
+	floor.w = w;
+	segments.push_back( floor );
+}
+
+bool Atlas::Skyline::insert(int w, int h, SDL_Rect& rect)
+{
+	int best = -1, besty = 0;
+	
+	for( unsigned int i = 0; i < segments.size(); i++ )
+	{
+		int y = fit( i, w );
+		if( ( y >= 0 ) && ( y + h <= this->h ) && ( ( best < 0 ) || ( y < besty ) ) )
+		{
+			best = i;
+			besty = y;
+		}
+	}
+	
+	if( best < 0 )
+		return false;
+	
+	rect.x = segments[best].x;
+	rect.y = besty;
+	rect.w = w;
+	rect.h = h;
+	
+	// the image becomes the new skyline over its width
+	Segment top;
+	top.x = rect.x;
+	top.y = besty + h;
+	top.w = w;
+	segments.insert( segments.begin() + best, top );
+	
+	for( unsigned int i = best + 1; i < segments.size(); )
+	{
+		int covered = top.x + top.w - segments[i].x;
+		if( covered <= 0 )
+			break;
+		
+		if( covered >= segments[i].w )
+			segments.erase( segments.begin() + i );
+		else
+		{
+			segments[i].x += covered;
+			segments[i].w -= covered;
+			break;
+		}
+	}
+	
+	for( unsigned int i = 0; i + 1 < segments.size(); )
+	{
+		if( segments[i].y == segments[i + 1].y )
+		{
+			segments[i].w += segments[i + 1].w;
+			segments.erase( segments.begin() + i + 1 );
+		}
+		else
+			i++;
+	}
+	
+	return true;
+}
+
+int Atlas::Skyline::fit(unsigned int i, int w) const
+{
+	if( segments[i].x + w > this->w )
+		return -1;
+	
+	// the image rests on the highest segment under it
+	int y = 0;
+	for( int left = w; left > 0; i++ )
+	{
+		y = std::max( y, segments[i].y );
+		left -= segments[i].w;
+	}
+	
+	return y;
+}
+
+Atlas::Atlas(int pagew, int pageh) :
+pagew( ( pagew > 0 ) ? pagew : 1024 ), pageh( ( pageh > 0 ) ? pageh : 1024 )
+{
+}
+
+Atlas::~Atlas()
+{
+	release();
+}
+
+int Atlas::add(const string& filename)
+{
+	int id = find( filename );
+	if( id >= 0 )
+		return id;
+	
+	Image image;
+	image.filename = filename;
+	image.mtime = -1;
+	image.pixels = NULL;
+	image.opacity = SDLBase::TRANSLUCENT;
+	image.page = -1;
+	memset( &image.rect, 0, sizeof( SDL_Rect ) );
+	
+	images.push_back( image );
+	
+	return ( images.size() - 1 );
+}
+
+void Atlas::build(const string& cache)
+{
+	release();
+	
+	for( unsigned int i = 0; i < images.size(); i++ )
+		images[i].mtime = modified( images[i].filename );
+	
+	if( ( !cache.empty() ) && ( restore( cache ) ) )
+		return;
+	
+	for( unsigned int i = 0; i < images.size(); i++ )
+	{
+		SDL_Surface* tmp = IMG_Load( images[i].filename.c_str() );
+		if( !tmp )
+		{
+			release();
+			throw( mexception( "IMG_Load error" ) );
+		}
+		
+		images[i].opacity = SDLBase::classify( tmp );
+		images[i].pixels = SDL_DisplayFormatAlpha( tmp );
+		SDL_FreeSurface( tmp );
+		
+		if( !images[i].pixels )
+		{
+			release();
+			throw( mexception( "SDL display format conversion error" ) );
+		}
+	}
+	
+	vector< SDL_Surface* > raw;
+	vector< int > classes;
+	pack( raw, classes );
+	
+	for( unsigned int i = 0; i < images.size(); i++ )
+	{
+		SDL_FreeSurface( images[i].pixels );
+		images[i].pixels = NULL;
+	}
+	
+	if( !cache.empty() )
+		save( cache, raw, classes );
+	
+	for( unsigned int p = 0; p < raw.size(); p++ )
+	{
+		pages.push_back( SDLBase::displayFormat( raw[p], SDLBase::Opacity( classes[p] ) ) );
+		SDL_FreeSurface( raw[p] );
+	}
+}
+
+Atlas::Region Atlas::region(int id) const
+{
+	if( ( id < 0 ) || ( id >= int( images.size() ) ) || ( images[id].page < 0 ) )
+		throw( mexception( "Atlas region not built" ) );
+	
+	Region region;
+	region.page = pages[ images[id].page ];
+	region.rect = images[id].rect;
+	
+	return region;
+}
+
+int Atlas::find(const string& filename) const
+{
+	for( unsigned int i = 0; i < images.size(); i++ )
+	{
+		if( images[i].filename == filename )
+			return i;
+	}
+	
+	return -1;
+}
+
+int Atlas::size() const
+{
+	return images.size();
+}
+
+int Atlas::pageCount() const
+{
+	return pages.size();
+}
+
+void Atlas::pack(vector< SDL_Surface* >& raw, vector< int >& classes)
+{
+	vector< SDL_Surface* > surfaces;
+	for( unsigned int i = 0; i < images.size(); i++ )
+		surfaces.push_back( images[i].pixels );
+	
+	const SDLBase::Opacity groups[] = {
+		SDLBase::OPAQUE, SDLBase::BINARY, SDLBase::TRANSLUCENT
+	};
+	
+	for( int g = 0; g < 3; g++ )
+	{
+		// empty images are packed with the binary ones, they're all key
+		vector< int > order;
+		for( unsigned int i = 0; i < images.size(); i++ )
+		{
+			SDLBase::Opacity opacity = images[i].opacity;
+			if( opacity == SDLBase::EMPTY )
+				opacity = SDLBase::BINARY;
+			
+			if( opacity == groups[g] )
+				order.push_back( i );
+		}
+		std::sort( order.begin(), order.end(), Taller( &surfaces ) );
+		
+		vector< Skyline > skylines;
+		vector< int > ids;
+		
+		for( unsigned int k = 0; k < order.size(); k++ )
+		{
+			Image& image = images[ order[k] ];
+			int w = image.pixels->w;
+			int h = image.pixels->h;
+			
+			unsigned int s = 0;
+			while( ( s < skylines.size() ) && ( !skylines[s].insert( w, h, image.rect ) ) )
+				s++;
+			
+			// a new page, as big as the image if it doesn't fit in one
+			if( s == skylines.size() )
+			{
+				skylines.push_back( Skyline( std::max( pagew, w ), std::max( pageh, h ) ) );
+				skylines.back().insert( w, h, image.rect );
+				
+				ids.push_back( raw.size() );
+				raw.push_back( NULL );
+				classes.push_back( groups[g] );
+			}
+			
+			image.page = ids[s];
+		}
+	}
+	
+	// the pages are trimmed to their images
+	vector< int > w( raw.size(), 1 ), h( raw.size(), 1 );
+	for( unsigned int i = 0; i < images.size(); i++ )
+	{
+		const SDL_Rect& rect = images[i].rect;
+		w[ images[i].page ] = std::max( w[ images[i].page ], rect.x + rect.w );
+		h[ images[i].page ] = std::max( h[ images[i].page ], rect.y + rect.h );
+	}
+	
+	const SDL_PixelFormat* format = images.empty() ? NULL : images[0].pixels->format;
+	
+	for( unsigned int p = 0; p < raw.size(); p++ )
+	{
+		raw[p] = SDL_CreateRGBSurface(
+			SDL_SWSURFACE, w[p], h[p], 32,
+			format->Rmask, format->Gmask, format->Bmask, format->Amask
+		);
+		if( !raw[p] )
+			throw( mexception( "SDL_CreateRGBSurface error" ) );
+		
+		for( int y = 0; y < h[p]; y++ )
+			memset( (Uint8*) raw[p]->pixels + y * raw[p]->pitch, 0, w[p] * 4 );
+	}
+	
+	for( unsigned int i = 0; i < images.size(); i++ )
+	{
+		SDL_Surface* src = images[i].pixels;
+		SDL_Surface* dst = raw[ images[i].page ];
+		const SDL_Rect& rect = images[i].rect;
+		
+		if( SDL_MUSTLOCK( src ) )
+			SDL_LockSurface( src );
+		
+		for( int y = 0; y < rect.h; y++ )
+		{
+			memcpy(
+				(Uint8*) dst->pixels + ( rect.y + y ) * dst->pitch + rect.x * 4,
+				(Uint8*) src->pixels + y * src->pitch,
+				rect.w * 4
+			);
+		}
+		
+		if( SDL_MUSTLOCK( src ) )
+			SDL_UnlockSurface( src );
+	}
+}
+
+bool Atlas::restore(const string& cache)
+{
+	fstream f( cache.c_str(), fstream::in | fstream::binary );
+	if( !f.is_open() )
+		return false;
+	
+	char magic[ sizeof( ATLAS_MAGIC ) ];
+	f.read( magic, sizeof( magic ) );
+	if( ( !f.good() ) || ( memcmp( magic, ATLAS_MAGIC, sizeof( magic ) ) ) )
+		return false;
+	
+	// the cache is only good for the same files, unchanged
+	Uint32 count;
+	if( ( !get( f, count ) ) || ( count != images.size() ) )
+		return false;
+	
+	vector< Image > cached( images );
+	vector< Sint32 > rects;
+	for( unsigned int i = 0; i < count; i++ )
+	{
+		Uint32 length;
+		long int mtime;
+		Sint32 page, x, y, w, h;
+		
+		if( ( !get( f, length ) ) || ( !length ) || ( length > 4096 ) )
+			return false;
+		string filename( length, ' ' );
+		f.read( &filename[0], length );
+		
+		if(	( !get( f, mtime ) ) || ( !get( f, page ) ) ||
+			( !get( f, x ) ) || ( !get( f, y ) ) ||
+			( !get( f, w ) ) || ( !get( f, h ) )	)
+		{
+			return false;
+		}
+		
+		if(	( filename != images[i].filename ) ||
+			( mtime != images[i].mtime ) || ( mtime < 0 )	)
+		{
+			return false;
+		}
+		
+		// checked against the pages, once they're read
+		cached[i].page = page;
+		rects.push_back( x );
+		rects.push_back( y );
+		rects.push_back( w );
+		rects.push_back( h );
+	}
+	
+	Uint32 pagecount;
+	if( !get( f, pagecount ) )
+		return false;
+	
+	vector< SDL_Surface* > raw;
+	vector< int > classes;
+	bool ok = true;
+	
+	for( unsigned int p = 0; ( p < pagecount ) && ( ok ); p++ )
+	{
+		Sint32 opacity, w, h;
+		Uint32 masks[4];
+		
+		ok = (	( get( f, opacity ) ) && ( get( f, w ) ) && ( get( f, h ) ) &&
+			( get( f, masks[0] ) ) && ( get( f, masks[1] ) ) &&
+			( get( f, masks[2] ) ) && ( get( f, masks[3] ) ) &&
+			( w > 0 ) && ( h > 0 )	);
+		if( !ok )
+			break;
+		
+		SDL_Surface* page = SDL_CreateRGBSurface(
+			SDL_SWSURFACE, w, h, 32, masks[0], masks[1], masks[2], masks[3]
+		);
+		if( !page )
+		{
+			ok = false;
+			break;
+		}
+		raw.push_back( page );
+		classes.push_back( opacity );
+		
+		for( int y = 0; ( y < h ) && ( ok ); y++ )
+		{
+			f.read( (char*) page->pixels + y * page->pitch, w * 4 );
+			ok = f.good();
+		}
+	}
+	
+	// a piece out of its page would be read out of the surface, so the
+	// cache is dropped and the atlas is built again
+	for( unsigned int i = 0; ( i < cached.size() ) && ( ok ); i++ )
+	{
+		const Sint32* r = &rects[ 4 * i ];
+		
+		ok = ( ( cached[i].page >= 0 ) && ( cached[i].page < int( raw.size() ) ) );
+		if( !ok )
+			break;
+		
+		SDL_Surface* page = raw[ cached[i].page ];
+		ok = (	( r[0] >= 0 ) && ( r[1] >= 0 ) && ( r[2] > 0 ) && ( r[3] > 0 ) &&
+			( r[2] <= page->w - r[0] ) && ( r[3] <= page->h - r[1] ) &&
+			( r[0] + r[2] <= 0x7FFF ) && ( r[1] + r[3] <= 0x7FFF )	);
+		
+		cached[i].rect.x = r[0];
+		cached[i].rect.y = r[1];
+		cached[i].rect.w = r[2];
+		cached[i].rect.h = r[3];
+	}
+	
+	if( ok )
+	{
+		images = cached;
+		for( unsigned int p = 0; p < raw.size(); p++ )
+			pages.push_back( SDLBase::displayFormat( raw[p], SDLBase::Opacity( classes[p] ) ) );
+	}
+	
+	for( unsigned int p = 0; p < raw.size(); p++ )
+		SDL_FreeSurface( raw[p] );
+	
+	return ok;
+}
+
+void Atlas::save(
+	const string& cache,
+	const vector< SDL_Surface* >& raw,
+	const vector< int >& classes
+) const
+{
+	// the game runs fine without it
+	fstream f( cache.c_str(), fstream::out | fstream::binary | fstream::trunc );
+	if( !f.is_open() )
+		return;
+	
+	f.write( ATLAS_MAGIC, sizeof( ATLAS_MAGIC ) );
+	
+	put( f, Uint32( images.size() ) );
+	for( unsigned int i = 0; i < images.size(); i++ )
+	{
+		put( f, Uint32( images[i].filename.size() ) );
+		f.write( images[i].filename.data(), images[i].filename.size() );
+		put( f, images[i].mtime );
+		put( f, Sint32( images[i].page ) );
+		put( f, Sint32( images[i].rect.x ) );
+		put( f, Sint32( images[i].rect.y ) );
+		put( f, Sint32( images[i].rect.w ) );
+		put( f, Sint32( images[i].rect.h ) );
+	}
+	
+	put( f, Uint32( raw.size() ) );
+	for( unsigned int p = 0; p < raw.size(); p++ )
+	{
+		const SDL_PixelFormat* format = raw[p]->format;
+		
+		put( f, Sint32( classes[p] ) );
+		put( f, Sint32( raw[p]->w ) );
+		put( f, Sint32( raw[p]->h ) );
+		put( f, format->Rmask );
+		put( f, format->Gmask );
+		put( f, format->Bmask );
+		put( f, format->Amask );
+		
+		for( int y = 0; y < raw[p]->h; y++ )
+			f.write( (const char*) raw[p]->pixels + y * raw[p]->pitch, raw[p]->w * 4 );
+	}
+}
+
+void Atlas::release()
+{
+	for( unsigned int i = 0; i < images.size(); i++ )
+	{
+		if( images[i].pixels )
+		{
+			SDL_FreeSurface( images[i].pixels );
+			images[i].pixels = NULL;
+		}
+		images[i].page = -1;
+	}
+	
+	for( unsigned int p = 0; p < pages.size(); p++ )
+		SDL_FreeSurface( pages[p] );
+	pages.clear();
+}
@@ -0,0 +1,251 @@
+#include "simplestructures.hpp"
+
+#include "AudioBank.hpp"
+
+using std::string;
+using std::map;
+using std::vector;
+
+map< string, AudioBank::Sound* > AudioBank::sounds;
+vector< AudioBank::Channel > AudioBank::channels;
+unsigned int AudioBank::frame = 1;
+unsigned int AudioBank::serial = 0;
+AudioBank::Stats AudioBank::stats_ = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+void AudioBank::init(int nchannels)
+{
+	Channel empty = { NULL, 0 };
+	channels.assign( Mix_AllocateChannels( nchannels ), empty );
+	stats_.channels = channels.size();
+}
+
+void AudioBank::close()
+{
+	Mix_HaltChannel( -1 );
+	
+	for( map< string, Sound* >::iterator it = sounds.begin(); it != sounds.end(); ++it )
+	{
+		if( it->second->chunk )
+			Mix_FreeChunk( it->second->chunk );
+		if( it->second->music )
+			Mix_FreeMusic( it->second->music );
+		delete it->second;
+	}
+	sounds.clear();
+	channels.clear();
+}
+
+AudioBank::Sound* AudioBank::acquire(const string& filename)
+{
+	map< string, Sound* >::iterator it = sounds.find( filename );
+	if( it != sounds.end() )
+	{
+		stats_.hits++;
+		it->second->refs++;
+		return it->second;
+	}
+	
+	Sound* sound = new Sound;
+	sound->filename = filename;
+	sound->chunk = NULL;
+	sound->music = NULL;
+	sound->refs = 1;
+	sound->maxvoices = 0;
+	sound->priority = 0;
+	sound->lastframe = 0;
+	sound->lastchannel = -1;
+	
+	// short effects are decoded to PCM, musics are streamed
+	if( filename[ filename.size() - 1 ] == 'v' )
+	{
+		sound->chunk = Mix_LoadWAV( filename.c_str() );
+		if( !sound->chunk )
+		{
+			delete sound;
+			throw( mexception( "Mix_LoadWAV error" ) );
+		}
+	}
+	else
+	{
+		sound->music = Mix_LoadMUS( filename.c_str() );
+		if( !sound->music )
+		{
+			delete sound;
+			throw( mexception( "Mix_LoadMUS error" ) );
+		}
+	}
+	
+	stats_.decoded++;
+	sounds[ filename ] = sound;
+	return sound;
+}
+
+void AudioBank::release(Sound* sound)
+{
+	// unused sounds are kept decoded until purge(), for the next states
+	sound->refs--;
+}
+
+void AudioBank::purge()
+{
+	map< string, Sound* >::iterator it = sounds.begin();
+	while( it != sounds.end() )
+	{
+		Sound* sound = it->second;
+		if( sound->refs > 0 )
+		{
+			++it;
+			continue;
+		}
+		
+		if( sound->chunk )
+		{
+			prune( sound );
+			for( unsigned int i = 0; i < sound->voices.size(); i++ )
+			{
+				Mix_HaltChannel( sound->voices[i] );
+				channels[ sound->voices[i] ].sound = NULL;
+			}
+			Mix_FreeChunk( sound->chunk );
+		}
+		if( sound->music )
+			Mix_FreeMusic( sound->music );
+		delete sound;
+		sounds.erase( it++ );
+	}
+}
+
+void AudioBank::limit(Sound* sound, int maxvoices, int priority)
+{
+	sound->maxvoices = maxvoices;
+	sound->priority = priority;
+}
+
+void AudioBank::prune(Sound* sound)
+{
+	// drops the voices that finished or whose channels were taken
+	unsigned int n = 0;
+	for( unsigned int i = 0; i < sound->voices.size(); i++ )
+	{
+		int ch = sound->voices[i];
+		if( ( channels[ ch ].sound == sound ) && Mix_Playing( ch ) )
+			sound->voices[ n++ ] = ch;
+		else if( channels[ ch ].sound == sound )
+			channels[ ch ].sound = NULL;
+	}
+	sound->voices.resize( n );
+}
+
+int AudioBank::steal(int priority)
+{
+	// the oldest voice among the ones with the lowest priority
+	int victim = -1;
+	for( unsigned int ch = 0; ch < channels.size(); ch++ )
+	{
+		Sound* owner = channels[ ch ].sound;
+		if( !owner || ( owner->priority >= priority ) )
+			continue;
+		if( ( victim < 0 ) ||
+			( owner->priority < channels[ victim ].sound->priority ) ||
+			( ( owner->priority == channels[ victim ].sound->priority ) &&
+			( channels[ ch ].serial < channels[ victim ].serial ) ) )
+		{
+			victim = ch;
+		}
+	}
+	
+	if( victim >= 0 )
+		Mix_HaltChannel( victim );
+	
+	return victim;
+}
+
+int AudioBank::play(Sound* sound, int loops)
+{
+	if( sound->music )
+	{
+		stats_.plays++;
+		Mix_PlayMusic( sound->music, loops );
+		return -1;
+	}
+	
+	if( sound->lastframe == frame )
+	{
+		stats_.collapsed++;
+		return sound->lastchannel;
+	}
+	
+	prune( sound );
+	
+	int ch = -1;
+	if( sound->maxvoices && ( (int) sound->voices.size() >= sound->maxvoices ) )
+	{
+		// voice limit reached: the oldest voice of the sound is stolen
+		ch = sound->voices[0];
+		sound->voices.erase( sound->voices.begin() );
+		Mix_HaltChannel( ch );
+		stats_.stolen++;
+	}
+	
+	ch = Mix_PlayChannel( ch, sound->chunk, loops );
+	if( ch < 0 )
+	{
+		// all channels busy: only sounds with lower priority are stolen
+		ch = steal( sound->priority );
+		if( ch >= 0 )
+		{
+			stats_.stolen++;
+			ch = Mix_PlayChannel( ch, sound->chunk, loops );
+		}
+	}
+	
+	if( ( ch < 0 ) || ( ch >= (int) channels.size() ) )
+	{
+		stats_.refused++;
+		return -1;
+	}
+	
+	// the channel may still be listed as a voice of its previous owner
+	Sound* previous = channels[ ch ].sound;
+	channels[ ch ].sound = sound;
+	channels[ ch ].serial = serial++;
+	if( previous && ( previous != sound ) )
+		prune( previous );
+	sound->voices.push_back( ch );
+	sound->lastframe = frame;
+	sound->lastchannel = ch;
+	stats_.plays++;
+	
+	return ch;
+}
+
+void AudioBank::stop(Sound* sound, int channel, int fade)
+{
+	if( sound->music )
+		Mix_FadeOutMusic( fade );
+	else if( ( channel >= 0 ) && ( channel < (int) channels.size() ) &&
+		( channels[ channel ].sound == sound ) )
+	{
+		Mix_HaltChannel( channel );
+	}
+}
+
+void AudioBank::nextFrame()
+{
+	frame++;
+	
+	int busy = 0;
+	for( unsigned int ch = 0; ch < channels.size(); ch++ )
+	{
+		if( channels[ ch ].sound && Mix_Playing( ch ) )
+			busy++;
+	}
+	stats_.busy = busy;
+	if( busy > stats_.peak )
+		stats_.peak = busy;
+}
+
+const AudioBank::Stats& AudioBank::stats()
+{
+	return stats_;
+}
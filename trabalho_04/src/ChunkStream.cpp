@@ -0,0 +1,531 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "ChunkStream.hpp"
+#include "TileMap.hpp"
+
+#include "simplestructures.hpp"
+
+#define CHUNKSTREAM_MAGIC	"TMCHUNK1"
+
+// requests waiting at most, the oldest ones are dropped
+#define CHUNKSTREAM_QUEUE	64
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+ChunkStream::Stats ChunkStream::stats_ = { 0, 0, 0, 0, 0, 0 };
+
+namespace
+{
+	enum
+	{
+		ABSENT,
+		PENDING,
+		RESIDENT
+	};
+}
+
+ChunkStream::ChunkStream(const string& path, unsigned int capacity) :
+fd( -1 ), layers_( 0 ), side_( 0 ), capacity( capacity ? capacity : 1 ),
+clock( 0 ), arrivals_( 0 ), loader( NULL ), lock( NULL ), wake( NULL ), quit( false )
+{
+	fd = open( path.c_str(), O_RDONLY );
+	if( fd < 0 )
+		throw( mexception( "Can't open the chunked map " + path ) );
+	
+	char magic[8];
+	Sint32 header[2];
+	off_t at = 0;
+	
+	if( ( !readAt( magic, sizeof( magic ), at ) ) ||
+		( memcmp( magic, CHUNKSTREAM_MAGIC, sizeof( magic ) ) ) ||
+		( !readAt( header, sizeof( header ), at += sizeof( magic ) ) ) ||
+		( header[0] < 1 ) || ( header[1] < 1 ) )
+	{
+		close();
+		throw( mexception( "Not a chunked map: " + path ) );
+	}
+	at += sizeof( header );
+	
+	layers_ = header[0];
+	side_ = header[1];
+	
+	int total = 0;
+	for( int k = 0; k < layers_; k++ )
+	{
+		Sint32 size[2];
+		if( !readAt( size, sizeof( size ), at ) )
+		{
+			close();
+			throw( mexception( "Truncated chunked map: " + path ) );
+		}
+		at += sizeof( size );
+		
+		w.push_back( size[0] );
+		h.push_back( size[1] );
+		cols.push_back( ( size[0] + side_ - 1 ) / side_ );
+		rows.push_back( ( size[1] + side_ - 1 ) / side_ );
+		first.push_back( total );
+		total += cols.back() * rows.back();
+	}
+	
+	vector< Uint32 > index( 2 * total + 1 );
+	if( !readAt( &index[0], 2 * total * sizeof( Uint32 ), at ) )
+	{
+		close();
+		throw( mexception( "Truncated chunked map: " + path ) );
+	}
+	
+	for( int c = 0; c < total; c++ )
+		offsets.push_back( off_t( index[ 2 * c ] ) | ( ( off_t( index[ 2 * c + 1 ] ) << 16 ) << 16 ) );
+	
+	state.assign( total, ABSENT );
+	empty.assign( side_ * side_, -1 );
+	
+	lock = SDL_CreateMutex();
+	wake = SDL_CreateCond();
+	loader = SDL_CreateThread( run, (void*) this );
+	if( !loader )
+	{
+		close();
+		throw( mexception( "SDL_CreateThread error" ) );
+	}
+}
+
+ChunkStream::~ChunkStream()
+{
+	close();
+}
+
+void ChunkStream::close()
+{
+	if( loader )
+	{
+		SDL_LockMutex( lock );
+		quit = true;
+		SDL_CondSignal( wake );
+		SDL_UnlockMutex( lock );
+		
+		SDL_WaitThread( loader, NULL );
+		loader = NULL;
+	}
+	
+	for( map< int, Chunk >::iterator it = cache.begin(); it != cache.end(); ++it )
+		delete it->second.tiles;
+	cache.clear();
+	
+	for( unsigned int i = 0; i < done.size(); i++ )
+		delete done[i].second;
+	done.clear();
+	
+	if( wake )
+		SDL_DestroyCond( wake );
+	if( lock )
+		SDL_DestroyMutex( lock );
+	wake = NULL;
+	lock = NULL;
+	
+	if( fd >= 0 )
+		::close( fd );
+	fd = -1;
+}
+
+bool ChunkStream::isChunked(const string& path)
+{
+	char magic[8];
+	
+	FILE* f = fopen( path.c_str(), "rb" );
+	if( !f )
+		return false;
+	
+	bool chunked = (
+		( fread( magic, sizeof( magic ), 1, f ) == 1 ) &&
+		( !memcmp( magic, CHUNKSTREAM_MAGIC, sizeof( magic ) ) )
+	);
+	fclose( f );
+	
+	return chunked;
+}
+
+void ChunkStream::write(const string& path, TileMap& map, int side)
+{
+	if( side < 1 )
+		side = 1;
+	
+	FILE* f = fopen( path.c_str(), "wb" );
+	if( !f )
+		throw( mexception( "Can't write the chunked map " + path ) );
+	
+	Sint32 header[2] = { map.layers(), side };
+	fwrite( CHUNKSTREAM_MAGIC, 8, 1, f );
+	fwrite( header, sizeof( header ), 1, f );
+	
+	int total = 0;
+	for( int k = 0; k < map.layers(); k++ )
+	{
+		Sint32 size[2] = { map.width( k ), map.height( k ) };
+		fwrite( size, sizeof( size ), 1, f );
+		
+		total += ( ( size[0] + side - 1 ) / side ) * ( ( size[1] + side - 1 ) / side );
+	}
+	
+	// the index is written again once the chunks are in place
+	off_t base = 8 + sizeof( header ) + 2 * sizeof( Sint32 ) * map.layers();
+	vector< Uint32 > index( 2 * total, 0 );
+	if( total )
+		fwrite( &index[0], sizeof( Uint32 ), index.size(), f );
+	
+	off_t at = base + sizeof( Uint32 ) * index.size();
+	vector< Sint16 > tiles( side * side );
+	int c = 0;
+	
+	for( int k = 0; k < map.layers(); k++ )
+	{
+		int w = map.width( k ), h = map.height( k );
+		
+		for( int ci = 0; ci * side < h; ci++ )
+		{
+			for( int cj = 0; cj * side < w; cj++, c++ )
+			{
+				bool blank = true;
+				
+				for( int i = 0; i < side; i++ )
+				{
+					for( int j = 0; j < side; j++ )
+					{
+						int ti = ci * side + i, tj = cj * side + j;
+						int tile = ( ( ti < h ) && ( tj < w ) ) ? map.at( k, ti, tj ) : -1;
+						
+						tiles[ i * side + j ] = ( tile >= 0 ) ? tile : -1;
+						blank = ( ( blank ) && ( tile < 0 ) );
+					}
+				}
+				
+				if( blank )
+					continue;
+				
+				index[ 2 * c ] = Uint32( at & 0xFFFFFFFF );
+				index[ 2 * c + 1 ] = Uint32( ( at >> 16 ) >> 16 );
+				
+				fwrite( &tiles[0], sizeof( Sint16 ), tiles.size(), f );
+				at += sizeof( Sint16 ) * tiles.size();
+			}
+		}
+	}
+	
+	fseek( f, base, SEEK_SET );
+	if( total )
+		fwrite( &index[0], sizeof( Uint32 ), index.size(), f );
+	
+	if( ferror( f ) )
+	{
+		fclose( f );
+		throw( mexception( "Can't write the chunked map " + path ) );
+	}
+	fclose( f );
+}
+
+int ChunkStream::layers() const
+{
+	return layers_;
+}
+
+int ChunkStream::side() const
+{
+	return side_;
+}
+
+int ChunkStream::width(int layer) const
+{
+	return w[ layer ];
+}
+
+int ChunkStream::height(int layer) const
+{
+	return h[ layer ];
+}
+
+int ChunkStream::index(int layer, int ci, int cj) const
+{
+	return ( first[ layer ] + ci * cols[ layer ] + cj );
+}
+
+void ChunkStream::request(int layer, int i0, int j0, int i1, int j1)
+{
+	if( ( layer < 0 ) || ( layer >= layers_ ) )
+		return;
+	
+	int ci0 = std::max( i0, 0 ) / side_, ci1 = std::min( i1, h[ layer ] - 1 ) / side_;
+	int cj0 = std::max( j0, 0 ) / side_, cj1 = std::min( j1, w[ layer ] - 1 ) / side_;
+	
+	if( ( i1 < 0 ) || ( j1 < 0 ) || ( ci0 > ci1 ) || ( cj0 > cj1 ) )
+		return;
+	
+	SDL_LockMutex( lock );
+	
+	bool asked = false;
+	for( int ci = ci0; ci <= ci1; ci++ )
+	{
+		for( int cj = cj0; cj <= cj1; cj++ )
+		{
+			int c = index( layer, ci, cj );
+			
+			if( ( state[c] != ABSENT ) || ( !offsets[c] ) )
+				continue;
+			
+			state[c] = PENDING;
+			requests.push_back( c );
+			stats_.requested++;
+			asked = true;
+		}
+	}
+	
+	// the camera has moved on from the oldest ones
+	if( requests.size() > CHUNKSTREAM_QUEUE )
+	{
+		int stale = requests.size() - CHUNKSTREAM_QUEUE;
+		for( int k = 0; k < stale; k++ )
+			state[ requests[k] ] = ABSENT;
+		requests.erase( requests.begin(), requests.begin() + stale );
+	}
+	
+	if( asked )
+		SDL_CondSignal( wake );
+	
+	SDL_UnlockMutex( lock );
+}
+
+void ChunkStream::update()
+{
+	SDL_LockMutex( lock );
+	
+	clock++;
+	
+	for( unsigned int i = 0; i < done.size(); i++ )
+	{
+		int c = done[i].first;
+		
+		// fetched meanwhile
+		if( cache.count( c ) )
+		{
+			delete done[i].second;
+			continue;
+		}
+		
+		Chunk chunk = { done[i].second, clock };
+		cache[c] = chunk;
+		state[c] = RESIDENT;
+		stats_.loaded++;
+		arrivals_++;
+	}
+	done.clear();
+	
+	while( cache.size() > capacity )
+	{
+		map< int, Chunk >::iterator oldest = cache.end();
+		for( map< int, Chunk >::iterator it = cache.begin(); it != cache.end(); ++it )
+		{
+			if( ( oldest == cache.end() ) || ( it->second.used < oldest->second.used ) )
+				oldest = it;
+		}
+		
+		// everything left is in use, so the cache grows for a while
+		if( oldest->second.used + 1 >= clock )
+			break;
+		
+		delete oldest->second.tiles;
+		state[ oldest->first ] = ABSENT;
+		cache.erase( oldest );
+		stats_.evicted++;
+	}
+	
+	SDL_UnlockMutex( lock );
+}
+
+void ChunkStream::lockCache()
+{
+	SDL_LockMutex( lock );
+}
+
+void ChunkStream::unlockCache()
+{
+	SDL_UnlockMutex( lock );
+}
+
+const int* ChunkStream::chunk(int layer, int ci, int cj)
+{
+	int c = index( layer, ci, cj );
+	
+	map< int, Chunk >::iterator it = cache.find( c );
+	if( it != cache.end() )
+	{
+		it->second.used = clock;
+		stats_.hits++;
+		return &( *it->second.tiles )[0];
+	}
+	
+	if( !offsets[c] )
+	{
+		stats_.hits++;
+		return &empty[0];
+	}
+	
+	stats_.misses++;
+	return NULL;
+}
+
+int* ChunkStream::fetch(int layer, int ci, int cj)
+{
+	int c = index( layer, ci, cj );
+	
+	SDL_LockMutex( lock );
+	map< int, Chunk >::iterator it = cache.find( c );
+	if( it != cache.end() )
+	{
+		it->second.used = clock;
+		SDL_UnlockMutex( lock );
+		return &( *it->second.tiles )[0];
+	}
+	SDL_UnlockMutex( lock );
+	
+	vector< int >* tiles = read( c );
+	
+	SDL_LockMutex( lock );
+	Chunk chunk = { tiles, clock };
+	cache[c] = chunk;
+	state[c] = RESIDENT;
+	stats_.blocking++;
+	arrivals_++;
+	
+	for( unsigned int k = 0; k < requests.size(); k++ )
+	{
+		if( requests[k] == c )
+		{
+			requests.erase( requests.begin() + k );
+			break;
+		}
+	}
+	SDL_UnlockMutex( lock );
+	
+	return &( *tiles )[0];
+}
+
+bool ChunkStream::peek(int layer, int ci, int cj, vector< int >& tiles)
+{
+	int c = index( layer, ci, cj );
+	
+	if( !offsets[c] )
+	{
+		tiles = empty;
+		return true;
+	}
+	
+	SDL_LockMutex( lock );
+	map< int, Chunk >::iterator it = cache.find( c );
+	bool found = ( it != cache.end() );
+	if( found )
+		tiles = *it->second.tiles;
+	SDL_UnlockMutex( lock );
+	
+	return found;
+}
+
+unsigned int ChunkStream::arrivals() const
+{
+	SDL_LockMutex( lock );
+	unsigned int n = arrivals_;
+	SDL_UnlockMutex( lock );
+	
+	return n;
+}
+
+int ChunkStream::run(void* data)
+{
+	( (ChunkStream*) data )->work();
+	
+	return 0;
+}
+
+void ChunkStream::work()
+{
+	SDL_LockMutex( lock );
+	
+	while( !quit )
+	{
+		if( requests.empty() )
+		{
+			SDL_CondWait( wake, lock );
+			continue;
+		}
+		
+		int c = requests.back();
+		requests.pop_back();
+		
+		// the disk is read with the cache unlocked
+		SDL_UnlockMutex( lock );
+		vector< int >* tiles = read( c );
+		SDL_LockMutex( lock );
+		
+		done.push_back( pair< int, vector< int >* >( c, tiles ) );
+	}
+	
+	SDL_UnlockMutex( lock );
+}
+
+vector< int >* ChunkStream::read(int index) const
+{
+	vector< int >* tiles = new vector< int >( empty );
+	
+	if( !offsets[ index ] )
+		return tiles;
+	
+	// a chunk that can't be read is left empty
+	vector< Sint16 > raw( side_ * side_ );
+	if( readAt( &raw[0], sizeof( Sint16 ) * raw.size(), offsets[ index ] ) )
+	{
+		for( unsigned int k = 0; k < raw.size(); k++ )
+			( *tiles )[k] = raw[k];
+	}
+	
+	return tiles;
+}
+
+bool ChunkStream::readAt(void* buffer, size_t size, off_t offset) const
+{
+	char* bytes = (char*) buffer;
+	
+	while( size )
+	{
+		ssize_t n = pread( fd, bytes, size, offset );
+		if( n <= 0 )
+			return false;
+		
+		bytes += n;
+		size -= n;
+		offset += n;
+	}
+	
+	return true;
+}
+
+const ChunkStream::Stats& ChunkStream::stats()
+{
+	return stats_;
+}
+
+void ChunkStream::resetStats()
+{
+	stats_.requested = 0;
+	stats_.loaded = 0;
+	stats_.hits = 0;
+	stats_.misses = 0;
+	stats_.evicted = 0;
+	stats_.blocking = 0;
+}
@@ -0,0 +1,763 @@
+#include <cmath>
+#include <cstring>
+
+#include "Compositor.hpp"
+
+#include "AlphaBlit.hpp"
+#include "JobSystem.hpp"
+
+// pixels sampled by a transformed blit before they're blended at once
+#define COMPOSITOR_SPAN	256
+
+namespace
+{
+	// draws one row of a 32-bit surface over a 32-bit target, following the
+	// rules of SDL for the flags of the source
+	class Row
+	{
+	private:
+		enum
+		{
+			COPY,
+			CONVERT,
+			KEY,
+			ALPHA,
+			PIXELALPHA,
+			ARGB,
+			PREMULTIPLIED
+		};
+		
+		const SDL_PixelFormat* sf;
+		const SDL_PixelFormat* df;
+		
+		int mode;
+		bool keyed;
+		bool packed;
+		Uint32 rgbmask;
+		Uint32 key;
+		int alpha;
+	public:
+		Row(SDL_Surface* src, SDL_Surface* dst, bool premultiplied = false) :
+		sf( src->format ), df( dst->format ), keyed( false ), alpha( 255 )
+		{
+			rgbmask = sf->Rmask | sf->Gmask | sf->Bmask;
+			key = sf->colorkey & rgbmask;
+			
+			// SDL blends the channels in place when they're where the
+			// target has them, and converts them one by one otherwise
+			packed = (
+				( sf->Rmask == df->Rmask ) && ( sf->Gmask == df->Gmask ) &&
+				( sf->Bmask == df->Bmask ) && ( rgbmask == 0x00FFFFFF ) &&
+				( ( !sf->Amask ) || ( sf->Amask == 0xFF000000 ) )
+			);
+			
+			// the images of SDL_DisplayFormatAlpha over the screen have a
+			// vector blitter of their own, which is the only one for the
+			// premultiplied ones
+			if( premultiplied )
+				mode = PREMULTIPLIED;
+			else if( ( src->flags & SDL_SRCALPHA ) && ( sf->Amask ) )
+				mode = AlphaBlit::fits( sf, df ) ? ARGB : PIXELALPHA;
+			else
+			{
+				keyed = ( ( src->flags & SDL_SRCCOLORKEY ) != 0 );
+				if( ( src->flags & SDL_SRCALPHA ) && ( sf->alpha != SDL_ALPHA_OPAQUE ) )
+				{
+					mode = ALPHA;
+					alpha = sf->alpha;
+					packed = ( ( packed ) && ( !keyed ) );
+				}
+				else if( keyed )
+					mode = KEY;
+				else if(	( sf->Rmask == df->Rmask ) && ( sf->Gmask == df->Gmask ) &&
+						( sf->Bmask == df->Bmask ) && ( sf->Amask == df->Amask )	)
+				{
+					mode = COPY;
+				}
+				else
+					mode = CONVERT;
+			}
+		}
+		
+		void operator()(const Uint32* src, Uint32* dst, int w) const
+		{
+			switch( mode )
+			{
+			case COPY:
+				memcpy( dst, src, w * sizeof( Uint32 ) );
+				break;
+			
+			case CONVERT:
+				for( int i = 0; i < w; i++ )
+					dst[i] = convert( src[i] );
+				break;
+			
+			case KEY:
+				for( int i = 0; i < w; i++ )
+				{
+					if( ( src[i] & rgbmask ) != key )
+						dst[i] = convert( src[i] );
+				}
+				break;
+			
+			case ALPHA:
+				for( int i = 0; i < w; i++ )
+				{
+					if( ( !keyed ) || ( ( src[i] & rgbmask ) != key ) )
+						dst[i] = blend( src[i], dst[i], alpha );
+				}
+				break;
+			
+			case PIXELALPHA:
+				for( int i = 0; i < w; i++ )
+				{
+					int a = ( src[i] & sf->Amask ) >> sf->Ashift;
+					
+					if( ( packed ) && ( a == SDL_ALPHA_OPAQUE ) )
+						dst[i] = ( convert( src[i] ) & ~df->Amask ) | ( dst[i] & df->Amask );
+					else if( a )
+						dst[i] = blend( src[i], dst[i], a );
+				}
+				break;
+			
+			case ARGB:
+				AlphaBlit::blend( src, dst, w );
+				break;
+			
+			case PREMULTIPLIED:
+				AlphaBlit::blendPremultiplied( src, dst, w );
+				break;
+			
+			default:
+				break;
+			}
+		}
+	private:
+		Uint32 convert(Uint32 s) const
+		{
+			Uint32 a = SDL_ALPHA_OPAQUE;
+			if( sf->Amask )
+				a = ( s & sf->Amask ) >> sf->Ashift;
+			
+			return (
+				( ( ( s & sf->Rmask ) >> sf->Rshift ) << df->Rshift ) |
+				( ( ( s & sf->Gmask ) >> sf->Gshift ) << df->Gshift ) |
+				( ( ( s & sf->Bmask ) >> sf->Bshift ) << df->Bshift ) |
+				( ( a << df->Ashift ) & df->Amask )
+			);
+		}
+		
+		// the arithmetic of the blitter SDL would pick: the packed ones
+		// shift the product down, rounding toward minus infinity, and copy
+		// the opaque pixels; the generic ones add 255 before the shift. The
+		// bias keeps the shift away from negative numbers.
+		int mix(int s, int d, int a) const
+		{
+			if( packed )
+				return ( ( ( ( s - d ) * a + 0x10000 ) >> 8 ) - 0x100 + d );
+			
+			return ( ( ( ( s - d ) * a + 255 + 0x10000 ) >> 8 ) - 0x100 + d );
+		}
+		
+		Uint32 blend(Uint32 s, Uint32 d, int a) const
+		{
+			int r = mix(
+				( s & sf->Rmask ) >> sf->Rshift, ( d & df->Rmask ) >> df->Rshift, a
+			);
+			int g = mix(
+				( s & sf->Gmask ) >> sf->Gshift, ( d & df->Gmask ) >> df->Gshift, a
+			);
+			int b = mix(
+				( s & sf->Bmask ) >> sf->Bshift, ( d & df->Bmask ) >> df->Bshift, a
+			);
+			
+			return (
+				( Uint32( r ) << df->Rshift ) |
+				( Uint32( g ) << df->Gshift ) |
+				( Uint32( b ) << df->Bshift ) |
+				( d & df->Amask )
+			);
+		}
+	};
+	
+	// reads the pixels of a piece of a 32-bit source, with the masks of the
+	// target, as straight alpha in the top byte, which is what AlphaBlit
+	// blends; the color key becomes a clear pixel, and a source without
+	// alpha is opaque. Reads out of the piece take the nearest pixel of its
+	// border.
+	class Texels
+	{
+	private:
+		const Uint8* pixels;
+		int pitch;
+		SDL_Rect rect;
+		
+		bool alpha;
+		bool keyed;
+		Uint32 rgbmask;
+		Uint32 key;
+	public:
+		Texels(SDL_Surface* src, const SDL_Rect& rect) :
+		pixels( (const Uint8*) src->pixels ), pitch( src->pitch ), rect( rect )
+		{
+			const SDL_PixelFormat* sf = src->format;
+			
+			alpha = ( ( src->flags & SDL_SRCALPHA ) && ( sf->Amask ) );
+			keyed = ( ( !alpha ) && ( src->flags & SDL_SRCCOLORKEY ) );
+			rgbmask = sf->Rmask | sf->Gmask | sf->Bmask;
+			key = sf->colorkey & rgbmask;
+		}
+		
+		Uint32 operator()(int i, int j) const
+		{
+			if( i < 0 )
+				i = 0;
+			else if( i >= rect.w )
+				i = rect.w - 1;
+			
+			if( j < 0 )
+				j = 0;
+			else if( j >= rect.h )
+				j = rect.h - 1;
+			
+			Uint32 p = ( (const Uint32*) ( pixels + ( rect.y + j ) * pitch ) )[ rect.x + i ];
+			
+			if( alpha )
+				return p;
+			if( ( keyed ) && ( ( p & rgbmask ) == key ) )
+				return 0;
+			return ( p | 0xFF000000 );
+		}
+	};
+	
+	// a + ( b - a ) * f / 256 for the four channels, two at a time
+	Uint32 lerp(Uint32 a, Uint32 b, Uint32 f)
+	{
+		Uint32 rb = (
+			( ( a & 0x00FF00FF ) * ( 256 - f ) + ( b & 0x00FF00FF ) * f ) >> 8
+		) & 0x00FF00FF;
+		Uint32 ag = (
+			( ( a >> 8 ) & 0x00FF00FF ) * ( 256 - f ) + ( ( b >> 8 ) & 0x00FF00FF ) * f
+		) & 0xFF00FF00;
+		
+		return ( rb | ag );
+	}
+	
+	// narrows [i0, i1) to the pixels i for which 0 <= a + d * i < size
+	void span(double a, double d, int size, int& i0, int& i1)
+	{
+		double beg, end;
+		
+		if( d > 0 )
+		{
+			beg = ceil( -a / d );
+			end = ceil( ( size - a ) / d );
+		}
+		else if( d < 0 )
+		{
+			beg = floor( ( size - a ) / d ) + 1;
+			end = floor( -a / d ) + 1;
+		}
+		else
+		{
+			if( ( a < 0 ) || ( a >= size ) )
+				i1 = i0;
+			return;
+		}
+		
+		if( beg > i0 )
+			i0 = ( beg < i1 ) ? int( beg ) : i1;
+		if( end < i1 )
+			i1 = ( end > i0 ) ? int( end ) : i0;
+	}
+}
+
+Compositor::Bands::Bands(const Compositor* compositor) : compositor( compositor )
+{
+}
+
+void Compositor::Bands::operator()(int beg, int end) const
+{
+	int y0 = beg * compositor->bandheight;
+	int y1 = end * compositor->bandheight;
+	if( y1 > compositor->target->h )
+		y1 = compositor->target->h;
+	
+	compositor->rasterize( y0, y1 );
+}
+
+Compositor::Compositor(SDL_Surface* target, int bandheight) :
+target( target ), bandheight( ( bandheight > 0 ) ? bandheight : 1 ),
+native( canDraw( target ) ), drawable( native )
+{
+}
+
+Compositor::~Compositor()
+{
+	discard();
+}
+
+void Compositor::blit(SDL_Surface* src, SDL_Rect* srcrect, SDL_Rect* dstrect)
+{
+	record( src, srcrect, dstrect, false );
+}
+
+bool Compositor::blitPremultiplied(SDL_Surface* src, SDL_Rect* srcrect, SDL_Rect* dstrect)
+{
+	if( ( !src ) || ( !native ) || ( src->flags & SDL_RLEACCEL ) ||
+		( !AlphaBlit::fits( src->format, target->format ) ) )
+	{
+		return false;
+	}
+	
+	record( src, srcrect, dstrect, true );
+	return true;
+}
+
+void Compositor::record(
+	SDL_Surface* src,
+	SDL_Rect* srcrect,
+	SDL_Rect* dstrect,
+	bool premultiplied
+)
+{
+	SDL_Rect fulldst;
+	int srcx, srcy, w, h;
+	
+	if( !src )
+		return;
+	
+	if( !dstrect )
+	{
+		fulldst.x = 0;
+		fulldst.y = 0;
+		dstrect = &fulldst;
+	}
+	
+	// the source rectangle is clipped to the source, moving the destination
+	if( srcrect )
+	{
+		srcx = srcrect->x;
+		w = srcrect->w;
+		if( srcx < 0 )
+		{
+			w += srcx;
+			dstrect->x -= srcx;
+			srcx = 0;
+		}
+		if( src->w - srcx < w )
+			w = src->w - srcx;
+		
+		srcy = srcrect->y;
+		h = srcrect->h;
+		if( srcy < 0 )
+		{
+			h += srcy;
+			dstrect->y -= srcy;
+			srcy = 0;
+		}
+		if( src->h - srcy < h )
+			h = src->h - srcy;
+	}
+	else
+	{
+		srcx = 0;
+		srcy = 0;
+		w = src->w;
+		h = src->h;
+	}
+	
+	// and then to the clipping rectangle of the target
+	const SDL_Rect& clip = target->clip_rect;
+	int d = clip.x - dstrect->x;
+	if( d > 0 )
+	{
+		w -= d;
+		dstrect->x += d;
+		srcx += d;
+	}
+	d = dstrect->x + w - clip.x - clip.w;
+	if( d > 0 )
+		w -= d;
+	
+	d = clip.y - dstrect->y;
+	if( d > 0 )
+	{
+		h -= d;
+		dstrect->y += d;
+		srcy += d;
+	}
+	d = dstrect->y + h - clip.y - clip.h;
+	if( d > 0 )
+		h -= d;
+	
+	if( ( w <= 0 ) || ( h <= 0 ) )
+	{
+		dstrect->w = 0;
+		dstrect->h = 0;
+		return;
+	}
+	dstrect->w = w;
+	dstrect->h = h;
+	
+	Command command;
+	command.src = src;
+	command.srcrect.x = srcx;
+	command.srcrect.y = srcy;
+	command.srcrect.w = w;
+	command.srcrect.h = h;
+	command.dstrect = *dstrect;
+	command.color = 0;
+	command.premultiplied = premultiplied;
+	command.transformed = false;
+	
+	// the surface may be freed by its owner before the flush
+	src->refcount++;
+	
+	commands.push_back( command );
+	drawable = ( ( drawable ) && ( canDraw( src ) ) );
+}
+
+void Compositor::fill(SDL_Rect* dstrect, Uint32 color)
+{
+	const SDL_Rect& clip = target->clip_rect;
+	
+	Command command;
+	command.src = NULL;
+	command.srcrect = clip;
+	command.dstrect = clip;
+	command.color = color;
+	command.premultiplied = false;
+	command.transformed = false;
+	
+	if( dstrect )
+	{
+		int x0 = ( dstrect->x > clip.x ) ? dstrect->x : clip.x;
+		int y0 = ( dstrect->y > clip.y ) ? dstrect->y : clip.y;
+		int x1 = ( dstrect->x + dstrect->w < clip.x + clip.w ) ?
+			dstrect->x + dstrect->w : clip.x + clip.w;
+		int y1 = ( dstrect->y + dstrect->h < clip.y + clip.h ) ?
+			dstrect->y + dstrect->h : clip.y + clip.h;
+		
+		if( ( x1 <= x0 ) || ( y1 <= y0 ) )
+			return;
+		
+		command.dstrect.x = x0;
+		command.dstrect.y = y0;
+		command.dstrect.w = x1 - x0;
+		command.dstrect.h = y1 - y0;
+		*dstrect = command.dstrect;
+	}
+	
+	commands.push_back( command );
+}
+
+bool Compositor::transform(
+	SDL_Surface* src,
+	const SDL_Rect& srcrect,
+	const lalge::R2LinearOp& op,
+	double x, double y,
+	Filter filter
+)
+{
+	if( ( !src ) || ( !canTransform( src ) ) )
+		return false;
+	
+	// the piece turns around its center, even if it's partly out of the
+	// source
+	double cx = srcrect.x + srcrect.w / 2.0;
+	double cy = srcrect.y + srcrect.h / 2.0;
+	
+	SDL_Rect rect;
+	rect.x = ( srcrect.x > 0 ) ? srcrect.x : 0;
+	rect.y = ( srcrect.y > 0 ) ? srcrect.y : 0;
+	int w = ( srcrect.x + srcrect.w < src->w ) ? srcrect.x + srcrect.w : src->w;
+	int h = ( srcrect.y + srcrect.h < src->h ) ? srcrect.y + srcrect.h : src->h;
+	
+	// nothing to draw isn't a reason to fall back
+	if( ( w <= rect.x ) || ( h <= rect.y ) || ( !op.det() ) )
+		return true;
+	
+	rect.w = w - rect.x;
+	rect.h = h - rect.y;
+	
+	// the bounding box of the corners, clipped to the target
+	double minx = 0, maxx = 0, miny = 0, maxy = 0;
+	for( int k = 0; k < 4; k++ )
+	{
+		double px = ( ( k & 1 ) ? rect.x + rect.w : rect.x ) - cx;
+		double py = ( ( k & 2 ) ? rect.y + rect.h : rect.y ) - cy;
+		double tx = x + op.a( 0, 0 ) * px + op.a( 0, 1 ) * py;
+		double ty = y + op.a( 1, 0 ) * px + op.a( 1, 1 ) * py;
+		
+		if( ( !k ) || ( tx < minx ) )
+			minx = tx;
+		if( ( !k ) || ( tx > maxx ) )
+			maxx = tx;
+		if( ( !k ) || ( ty < miny ) )
+			miny = ty;
+		if( ( !k ) || ( ty > maxy ) )
+			maxy = ty;
+	}
+	
+	const SDL_Rect& clip = target->clip_rect;
+	double x0 = ( floor( minx ) > clip.x ) ? floor( minx ) : clip.x;
+	double y0 = ( floor( miny ) > clip.y ) ? floor( miny ) : clip.y;
+	double x1 = ( ceil( maxx ) < clip.x + clip.w ) ? ceil( maxx ) : clip.x + clip.w;
+	double y1 = ( ceil( maxy ) < clip.y + clip.h ) ? ceil( maxy ) : clip.y + clip.h;
+	
+	if( ( x1 <= x0 ) || ( y1 <= y0 ) )
+		return true;
+	
+	lalge::R2LinearOp inverse = op.inverse();
+	
+	Command command;
+	command.src = src;
+	command.srcrect = rect;
+	command.dstrect.x = Sint16( x0 );
+	command.dstrect.y = Sint16( y0 );
+	command.dstrect.w = Uint16( x1 - x0 );
+	command.dstrect.h = Uint16( y1 - y0 );
+	command.color = 0;
+	command.premultiplied = false;
+	command.transformed = true;
+	command.filter = filter;
+	command.dudx = inverse.a( 0, 0 );
+	command.dudy = inverse.a( 0, 1 );
+	command.dvdx = inverse.a( 1, 0 );
+	command.dvdy = inverse.a( 1, 1 );
+	command.u = cx - rect.x + command.dudx * ( 0.5 - x ) + command.dudy * ( 0.5 - y );
+	command.v = cy - rect.y + command.dvdx * ( 0.5 - x ) + command.dvdy * ( 0.5 - y );
+	
+	src->refcount++;
+	
+	commands.push_back( command );
+	return true;
+}
+
+void Compositor::flush(bool parallel)
+{
+	if( commands.empty() )
+		return;
+	
+	if( !drawable )
+	{
+		// SDL draws the whole frame, in the order it was recorded
+		for( unsigned int i = 0; i < commands.size(); i++ )
+		{
+			SDL_Rect srcrect = commands[i].srcrect;
+			SDL_Rect dstrect = commands[i].dstrect;
+			
+			// SDL has nothing like these, so they're still drawn here
+			if( ( commands[i].transformed ) || ( commands[i].premultiplied ) )
+			{
+				if( SDL_MUSTLOCK( target ) )
+					SDL_LockSurface( target );
+				
+				draw( commands[i], 0, target->h );
+				
+				if( SDL_MUSTLOCK( target ) )
+					SDL_UnlockSurface( target );
+			}
+			else if( commands[i].src )
+				SDL_BlitSurface( commands[i].src, &srcrect, target, &dstrect );
+			else
+				SDL_FillRect( target, &dstrect, commands[i].color );
+		}
+	}
+	else
+	{
+		if( SDL_MUSTLOCK( target ) )
+			SDL_LockSurface( target );
+		
+		if( ( parallel ) && ( JobSystem::size() > 1 ) )
+		{
+			Bands bands( this );
+			JobSystem::parallelFor( this->bands(), 1, bands );
+		}
+		else
+			rasterize( 0, target->h );
+		
+		if( SDL_MUSTLOCK( target ) )
+			SDL_UnlockSurface( target );
+	}
+	
+	discard();
+}
+
+void Compositor::discard()
+{
+	for( unsigned int i = 0; i < commands.size(); i++ )
+	{
+		if( commands[i].src )
+			SDL_FreeSurface( commands[i].src );
+	}
+	commands.clear();
+	
+	drawable = native;
+}
+
+unsigned int Compositor::size() const
+{
+	return commands.size();
+}
+
+int Compositor::bands() const
+{
+	return ( ( target->h + bandheight - 1 ) / bandheight );
+}
+
+bool Compositor::canDraw(SDL_Surface* surface)
+{
+	const SDL_PixelFormat* format = surface->format;
+	
+	return (
+		( format->BytesPerPixel == 4 ) &&
+		( !format->Rloss ) && ( !format->Gloss ) && ( !format->Bloss ) &&
+		( ( !format->Amask ) || ( !format->Aloss ) ) &&
+		( !( surface->flags & SDL_RLEACCEL ) )
+	);
+}
+
+bool Compositor::canTransform(SDL_Surface* surface) const
+{
+	const SDL_PixelFormat* sf = surface->format;
+	const SDL_PixelFormat* df = target->format;
+	
+	// the samples are blended by AlphaBlit, which wants the target without
+	// alpha and the source with its masks
+	return (
+		( native ) && ( !df->Amask ) &&
+		( ( df->Rmask | df->Gmask | df->Bmask ) == 0x00FFFFFF ) &&
+		( sf->BytesPerPixel == 4 ) &&
+		( sf->Rmask == df->Rmask ) && ( sf->Gmask == df->Gmask ) &&
+		( sf->Bmask == df->Bmask ) &&
+		( ( !sf->Amask ) || ( sf->Amask == 0xFF000000 ) ) &&
+		( !(	( surface->flags & SDL_SRCALPHA ) && ( !sf->Amask ) &&
+			( sf->alpha != SDL_ALPHA_OPAQUE )	) ) &&
+		( !( surface->flags & SDL_RLEACCEL ) )
+	);
+}
+
+void Compositor::rasterize(int y0, int y1) const
+{
+	for( unsigned int i = 0; i < commands.size(); i++ )
+	{
+		const SDL_Rect& dstrect = commands[i].dstrect;
+		
+		if( ( dstrect.y < y1 ) && ( dstrect.y + dstrect.h > y0 ) )
+			draw( commands[i], y0, y1 );
+	}
+}
+
+void Compositor::draw(const Command& command, int y0, int y1) const
+{
+	const SDL_Rect& dstrect = command.dstrect;
+	
+	int beg = ( dstrect.y > y0 ) ? dstrect.y : y0;
+	int end = ( dstrect.y + dstrect.h < y1 ) ? dstrect.y + dstrect.h : y1;
+	
+	Uint8* pixels = (Uint8*) target->pixels;
+	
+	if( command.transformed )
+	{
+		drawTransformed( command, beg, end );
+		return;
+	}
+	
+	if( !command.src )
+	{
+		for( int y = beg; y < end; y++ )
+		{
+			Uint32* dst = (Uint32*) ( pixels + y * target->pitch ) + dstrect.x;
+			for( int i = 0; i < dstrect.w; i++ )
+				dst[i] = command.color;
+		}
+		return;
+	}
+	
+	Row row( command.src, target, command.premultiplied );
+	Uint8* srcpixels = (Uint8*) command.src->pixels;
+	
+	for( int y = beg; y < end; y++ )
+	{
+		const Uint32* src = (const Uint32*) (
+			srcpixels + ( command.srcrect.y + y - dstrect.y ) * command.src->pitch
+		) + command.srcrect.x;
+		Uint32* dst = (Uint32*) ( pixels + y * target->pitch ) + dstrect.x;
+		
+		row( src, dst, dstrect.w );
+	}
+}
+
+void Compositor::drawTransformed(const Command& command, int y0, int y1) const
+{
+	const SDL_Rect& dstrect = command.dstrect;
+	Uint8* pixels = (Uint8*) target->pixels;
+	
+	Texels texels( command.src, command.srcrect );
+	Uint32 samples[ COMPOSITOR_SPAN ];
+	
+	// 16.16 fixed point along the rows
+	Sint32 du = Sint32( command.dudx * 65536 );
+	Sint32 dv = Sint32( command.dvdx * 65536 );
+	
+	for( int y = y0; y < y1; y++ )
+	{
+		double u = command.u + command.dudx * dstrect.x + command.dudy * y;
+		double v = command.v + command.dvdx * dstrect.x + command.dvdy * y;
+		
+		// only the pixels whose centers fall in the source are drawn
+		int i0 = 0, i1 = dstrect.w;
+		span( u, command.dudx, command.srcrect.w, i0, i1 );
+		span( v, command.dvdx, command.srcrect.h, i0, i1 );
+		
+		Sint32 fu = Sint32( ( u + command.dudx * i0 ) * 65536 );
+		Sint32 fv = Sint32( ( v + command.dvdx * i0 ) * 65536 );
+		
+		// bilinear filtering samples around the centers of the pixels
+		if( command.filter == BILINEAR )
+		{
+			fu -= 0x8000;
+			fv -= 0x8000;
+		}
+		
+		Uint32* dst = (Uint32*) ( pixels + y * target->pitch ) + dstrect.x;
+		
+		// sampled into a small buffer and blended by the vector kernels
+		for( int i = i0; i < i1; i += COMPOSITOR_SPAN )
+		{
+			int n = ( i1 - i < COMPOSITOR_SPAN ) ? i1 - i : COMPOSITOR_SPAN;
+			
+			if( command.filter == BILINEAR )
+			{
+				for( int k = 0; k < n; k++ )
+				{
+					int tx = fu >> 16, ty = fv >> 16;
+					Uint32 fx = ( fu >> 8 ) & 0xFF, fy = ( fv >> 8 ) & 0xFF;
+					
+					samples[k] = lerp(
+						lerp( texels( tx, ty ), texels( tx + 1, ty ), fx ),
+						lerp( texels( tx, ty + 1 ), texels( tx + 1, ty + 1 ), fx ),
+						fy
+					);
+					
+					fu += du;
+					fv += dv;
+				}
+			}
+			else
+			{
+				for( int k = 0; k < n; k++ )
+				{
+					samples[k] = texels( fu >> 16, fv >> 16 );
+					
+					fu += du;
+					fv += dv;
+				}
+			}
+			
+			AlphaBlit::blend( samples, dst + i, n );
+		}
+	}
+}
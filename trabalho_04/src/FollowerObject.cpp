@@ -4,9 +4,7 @@
 #include "Camera.hpp"
 
 #define VELOCITY	300
-
-using std::queue;
-using std::list;
+#define WAYPOINTS	128
 
 using namespace lalge;
 
@@ -14,7 +12,18 @@ FollowerObject::FollowerObject (
 	const R2Vector& r,
 	const Scalar& depthconst,
 	Sprite* sprite
-) : Circle ( r, depthconst, sprite->srcW () / 2 ), sprite ( sprite )
+) : Circle ( r, depthconst, sprite->srcW () / 2 ), sprite ( sprite ),
+path ( WAYPOINTS ), finder ( NULL ), finderdepth ( 0 )
+{
+	connect ();
+}
+
+FollowerObject::~FollowerObject ()
+{
+	disconnect ();
+}
+
+void FollowerObject::connect ()
 {
 	InputManager::instance ()->connect (
 		InputManager::MOUSEDOWN_RIGHT,
@@ -23,7 +32,7 @@ FollowerObject::FollowerObject (
 	);
 }
 
-FollowerObject::~FollowerObject ()
+void FollowerObject::disconnect ()
 {
 	InputManager::instance ()->disconnect ( this );
 }
@@ -68,15 +77,27 @@ void FollowerObject::update ()
 	}
 }
 
-void FollowerObject::render ()
+void FollowerObject::snapshot (RenderSnapshot& snap) const
 {
-	if ( sprite )
+	R2Vector camera = snap.camera * depthconst;
+	
+	// the path is drawn below the object, from its destination backwards
+	if ( ( v.length () ) || ( !path.empty () ) )
 	{
-		sprite->render (
-			r.x ( 0 ) - sprite->srcrect ().w / 2 - Camera::r.x ( 0 ) * depthconst,
-			r.x ( 1 ) - sprite->srcrect ().h / 2 - Camera::r.x ( 1 ) * depthconst
-		);
+		snap.drawLine ( dest - camera, r - camera, 0xFFFFFF, 30 );
+		
+		R2Vector vtmp = dest;
+		
+		for ( unsigned int i = 0; i < path.size (); i++ )
+		{
+			snap.drawLine ( path[i] - camera, vtmp - camera, 0xFFFFFF, 30 );
+			
+			vtmp = path[i];
+		}
 	}
+	
+	if ( sprite )
+		snap.drawSprite ( sprite, r - camera );
 }
 
 GameObject* FollowerObject::clone () const
@@ -91,54 +112,45 @@ void FollowerObject::setSprite (Sprite* sprite)
 	setRadius ( sprite->srcrect ().w / 2 );
 }
 
-void FollowerObject::handleMouseDownRight ()
+void FollowerObject::setPathFinder (PathFinder* finder, const Scalar& depth)
 {
-	path.push ( r2vec (
-		InputManager::instance ()->mouseDownX () + Camera::r.x ( 0 ) * depthconst,
-		InputManager::instance ()->mouseDownY () + Camera::r.x ( 1 ) * depthconst
-	) );
+	this->finder = finder;
+	finderdepth = depth;
 }
 
-void FollowerObject::renderLines ()
+void FollowerObject::moveTo (const R2Vector& target)
 {
-	if ( ( v.length () ) || ( !path.empty () ) )
+	if ( !finder )
 	{
-		SDLBase::drawLine (
-			r2vec(
-				dest.x ( 0 ) - Camera::r.x ( 0 ) * depthconst,
-				dest.x ( 1 ) - Camera::r.x ( 1 ) * depthconst
-			),
-			r2vec(
-				r.x ( 0 ) - Camera::r.x ( 0 ) * depthconst,
-				r.x ( 1 ) - Camera::r.x ( 1 ) * depthconst
-			),
-			0xFFFFFF,
-			30
-		);
-		
-		queue< R2Vector, list< R2Vector > > tmp;
-		R2Vector vtmp = dest;
-		
-		while ( !path.empty () )
-		{
-			SDLBase::drawLine (
-				r2vec(
-					path.front ().x ( 0 ) - Camera::r.x ( 0 ) * depthconst,
-					path.front ().x ( 1 ) - Camera::r.x ( 1 ) * depthconst
-				),
-				r2vec(
-					vtmp.x ( 0 ) - Camera::r.x ( 0 ) * depthconst,
-					vtmp.x ( 1 ) - Camera::r.x ( 1 ) * depthconst
-				),
-				0xFFFFFF,
-				30
-			);
-			
-			vtmp = path.front ();
-			tmp.push ( vtmp );
-			path.pop ();
-		}
-		
-		path = tmp;
+		path.push ( target );
+		return;
 	}
+	
+	// the new leg starts where the last one ends
+	R2Vector from = r;
+	if ( !path.empty () )
+		from = path.back ();
+	else if ( v.length () > 0 )
+		from = dest;
+	
+	// the layer is seen where it's drawn now, under the parallax
+	R2Vector offset = Camera::r * ( depthconst - finderdepth );
+	
+	// with no way around the blocked tiles, or no room left for it, it goes
+	// straight, as it does without a path finder
+	if ( !finder->find ( from - offset, target - offset, path, offset ) )
+		path.push ( target );
+}
+
+bool FollowerObject::idle () const
+{
+	return ( ( path.empty () ) && ( !v.length () ) );
+}
+
+void FollowerObject::handleMouseDownRight ()
+{
+	moveTo ( r2vec (
+		InputManager::instance ()->mouseDownX () + Camera::r.x ( 0 ) * depthconst,
+		InputManager::instance ()->mouseDownY () + Camera::r.x ( 1 ) * depthconst
+	) );
 }
@@ -11,6 +11,15 @@ GameObject::~GameObject ()
 {
 }
 
+void GameObject::snapshot (RenderSnapshot&) const
+{
+}
+
+Scalar GameObject::extent () const
+{
+	return 0;
+}
+
 R2Vector GameObject::range (const R2Vector& param) const
 {
 	return ( param - r );
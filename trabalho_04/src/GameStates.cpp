@@ -1,23 +1,221 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/time.h>
+
 #include "GameStates.hpp"
 
 #include "InputManager.hpp"
 #include "Text.hpp"
 #include "Camera.hpp"
+#include "JobSystem.hpp"
+#include "ImageCache.hpp"
+#include "ChunkStream.hpp"
 
 using namespace lalge;
 
 using std::list;
+using std::string;
+using std::vector;
+
+#define COLLISION_GRAIN	64
+#define PARTICLES_CAPACITY	4096
+#define ATLAS_CACHE	"img/StateGame.atlas"
+#define GRAVITY_THETA	0.5f
+#define GRAVITY_G	1000
+#define GRAVITY_SOFTENING	50
+#define GRAVITY_PARALLEL	512
+#define GRID_CELL	256
+#define MASS_EARTH	3200
+#define MASS_MOON	400
+#define MASS_PLANET	50
+#define MASS_SHIP	20
+#define STRESS_CONF	"conf/stress.conf"
+#define STRESS_STEP	( 1000 / 60 )
+#define STRESS_GRAIN	32
+#define STRESS_SHIPGRAIN	4
+#define STRESS_STEER	30
+
+namespace
+{
+	class UpdateJob : public Job
+	{
+	private:
+		GameObject* object;
+	public:
+		UpdateJob(GameObject* object) : object( object ) {}
+		
+		void run()
+		{
+			object->update();
+		}
+	};
+	
+	// bounding boxes of the planets against the ship's
+	class Broadphase
+	{
+	private:
+		const Circle* ship;
+		const vector< Planet* >& planets;
+		vector< char >& hits;
+	public:
+		Broadphase(const Circle* ship, const vector< Planet* >& planets, vector< char >& hits) :
+		ship( ship ), planets( planets ), hits( hits ) {}
+		
+		void operator()(int beg, int end)
+		{
+			for( int i = beg; i < end; i++ )
+			{
+				Scalar reach = ship->radius() + planets[i]->radius();
+				hits[i] = (
+					( fabs( planets[i]->r.x( 0 ) - ship->r.x( 0 ) ) <= reach ) &&
+					( fabs( planets[i]->r.x( 1 ) - ship->r.x( 1 ) ) <= reach )
+				);
+			}
+		}
+	};
+	
+	// exact test of the candidates found by the broadphase
+	class Narrowphase
+	{
+	private:
+		const Circle* ship;
+		const vector< Planet* >& planets;
+		const vector< int >& candidates;
+		vector< char >& hits;
+	public:
+		Narrowphase(const Circle* ship, const vector< Planet* >& planets, const vector< int >& candidates, vector< char >& hits) :
+		ship( ship ), planets( planets ), candidates( candidates ), hits( hits ) {}
+		
+		void operator()(int beg, int end)
+		{
+			for( int i = beg; i < end; i++ )
+				hits[ candidates[i] ] = ship->colliding( *planets[ candidates[i] ] );
+		}
+	};
+	
+	class UpdateRange
+	{
+	private:
+		const vector< GameObject* >& objects;
+	public:
+		UpdateRange(const vector< GameObject* >& objects) : objects( objects ) {}
+		
+		void operator()(int beg, int end)
+		{
+			for( int i = beg; i < end; i++ )
+				objects[i]->update();
+		}
+	};
+	
+	// every ship against every planet, counting the hits without resolving
+	// them, so a run costs the same whatever happens in it
+	class StressCollision
+	{
+	private:
+		const vector< AccObject* >& ships;
+		const vector< Planet* >& planets;
+		vector< int >& counts;
+	public:
+		StressCollision(const vector< AccObject* >& ships, const vector< Planet* >& planets, vector< int >& counts) :
+		ships( ships ), planets( planets ), counts( counts ) {}
+		
+		void operator()(int beg, int end)
+		{
+			vector< char > hits( planets.size(), 0 );
+			
+			for( int i = beg; i < end; i++ )
+			{
+				Broadphase broadphase( ships[i], planets, hits );
+				broadphase( 0, planets.size() );
+				
+				counts[i] = 0;
+				for( unsigned int j = 0; j < hits.size(); j++ )
+				{
+					if( ( hits[j] ) && ( ships[i]->colliding( *planets[j] ) ) )
+						counts[i]++;
+				}
+			}
+		}
+	};
+	
+	double now()
+	{
+		timeval tv;
+		gettimeofday( &tv, NULL );
+		return ( tv.tv_sec + tv.tv_usec / 1000000.0 );
+	}
+	
+	// the objects, all at the same depth, whose bounds overlap the screen,
+	// found through the grid
+	void cull(
+		SpatialGrid& grid,
+		const vector< GameObject* >& objects,
+		const R2Vector& camera,
+		Scalar depth,
+		vector< int >& visible
+	)
+	{
+		grid.clear();
+		for( unsigned int i = 0; i < objects.size(); i++ )
+		{
+			float x = objects[i]->r.x( 0 );
+			float y = objects[i]->r.x( 1 );
+			float e = objects[i]->extent();
+			
+			grid.insert( i, x - e, y - e, x + e, y + e );
+		}
+		
+		float x0 = camera.x( 0 ) * depth;
+		float y0 = camera.x( 1 ) * depth;
+		grid.query( x0, y0, x0 + SDLBase::screen()->w, y0 + SDLBase::screen()->h, visible );
+	}
+	
+	// random point of [0, w) x [0, h)
+	R2Vector anywhere(int w, int h)
+	{
+		return r2vec( rand() % ( w > 0 ? w : 1 ), rand() % ( h > 0 ? h : 1 ) );
+	}
+}
 
 // ==========================================================================
 // StateSplash
 // ==========================================================================
 
+const char* StateSplash::name() const
+{
+	return "StateSplash";
+}
+
+int StateSplash::id() const
+{
+	return STATESPLASH;
+}
+
 void StateSplash::load(MainArgs* args, StateArgs* st_args)
 {
 	if( st_args ){}
 	
 	this->args = args;
 	
+	connect();
+	
+	bgm = arena.track( new ( arena ) Audio( "./sfx/stateLose.mp3" ) );
+	bgm->play();
+	
+	renderMenu();
+}
+
+StateArgs* StateSplash::unload()
+{
+	InputManager::instance()->disconnect( this );
+	
+	return 0;
+}
+
+void StateSplash::connect()
+{
 	InputManager::instance()->connect(
 		InputManager::QUIT,
 		this,
@@ -28,20 +226,16 @@ void StateSplash::load(MainArgs* args, StateArgs* st_args)
 		this,
 		&StateSplash::handleKeyDown
 	);
-	
-	bgm = new Audio( "./sfx/stateLose.mp3" );
-	bgm->play();
-	
-	renderMenu();
 }
 
-StateArgs* StateSplash::unload()
+void StateSplash::suspend()
 {
 	InputManager::instance()->disconnect( this );
-	
-	delete bgm;
-	
-	return 0;
+}
+
+void StateSplash::resume()
+{
+	connect();
 }
 
 int StateSplash::input()
@@ -60,7 +254,7 @@ int StateSplash::update()
 	return tmp;
 }
 
-void StateSplash::render()
+void StateSplash::snapshot(RenderSnapshot&) const
 {
 }
 
@@ -162,6 +356,7 @@ void StateSplash::handleKeyDown()
 // StateGame
 // ==========================================================================
 
+// 'u' for the ufo, 's' for the ship, 'd' when both die in the same step
 struct StateGameArgs : public StateArgs
 {
 	char winner;
@@ -169,54 +364,99 @@ struct StateGameArgs : public StateArgs
 	StateGameArgs(char winner) : winner(winner) {}
 };
 
+// a draw, unless the arguments say otherwise
+static char winnerOf(StateArgs* st_args)
+{
+	return ( st_args ? ( (StateGameArgs*) st_args )->winner : 'd' );
+}
+
+const char* StateGame::name() const
+{
+	return "StateGame";
+}
+
+int StateGame::id() const
+{
+	return STATEGAME;
+}
+
 void StateGame::load(MainArgs* args, StateArgs* st_args)
 {
 	if( st_args ){}
 	
 	this->args = args;
 	
-	InputManager::instance()->connect(
-		InputManager::QUIT,
-		this,
-		&StateGame::handleQuit
-	);
-	InputManager::instance()->connect(
-		InputManager::KEYDOWN,
-		this,
-		&StateGame::handleKeyDown
-	);
-	InputManager::instance ()->connect (
-		InputManager::MOUSEDOWN_LEFT,
-		this,
-		&StateGame::addPlanet
-	);
+	connect();
 	
-	bgm = new Audio( "./sfx/stateGame.mp3" );
-	sfx = new Audio( "./sfx/boom.wav" );
+	bgm = arena.track( new ( arena ) Audio( "./sfx/stateGame.mp3" ) );
+	sfx = arena.track( new ( arena ) Audio( "./sfx/boom.wav", 3, 1 ) );
+	booms = 0;
 	bgm->play();
 	
-	spr_bg = new Sprite( "./img/bg.png" );
-	spr_redplanet = new Sprite( "./img/redplanet.png" );
-	spr_earth = new Sprite( "./img/earth.png" );
-	spr_moon = new Sprite( "./img/moon.png" );
-	spr_ufo = new Sprite( "./img/ufo.png" );
-	
-	anim_ship = new Animation ( "./img/NaveSheet.png", 0, 2000, 1, 4 );
-	anim_shipturn = new Animation ( "./img/NaveTurnSheet.png", 0, 50, 1, 4 );
-	anim_boom = new Animation ( "./img/BoomSheet.png", 0, 100, 1, 8 );
+	// the big images are decoded together, unless they're in the cache
+	vector< string > images;
+	images.push_back( "./img/bg.png" );
+	images.push_back( "./img/Tileset.png" );
+	images.push_back( "./img/BoomSheet.png" );
+	ImageCache::prefetch( images );
+	
+	// the small images share a few surfaces, packed once and then read
+	// from the cache
+	atlas = arena.track( new ( arena ) Atlas() );
+	int id_redplanet = atlas->add( "./img/redplanet.png" );
+	int id_earth = atlas->add( "./img/earth.png" );
+	int id_moon = atlas->add( "./img/moon.png" );
+	int id_ufo = atlas->add( "./img/ufo.png" );
+	int id_ship = atlas->add( "./img/NaveSheet.png" );
+	int id_shipturn = atlas->add( "./img/NaveTurnSheet.png" );
+	atlas->build( args->get( "--path" ) + ATLAS_CACHE );
+	
+	spr_bg = arena.track( new ( arena ) Sprite( "./img/bg.png" ) );
+	spr_redplanet = arena.track( new ( arena ) Sprite( atlas->region( id_redplanet ) ) );
+	spr_earth = arena.track( new ( arena ) Sprite( atlas->region( id_earth ) ) );
+	spr_moon = arena.track( new ( arena ) Sprite( atlas->region( id_moon ) ) );
+	spr_ufo = arena.track( new ( arena ) Sprite( atlas->region( id_ufo ) ) );
+	
+	anim_ship = arena.track( new ( arena ) Animation(
+		atlas->region( id_ship ), 0, 2000, 1, 4
+	) );
+	anim_shipturn = arena.track( new ( arena ) Animation(
+		atlas->region( id_shipturn ), 0, 50, 1, 4
+	) );
+	
+	particles = arena.track( new ( arena ) ParticleSystem( PARTICLES_CAPACITY ) );
+	Configuration fxconf;
+	try {
+		fxconf.readTxt( args->get( "--path" ) + "conf/particles.conf" );
+	} catch (Configuration::FileNotFound& e) {
+	}
+	particles->load( fxconf );
+	fx_boom = particles->find( "boom" );
+	fx_debris = particles->find( "debris" );
+	
+	tileset = arena.track( new ( arena ) TileSet( "./img/Tileset.png", 75, 75 ) );
+	Configuration tileconf;
+	try {
+		tileconf.readTxt( args->get( "--path" ) + "conf/tiles.conf" );
+	} catch (Configuration::FileNotFound& e) {
+	}
+	tileset->load( tileconf );
 	
-	tileset = new TileSet ( "./img/Tileset.png", 75, 75 );
-	tilemap = new TileMap ( tileset, "./map/tilemap.txt" );
+	// a chunked map, when there's one, is streamed instead
+	string map = "./map/tilemap.chunks";
+	if( !ChunkStream::isChunked( map ) )
+		map = "./map/tilemap.txt";
+	tilemap = arena.track( new ( arena ) TileMap( tileset, map ) );
 	
-	earth = new Earth (
-		r2vec ( ( rand () % 2001 ) - 600, ( rand () % 1801 ) - 300 ),
-		tilemap->layers () + 1,
+	earth = arena.track( new ( arena ) Earth(
+		r2vec( ( rand() % 2001 ) - 600, ( rand() % 1801 ) - 300 ),
+		tilemap->layers() + 1,
 		spr_earth,
 		10
-	);
-	moon = new Moon (
-		R2Vector (), tilemap->layers () + 1, spr_moon, earth
-	);
+	) );
+	moon = arena.track( new ( arena ) Moon(
+		R2Vector(), tilemap->layers() + 1, spr_moon, earth
+	) );
 	
 	R2Vector tmp;
 	do {
@@ -234,51 +474,89 @@ void StateGame::load(MainArgs* args, StateArgs* st_args)
 		tilemap->layers () + 1,
 		spr_ufo
 	);
+	
+	// the ufo flies around the tiles of the nearest layer
+	pathfinder = arena.track( new ( arena ) PathFinder( tilemap, tilemap->layers() - 1 ) );
+	ufo->setPathFinder( pathfinder, tilemap->layers() );
+	
+	gravity = arena.track( new ( arena ) Gravity(
+		GRAVITY_THETA, GRAVITY_G, GRAVITY_SOFTENING
+	) );
+	grid = arena.track( new ( arena ) SpatialGrid( GRID_CELL ) );
 }
 
 StateArgs* StateGame::unload()
 {
-	StateArgs* ret;
-	
 	InputManager::instance()->disconnect( this );
 	
-	delete bgm;
-	delete sfx;
-	
-	delete spr_bg;
-	delete spr_redplanet;
-	delete spr_earth;
-	delete spr_moon;
-	delete spr_ufo;
-	
-	delete anim_ship;
-	delete anim_shipturn;
-	delete anim_boom;
-	
-	delete tileset;
-	delete tilemap;
-	
+	// everything else was allocated in the arena and is released by the
+	// state manager, only the objects that may die during the game are
+	// freed here
 	while( planets.size () )
 	{
 		delete planets.back();
 		planets.pop_back();
 	}
 	
-	delete earth;
-	delete moon;
+	// a single step may kill both of them
+	char winner = 'd';
+	if( ( ufo ) && ( !ship ) )
+		winner = 'u';
+	else if( ( ship ) && ( !ufo ) )
+		winner = 's';
+	
+	delete ufo;
+	delete ship;
 	
+	return new StateGameArgs( winner );
+}
+
+void StateGame::connect()
+{
+	InputManager::instance()->connect(
+		InputManager::QUIT,
+		this,
+		&StateGame::handleQuit
+	);
+	InputManager::instance()->connect(
+		InputManager::KEYDOWN,
+		this,
+		&StateGame::handleKeyDown
+	);
+	InputManager::instance ()->connect (
+		InputManager::MOUSEDOWN_LEFT,
+		this,
+		&StateGame::addPlanet
+	);
+}
+
+void StateGame::suspend()
+{
+	// the world stays as it is, only the clock of the game stops
+	InputManager::instance()->disconnect( this );
+	if( ship )
+		ship->disconnect();
 	if( ufo )
-	{
-		ret = new StateGameArgs( 'u' );
-		delete ufo;
-	}
+		ufo->disconnect();
+	
+	gameover.pause();
+	newplanet.pause();
+	
+	bgm->stop();
+}
+
+void StateGame::resume()
+{
+	connect();
 	if( ship )
-	{
-		ret = new StateGameArgs( 's' );
-		delete ship;
-	}
+		ship->connect();
+	if( ufo )
+		ufo->connect();
+	
+	gameover.resume();
+	newplanet.resume();
 	
-	return ret;
+	bgm->play();
 }
 
 int StateGame::input()
@@ -293,16 +571,39 @@ int StateGame::input()
 
 int StateGame::update()
 {
-	earth->update();
-	moon->update();
+	pull();
+	
+	booms = 0;
 	
+	// the objects are independent, except for the moon, which follows the
+	// earth
+	UpdateJob earthjob( earth ), moonjob( moon ), ufojob( ufo ), shipjob( ship );
+	
+	JobSystem::depend( &moonjob, &earthjob );
+	JobSystem::submit( &earthjob );
+	JobSystem::submit( &moonjob );
 	if( ufo )
-		ufo->update();
+		JobSystem::submit( &ufojob );
+	if( ( ufo ) && ( ship ) )
+		JobSystem::submit( &shipjob );
+	
+	particles->update( float( SDLBase::dt() ) / 1000 );
 	
+	vector< GameObject* > drifting( planets.begin(), planets.end() );
+	UpdateRange updater( drifting );
+	JobSystem::parallelFor( drifting.size(), COLLISION_GRAIN, updater );
+	
+	JobSystem::wait( &moonjob );
+	if( ufo )
+		JobSystem::wait( &ufojob );
 	if( ( ufo ) && ( ship ) )
-		ship->update();
+		JobSystem::wait( &shipjob );
 	
-	anim_boom->update();
+	// the camera moves as the ship does, but on its own plane
+	R2Vector v;
+	if( ship )
+		v = ship->velocity() * ( 1.0 / ( tilemap->layers() + 1 ) );
+	tilemap->prefetch( Camera::r.x( 0 ), Camera::r.x( 1 ), v.x( 0 ), v.x( 1 ) );
 	
 	checkCollision();
 	checkGameOver();
@@ -313,47 +614,43 @@ int StateGame::update()
 	return tmp;
 }
 
-void StateGame::render()
+void StateGame::snapshot(RenderSnapshot& snap) const
 {
-	spr_bg->render( 0, 0 );
+	snap.camera = Camera::r;
+	
+	snap.drawSprite( spr_bg, 0, 0 );
 	
 	for( int k = 0; k < tilemap->layers(); ++k )
 	{
-		tilemap->renderLayer(
+		snap.drawLayer(
+			tilemap,
 			k,
-			Camera::r.x( 0 ) * ( k + 1 ),
-			Camera::r.x( 1 ) * ( k + 1 )
+			snap.camera.x( 0 ) * ( k + 1 ),
+			snap.camera.x( 1 ) * ( k + 1 )
 		);
 	}
 	
-	earth->render();
-	moon->render();
-	
+	// only the objects over the screen are recorded, so the ones away
+	// from it cost neither a blit nor a rotozoom
+	vector< GameObject* > objects;
+	objects.push_back( earth );
+	objects.push_back( moon );
 	if( ship )
-		ship->render();
+		objects.push_back( ship );
+	objects.insert( objects.end(), planets.begin(), planets.end() );
 	
-	for(
-		list< Planet* >::iterator it = planets.begin();
-		it != planets.end();
-		++it
-	)
-	{	
-		(*it)->render();
-	}
+	vector< int > visible;
+	cull( *grid, objects, snap.camera, tilemap->layers() + 1, visible );
+	for( unsigned int i = 0; i < visible.size(); i++ )
+		objects[ visible[i] ]->snapshot( snap );
 	
-	if( boom_r.length() )
-	{
-		anim_boom->render(
-			boom_r.x( 0 ) - anim_boom->rectW() / 2 - Camera::r.x( 0 ) * ( tilemap->layers() + 1 ),
-			boom_r.x( 1 ) - anim_boom->rectH() / 2 - Camera::r.x( 1 ) * ( tilemap->layers() + 1 )
-     	);
-	}
+	particles->snapshot( snap, snap.camera * ( tilemap->layers() + 1 ) );
 	
 	if( ufo )
-	{
-		ufo->renderLines();
-		ufo->render();
-	}
+		ufo->snapshot( snap );
+	
+	for( int i = 0; i < booms; i++ )
+		snap.playAudio( sfx, 1 );
 }
 
 void StateGame::handleQuit()
@@ -374,8 +671,9 @@ void StateGame::handleKeyDown()
 		break;
 		
 	case SDLK_m:
+		// the game is kept below the menu, which resumes it
 		if( gameover.unused() )
-			newstate = STATESPLASH;
+			newstate = STATEPUSH | STATESPLASH;
 		break;
 		
 	default:
@@ -404,27 +702,96 @@ void StateGame::addPlanet()
 
 void StateGame::showFPS()
 {
-	// debugging tool to show FPS
-	if(	( args->find( "-fps" ) ) &&
+	// debugging tool to show FPS and the load of the worker threads
+	if(	( args->find( "-fps" ) != -1 ) &&
 			( InputManager::instance()->keyPressed( SDLK_f ) )	)
+	{
 		printf ( "FPS: %.1f\n", SDLBase::FPS() );
+		
+		for( int i = 0; i < JobSystem::size(); i++ )
+		{
+			printf(
+				"Worker %d: %.1f%% busy, %u jobs\n",
+				i,
+				JobSystem::utilization( i ) * 100,
+				JobSystem::executed( i )
+			);
+		}
+		JobSystem::resetStats();
+	}
+}
+
+void StateGame::pull()
+{
+	// the earth and the moon keep to their orbit, but they pull the others
+	gravity->clear();
+	gravity->add( earth->r, MASS_EARTH );
+	gravity->add( moon->r, MASS_MOON );
+	
+	for(
+		list< Planet* >::const_iterator it = planets.begin();
+		it != planets.end();
+		++it
+	)
+	{
+		gravity->add( (*it)->r, MASS_PLANET );
+	}
+	
+	int id_ship = -1;
+	if( ship )
+		id_ship = gravity->add( ship->r, MASS_SHIP );
+	
+	gravity->build();
+	gravity->solve( gravity->size() >= GRAVITY_PARALLEL );
+	
+	// only red planets are added by the player
+	int i = 2;
+	for(
+		list< Planet* >::iterator it = planets.begin();
+		it != planets.end();
+		++it, ++i
+	)
+	{
+		( (RedPlanet*) (*it) )->a = gravity->acceleration( i );
+	}
+	
+	if( ship )
+		ship->gravity = gravity->acceleration( id_ship );
 }
 
 void StateGame::checkCollision()
 {
 	if( ( ufo ) && ( ship ) )
 	{
+		// the tests run in parallel, but the hits are resolved serially in
+		// the order of the list, so the outcome doesn't depend on timing
+		vector< Planet* > tested( planets.begin(), planets.end() );
+		vector< char > hits( tested.size(), 0 );
+		vector< int > candidates;
+		
+		Broadphase broadphase( ship, tested, hits );
+		JobSystem::parallelFor( tested.size(), COLLISION_GRAIN, broadphase );
+		
+		for( unsigned int i = 0; i < hits.size(); i++ )
+		{
+			if( hits[i] )
+				candidates.push_back( i );
+		}
+		
+		Narrowphase narrowphase( ship, tested, candidates, hits );
+		JobSystem::parallelFor( candidates.size(), COLLISION_GRAIN, narrowphase );
+		
 		list< Planet* >::iterator it = planets.begin();
 		
-		while( it != planets.end() )
+		for( unsigned int i = 0; it != planets.end(); i++ )
 		{
-			if( !(*it)->colliding( *ship ) )
+			if( !hits[i] )
 				++it;
 			else
 			{
-				sfx->play( 1 );
+				booms++;
 				
-				boom_r = (*it)->r;
+				explode( (*it)->r );
 				ship->hp--;
 				
 				delete( *it );
@@ -434,17 +801,17 @@ void StateGame::checkCollision()
 		
 		if( ship->colliding( *ufo ) )
 		{
-			sfx->play( 1 );
+			booms++;
 			
-			boom_r = ship->r;
+			explode( ship->r );
 			ship->hp = 0;
 		}
 		
 		if( ship->colliding( *earth ) )
 		{
-			sfx->play( 1 );
+			booms++;
 			
-			boom_r = ufo->r;
+			explode( ufo->r );
 			
 			delete ufo;
 			ufo = NULL;
@@ -454,7 +821,7 @@ void StateGame::checkCollision()
 		
 		if( ship->hp <= 0 )
 		{
-			boom_r = ship->r;
+			explode( ship->r );
 			
 			delete ship;
 			ship = NULL;
@@ -470,14 +837,50 @@ void StateGame::checkGameOver()
 		newstate = STATEWINLOSE;
 }
 
+void StateGame::explode(const R2Vector& r)
+{
+	particles->emit( fx_boom, r );
+	particles->emit( fx_debris, r );
+}
+
 // ==========================================================================
 // StateWinLose
 // ==========================================================================
 
+const char* StateWinLose::name() const
+{
+	return "StateWinLose";
+}
+
+int StateWinLose::id() const
+{
+	return STATEWINLOSE;
+}
+
 void StateWinLose::load(MainArgs* args, StateArgs* st_args)
 {
 	this->args = args;
 	
+	connect();
+	
+	if( winnerOf( st_args ) != 's' )
+		bgm = arena.track( new ( arena ) Audio( "./sfx/stateLose.mp3" ) );
+	else
+		bgm = arena.track( new ( arena ) Audio( "./sfx/stateWin.mp3" ) );
+	bgm->play();
+	
+	renderMenu( st_args );
+}
+
+StateArgs* StateWinLose::unload()
+{
+	InputManager::instance()->disconnect( this );
+	
+	return 0;
+}
+
+void StateWinLose::connect()
+{
 	InputManager::instance()->connect(
 		InputManager::QUIT,
 		this,
@@ -488,23 +891,16 @@ void StateWinLose::load(MainArgs* args, StateArgs* st_args)
 		this,
 		&StateWinLose::handleKeyDown
 	);
-	
-	if( ( (StateGameArgs*) st_args )->winner == 'u' )
-		bgm = new Audio( "./sfx/stateLose.mp3" );
-	else
-		bgm = new Audio( "./sfx/stateWin.mp3" );
-	bgm->play();
-	
-	renderMenu( st_args );
 }
 
-StateArgs* StateWinLose::unload()
+void StateWinLose::suspend()
 {
 	InputManager::instance()->disconnect( this );
-	
-	delete bgm;
-	
-	return 0;
+}
+
+void StateWinLose::resume()
+{
+	connect();
 }
 
 int StateWinLose::input()
@@ -523,7 +919,7 @@ int StateWinLose::update()
 	return tmp;
 }
 
-void StateWinLose::render()
+void StateWinLose::snapshot(RenderSnapshot&) const
 {
 }
 
@@ -532,7 +928,9 @@ void StateWinLose::renderMenu(StateArgs* st_args)
 	Sprite* bg;
 	Text* text;
 	
-	if( ( (StateGameArgs*) st_args )->winner == 'u' )
+	char winner = winnerOf( st_args );
+	
+	if( winner == 'u' )
 	{
 		bg = new Sprite( "./img/stateLose.jpg" );
 		text = new Text(
@@ -541,6 +939,15 @@ void StateWinLose::renderMenu(StateArgs* st_args)
 			SDLBase::getColor( 255, 255, 255 ), Text::blended
 		);
 	}
+	else if( winner != 's' )
+	{
+		bg = new Sprite( "./img/stateLose.jpg" );
+		text = new Text(
+			"./ttf/DiabloLight.ttf",
+			"Draw", 45, TTF_STYLE_BOLD,
+			SDLBase::getColor( 255, 255, 255 ), Text::blended
+		);
+	}
 	else
 	{
 		bg = new Sprite( "./img/stateWin.jpg" );
@@ -635,3 +1042,387 @@ void StateWinLose::handleKeyDown()
 		break;
 	}
 }
+
+// ==========================================================================
+// StateStress
+// ==========================================================================
+
+// each scenario runs in a fresh state, so the main thread never draws a map
+// that the next scenario is resizing
+struct StateStressArgs : public StateArgs
+{
+	unsigned int next;
+	
+	StateStressArgs(unsigned int next) : next(next) {}
+};
+
+const char* StateStress::name() const
+{
+	return "StateStress";
+}
+
+int StateStress::id() const
+{
+	return STATESTRESS;
+}
+
+void StateStress::load(MainArgs* args, StateArgs* st_args)
+{
+	this->args = args;
+	
+	connect();
+	
+	string path = args->get( "-stress" );
+	if( ( path.empty() ) || ( path[0] == '-' ) )
+		path = args->get( "--path" ) + STRESS_CONF;
+	
+	Configuration conf;
+	try {
+		conf.readTxt( path );
+	} catch (Configuration::FileNotFound& e) {
+		throw( mexception( "StateStress: can't read " + path ) );
+	} catch (Configuration::VarAlreadyExisting& e) {
+		throw( mexception( "StateStress: repeated scenario in " + path ) );
+	} catch (mexception& e) {
+		throw( mexception( "StateStress: can't parse " + path + ": " + e.what() ) );
+	}
+	
+	ConfigBinding< Scenario > binding;
+	binding
+		.bind( "planets", &Scenario::planets, 0 )
+		.bind( "followers", &Scenario::followers, 0 )
+		.bind( "ships", &Scenario::ships, 0 )
+		.bind( "map_w", &Scenario::map_w, 16 )
+		.bind( "map_h", &Scenario::map_h, 16 )
+		.bind( "layers", &Scenario::layers, 3 )
+		.bind( "density", &Scenario::density, 20 )
+		.bind( "frames", &Scenario::frames, 300 )
+		.bind( "warmup", &Scenario::warmup, 30 )
+		.bind( "seed", &Scenario::seed, 1 );
+	
+	for(
+		Configuration::Iterator it = conf.beginConfigs();
+		it.valid();
+		it.next()
+	)
+	{
+		Scenario scenario;
+		try {
+			binding.load( it.config(), scenario );
+		} catch (mexception& e) {
+			throw( mexception(
+				"StateStress: bad scenario " + it.name() + " in " + path + ": " + e.what()
+			) );
+		}
+		scenario.name = it.name();
+		
+		if( scenario.map_w < 1 )
+			scenario.map_w = 1;
+		if( scenario.map_h < 1 )
+			scenario.map_h = 1;
+		if( scenario.layers < 1 )
+			scenario.layers = 1;
+		if( scenario.frames < 1 )
+			scenario.frames = 1;
+		if( scenario.warmup < 0 )
+			scenario.warmup = 0;
+		
+		scenarios.push_back( scenario );
+	}
+	
+	spr_planet = arena.track( new ( arena ) Sprite( "./img/redplanet.png" ) );
+	spr_follower = arena.track( new ( arena ) Sprite( "./img/ufo.png" ) );
+	
+	anim_ship = arena.track( new ( arena ) Animation(
+		"./img/NaveSheet.png", 0, 2000, 1, 4
+	) );
+	anim_shipturn = arena.track( new ( arena ) Animation(
+		"./img/NaveTurnSheet.png", 0, 50, 1, 4
+	) );
+	
+	tileset = arena.track( new ( arena ) TileSet( "./img/Tileset.png", 75, 75 ) );
+	tilemap = arena.track( new ( arena ) TileMap( tileset ) );
+	pathfinder = NULL;
+	grid = arena.track( new ( arena ) SpatialGrid( GRID_CELL ) );
+	
+	// every frame lasts the same, as fast as the machine goes
+	SDLBase::setStep( STRESS_STEP );
+	
+	current = ( st_args ? ( (StateStressArgs*) st_args )->next : 0 );
+	
+	if( !current )
+	{
+		printf(
+			"scenario\tplanets\tfollowers\tships\tobjects\tmap_w\tmap_h\tlayers\t"
+			"tiles\tmap_kb\tframes\tcollisions\tupdate_ms\trender_ms\tframe_ms\tworst_ms\t"
+			"scale\tdraw_ms\tupscale_ms\n"
+		);
+	}
+	
+	if( current < scenarios.size() )
+		begin();
+	else
+		newstate = STATEQUIT;
+}
+
+StateArgs* StateStress::unload()
+{
+	InputManager::instance()->disconnect( this );
+	
+	end();
+	SDLBase::setStep( 0 );
+	
+	return new StateStressArgs( current + 1 );
+}
+
+void StateStress::connect()
+{
+	InputManager::instance()->connect(
+		InputManager::QUIT,
+		this,
+		&StateStress::handleQuit
+	);
+}
+
+void StateStress::handleQuit()
+{
+	newstate = STATEQUIT;
+}
+
+void StateStress::begin()
+{
+	const Scenario& s = scenarios[ current ];
+	
+	srand( s.seed );
+	
+	// the nearest layer blocks the followers, as in the game
+	tilemap->resize( s.layers, s.map_w, s.map_h );
+	tiles = 0;
+	for( int k = 0; k < s.layers; k++ )
+	{
+		for( int i = 0; i < s.map_h; i++ )
+		{
+			for( int j = 0; j < s.map_w; j++ )
+			{
+				if( rand() % 100 < s.density )
+				{
+					tilemap->at( k, i, j ) = rand() % tileset->size();
+					tiles++;
+				}
+			}
+		}
+	}
+	pathfinder = new PathFinder( tilemap, s.layers - 1 );
+	
+	int w = s.map_w * tileset->tileW();
+	int h = s.map_h * tileset->tileH();
+	
+	// the objects don't listen to the input, so thousands of them don't
+	// make each event go through thousands of observers
+	for( int i = 0; i < s.planets; i++ )
+	{
+		planets.push_back( new RedPlanet(
+			anywhere( w, h ), s.layers + 1, spr_planet
+		) );
+		objects.push_back( planets.back() );
+	}
+	for( int i = 0; i < s.followers; i++ )
+	{
+		followers.push_back( new FollowerObject(
+			anywhere( w, h ), s.layers + 1, spr_follower
+		) );
+		followers.back()->disconnect();
+		followers.back()->setPathFinder( pathfinder, s.layers );
+		objects.push_back( followers.back() );
+	}
+	for( int i = 0; i < s.ships; i++ )
+	{
+		ships.push_back( new AccObject(
+			anywhere( w, h ), s.layers + 1, anim_ship, anim_shipturn, 20
+		) );
+		ships.back()->disconnect();
+		
+		// only the first ship moves the camera, the others would race
+		// for it
+		ships.back()->setCamera( !i );
+		objects.push_back( ships.back() );
+	}
+	
+	frame = -s.warmup;
+	collisions = 0;
+	update_ms = 0;
+	frame_ms = 0;
+	worst_ms = 0;
+	last = now();
+	
+	SDLBase::resetFrameStats();
+}
+
+void StateStress::end()
+{
+	for( unsigned int i = 0; i < objects.size(); i++ )
+		delete objects[i];
+	
+	objects.clear();
+	planets.clear();
+	followers.clear();
+	ships.clear();
+	
+	delete pathfinder;
+	pathfinder = NULL;
+}
+
+void StateStress::report() const
+{
+	const Scenario& s = scenarios[ current ];
+	
+	// the screen is shown in the frames measured and in the warm up
+	const SDLBase::FrameStats& shown = SDLBase::frameStats();
+	unsigned int frames = shown.frames ? shown.frames : 1;
+	
+	printf(
+		"%s\t%d\t%d\t%d\t%u\t%d\t%d\t%d\t%d\t%lu\t%d\t%lu\t%.3f\t%.3f\t%.3f\t%.3f\t"
+		"%d\t%.3f\t%.3f\n",
+		s.name.c_str(),
+		s.planets,
+		s.followers,
+		s.ships,
+		(unsigned int) objects.size(),
+		s.map_w,
+		s.map_h,
+		s.layers,
+		tiles,
+		tilemap->bytes() / 1024,
+		s.frames,
+		collisions,
+		update_ms / s.frames,
+		( frame_ms - update_ms ) / s.frames,
+		frame_ms / s.frames,
+		worst_ms,
+		SDLBase::scale(),
+		shown.draw / frames,
+		shown.upscale / frames
+	);
+	fflush( stdout );
+}
+
+int StateStress::input()
+{
+	// a frame goes from one input to the next, so it has the update, the
+	// snapshot and the presentation
+	double t = now();
+	if( frame > 0 )
+	{
+		double ms = ( t - last ) * 1000;
+		
+		frame_ms += ms;
+		if( ms > worst_ms )
+			worst_ms = ms;
+	}
+	last = t;
+	
+	// the next scenario is loaded by a new state, after the pipeline has
+	// stopped and dropped the snapshots of this one
+	if( ( !newstate ) && ( frame >= scenarios[ current ].frames ) )
+	{
+		report();
+		
+		if( current + 1 < scenarios.size() )
+			newstate = STATESTRESS;
+		else
+			newstate = STATEQUIT;
+	}
+	
+	// don't change this
+	int tmp = newstate;
+	newstate = 0;
+	return tmp;
+}
+
+int StateStress::update()
+{
+	double t = now();
+	
+	steer();
+	
+	UpdateRange updater( objects );
+	JobSystem::parallelFor( objects.size(), STRESS_GRAIN, updater );
+	
+	checkCollision();
+	
+	if( frame >= 0 )
+		update_ms += ( now() - t ) * 1000;
+	frame++;
+	
+	// don't change this
+	int tmp = newstate;
+	newstate = 0;
+	return tmp;
+}
+
+void StateStress::snapshot(RenderSnapshot& snap) const
+{
+	snap.camera = Camera::r;
+	
+	for( int k = 0; k < tilemap->layers(); ++k )
+	{
+		snap.drawLayer(
+			tilemap,
+			k,
+			snap.camera.x( 0 ) * ( k + 1 ),
+			snap.camera.x( 1 ) * ( k + 1 )
+		);
+	}
+	
+	// the followers draw their path too, which may cross the screen while
+	// they're away from it
+	vector< int > visible;
+	cull( *grid, objects, snap.camera, scenarios[ current ].layers + 1, visible );
+	for( unsigned int i = 0; i < visible.size(); i++ )
+	{
+		if( visible[i] < int( planets.size() ) )
+			objects[ visible[i] ]->snapshot( snap );
+	}
+	for( unsigned int i = 0; i < followers.size(); i++ )
+		followers[i]->snapshot( snap );
+	for( unsigned int i = 0; i < visible.size(); i++ )
+	{
+		if( visible[i] >= int( planets.size() + followers.size() ) )
+			objects[ visible[i] ]->snapshot( snap );
+	}
+}
+
+void StateStress::steer()
+{
+	// serially, so the same seed gives the same run
+	const Scenario& s = scenarios[ current ];
+	int w = s.map_w * tileset->tileW();
+	int h = s.map_h * tileset->tileH();
+	
+	for( unsigned int i = 0; i < followers.size(); i++ )
+	{
+		if( followers[i]->idle() )
+			followers[i]->moveTo( anywhere( w, h ) );
+	}
+	
+	// each ship holds its keys for a while, as a player would
+	for( unsigned int i = 0; i < ships.size(); i++ )
+	{
+		if( !( rand() % STRESS_STEER ) )
+			ships[i]->steer( ( rand() % 4 ) != 0, rand() % 3 - 1 );
+	}
+}
+
+void StateStress::checkCollision()
+{
+	vector< int > counts( ships.size(), 0 );
+	
+	StressCollision collision( ships, planets, counts );
+	JobSystem::parallelFor( ships.size(), STRESS_SHIPGRAIN, collision );
+	
+	if( frame >= 0 )
+	{
+		for( unsigned int i = 0; i < counts.size(); i++ )
+			collisions += counts[i];
+	}
+}
@@ -136,6 +136,11 @@ const Scalar& Circle::radius () const
 	return radius_;
 }
 
+Scalar Circle::extent () const
+{
+	return radius_;
+}
+
 void Circle::setRadius (const Scalar& radius)
 {
 	if ( radius <= 0 )
@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Gravity.hpp"
+
+#include "JobSystem.hpp"
+
+// deepest level of the tree, where bodies too close to be told apart share
+// a leaf
+#define GRAVITY_DEPTH	24
+#define GRAVITY_STACK	( 3 * GRAVITY_DEPTH + 8 )
+#define GRAVITY_GRAIN	256
+
+using namespace lalge;
+
+using std::vector;
+
+namespace
+{
+	// the pulls of a range of bodies, each range summing its own count
+	class Pass
+	{
+	private:
+		Gravity* gravity;
+		bool exact;
+		vector< unsigned long int >& counts;
+	public:
+		Pass(Gravity* gravity, bool exact, vector< unsigned long int >& counts) :
+		gravity( gravity ), exact( exact ), counts( counts ) {}
+		
+		void operator()(int beg, int end)
+		{
+			counts[ beg / GRAVITY_GRAIN ] = exact ? gravity->brute( beg, end ) : gravity->solve( beg, end );
+		}
+	};
+}
+
+Gravity::Gravity(float theta, float g, float softening) :
+opening( theta ), constant( g ), softening( softening )
+{
+	stats_.nodes = 0;
+	stats_.depth = 0;
+	resetStats();
+}
+
+void Gravity::setTheta(float theta)
+{
+	opening = ( theta > 0 ) ? theta : 0;
+}
+
+float Gravity::theta() const
+{
+	return opening;
+}
+
+void Gravity::clear()
+{
+	x.clear();
+	y.clear();
+	mass.clear();
+	ax.clear();
+	ay.clear();
+	next.clear();
+	nodes.clear();
+}
+
+int Gravity::add(const R2Vector& r, float mass)
+{
+	return add( float( r.x( 0 ) ), float( r.x( 1 ) ), mass );
+}
+
+int Gravity::add(float x, float y, float mass)
+{
+	// a body without mass is pulled, but pulls nothing
+	this->x.push_back( x );
+	this->y.push_back( y );
+	this->mass.push_back( ( mass > 0 ) ? mass : 0 );
+	ax.push_back( 0 );
+	ay.push_back( 0 );
+	
+	return ( this->x.size() - 1 );
+}
+
+int Gravity::size() const
+{
+	return x.size();
+}
+
+void Gravity::build()
+{
+	nodes.clear();
+	next.assign( x.size(), -1 );
+	stats_.nodes = 0;
+	stats_.depth = 0;
+	
+	if( x.empty() )
+		return;
+	
+	float minx = x[0], maxx = x[0];
+	float miny = y[0], maxy = y[0];
+	for( unsigned int i = 1; i < x.size(); i++ )
+	{
+		minx = std::min( minx, x[i] );
+		maxx = std::max( maxx, x[i] );
+		miny = std::min( miny, y[i] );
+		maxy = std::max( maxy, y[i] );
+	}
+	
+	// a bit larger, so the bodies on the far edges fall inside
+	float side = std::max( maxx - minx, maxy - miny ) * 1.001f + 1;
+	
+	Node root = { minx, miny, side, 0, 0, 0, -1, -1, 0 };
+	nodes.reserve( 2 * x.size() );
+	nodes.push_back( root );
+	
+	for( unsigned int i = 0; i < x.size(); i++ )
+		insert( i );
+	
+	accumulate();
+	stats_.nodes = nodes.size();
+}
+
+void Gravity::insert(int body)
+{
+	int n = 0, depth = 0;
+	
+	for( ;; )
+	{
+		if( nodes[n].child >= 0 )
+		{
+			float half = nodes[n].side / 2;
+			int q = ( x[ body ] >= nodes[n].x0 + half ) + 2 * ( y[ body ] >= nodes[n].y0 + half );
+			
+			n = nodes[n].child + q;
+			depth++;
+			continue;
+		}
+		
+		if( ( !nodes[n].count ) || ( depth >= GRAVITY_DEPTH ) )
+		{
+			next[ body ] = nodes[n].body;
+			nodes[n].body = body;
+			nodes[n].count++;
+			
+			if( depth > stats_.depth )
+				stats_.depth = depth;
+			return;
+		}
+		
+		// a leaf above the bottom holds a single body, which goes down
+		// one level before the new one is put again
+		split( n );
+	}
+}
+
+void Gravity::split(int node)
+{
+	Node cell = nodes[ node ];
+	float half = cell.side / 2;
+	int child = nodes.size();
+	
+	for( int q = 0; q < 4; q++ )
+	{
+		Node leaf = {
+			cell.x0 + half * ( q & 1 ), cell.y0 + half * ( q >> 1 ), half,
+			0, 0, 0, -1, -1, 0
+		};
+		nodes.push_back( leaf );
+	}
+	
+	int body = cell.body;
+	int q = ( x[ body ] >= cell.x0 + half ) + 2 * ( y[ body ] >= cell.y0 + half );
+	
+	nodes[ child + q ].body = body;
+	nodes[ child + q ].count = 1;
+	next[ body ] = -1;
+	
+	nodes[ node ].child = child;
+	nodes[ node ].body = -1;
+	nodes[ node ].count = 0;
+}
+
+void Gravity::accumulate()
+{
+	// the children always come after their parent
+	for( int n = nodes.size() - 1; n >= 0; n-- )
+	{
+		Node& node = nodes[n];
+		float m = 0, sx = 0, sy = 0;
+		
+		if( node.child < 0 )
+		{
+			for( int b = node.body; b >= 0; b = next[b] )
+			{
+				m += mass[b];
+				sx += mass[b] * x[b];
+				sy += mass[b] * y[b];
+			}
+		}
+		else
+		{
+			for( int q = 0; q < 4; q++ )
+			{
+				const Node& child = nodes[ node.child + q ];
+				m += child.mass;
+				sx += child.mass * child.cx;
+				sy += child.mass * child.cy;
+			}
+		}
+		
+		node.mass = m;
+		node.cx = ( m > 0 ) ? sx / m : node.x0 + node.side / 2;
+		node.cy = ( m > 0 ) ? sy / m : node.y0 + node.side / 2;
+	}
+}
+
+void Gravity::pull(float dx, float dy, float m, float& sx, float& sy) const
+{
+	float d2 = dx * dx + dy * dy + softening * softening;
+	float inv = 1 / std::sqrt( d2 );
+	float f = constant * m * inv * inv * inv;
+	
+	sx += f * dx;
+	sy += f * dy;
+}
+
+void Gravity::solve(bool parallel)
+{
+	if( !parallel )
+	{
+		stats_.interactions += solve( 0, x.size() );
+		return;
+	}
+	
+	vector< unsigned long int > counts( x.size() / GRAVITY_GRAIN + 1, 0 );
+	Pass pass( this, false, counts );
+	JobSystem::parallelFor( x.size(), GRAVITY_GRAIN, pass );
+	
+	for( unsigned int i = 0; i < counts.size(); i++ )
+		stats_.interactions += counts[i];
+}
+
+unsigned long int Gravity::solve(int beg, int end)
+{
+	unsigned long int count = 0;
+	float theta2 = opening * opening;
+	int stack[ GRAVITY_STACK ];
+	
+	for( int i = beg; i < end; i++ )
+	{
+		float px = x[i], py = y[i];
+		float sx = 0, sy = 0;
+		
+		int top = 0;
+		if( nodes.size() )
+			stack[ top++ ] = 0;
+		
+		while( top )
+		{
+			const Node& node = nodes[ stack[ --top ] ];
+			
+			if( node.mass <= 0 )
+				continue;
+			
+			if( node.child < 0 )
+			{
+				for( int b = node.body; b >= 0; b = next[b] )
+				{
+					if( b != i )
+					{
+						pull( x[b] - px, y[b] - py, mass[b], sx, sy );
+						count++;
+					}
+				}
+				continue;
+			}
+			
+			float dx = node.cx - px, dy = node.cy - py;
+			
+			// a cell with the body inside is always opened, or the body
+			// would pull itself
+			bool inside = (
+				( px >= node.x0 ) && ( px < node.x0 + node.side ) &&
+				( py >= node.y0 ) && ( py < node.y0 + node.side )
+			);
+			
+			if( ( !inside ) && ( node.side * node.side < theta2 * ( dx * dx + dy * dy ) ) )
+			{
+				pull( dx, dy, node.mass, sx, sy );
+				count++;
+			}
+			else
+			{
+				for( int q = 0; q < 4; q++ )
+					stack[ top++ ] = node.child + q;
+			}
+		}
+		
+		ax[i] = sx;
+		ay[i] = sy;
+	}
+	
+	return count;
+}
+
+void Gravity::brute(bool parallel)
+{
+	if( !parallel )
+	{
+		stats_.interactions += brute( 0, x.size() );
+		return;
+	}
+	
+	vector< unsigned long int > counts( x.size() / GRAVITY_GRAIN + 1, 0 );
+	Pass pass( this, true, counts );
+	JobSystem::parallelFor( x.size(), GRAVITY_GRAIN, pass );
+	
+	for( unsigned int i = 0; i < counts.size(); i++ )
+		stats_.interactions += counts[i];
+}
+
+unsigned long int Gravity::brute(int beg, int end)
+{
+	unsigned long int count = 0;
+	int n = x.size();
+	
+	for( int i = beg; i < end; i++ )
+	{
+		float px = x[i], py = y[i];
+		float sx = 0, sy = 0;
+		
+		for( int j = 0; j < n; j++ )
+		{
+			if( ( j != i ) && ( mass[j] > 0 ) )
+			{
+				pull( x[j] - px, y[j] - py, mass[j], sx, sy );
+				count++;
+			}
+		}
+		
+		ax[i] = sx;
+		ay[i] = sy;
+	}
+	
+	return count;
+}
+
+R2Vector Gravity::acceleration(int i) const
+{
+	return r2vec( ax[i], ay[i] );
+}
+
+float Gravity::accelX(int i) const
+{
+	return ax[i];
+}
+
+float Gravity::accelY(int i) const
+{
+	return ay[i];
+}
+
+const Gravity::Stats& Gravity::stats() const
+{
+	return stats_;
+}
+
+void Gravity::resetStats()
+{
+	// the size of the tree stays until the next build
+	stats_.interactions = 0;
+}
@@ -0,0 +1,463 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "SDL_image.h"
+
+#include "ImageCache.hpp"
+#include "JobSystem.hpp"
+
+#include "simplestructures.hpp"
+
+#define IMAGECACHE_MAGIC	"IMGBLOB1"
+#define IMAGECACHE_EXT	".img"
+
+using std::map;
+using std::string;
+using std::vector;
+
+string ImageCache::dir;
+vector< ImageCache::Mapping > ImageCache::mappings;
+map< string, ImageCache::Ready > ImageCache::ready;
+ImageCache::Stats ImageCache::stats_ = { 0, 0, 0, 0 };
+
+namespace
+{
+	// beginning of a blob, followed by the path of the image and, from
+	// "offset" on, by its rows of pixels
+	struct Header
+	{
+		char magic[8];
+		
+		// of the image file
+		long int mtime;
+		long int size;
+		
+		// bits per pixel and masks of the screen
+		Uint32 display[4];
+		
+		Sint32 w, h, pitch;
+		Uint32 bpp;
+		Uint32 masks[4];
+		Uint32 keyed, colorkey;
+		Uint32 opacity;
+		
+		Uint32 namelen;
+		Uint32 offset;
+	};
+	
+	bool source(const string& filename, long int& mtime, long int& size)
+	{
+		struct stat st;
+		if( stat( filename.c_str(), &st ) )
+			return false;
+		
+		mtime = st.st_mtime;
+		size = st.st_size;
+		return true;
+	}
+	
+	void display(Uint32* format)
+	{
+		const SDL_PixelFormat* screen = SDLBase::screen()->format;
+		
+		format[0] = screen->BitsPerPixel;
+		format[1] = screen->Rmask;
+		format[2] = screen->Gmask;
+		format[3] = screen->Bmask;
+	}
+	
+	// whether a blob of "length" bytes, starting with the header and the
+	// name, holds the current version of the image
+	bool valid(const Header& header, const char* name, size_t length, const string& filename)
+	{
+		long int mtime, size;
+		Uint32 format[4];
+		
+		if( memcmp( header.magic, IMAGECACHE_MAGIC, sizeof( header.magic ) ) )
+			return false;
+		if( ( !source( filename, mtime, size ) ) || ( header.mtime != mtime ) || ( header.size != size ) )
+			return false;
+		
+		display( format );
+		if( memcmp( header.display, format, sizeof( format ) ) )
+			return false;
+		
+		if( ( header.namelen != filename.size() ) || ( sizeof( Header ) + header.namelen > length ) )
+			return false;
+		if( ( name ) && ( filename.compare( 0, string::npos, name, header.namelen ) ) )
+			return false;
+		
+		return ( ( header.w > 0 ) && ( header.h > 0 ) &&
+			( header.offset + (size_t) header.pitch * header.h <= length ) );
+	}
+	
+	struct Decode
+	{
+		string filename;
+		SDL_Surface* surface;
+		SDLBase::Opacity opacity;
+	};
+	
+	class Decoder
+	{
+	private:
+		vector< Decode >& work;
+	public:
+		Decoder(vector< Decode >& work) : work( work ) {}
+		
+		void operator()(int beg, int end)
+		{
+			for( int i = beg; i < end; i++ )
+			{
+				// a failure is left for the load, which throws it
+				work[i].surface = IMG_Load( work[i].filename.c_str() );
+				if( work[i].surface )
+					work[i].opacity = SDLBase::classify( work[i].surface );
+			}
+		}
+	};
+}
+
+void ImageCache::init(const string& dir)
+{
+	// the loaders of each format are set up before any worker uses them
+	IMG_Init( IMG_INIT_JPG | IMG_INIT_PNG );
+	
+	ImageCache::dir = dir;
+	
+	// without a directory of its own, the cache is off
+	if( ( dir.size() ) && ( mkdir( dir.c_str(), 0755 ) ) && ( errno != EEXIST ) )
+		ImageCache::dir = "";
+}
+
+void ImageCache::close()
+{
+	for( map< string, Ready >::iterator it = ready.begin(); it != ready.end(); ++it )
+		SDL_FreeSurface( it->second.surface );
+	ready.clear();
+	
+	// every surface of a blob must have been freed by now
+	for( unsigned int i = 0; i < mappings.size(); i++ )
+	{
+		SDL_FreeSurface( mappings[i].surface );
+		munmap( mappings[i].data, mappings[i].size );
+	}
+	mappings.clear();
+	
+	dir = "";
+	
+	IMG_Quit();
+}
+
+string ImageCache::blob(const string& filename)
+{
+	Uint32 format[4];
+	display( format );
+	
+	// FNV-1a of the path and of the pixel format of the screen
+	Uint32 hash = 2166136261u;
+	for( unsigned int i = 0; i < filename.size(); i++ )
+		hash = ( hash ^ (Uint8) filename[i] ) * 16777619u;
+	for( unsigned int i = 0; i < sizeof( format ); i++ )
+		hash = ( hash ^ ( (const Uint8*) format )[i] ) * 16777619u;
+	
+	char name[16];
+	sprintf( name, "%08x", (unsigned int) hash );
+	
+	return dir + "/" + name + IMAGECACHE_EXT;
+}
+
+bool ImageCache::fresh(const string& filename)
+{
+	FILE* f = fopen( blob( filename ).c_str(), "rb" );
+	if( !f )
+		return false;
+	
+	Header header;
+	bool ret = false;
+	
+	if( fread( &header, sizeof( Header ), 1, f ) == 1 )
+	{
+		fseek( f, 0, SEEK_END );
+		size_t length = ftell( f );
+		
+		// the name is read only once the rest of the header makes sense
+		if( valid( header, NULL, length, filename ) )
+		{
+			vector< char > name( header.namelen + 1 );
+			fseek( f, sizeof( Header ), SEEK_SET );
+			
+			ret = ( ( fread( &name[0], 1, header.namelen, f ) == header.namelen ) &&
+				( valid( header, &name[0], length, filename ) ) );
+		}
+	}
+	
+	fclose( f );
+	return ret;
+}
+
+void ImageCache::collect()
+{
+	for( unsigned int i = 0; i < mappings.size(); )
+	{
+		if( mappings[i].surface->refcount > 1 )
+		{
+			i++;
+			continue;
+		}
+		
+		SDL_FreeSurface( mappings[i].surface );
+		munmap( mappings[i].data, mappings[i].size );
+		mappings.erase( mappings.begin() + i );
+	}
+}
+
+void ImageCache::prefetch(const vector< string >& filenames)
+{
+	vector< Decode > work;
+	
+	for( unsigned int i = 0; i < filenames.size(); i++ )
+	{
+		if( ready.count( filenames[i] ) )
+			continue;
+		if( ( dir.size() ) && ( fresh( filenames[i] ) ) )
+			continue;
+		
+		bool queued = false;
+		for( unsigned int j = 0; ( j < work.size() ) && ( !queued ); j++ )
+			queued = ( work[j].filename == filenames[i] );
+		if( queued )
+			continue;
+		
+		Decode decode;
+		decode.filename = filenames[i];
+		decode.surface = NULL;
+		decode.opacity = SDLBase::OPAQUE;
+		work.push_back( decode );
+	}
+	
+	Decoder decoder( work );
+	JobSystem::parallelFor( work.size(), 1, decoder );
+	
+	// the conversion uses the screen, so it stays in this thread
+	for( unsigned int i = 0; i < work.size(); i++ )
+	{
+		if( !work[i].surface )
+			continue;
+		
+		Ready r;
+		r.info.filename = work[i].filename;
+		r.info.w = work[i].surface->w;
+		r.info.h = work[i].surface->h;
+		r.info.opacity = work[i].opacity;
+		for( int j = 0; j < 4; j++ )
+			r.info.tiles[j] = 0;
+		
+		try {
+			r.surface = SDLBase::displayFormat( work[i].surface, work[i].opacity );
+		} catch (mexception& e) {
+			for( unsigned int j = i; j < work.size(); j++ )
+			{
+				if( work[j].surface )
+					SDL_FreeSurface( work[j].surface );
+			}
+			throw;
+		}
+		SDL_FreeSurface( work[i].surface );
+		
+		save( r.info.filename, r.surface, r.info );
+		ready[ r.info.filename ] = r;
+		stats_.prefetched++;
+	}
+}
+
+SDL_Surface* ImageCache::load(const string& filename, SDLBase::ImageInfo& info)
+{
+	collect();
+	
+	map< string, Ready >::iterator it = ready.find( filename );
+	if( it != ready.end() )
+	{
+		SDL_Surface* ret = it->second.surface;
+		info = it->second.info;
+		ready.erase( it );
+		return ret;
+	}
+	
+	if( !dir.size() )
+	{
+		stats_.misses++;
+		return NULL;
+	}
+	
+	int fd = open( blob( filename ).c_str(), O_RDONLY );
+	if( fd < 0 )
+	{
+		stats_.misses++;
+		return NULL;
+	}
+	
+	struct stat st;
+	void* data = MAP_FAILED;
+	if( ( !fstat( fd, &st ) ) && ( st.st_size >= (off_t) sizeof( Header ) ) )
+	{
+		// private, so a write to the pixels never reaches the blob
+		data = mmap( NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+	}
+	::close( fd );
+	
+	if( data == MAP_FAILED )
+	{
+		stats_.misses++;
+		return NULL;
+	}
+	
+	const Header* header = (const Header*) data;
+	const char* name = (const char*) data + sizeof( Header );
+	
+	SDL_Surface* ret = NULL;
+	if( valid( *header, name, st.st_size, filename ) )
+	{
+		ret = SDL_CreateRGBSurfaceFrom(
+			(char*) data + header->offset,
+			header->w,
+			header->h,
+			header->bpp,
+			header->pitch,
+			header->masks[0],
+			header->masks[1],
+			header->masks[2],
+			header->masks[3]
+		);
+	}
+	
+	if( !ret )
+	{
+		munmap( data, st.st_size );
+		stats_.misses++;
+		return NULL;
+	}
+	
+	if( header->keyed )
+		SDL_SetColorKey( ret, SDL_SRCCOLORKEY, header->colorkey );
+	
+	info.filename = filename;
+	info.w = header->w;
+	info.h = header->h;
+	info.opacity = (SDLBase::Opacity) header->opacity;
+	for( int i = 0; i < 4; i++ )
+		info.tiles[i] = 0;
+	
+	// the mapping lives until the cache holds the only reference left
+	Mapping mapping;
+	mapping.surface = ret;
+	mapping.data = data;
+	mapping.size = st.st_size;
+	mappings.push_back( mapping );
+	ret->refcount++;
+	
+	stats_.hits++;
+	return ret;
+}
+
+void ImageCache::save(const string& filename, SDL_Surface* surface, const SDLBase::ImageInfo& info)
+{
+	if( !dir.size() )
+		return;
+	
+	Header header;
+	memset( &header, 0, sizeof( Header ) );
+	memcpy( header.magic, IMAGECACHE_MAGIC, sizeof( header.magic ) );
+	
+	if( !source( filename, header.mtime, header.size ) )
+		return;
+	display( header.display );
+	
+	header.w = surface->w;
+	header.h = surface->h;
+	header.pitch = surface->pitch;
+	header.bpp = surface->format->BitsPerPixel;
+	header.masks[0] = surface->format->Rmask;
+	header.masks[1] = surface->format->Gmask;
+	header.masks[2] = surface->format->Bmask;
+	header.masks[3] = surface->format->Amask;
+	header.keyed = ( ( surface->flags & SDL_SRCCOLORKEY ) != 0 );
+	header.colorkey = surface->format->colorkey;
+	header.opacity = info.opacity;
+	header.namelen = filename.size();
+	
+	// the pixels start aligned, as SDL would allocate them
+	header.offset = ( sizeof( Header ) + header.namelen + 15 ) & ~15u;
+	
+	// written aside and renamed, so a blob is never seen half written
+	string path = blob( filename );
+	string tmp = path + ".tmp";
+	
+	FILE* f = fopen( tmp.c_str(), "wb" );
+	if( !f )
+		return;
+	
+	char pad[16];
+	memset( pad, 0, sizeof( pad ) );
+	
+	if( SDL_MUSTLOCK( surface ) )
+		SDL_LockSurface( surface );
+	
+	bool ok = ( ( fwrite( &header, sizeof( Header ), 1, f ) == 1 ) &&
+		( fwrite( filename.data(), 1, header.namelen, f ) == header.namelen ) &&
+		( fwrite( pad, 1, header.offset - sizeof( Header ) - header.namelen, f ) ==
+			header.offset - sizeof( Header ) - header.namelen ) &&
+		( fwrite( surface->pixels, header.pitch, header.h, f ) == (size_t) header.h ) );
+	
+	if( SDL_MUSTLOCK( surface ) )
+		SDL_UnlockSurface( surface );
+	
+	// a cache that can't be written only costs the next startup
+	if( ( fclose( f ) ) || ( !ok ) || ( rename( tmp.c_str(), path.c_str() ) ) )
+	{
+		remove( tmp.c_str() );
+		return;
+	}
+	
+	stats_.written++;
+}
+
+void ImageCache::clear()
+{
+	if( !dir.size() )
+		return;
+	
+	DIR* d = opendir( dir.c_str() );
+	if( !d )
+		return;
+	
+	string ext = IMAGECACHE_EXT;
+	for( dirent* entry = readdir( d ); entry; entry = readdir( d ) )
+	{
+		string name = entry->d_name;
+		if( ( name.size() > ext.size() ) && ( !name.compare( name.size() - ext.size(), ext.size(), ext ) ) )
+			remove( ( dir + "/" + name ).c_str() );
+	}
+	
+	closedir( d );
+}
+
+const ImageCache::Stats& ImageCache::stats()
+{
+	return stats_;
+}
+
+void ImageCache::resetStats()
+{
+	stats_.hits = 0;
+	stats_.misses = 0;
+	stats_.prefetched = 0;
+	stats_.written = 0;
+}
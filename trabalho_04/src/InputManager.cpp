@@ -1,12 +1,25 @@
 #include <climits>
 
 #include "InputManager.hpp"
+#include "SDLBase.hpp"
 
 #define N_EVENTS		11
 #define broadcast(X)	subject.broadcast ( Event ( (X), &event_ ) )
 
 InputManager* InputManager::instance_ = 0;
 
+// the game may be drawn smaller than the window, so the mouse is moved to
+// the pixels of the screen before anyone sees it
+static void toScreen (Uint16& x, Uint16& y)
+{
+	int tx = x, ty = y;
+	
+	SDLBase::windowToScreen ( tx, ty );
+	
+	x = tx;
+	y = ty;
+}
+
 InputManager::Event::Event (event_id event_type, SDL_Event* event) :
 observer::Event ( event_type ), event ( event )
 {
@@ -62,11 +75,13 @@ void InputManager::update ()
 			break;
 			
 		case SDL_MOUSEMOTION:
+			toScreen ( event_.motion.x, event_.motion.y );
 			mouse_x = event_.motion.x;
 			mouse_y = event_.motion.y;
 			break;
 			
 		case SDL_MOUSEBUTTONDOWN:
+			toScreen ( event_.button.x, event_.button.y );
 			mouse_pressed[ event_.button.button ] = true;
 			
 			mousedown_x = event_.button.x;
@@ -98,6 +113,7 @@ void InputManager::update ()
 			break;
 			
 		case SDL_MOUSEBUTTONUP:
+			toScreen ( event_.button.x, event_.button.y );
 			mouse_pressed[ event_.button.button ] = false;
 			
 			switch ( event_.button.button )
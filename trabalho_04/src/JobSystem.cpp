@@ -0,0 +1,285 @@
+#ifdef __unix__
+#include <unistd.h>
+#include <sys/time.h>
+#endif
+
+#include "simplestructures.hpp"
+
+#include "JobSystem.hpp"
+
+using std::vector;
+
+vector< JobSystem::Worker* > JobSystem::workers;
+SDL_mutex* JobSystem::graph = NULL;
+SDL_cond* JobSystem::finished = NULL;
+SDL_sem* JobSystem::available = NULL;
+bool JobSystem::quit = false;
+double JobSystem::since = 0;
+
+Job::Job() : pending( 1 ), done( false )
+{
+}
+
+Job::~Job()
+{
+}
+
+void JobSystem::init(int nworkers)
+{
+	if( workers.size() )
+		throw( mexception( "JobSystem already on" ) );
+	
+	// one worker per core, the main thread included
+	if( nworkers < 0 )
+	{
+#ifdef __unix__
+		nworkers = sysconf( _SC_NPROCESSORS_ONLN ) - 1;
+#endif
+		if( nworkers < 0 )
+			nworkers = 0;
+	}
+	
+	graph = SDL_CreateMutex();
+	finished = SDL_CreateCond();
+	available = SDL_CreateSemaphore( 0 );
+	quit = false;
+	
+	for( int i = 0; i <= nworkers; i++ )
+	{
+		Worker* worker = new Worker;
+		worker->thread = NULL;
+		worker->id = ( i ? 0 : SDL_ThreadID() );
+		worker->lock = SDL_CreateMutex();
+		worker->busy = 0;
+		worker->executed = 0;
+		workers.push_back( worker );
+	}
+	
+	// the threads only start after every worker exists, so they can steal
+	for( int i = 1; i <= nworkers; i++ )
+	{
+		workers[i]->thread = SDL_CreateThread( work, (void*) workers[i] );
+		if( !workers[i]->thread )
+			throw( mexception( "SDL_CreateThread error" ) );
+	}
+	
+	since = now();
+}
+
+void JobSystem::close()
+{
+	quit = true;
+	for( unsigned int i = 1; i < workers.size(); i++ )
+		SDL_SemPost( available );
+	
+	for( unsigned int i = 0; i < workers.size(); i++ )
+	{
+		if( workers[i]->thread )
+			SDL_WaitThread( workers[i]->thread, NULL );
+		SDL_DestroyMutex( workers[i]->lock );
+		delete workers[i];
+	}
+	workers.clear();
+	
+	SDL_DestroySemaphore( available );
+	SDL_DestroyCond( finished );
+	SDL_DestroyMutex( graph );
+}
+
+int JobSystem::work(void* data)
+{
+	Worker* worker = (Worker*) data;
+	
+	int index = 0;
+	while( workers[ index ] != worker )
+		index++;
+	
+	SDL_LockMutex( worker->lock );
+	worker->id = SDL_ThreadID();
+	SDL_UnlockMutex( worker->lock );
+	
+	for( ;; )
+	{
+		SDL_SemWait( available );
+		if( quit )
+			break;
+		
+		Job* job = take( index );
+		if( job )
+			execute( index, job );
+	}
+	
+	return 0;
+}
+
+int JobSystem::self()
+{
+	Uint32 id = SDL_ThreadID();
+	
+	for( unsigned int i = 1; i < workers.size(); i++ )
+	{
+		SDL_LockMutex( workers[i]->lock );
+		bool found = ( workers[i]->id == id );
+		SDL_UnlockMutex( workers[i]->lock );
+		if( found )
+			return i;
+	}
+	
+	return 0;
+}
+
+void JobSystem::push(int worker, Job* job)
+{
+	SDL_LockMutex( workers[ worker ]->lock );
+	workers[ worker ]->jobs.push_back( job );
+	SDL_UnlockMutex( workers[ worker ]->lock );
+	
+	SDL_SemPost( available );
+}
+
+Job* JobSystem::take(int worker)
+{
+	Job* job = NULL;
+	
+	// newest job of its own deque, while it's still hot in cache
+	SDL_LockMutex( workers[ worker ]->lock );
+	if( workers[ worker ]->jobs.size() )
+	{
+		job = workers[ worker ]->jobs.back();
+		workers[ worker ]->jobs.pop_back();
+	}
+	SDL_UnlockMutex( workers[ worker ]->lock );
+	
+	// oldest job of some other worker
+	for( unsigned int i = 1; ( !job ) && ( i < workers.size() ); i++ )
+	{
+		Worker* victim = workers[ ( worker + i ) % workers.size() ];
+		
+		SDL_LockMutex( victim->lock );
+		if( victim->jobs.size() )
+		{
+			job = victim->jobs.front();
+			victim->jobs.pop_front();
+		}
+		SDL_UnlockMutex( victim->lock );
+	}
+	
+	return job;
+}
+
+void JobSystem::execute(int worker, Job* job)
+{
+	double t = now();
+	job->run();
+	t = now() - t;
+	
+	SDL_LockMutex( workers[ worker ]->lock );
+	workers[ worker ]->busy += t;
+	workers[ worker ]->executed++;
+	SDL_UnlockMutex( workers[ worker ]->lock );
+	
+	// successors whose last dependency was this job are ready now
+	SDL_LockMutex( graph );
+	job->done = true;
+	for( unsigned int i = 0; i < job->successors.size(); i++ )
+	{
+		if( !--job->successors[i]->pending )
+			push( worker, job->successors[i] );
+	}
+	SDL_CondBroadcast( finished );
+	SDL_UnlockMutex( graph );
+}
+
+double JobSystem::now()
+{
+#ifdef __unix__
+	timeval tv;
+	gettimeofday( &tv, NULL );
+	return ( tv.tv_sec + tv.tv_usec / 1000000.0 );
+#else
+	return ( SDL_GetTicks() / 1000.0 );
+#endif
+}
+
+int JobSystem::size()
+{
+	return workers.size();
+}
+
+void JobSystem::depend(Job* job, Job* dependency)
+{
+	SDL_LockMutex( graph );
+	if( !dependency->done )
+	{
+		job->pending++;
+		dependency->successors.push_back( job );
+	}
+	SDL_UnlockMutex( graph );
+}
+
+void JobSystem::submit(Job* job)
+{
+	SDL_LockMutex( graph );
+	if( !--job->pending )
+		push( self(), job );
+	SDL_UnlockMutex( graph );
+}
+
+void JobSystem::wait(Job* job)
+{
+	int worker = self();
+	
+	for( ;; )
+	{
+		SDL_LockMutex( graph );
+		bool done = job->done;
+		SDL_UnlockMutex( graph );
+		if( done )
+			break;
+		
+		// helps with any job while the awaited one isn't finished
+		Job* other = take( worker );
+		if( other )
+			execute( worker, other );
+		else
+		{
+			SDL_LockMutex( graph );
+			if( !job->done )
+				SDL_CondWaitTimeout( finished, graph, 1 );
+			SDL_UnlockMutex( graph );
+		}
+	}
+}
+
+double JobSystem::utilization(int worker)
+{
+	double elapsed = now() - since;
+	
+	SDL_LockMutex( workers[ worker ]->lock );
+	double busy = workers[ worker ]->busy;
+	SDL_UnlockMutex( workers[ worker ]->lock );
+	
+	return ( ( elapsed > 0 ) ? busy / elapsed : 0 );
+}
+
+unsigned int JobSystem::executed(int worker)
+{
+	SDL_LockMutex( workers[ worker ]->lock );
+	unsigned int ret = workers[ worker ]->executed;
+	SDL_UnlockMutex( workers[ worker ]->lock );
+	
+	return ret;
+}
+
+void JobSystem::resetStats()
+{
+	for( unsigned int i = 0; i < workers.size(); i++ )
+	{
+		SDL_LockMutex( workers[i]->lock );
+		workers[i]->busy = 0;
+		workers[i]->executed = 0;
+		SDL_UnlockMutex( workers[i]->lock );
+	}
+	
+	since = now();
+}
@@ -0,0 +1,284 @@
+#include <cmath>
+#include <cstdlib>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "ParticleSystem.hpp"
+
+#include "Animation.hpp"
+#include "RenderSnapshot.hpp"
+
+using namespace lalge;
+
+using std::string;
+
+namespace
+{
+	// uniform in [ -1, 1 ]
+	float noise()
+	{
+		return ( 2.0f * float( rand() ) / float( RAND_MAX ) - 1.0f );
+	}
+}
+
+ParticleSystem::ParticleSystem(int capacity) :
+capacity( ( capacity > 0 ) ? capacity : 1 ), head( 0 ), tail( 0 ), used( 0 ),
+emitted_( 0 ), overwritten_( 0 )
+{
+	x.resize( this->capacity );
+	y.resize( this->capacity );
+	vx.resize( this->capacity );
+	vy.resize( this->capacity );
+	ax.resize( this->capacity );
+	ay.resize( this->capacity );
+	age.resize( this->capacity );
+	life.resize( this->capacity );
+	frame.resize( this->capacity );
+	rate.resize( this->capacity );
+	kind.resize( this->capacity );
+}
+
+ParticleSystem::~ParticleSystem()
+{
+	for( unsigned int i = 0; i < emitters.size(); i++ )
+		delete emitters[i].sheet;
+}
+
+void ParticleSystem::load(const Configuration& conf, bool headless)
+{
+	ConfigBinding< Emitter > binding;
+	binding
+		.bind( "image", &Emitter::image, "" )
+		.bind( "rows", &Emitter::rows, 1 )
+		.bind( "cols", &Emitter::cols, 1 )
+		.bind( "count", &Emitter::count, 1 )
+		.bind( "life", &Emitter::life, 1 )
+		.bind( "lifevar", &Emitter::lifevar, 0 )
+		.bind( "speed", &Emitter::speed, 0 )
+		.bind( "speedvar", &Emitter::speedvar, 0 )
+		.bind( "spread", &Emitter::spread, 360 )
+		.bind( "gravity", &Emitter::gravity, 0 );
+	
+	for(
+		Configuration::Iterator it = conf.beginConfigs();
+		it.valid();
+		it.next()
+	)
+	{
+		Emitter emitter;
+		binding.load( it.config(), emitter );
+		emitter.name = it.name();
+		emitter.sheet = NULL;
+		
+		if( ( !headless ) && ( !emitter.image.empty() ) )
+		{
+			emitter.sheet = new Animation(
+				emitter.image, 0, 100, emitter.rows, emitter.cols
+			);
+		}
+		
+		add( emitter );
+	}
+}
+
+int ParticleSystem::add(const Emitter& emitter)
+{
+	emitters.push_back( emitter );
+	
+	Emitter& e = emitters.back();
+	if( e.rows < 1 )
+		e.rows = 1;
+	if( e.cols < 1 )
+		e.cols = 1;
+	if( e.count < 0 )
+		e.count = 0;
+	if( e.life <= 0 )
+		e.life = 1;
+	
+	return ( emitters.size() - 1 );
+}
+
+int ParticleSystem::find(const string& name) const
+{
+	for( unsigned int i = 0; i < emitters.size(); i++ )
+	{
+		if( emitters[i].name == name )
+			return i;
+	}
+	
+	return -1;
+}
+
+void ParticleSystem::emit(int emitter, const R2Vector& r)
+{
+	if( ( emitter < 0 ) || ( emitter >= int( emitters.size() ) ) )
+		return;
+	
+	const Emitter& e = emitters[emitter];
+	float frames = float( e.rows * e.cols );
+	
+	for( int n = 0; n < e.count; n++ )
+	{
+		// full ring, the oldest particle gives its slot
+		if( used == capacity )
+		{
+			if( !dead( tail ) )
+				overwritten_++;
+			tail = ( tail + 1 ) % capacity;
+			used--;
+		}
+		
+		int i = head;
+		head = ( head + 1 ) % capacity;
+		used++;
+		
+		float angle = float( deg2rad( e.spread * 0.5f * noise() ) );
+		float speed = e.speed + e.speedvar * noise();
+		
+		x[i] = float( r.x( 0 ) );
+		y[i] = float( r.x( 1 ) );
+		vx[i] = speed * float( cos( angle ) );
+		vy[i] = speed * float( sin( angle ) );
+		ax[i] = 0;
+		ay[i] = e.gravity;
+		age[i] = 0;
+		life[i] = e.life + e.lifevar * noise();
+		if( life[i] < 0.01f )
+			life[i] = 0.01f;
+		frame[i] = 0;
+		rate[i] = frames / life[i];
+		kind[i] = emitter;
+	}
+	
+	emitted_ += e.count;
+}
+
+void ParticleSystem::update(float dt)
+{
+	if( !used )
+		return;
+	
+	// the live part of the ring is one or two contiguous runs
+	if( tail < head )
+		integrate( tail, head, dt );
+	else
+	{
+		integrate( tail, capacity, dt );
+		integrate( 0, head, dt );
+	}
+	
+	while( ( used ) && ( dead( tail ) ) )
+	{
+		tail = ( tail + 1 ) % capacity;
+		used--;
+	}
+}
+
+void ParticleSystem::snapshot(RenderSnapshot& snap, const R2Vector& offset) const
+{
+	float ox = float( offset.x( 0 ) );
+	float oy = float( offset.x( 1 ) );
+	
+	// one batch per sheet, so the particles of an emitter are drawn together
+	for( unsigned int e = 0; e < emitters.size(); e++ )
+	{
+		if( !emitters[e].sheet )
+			continue;
+		
+		unsigned int n = 0;
+		for( int k = 0, i = tail; k < used; k++, i = ( i + 1 ) % capacity )
+		{
+			if( ( kind[i] == int( e ) ) && ( !dead( i ) ) )
+				n++;
+		}
+		
+		if( !n )
+			continue;
+		
+		int last = emitters[e].rows * emitters[e].cols - 1;
+		RenderSnapshot::Particle* p = snap.drawParticles( emitters[e].sheet, n );
+		
+		for( int k = 0, i = tail; k < used; k++, i = ( i + 1 ) % capacity )
+		{
+			if( ( kind[i] == int( e ) ) && ( !dead( i ) ) )
+			{
+				p->x = x[i] - ox;
+				p->y = y[i] - oy;
+				p->frame = ( int( frame[i] ) < last ) ? int( frame[i] ) : last;
+				p++;
+			}
+		}
+	}
+}
+
+int ParticleSystem::size() const
+{
+	return used;
+}
+
+int ParticleSystem::alive() const
+{
+	int n = 0;
+	for( int k = 0, i = tail; k < used; k++, i = ( i + 1 ) % capacity )
+	{
+		if( !dead( i ) )
+			n++;
+	}
+	
+	return n;
+}
+
+unsigned int ParticleSystem::emitted() const
+{
+	return emitted_;
+}
+
+unsigned int ParticleSystem::overwritten() const
+{
+	return overwritten_;
+}
+
+void ParticleSystem::integrate(int beg, int end, float dt)
+{
+	int i = beg;
+
+#ifdef __SSE__
+	__m128 step = _mm_set1_ps( dt );
+	
+	for( ; i + 4 <= end; i += 4 )
+	{
+		__m128 pvx = _mm_add_ps(
+			_mm_loadu_ps( &vx[i] ), _mm_mul_ps( _mm_loadu_ps( &ax[i] ), step )
+		);
+		__m128 pvy = _mm_add_ps(
+			_mm_loadu_ps( &vy[i] ), _mm_mul_ps( _mm_loadu_ps( &ay[i] ), step )
+		);
+		__m128 page = _mm_add_ps( _mm_loadu_ps( &age[i] ), step );
+		
+		_mm_storeu_ps( &vx[i], pvx );
+		_mm_storeu_ps( &vy[i], pvy );
+		_mm_storeu_ps( &x[i], _mm_add_ps( _mm_loadu_ps( &x[i] ), _mm_mul_ps( pvx, step ) ) );
+		_mm_storeu_ps( &y[i], _mm_add_ps( _mm_loadu_ps( &y[i] ), _mm_mul_ps( pvy, step ) ) );
+		_mm_storeu_ps( &age[i], page );
+		_mm_storeu_ps( &frame[i], _mm_mul_ps( page, _mm_loadu_ps( &rate[i] ) ) );
+	}
+#endif
+
+	// what doesn't fill a register, or everything without SSE
+	for( ; i < end; i++ )
+	{
+		vx[i] += ax[i] * dt;
+		vy[i] += ay[i] * dt;
+		x[i] += vx[i] * dt;
+		y[i] += vy[i] * dt;
+		age[i] += dt;
+		frame[i] = age[i] * rate[i];
+	}
+}
+
+bool ParticleSystem::dead(int i) const
+{
+	return ( age[i] >= life[i] );
+}
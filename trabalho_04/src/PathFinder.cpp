@@ -0,0 +1,514 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+
+#include "PathFinder.hpp"
+
+#include "simplestructures.hpp"
+
+#define PATHFINDER_CACHE	32
+#define PATHFINDER_SQRT2	1.41421356f
+
+using namespace lalge;
+
+using std::pair;
+using std::vector;
+
+namespace
+{
+	int sign(int x)
+	{
+		return ( x > 0 ) - ( x < 0 );
+	}
+	
+	typedef std::greater< pair< float, int > > Lower;
+}
+
+PathFinder::PathFinder(TileMap* map, int layer, bool jumps) :
+map( map ), layer( layer ), revision( 0 ), w( 0 ), h( 0 ), arrivals( 0 ),
+jumps( jumps ), visit( 0 ), clock( 0 )
+{
+	if( ( !map ) || ( !map->tileset ) )
+		throw( mexception( "PathFinder needs a tilemap with a tileset" ) );
+	
+	tilew = map->tileset->tileW();
+	tileh = map->tileset->tileH();
+	
+	resetStats();
+	refresh();
+}
+
+PathFinder::PathFinder(int w, int h, int tilew, int tileh, bool jumps) :
+map( NULL ), layer( 0 ), revision( 0 ), w( w ), h( h ),
+tilew( tilew ), tileh( tileh ), blocked( w * h, 0 ), arrivals( 0 ),
+jumps( jumps ), visit( 0 ), clock( 0 )
+{
+	Node empty = { 0, -1, 0, false };
+	nodes.assign( w * h, empty );
+	
+	resetStats();
+}
+
+void PathFinder::refresh()
+{
+	w = map->width( layer );
+	h = map->height( layer );
+	
+	blocked.assign( w * h, 0 );
+	if( map->streamed() )
+	{
+		int side = map->chunkSide();
+		filled.assign( ( ( h + side - 1 ) / side ) * ( ( w + side - 1 ) / side ), 0 );
+		fill();
+	}
+	else
+	{
+		for( int i = 0; i < h; i++ )
+		{
+			for( int j = 0; j < w; j++ )
+				blocked[ i * w + j ] = ( map->at( layer, i, j ) >= 0 );
+		}
+	}
+	
+	Node empty = { 0, -1, 0, false };
+	nodes.assign( w * h, empty );
+	visit = 0;
+	
+	revision = map->revision();
+	cache.clear();
+}
+
+// the chunks of a streamed map that aren't loaded yet are taken as free
+// and copied as they arrive, so a query never waits for the disk
+void PathFinder::fill()
+{
+	arrivals = map->chunkArrivals();
+	
+	int side = map->chunkSide();
+	int cols = ( w + side - 1 ) / side;
+	vector< int > tiles;
+	bool changed = false;
+	
+	for( unsigned int c = 0; c < filled.size(); c++ )
+	{
+		int ci = c / cols, cj = c % cols;
+		if( ( filled[c] ) || ( !map->peekChunk( layer, ci, cj, tiles ) ) )
+			continue;
+		
+		for( int i = ci * side; i < std::min( h, ci * side + side ); i++ )
+		{
+			for( int j = cj * side; j < std::min( w, cj * side + side ); j++ )
+				blocked[ i * w + j ] = ( tiles[ ( i - ci * side ) * side + ( j - cj * side ) ] >= 0 );
+		}
+		
+		filled[c] = true;
+		changed = true;
+	}
+	
+	if( changed )
+		cache.clear();
+}
+
+void PathFinder::setBlocked(int i, int j, bool blocked)
+{
+	if( ( i < 0 ) || ( i >= h ) || ( j < 0 ) || ( j >= w ) )
+		return;
+	
+	if( this->blocked[ i * w + j ] != blocked )
+	{
+		this->blocked[ i * w + j ] = blocked;
+		cache.clear();
+	}
+}
+
+bool PathFinder::isBlocked(int i, int j) const
+{
+	if( ( i < 0 ) || ( i >= h ) || ( j < 0 ) || ( j >= w ) )
+		return true;
+	
+	return blocked[ i * w + j ];
+}
+
+bool PathFinder::passable(int i, int j) const
+{
+	return ( ( i >= 0 ) && ( i < h ) && ( j >= 0 ) && ( j < w ) && ( !blocked[ i * w + j ] ) );
+}
+
+void PathFinder::setJumps(bool jumps)
+{
+	this->jumps = jumps;
+}
+
+void PathFinder::clearCache()
+{
+	cache.clear();
+}
+
+void PathFinder::reset()
+{
+	// the nodes of older queries are told apart by their visit
+	if( !++visit )
+	{
+		for( unsigned int i = 0; i < nodes.size(); i++ )
+			nodes[i].visit = 0;
+		visit = 1;
+	}
+	
+	open.clear();
+}
+
+bool PathFinder::search(int from, int to, vector< int >& cells)
+{
+	if( ( map ) && ( map->revision() != revision ) )
+		refresh();
+	else if( ( map ) && ( map->streamed() ) && ( map->chunkArrivals() != arrivals ) )
+		fill();
+	
+	stats_.queries++;
+	cells.clear();
+	
+	if( ( from < 0 ) || ( to < 0 ) || ( from >= w * h ) || ( to >= w * h ) )
+	{
+		stats_.failures++;
+		return false;
+	}
+	
+	for( unsigned int i = 0; i < cache.size(); i++ )
+	{
+		if( ( cache[i].from == from ) && ( cache[i].to == to ) )
+		{
+			stats_.hits++;
+			cache[i].used = ++clock;
+			cells = cache[i].cells;
+			
+			if( !cache[i].found )
+				stats_.failures++;
+			return cache[i].found;
+		}
+	}
+	
+	bool found = false;
+	
+	if( !blocked[ to ] )
+	{
+		reset();
+		
+		Node& start = nodes[ from ];
+		start.g = 0;
+		start.parent = -1;
+		start.visit = visit;
+		start.closed = false;
+		
+		open.push_back( pair< float, int >( distance( from, to ), from ) );
+		
+		while( open.size() )
+		{
+			std::pop_heap( open.begin(), open.end(), Lower() );
+			int cell = open.back().second;
+			open.pop_back();
+			
+			// a node pushed again with a shorter way was already closed
+			if( nodes[ cell ].closed )
+				continue;
+			
+			nodes[ cell ].closed = true;
+			stats_.expanded++;
+			
+			if( cell == to )
+			{
+				found = true;
+				break;
+			}
+			
+			expand( cell, to );
+		}
+	}
+	
+	if( found )
+		trace( to, cells );
+	else
+		stats_.failures++;
+	
+	Entry entry;
+	entry.from = from;
+	entry.to = to;
+	entry.used = ++clock;
+	entry.found = found;
+	entry.cells = cells;
+	
+	if( cache.size() < PATHFINDER_CACHE )
+		cache.push_back( entry );
+	else
+	{
+		unsigned int oldest = 0;
+		for( unsigned int i = 1; i < cache.size(); i++ )
+		{
+			if( cache[i].used < cache[ oldest ].used )
+				oldest = i;
+		}
+		cache[ oldest ] = entry;
+	}
+	
+	return found;
+}
+
+void PathFinder::expand(int cell, int goal)
+{
+	int i = cell / w, j = cell % w;
+	int parent = nodes[ cell ].parent;
+	
+	if( ( !jumps ) || ( parent < 0 ) )
+	{
+		for( int di = -1; di <= 1; di++ )
+		{
+			for( int dj = -1; dj <= 1; dj++ )
+			{
+				if( ( ( !di ) && ( !dj ) ) || ( !passable( i + di, j + dj ) ) )
+					continue;
+				
+				// no corner of a blocked tile is cut
+				if( ( di ) && ( dj ) && ( ( !passable( i + di, j ) ) || ( !passable( i, j + dj ) ) ) )
+					continue;
+				
+				int next = ( i + di ) * w + j + dj;
+				if( jumps )
+					next = jump( i + di, j + dj, di, dj, goal );
+				if( next >= 0 )
+					relax( cell, next, goal );
+			}
+		}
+		return;
+	}
+	
+	// only the neighbours that can't be reached better through the parent
+	int di = sign( i - parent / w );
+	int dj = sign( j - parent % w );
+	
+	int next[5][2];
+	int n = 0;
+	
+	if( ( di ) && ( dj ) )
+	{
+		bool vertical = passable( i + di, j );
+		bool horizontal = passable( i, j + dj );
+		
+		if( vertical )
+		{
+			next[n][0] = di;
+			next[n++][1] = 0;
+		}
+		if( horizontal )
+		{
+			next[n][0] = 0;
+			next[n++][1] = dj;
+		}
+		if( ( vertical ) && ( horizontal ) )
+		{
+			next[n][0] = di;
+			next[n++][1] = dj;
+		}
+	}
+	else
+	{
+		// the sides of the move, which can't be reached diagonally
+		// around a blocked tile
+		int si = dj ? 1 : 0;
+		int sj = di ? 1 : 0;
+		
+		bool ahead = passable( i + di, j + dj );
+		bool left = passable( i - si, j - sj );
+		bool right = passable( i + si, j + sj );
+		
+		if( ahead )
+		{
+			next[n][0] = di;
+			next[n++][1] = dj;
+			
+			if( left )
+			{
+				next[n][0] = di - si;
+				next[n++][1] = dj - sj;
+			}
+			if( right )
+			{
+				next[n][0] = di + si;
+				next[n++][1] = dj + sj;
+			}
+		}
+		if( left )
+		{
+			next[n][0] = -si;
+			next[n++][1] = -sj;
+		}
+		if( right )
+		{
+			next[n][0] = si;
+			next[n++][1] = sj;
+		}
+	}
+	
+	for( int k = 0; k < n; k++ )
+	{
+		int point = jump( i + next[k][0], j + next[k][1], next[k][0], next[k][1], goal );
+		if( point >= 0 )
+			relax( cell, point, goal );
+	}
+}
+
+void PathFinder::relax(int cell, int next, int goal)
+{
+	Node& node = nodes[ next ];
+	float g = nodes[ cell ].g + distance( cell, next );
+	
+	if( ( node.visit == visit ) && ( ( node.closed ) || ( g >= node.g ) ) )
+		return;
+	
+	node.visit = visit;
+	node.closed = false;
+	node.g = g;
+	node.parent = cell;
+	
+	open.push_back( pair< float, int >( g + distance( next, goal ), next ) );
+	std::push_heap( open.begin(), open.end(), Lower() );
+}
+
+int PathFinder::jump(int i, int j, int di, int dj, int goal) const
+{
+	for( ;; )
+	{
+		if( !passable( i, j ) )
+			return -1;
+		
+		int cell = i * w + j;
+		if( cell == goal )
+			return cell;
+		
+		// a jump point is where some neighbour can only be reached
+		// through it: the straight runs from a diagonal one, or a side
+		// that opens after a blocked tile
+		if( ( di ) && ( dj ) )
+		{
+			if( ( jump( i + di, j, di, 0, goal ) >= 0 ) || ( jump( i, j + dj, 0, dj, goal ) >= 0 ) )
+				return cell;
+		}
+		else if( di )
+		{
+			if( ( ( passable( i, j - 1 ) ) && ( !passable( i - di, j - 1 ) ) ) ||
+				( ( passable( i, j + 1 ) ) && ( !passable( i - di, j + 1 ) ) ) )
+			{
+				return cell;
+			}
+		}
+		else
+		{
+			if( ( ( passable( i - 1, j ) ) && ( !passable( i - 1, j - dj ) ) ) ||
+				( ( passable( i + 1, j ) ) && ( !passable( i + 1, j - dj ) ) ) )
+			{
+				return cell;
+			}
+		}
+		
+		if( ( !passable( i + di, j ) ) || ( !passable( i, j + dj ) ) )
+			return -1;
+		
+		i += di;
+		j += dj;
+	}
+}
+
+float PathFinder::distance(int a, int b) const
+{
+	int di = abs( a / w - b / w );
+	int dj = abs( a % w - b % w );
+	
+	// octile: diagonally while both differ, then straight
+	return ( di + dj ) + ( PATHFINDER_SQRT2 - 2 ) * std::min( di, dj );
+}
+
+void PathFinder::trace(int goal, vector< int >& cells) const
+{
+	vector< int > way;
+	for( int cell = goal; cell >= 0; cell = nodes[ cell ].parent )
+		way.push_back( cell );
+	std::reverse( way.begin(), way.end() );
+	
+	// only the cells where the direction changes are kept
+	cells.push_back( way[0] );
+	for( unsigned int k = 1; k + 1 < way.size(); k++ )
+	{
+		int di0 = sign( way[k] / w - way[k - 1] / w );
+		int dj0 = sign( way[k] % w - way[k - 1] % w );
+		int di1 = sign( way[k + 1] / w - way[k] / w );
+		int dj1 = sign( way[k + 1] % w - way[k] % w );
+		
+		if( ( di0 != di1 ) || ( dj0 != dj1 ) )
+			cells.push_back( way[k] );
+	}
+	if( way.size() > 1 )
+		cells.push_back( way.back() );
+}
+
+bool PathFinder::find(
+	const R2Vector& from,
+	const R2Vector& to,
+	RingBuffer< R2Vector >& path,
+	const R2Vector& offset
+)
+{
+	int fi = (int) floor( from.x( 1 ) / tileh );
+	int fj = (int) floor( from.x( 0 ) / tilew );
+	int ti = (int) floor( to.x( 1 ) / tileh );
+	int tj = (int) floor( to.x( 0 ) / tilew );
+	
+	if( ( fi < 0 ) || ( fi >= h ) || ( fj < 0 ) || ( fj >= w ) ||
+		( ti < 0 ) || ( ti >= h ) || ( tj < 0 ) || ( tj >= w ) )
+	{
+		return path.push( to + offset );
+	}
+	
+	vector< int > cells;
+	if( !search( fi * w + fj, ti * w + tj, cells ) )
+		return false;
+	
+	// the first cell is where the way starts and the last one holds the
+	// target itself, and a way that doesn't fit whole isn't started
+	unsigned int points = ( cells.size() > 1 ? cells.size() - 1 : 1 );
+	if( points > path.capacity() - path.size() )
+		return false;
+	
+	for( unsigned int k = 1; k + 1 < cells.size(); k++ )
+	{
+		R2Vector center = r2vec(
+			( cells[k] % w + 0.5 ) * tilew,
+			( cells[k] / w + 0.5 ) * tileh
+		);
+		
+		path.push( center + offset );
+	}
+	
+	return path.push( to + offset );
+}
+
+int PathFinder::width() const
+{
+	return w;
+}
+
+int PathFinder::height() const
+{
+	return h;
+}
+
+const PathFinder::Stats& PathFinder::stats() const
+{
+	return stats_;
+}
+
+void PathFinder::resetStats()
+{
+	stats_.queries = 0;
+	stats_.hits = 0;
+	stats_.failures = 0;
+	stats_.expanded = 0;
+}
@@ -6,9 +6,9 @@
 #include "Planet.hpp"
 
 #include "InputManager.hpp"
-#include "Camera.hpp"
 
 #define EARTH_SCALESIZE	3
+#define SQRT2	1.41421356
 
 using namespace lalge;
 
@@ -27,15 +27,10 @@ Planet::~Planet ()
 {
 }
 
-void Planet::render ()
+void Planet::snapshot (RenderSnapshot& snap) const
 {
 	if ( sprite )
-	{
-		sprite->render (
-			r.x ( 0 ) - sprite->srcrect ().w / 2 - Camera::r.x ( 0 ) * depthconst,
-			r.x ( 1 ) - sprite->srcrect ().h / 2 - Camera::r.x ( 1 ) * depthconst
-		);
-	}
+		snap.drawSprite ( sprite, r - snap.camera * depthconst );
 }
 
 void Planet::setSprite (Sprite* sprite)
@@ -66,6 +61,10 @@ RedPlanet::~RedPlanet ()
 
 void RedPlanet::update ()
 {
+	Scalar dt = ( (Scalar) SDLBase::dt () ) / 1000;
+	
+	r += ( ( v * dt ) + ( a * ( dt * dt / 2 ) ) );
+	v += ( a * dt );
 }
 
 GameObject* RedPlanet::clone () const
@@ -79,7 +78,7 @@ Earth::Earth (
 	Sprite* sprite,
 	Scalar omega
 ) :
-Planet ( r, depthconst, sprite ), omega ( omega )
+Planet ( r, depthconst, sprite ), omega ( omega ), angle ( 0 )
 {
 	sprite->rotozoom ( 0, EARTH_SCALESIZE, EARTH_SCALESIZE );
 	
@@ -94,8 +93,14 @@ void Earth::update ()
 {
 	Scalar dt = ( (Scalar) SDLBase::dt () ) / 1000;
 	
-	sprite->rotozoom (
-		sprite->angle () + omega * dt, EARTH_SCALESIZE, EARTH_SCALESIZE
+	angle += omega * dt;
+}
+
+void Earth::snapshot (RenderSnapshot& snap) const
+{
+	snap.drawSprite (
+		sprite, r - snap.camera * depthconst,
+		angle, EARTH_SCALESIZE, EARTH_SCALESIZE
 	);
 }
 
@@ -104,6 +109,12 @@ GameObject* Earth::clone () const
 	return new Earth ( *this );
 }
 
+Scalar Earth::extent () const
+{
+	// zoomed and turned by any angle
+	return ( radius_ * EARTH_SCALESIZE * SQRT2 );
+}
+
 Moon::Moon (
 	const R2Vector& r,
 	const Scalar& depthconst,
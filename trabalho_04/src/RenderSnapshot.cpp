@@ -0,0 +1,226 @@
+#include "RenderSnapshot.hpp"
+
+#include "SDLBase.hpp"
+#include "Animation.hpp"
+#include "TileMap.hpp"
+#include "Audio.hpp"
+
+using namespace lalge;
+
+RenderSnapshot::RenderSnapshot() : tick( 0 )
+{
+}
+
+void RenderSnapshot::clear()
+{
+	// keeps the capacity, so the snapshots stop allocating after a few frames
+	items.clear();
+	particles.clear();
+	cues.clear();
+	camera.annul();
+	tick = 0;
+	clock = 0;
+}
+
+void RenderSnapshot::drawSprite( Sprite* sprite, int x, int y )
+{
+	Item& item = push( SPRITE );
+	item.sprite = sprite;
+	item.r = r2vec( x, y );
+}
+
+void RenderSnapshot::drawSprite( Sprite* sprite, const R2Vector& r )
+{
+	Item& item = push( SPRITE );
+	item.sprite = sprite;
+	item.centered = true;
+	item.r = r;
+}
+
+void RenderSnapshot::drawSprite(
+	Sprite* sprite,
+	const R2Vector& r,
+	float angle,
+	float zoomx, float zoomy
+)
+{
+	Item& item = push( SPRITE );
+	item.sprite = sprite;
+	item.centered = true;
+	item.rotozoomed = true;
+	item.r = r;
+	item.angle = angle;
+	item.zoomx = zoomx;
+	item.zoomy = zoomy;
+}
+
+void RenderSnapshot::drawFrame( Animation* animation, int frame, const R2Vector& r )
+{
+	Item& item = push( SPRITE );
+	item.sprite = animation;
+	item.animation = animation;
+	item.index = frame;
+	item.centered = true;
+	item.r = r;
+}
+
+void RenderSnapshot::drawFrame(
+	Animation* animation,
+	int frame,
+	const R2Vector& r,
+	float angle
+)
+{
+	Item& item = push( SPRITE );
+	item.sprite = animation;
+	item.animation = animation;
+	item.index = frame;
+	item.centered = true;
+	item.rotozoomed = true;
+	item.r = r;
+	item.angle = angle;
+}
+
+void RenderSnapshot::drawLayer( TileMap* tilemap, int layer, float cameraX, float cameraY )
+{
+	Item& item = push( LAYER );
+	item.tilemap = tilemap;
+	item.index = layer;
+	item.r = r2vec( cameraX, cameraY );
+}
+
+void RenderSnapshot::drawLine(
+	const R2Vector& beg,
+	const R2Vector& end,
+	int rgb,
+	unsigned int spacing
+)
+{
+	Item& item = push( LINE );
+	item.r = beg;
+	item.end = end;
+	item.rgb = rgb;
+	item.spacing = spacing;
+}
+
+RenderSnapshot::Particle* RenderSnapshot::drawParticles( Animation* sheet, unsigned int n )
+{
+	Item& item = push( PARTICLES );
+	item.animation = sheet;
+	item.index = particles.size();
+	item.count = n;
+	
+	particles.resize( particles.size() + n );
+	
+	return ( n ? &particles[ item.index ] : 0 );
+}
+
+void RenderSnapshot::playAudio( Audio* audio, int n )
+{
+	Cue cue;
+	cue.audio = audio;
+	cue.n = n;
+	cues.push_back( cue );
+}
+
+void RenderSnapshot::takeAudio( RenderSnapshot& dropped )
+{
+	cues.insert( cues.end(), dropped.cues.begin(), dropped.cues.end() );
+	dropped.cues.clear();
+}
+
+void RenderSnapshot::present()
+{
+	for( unsigned int i = 0; i < cues.size(); i++ )
+		cues[ i ].audio->play( cues[ i ].n );
+	
+	for( unsigned int i = 0; i < items.size(); i++ )
+	{
+		const Item& item = items[ i ];
+		
+		switch( item.kind )
+		{
+		case SPRITE:
+		{
+			// a new frame changes the clip, so the rotated surface is stale
+			bool newframe = false;
+			if( ( item.animation ) && ( item.animation->getFrame() != item.index ) )
+			{
+				item.animation->setFrame( item.index );
+				newframe = true;
+			}
+			
+			if( item.rotozoomed )
+				item.sprite->rotozoom( item.angle, item.zoomx, item.zoomy, newframe );
+			
+			if( item.centered )
+			{
+				item.sprite->render(
+					item.r.x( 0 ) - item.sprite->rectW() / 2,
+					item.r.x( 1 ) - item.sprite->rectH() / 2
+				);
+			}
+			else
+				item.sprite->render( item.r.x( 0 ), item.r.x( 1 ) );
+			break;
+		}
+		
+		case LAYER:
+			item.tilemap->tick( clock );
+			item.tilemap->renderLayer( item.index, item.r.x( 0 ), item.r.x( 1 ) );
+			break;
+		
+		case LINE:
+			SDLBase::drawLine( item.r, item.end, item.rgb, item.spacing );
+			break;
+		
+		case PARTICLES:
+		{
+			// straight from the sheet, the clip of the animation is untouched
+			int w = item.animation->frameW();
+			int h = item.animation->frameH();
+			
+			for( unsigned int k = 0; k < item.count; k++ )
+			{
+				const Particle& p = particles[ item.index + k ];
+				item.animation->renderFrame(
+					p.frame,
+					int( p.x ) - w / 2,
+					int( p.y ) - h / 2
+				);
+			}
+			break;
+		}
+		
+		default:
+			break;
+		}
+	}
+}
+
+unsigned int RenderSnapshot::size() const
+{
+	return items.size();
+}
+
+RenderSnapshot::Item& RenderSnapshot::push( int kind )
+{
+	items.push_back( Item() );
+	
+	Item& item = items.back();
+	item.kind = kind;
+	item.sprite = 0;
+	item.animation = 0;
+	item.tilemap = 0;
+	item.index = 0;
+	item.count = 0;
+	item.centered = false;
+	item.rotozoomed = false;
+	item.angle = 0;
+	item.zoomx = 1;
+	item.zoomy = 1;
+	item.rgb = 0;
+	item.spacing = 0;
+	
+	return item;
+}
@@ -3,6 +3,12 @@
 /// @brief Implementations of all methods of the SDLBase class
 /// @author Matheus Pimenta
 
+#include <algorithm>
+
+#ifdef __unix__
+#include <sys/time.h>
+#endif
+
 #include "SDL_image.h"
 #include "SDL_rotozoom.h"
 #include "SDL_ttf.h"
@@ -12,6 +18,10 @@
 #include "configfile.hpp"
 
 #include "SDLBase.hpp"
+#include "AudioBank.hpp"
+#include "Compositor.hpp"
+#include "ImageCache.hpp"
+#include "Upscaler.hpp"
 
 #define SDL_WIDTH	800
 #define SDL_HEIGHT	600
@@ -19,81 +29,86 @@
 #define SDL_TITLE	"Game"
 #define SDL_ICON	""
 #define SDL_FPS 	30
+#define SDL_COMPOSITOR	true
+#define SDL_CACHE	""
+#define SDL_SCALE	1
 
 using namespace lalge;
 
 using std::string;
+using std::vector;
 
 SDL_Surface* SDLBase::screen_ = NULL;
+SDL_Surface* SDLBase::window_ = NULL;
+Compositor* SDLBase::compositor_ = NULL;
+Upscaler* SDLBase::upscaler_ = NULL;
+SDLBase::FrameStats SDLBase::frames_ = { 0, 0, 0, 0 };
 unsigned int SDLBase::dt_ = 0;
+unsigned int SDLBase::step_ = 0;
+unsigned int SDLBase::elapsed_ = 0;
 unsigned int SDLBase::fps = 0;
+vector< SDLBase::ImageInfo > SDLBase::images_;
 
-void readSDLConf(
-	const string& confpath,
-	int& w, int& h, int& bpp,
-	string& title, string& icon,
-	unsigned int& fps
-)
+struct SDLConf
 {
-	Configuration tmp;
+	int w, h, bpp;
+	string title, icon;
+	unsigned int fps;
+	bool compositor;
+	string cache;
+	int scale;
+};
+
+static void readSDLConf( const string& confpath, SDLConf& sdlconf )
+{
+	ConfigBinding< SDLConf > binding;
+	binding
+		.bind( "w", &SDLConf::w, SDL_WIDTH )
+		.bind( "h", &SDLConf::h, SDL_HEIGHT )
+		.bind( "bpp", &SDLConf::bpp, SDL_BPP )
+		.bind( "title", &SDLConf::title, SDL_TITLE )
+		.bind( "icon", &SDLConf::icon, SDL_ICON )
+		.bind( "fps", &SDLConf::fps, SDL_FPS )
+		.bind( "compositor", &SDLConf::compositor, SDL_COMPOSITOR )
+		.bind( "cache", &SDLConf::cache, SDL_CACHE )
+		.bind( "scale", &SDLConf::scale, SDL_SCALE );
 	
+	Configuration tmp;
 	try {
 		tmp.readTxt( confpath );
-		
-		try {
-			w = tmp.getInt( "w" );
-		} catch (Configuration::VarNotFound& e) {
-			w = SDL_WIDTH;
-		}
-		
-		try {
-			h = tmp.getInt( "h" );
-		} catch (Configuration::VarNotFound& e) {
-			h = SDL_HEIGHT;
-		}
-		
-		try {
-			bpp = tmp.getInt( "bpp" );
-		} catch (Configuration::VarNotFound& e) {
-			bpp = SDL_BPP;
-		}
-		
-		try {
-			title = tmp.getStr( "title" );
-		} catch (Configuration::VarNotFound& e) {
-			title = SDL_TITLE;
-		}
-		
-		try {
-			icon = tmp.getStr( "icon" );
-		} catch (Configuration::VarNotFound& e) {
-			icon = SDL_ICON;
-		}
-		
-		try {
-			fps = tmp.getInt( "fps" );
-		} catch (Configuration::VarNotFound& e) {
-			fps = SDL_FPS;
-		}
-		
 	} catch (Configuration::FileNotFound& e) {
-		
-		w = SDL_WIDTH;
-		h = SDL_HEIGHT;
-		bpp = SDL_BPP;
-		title = SDL_TITLE;
-		icon = SDL_ICON;
-		fps = SDL_FPS;
 	}
+	
+	binding.load( tmp, sdlconf );
 }
 
-void SDLBase::initSDL(const string& confpath)
+static double seconds()
 {
-	int w, h, bpp;
-	string title, icon;
-	unsigned int fps;
+#ifdef __unix__
+	timeval tv;
+	gettimeofday( &tv, NULL );
+	return ( tv.tv_sec + tv.tv_usec / 1000000.0 );
+#else
+	return ( SDL_GetTicks() / 1000.0 );
+#endif
+}
+
+void SDLBase::initSDL(const string& confpath, int scale)
+{
+	SDLConf sdlconf;
+	
+	readSDLConf( confpath, sdlconf );
 	
-	readSDLConf( confpath, w, h, bpp, title, icon, fps );
+	if ( scale > 0 )
+		sdlconf.scale = scale;
+	if ( sdlconf.scale < 1 )
+		sdlconf.scale = 1;
+	
+	if (	( sdlconf.w / sdlconf.scale < 1 ) ||
+		( sdlconf.h / sdlconf.scale < 1 )	)
+	{
+		throw ( mexception ( "Scale bigger than the window" ) );
+	}
 	
 	if ( screen_ )
 		throw ( mexception ( "SDL already on" ) );
@@ -101,11 +116,11 @@ void SDLBase::initSDL(const string& confpath)
 	if ( SDL_Init ( SDL_INIT_AUDIO | SDL_INIT_VIDEO | SDL_INIT_TIMER ) )
 		throw ( mexception ( "SDL_Init error" ) );
 	
-	SDL_WM_SetCaption ( title.c_str(), title.c_str() );
+	SDL_WM_SetCaption ( sdlconf.title.c_str(), sdlconf.title.c_str() );
 	
-	if ( icon.c_str() )
+	if ( sdlconf.icon.c_str() )
 	{
-		SDL_Surface* tmp = IMG_Load ( icon.c_str() );
+		SDL_Surface* tmp = IMG_Load ( sdlconf.icon.c_str() );
 		if ( tmp )
 		{
 			SDL_WM_SetIcon ( tmp, NULL );
@@ -113,11 +128,36 @@ void SDLBase::initSDL(const string& confpath)
 		}
 	}
 	
-	screen_ = SDL_SetVideoMode ( w, h, bpp, SDL_SWSURFACE );
-	if ( !screen_ )
+	window_ = SDL_SetVideoMode ( sdlconf.w, sdlconf.h, sdlconf.bpp, SDL_SWSURFACE );
+	if ( !window_ )
 		throw ( mexception ( "SDL_SetVideoMode error" ) );
 	
-	SDLBase::fps = fps;
+	// the game is drawn in a smaller surface of the same format, so the
+	// display formatted images fit both
+	if ( sdlconf.scale > 1 )
+	{
+		const SDL_PixelFormat* format = window_->format;
+		
+		screen_ = SDL_CreateRGBSurface (
+			SDL_SWSURFACE,
+			sdlconf.w / sdlconf.scale, sdlconf.h / sdlconf.scale,
+			format->BitsPerPixel,
+			format->Rmask, format->Gmask, format->Bmask, format->Amask
+		);
+		if ( !screen_ )
+			throw ( mexception ( "SDL_CreateRGBSurface error" ) );
+		
+		upscaler_ = new Upscaler ( screen_, window_, sdlconf.scale );
+	}
+	else
+		screen_ = window_;
+	
+	SDLBase::fps = sdlconf.fps;
+	
+	if ( sdlconf.compositor )
+		compositor_ = new Compositor ( screen_ );
+	
+	ImageCache::init ( sdlconf.cache );
 	
 	if( TTF_Init() )
 		throw( mexception( "TTF_Init error" ) );
@@ -131,10 +171,13 @@ void SDLBase::initSDL(const string& confpath)
 	{
 		throw( mexception( "Mix_OpenAudio error" ) );
 	}
+	
+	AudioBank::init();
 }
 
 void SDLBase::closeSDL()
 {
+	AudioBank::close();
 	Mix_CloseAudio();
 	
 	TTF_Quit();
@@ -142,8 +185,22 @@ void SDLBase::closeSDL()
 	if ( !screen_ )
 		throw ( mexception ( "SDL already off" ) );
 	
+	ImageCache::close ();
+	
+	delete compositor_;
+	compositor_ = NULL;
+	
+	if ( upscaler_ )
+	{
+		delete upscaler_;
+		upscaler_ = NULL;
+		
+		SDL_FreeSurface ( screen_ );
+	}
+	
 	SDL_Quit ();
 	screen_ = NULL;
+	window_ = NULL;
 }
 
 SDL_Surface* SDLBase::screen ()
@@ -154,6 +211,20 @@ SDL_Surface* SDLBase::screen ()
 	return screen_;
 }
 
+int SDLBase::scale ()
+{
+	return ( upscaler_ ? upscaler_->factor () : 1 );
+}
+
+void SDLBase::windowToScreen (int& x, int& y)
+{
+	if ( upscaler_ )
+	{
+		x = upscaler_->mapX ( x );
+		y = upscaler_->mapY ( y );
+	}
+}
+
 SDL_Surface* SDLBase::loadIMG (const string& filename)
 {
 	if ( !screen_ )
@@ -162,29 +233,331 @@ SDL_Surface* SDLBase::loadIMG (const string& filename)
 	SDL_Surface* tmp = NULL;
 	SDL_Surface* ret = NULL;
 	
+	ImageInfo info;
+	
+	ret = ImageCache::load ( filename, info );
+	if ( ret )
+	{
+		// the cached blobs aren't RLE encoded, as the compositor needs
+		if ( ( ret->flags & SDL_SRCCOLORKEY ) && ( !compositor_ ) )
+			SDL_SetColorKey ( ret, SDL_SRCCOLORKEY | SDL_RLEACCEL, ret->format->colorkey );
+		
+		images_.push_back ( info );
+		return ret;
+	}
+	
 	tmp = IMG_Load ( filename.c_str () );
 	if ( !tmp )
 		throw ( mexception ( "IMG_Load error" ) );
 	
-	if ( tmp->format->Amask )
-		ret = SDL_DisplayFormatAlpha ( tmp );
+	info.filename = filename;
+	info.w = tmp->w;
+	info.h = tmp->h;
+	info.opacity = classify ( tmp );
+	for ( int i = 0; i < 4; i++ )
+		info.tiles[i] = 0;
+	
+	try {
+		ret = displayFormat ( tmp, info.opacity );
+	} catch (mexception& e) {
+		SDL_FreeSurface ( tmp );
+		throw;
+	}
+	
+	SDL_FreeSurface ( tmp );
+	
+	ImageCache::save ( filename, ret, info );
+	images_.push_back ( info );
+	
+	return ret;
+}
+
+/// @param surface Surface to be read. Must be locked, if needed.
+/// @param x Column of the pixel.
+/// @param y Row of the pixel.
+/// @return Raw value of the pixel.
+/// @brief Reads a pixel of any depth
+static Uint32 getPixel (SDL_Surface* surface, int x, int y)
+{
+	Uint8* p = (Uint8*) surface->pixels + y * surface->pitch +
+		x * surface->format->BytesPerPixel;
+	
+	switch ( surface->format->BytesPerPixel )
+	{
+	case 1:
+		return *p;
+	
+	case 2:
+		return *( (Uint16*) p );
+	
+	case 3:
+		if ( SDL_BYTEORDER == SDL_BIG_ENDIAN )
+			return ( ( p[0] << 16 ) | ( p[1] << 8 ) | p[2] );
+		return ( p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) );
+	
+	default:
+		return *( (Uint32*) p );
+	}
+}
+
+SDLBase::Opacity SDLBase::classify (SDL_Surface* surface, SDL_Rect* rect)
+{
+	if ( !surface )
+		throw ( mexception ( "Invalid SDLBase::classify call" ) );
+	
+	bool keyed = ( ( surface->flags & SDL_SRCCOLORKEY ) != 0 );
+	const SDL_PixelFormat* format = surface->format;
+	
+	if ( ( !keyed ) && ( !format->Amask ) )
+		return OPAQUE;
+	
+	int x0 = 0, y0 = 0, x1 = surface->w, y1 = surface->h;
+	if ( rect )
+	{
+		x0 = std::max ( int ( rect->x ), 0 );
+		y0 = std::max ( int ( rect->y ), 0 );
+		x1 = std::min ( rect->x + rect->w, surface->w );
+		y1 = std::min ( rect->y + rect->h, surface->h );
+	}
+	
+	bool transparent = false;
+	bool opaque = false;
+	bool translucent = false;
+	
+	if ( SDL_MUSTLOCK ( surface ) )
+		SDL_LockSurface ( surface );
+	
+	for ( int y = y0; ( y < y1 ) && ( !translucent ); y++ )
+	{
+		for ( int x = x0; ( x < x1 ) && ( !translucent ); x++ )
+		{
+			Uint32 pixel = getPixel ( surface, x, y );
+			Uint8 r, g, b, a = SDL_ALPHA_OPAQUE;
+			
+			if ( ( keyed ) && ( pixel == format->colorkey ) )
+				a = SDL_ALPHA_TRANSPARENT;
+			else if ( format->Amask )
+				SDL_GetRGBA ( pixel, surface->format, &r, &g, &b, &a );
+			
+			if ( a == SDL_ALPHA_TRANSPARENT )
+				transparent = true;
+			else if ( a == SDL_ALPHA_OPAQUE )
+				opaque = true;
+			else
+				translucent = true;
+		}
+	}
+	
+	if ( SDL_MUSTLOCK ( surface ) )
+		SDL_UnlockSurface ( surface );
+	
+	if ( translucent )
+		return TRANSLUCENT;
+	if ( !opaque )
+		return EMPTY;
+	if ( transparent )
+		return BINARY;
+	return OPAQUE;
+}
+
+/// @param surface 32-bit surface with alpha channel. Must be locked, if
+/// needed.
+/// @param display Pixel format of the screen.
+/// @return Color key that, in display format, differs from every opaque pixel
+/// of the surface, or -1 if there isn't any.
+/// @brief Chooses a color key for a binary surface
+static long int chooseKey (SDL_Surface* surface, SDL_PixelFormat* display)
+{
+	vector< Uint32 > used;
+	
+	for ( int y = 0; y < surface->h; y++ )
+	{
+		Uint32* row = (Uint32*) ( (Uint8*) surface->pixels + y * surface->pitch );
+		for ( int x = 0; x < surface->w; x++ )
+		{
+			Uint8 r, g, b, a;
+			SDL_GetRGBA ( row[x], surface->format, &r, &g, &b, &a );
+			if ( a != SDL_ALPHA_TRANSPARENT )
+				used.push_back ( SDL_MapRGB ( display, r, g, b ) );
+		}
+	}
+	
+	std::sort ( used.begin (), used.end () );
+	used.erase ( std::unique ( used.begin (), used.end () ), used.end () );
+	
+	// magenta first, and then the colors closest to it
+	for ( long int c = 0; c < 0x1000000; c++ )
+	{
+		long int rgb = 0xFF00FF ^ c;
+		Uint32 key = SDL_MapRGB (
+			display, ( rgb >> 16 ) & 0xFF, ( rgb >> 8 ) & 0xFF, rgb & 0xFF
+		);
+		
+		if ( !std::binary_search ( used.begin (), used.end (), key ) )
+			return rgb;
+	}
+	
+	return -1;
+}
+
+SDL_Surface* SDLBase::displayFormat (SDL_Surface* surface, Opacity opacity)
+{
+	if ( !screen_ )
+		throw ( mexception ( "SDL still off" ) );
+	
+	SDL_Surface* ret = NULL;
+	
+	if ( opacity == OPAQUE )
+		ret = SDL_DisplayFormat ( surface );
+	else if ( opacity == TRANSLUCENT )
+		ret = SDL_DisplayFormatAlpha ( surface );
 	else
+	{
+		// a copy with alpha channel, where the transparent pixels are
+		// painted with the key before the alpha channel is dropped
+		SDL_Surface* tmp = SDL_DisplayFormatAlpha ( surface );
+		if ( !tmp )
+			throw ( mexception ( "SDL display format conversion error" ) );
+		
+		if ( SDL_MUSTLOCK ( tmp ) )
+			SDL_LockSurface ( tmp );
+		
+		long int rgb = chooseKey ( tmp, screen_->format );
+		
+		if ( rgb >= 0 )
+		{
+			Uint32 key = SDL_MapRGBA (
+				tmp->format,
+				( rgb >> 16 ) & 0xFF, ( rgb >> 8 ) & 0xFF, rgb & 0xFF,
+				SDL_ALPHA_OPAQUE
+			);
+			
+			for ( int y = 0; y < tmp->h; y++ )
+			{
+				Uint32* row = (Uint32*) ( (Uint8*) tmp->pixels + y * tmp->pitch );
+				for ( int x = 0; x < tmp->w; x++ )
+				{
+					if ( !( row[x] & tmp->format->Amask ) )
+						row[x] = key;
+				}
+			}
+		}
+		
+		if ( SDL_MUSTLOCK ( tmp ) )
+			SDL_UnlockSurface ( tmp );
+		
+		// every opaque color is in use: the alpha channel stays
+		if ( rgb < 0 )
+			return tmp;
+		
 		ret = SDL_DisplayFormat ( tmp );
+		SDL_FreeSurface ( tmp );
+		
+		if ( ret )
+		{
+			Uint32 key = SDL_MapRGB (
+				ret->format, ( rgb >> 16 ) & 0xFF, ( rgb >> 8 ) & 0xFF, rgb & 0xFF
+			);
+			
+			// the compositor draws the screen by itself and can't read RLE
+			// encoded surfaces
+			SDL_SetColorKey (
+				ret, SDL_SRCCOLORKEY | ( compositor_ ? 0 : SDL_RLEACCEL ), key
+			);
+		}
+	}
+	
 	if ( !ret )
 		throw ( mexception ( "SDL display format conversion error" ) );
 	
-	SDL_FreeSurface ( tmp );
-	
 	return ret;
 }
+	
+const vector< SDLBase::ImageInfo >& SDLBase::images ()
+{
+	return images_;
+}
+
+void SDLBase::clearImages ()
+{
+	images_.clear ();
+}
+
+void SDLBase::noteTile (const string& filename, Opacity opacity)
+{
+	for ( size_t i = images_.size (); i > 0; i-- )
+	{
+		if ( images_[i - 1].filename == filename )
+		{
+			images_[i - 1].tiles[opacity]++;
+			return;
+		}
+	}
+}
+
+const char* SDLBase::opacityName (Opacity opacity)
+{
+	switch ( opacity )
+	{
+	case EMPTY:
+		return "empty";
+	
+	case OPAQUE:
+		return "opaque";
+	
+	case BINARY:
+		return "binary";
+	
+	default:
+		return "translucent";
+	}
+}
 
 void SDLBase::renderSurface (
 	SDL_Surface* src,
 	SDL_Rect* srcrect,
-	SDL_Rect* dstrect
+	SDL_Rect* dstrect,
+	bool premultiplied
 )
 {
-	SDL_BlitSurface ( src, srcrect, screen_, dstrect );
+	// SDL can't blend these, so they're left to AlphaBlit; without the
+	// compositor, one of their own clips them and draws them right away
+	if ( ( premultiplied ) && ( compositor_ ) )
+	{
+		if ( compositor_->blitPremultiplied ( src, srcrect, dstrect ) )
+			return;
+	}
+	else if ( premultiplied )
+	{
+		Compositor direct ( screen_ );
+		if ( direct.blitPremultiplied ( src, srcrect, dstrect ) )
+		{
+			direct.flush ( false );
+			return;
+		}
+	}
+	
+	if ( compositor_ )
+		compositor_->blit ( src, srcrect, dstrect );
+	else
+		SDL_BlitSurface ( src, srcrect, screen_, dstrect );
+}
+
+bool SDLBase::renderTransformed (
+	SDL_Surface* src,
+	const SDL_Rect& srcrect,
+	const lalge::R2LinearOp& op,
+	double x, double y,
+	bool smooth
+)
+{
+	if ( !compositor_ )
+		return false;
+	
+	return compositor_->transform (
+		src, srcrect, op, x, y,
+		smooth ? Compositor::BILINEAR : Compositor::NEAREST
+	);
 }
 
 void SDLBase::delayFrame ()
@@ -192,6 +565,14 @@ void SDLBase::delayFrame ()
 	static unsigned int t = 0;
 	unsigned int frame_size = 1000 / fps;
 	
+	if ( step_ )
+	{
+		dt_ = step_;
+		elapsed_ += dt_;
+		t = SDL_GetTicks ();
+		return;
+	}
+	
 	dt_ = SDL_GetTicks () - t;
 	
 	if ( dt_ < frame_size )
@@ -200,6 +581,7 @@ void SDLBase::delayFrame ()
 	t = SDL_GetTicks ();
 	
 	dt_ = ( ( dt_ < frame_size ) ? frame_size : dt_ );
+	elapsed_ += dt_;
 }
 
 unsigned int SDLBase::dt ()
@@ -207,6 +589,11 @@ unsigned int SDLBase::dt ()
 	return dt_;
 }
 
+unsigned int SDLBase::elapsed ()
+{
+	return elapsed_;
+}
+
 float SDLBase::FPS ()
 {
 	return ( (float) 1000 / dt_ );
@@ -218,9 +605,49 @@ void SDLBase::setFPS(unsigned int fps)
 		SDLBase::fps = fps;
 }
 
+void SDLBase::setStep(unsigned int step)
+{
+	step_ = step;
+}
+
 void SDLBase::updateScreen ()
 {
-	SDL_Flip ( screen_ );
+	if ( !screen_ )
+		throw ( mexception ( "SDL still off" ) );
+	
+	double t0 = seconds ();
+	
+	if ( compositor_ )
+		compositor_->flush ();
+	
+	double t1 = seconds ();
+	
+	if ( upscaler_ )
+		upscaler_->flush ();
+	
+	double t2 = seconds ();
+	
+	SDL_Flip ( window_ );
+	
+	double t3 = seconds ();
+	
+	frames_.frames++;
+	frames_.draw += ( t1 - t0 ) * 1000;
+	frames_.upscale += ( t2 - t1 ) * 1000;
+	frames_.flip += ( t3 - t2 ) * 1000;
+}
+
+const SDLBase::FrameStats& SDLBase::frameStats ()
+{
+	return frames_;
+}
+
+void SDLBase::resetFrameStats ()
+{
+	frames_.frames = 0;
+	frames_.draw = 0;
+	frames_.upscale = 0;
+	frames_.flip = 0;
 }
 
 SDL_Surface* SDLBase::rotozoom (
@@ -230,6 +657,20 @@ SDL_Surface* SDLBase::rotozoom (
 	if ( !( ( src ) && ( ( zoomx > 0 ) && ( zoomy > 0 ) ) ) )
 		throw ( mexception ( "Invalid SDLBase::rotozoom call" ) );
 	
+	// the corners of a rotated color keyed surface would be opaque, so the
+	// key becomes an alpha channel first
+	if ( ( src->flags & SDL_SRCCOLORKEY ) && ( !src->format->Amask ) )
+	{
+		SDL_Surface* tmp = SDL_DisplayFormatAlpha ( src );
+		if ( !tmp )
+			throw ( mexception ( "SDL display format conversion error" ) );
+		
+		SDL_Surface* ret = rotozoomSurfaceXY ( tmp, angle, zoomx, zoomy, 1 );
+		SDL_FreeSurface ( tmp );
+		
+		return ret;
+	}
+	
 	return rotozoomSurfaceXY ( src, angle, zoomx, zoomy, 1 );
 }
 
@@ -238,11 +679,46 @@ SDL_Surface* SDLBase::clip (SDL_Surface* src, SDL_Rect* rect)
 	if ( !( ( src ) && ( rect ) ) )
 		throw ( mexception ( "Invalid SDLBase::clip call" ) );
 	
+	// the pixels with their own alpha are copied with it, so the piece is
+	// blended over the screen as the whole image would be
+	if ( ( src->flags & SDL_SRCALPHA ) && ( src->format->Amask ) )
+	{
+		SDL_PixelFormat* fmt = src->format;
+		SDL_Surface* tmp = SDL_CreateRGBSurface (
+			SDL_SWSURFACE, rect->w, rect->h, fmt->BitsPerPixel,
+			fmt->Rmask, fmt->Gmask, fmt->Bmask, fmt->Amask
+		);
+		if ( !tmp )
+			throw ( mexception ( "SDL_CreateRGBSurface error" ) );
+		
+		Uint32 flags = src->flags & ( SDL_SRCALPHA | SDL_RLEACCEL );
+		Uint8 alpha = fmt->alpha;
+		
+		SDL_SetAlpha ( src, 0, alpha );
+		SDL_BlitSurface ( src, rect, tmp, NULL );
+		SDL_SetAlpha ( src, flags, alpha );
+		
+		SDL_SetAlpha ( tmp, SDL_SRCALPHA, SDL_ALPHA_OPAQUE );
+		
+		return tmp;
+	}
+	
 	SDL_Surface* tmp = SDL_CreateRGBSurface (
 		SDL_SWSURFACE, rect->w, rect->h, screen_->format->BitsPerPixel,
 		0, 0, 0, 0
 	);
 	
+	// the keyed pixels aren't blitted, so they start with the key
+	if ( src->flags & SDL_SRCCOLORKEY )
+	{
+		Uint8 r, g, b;
+		SDL_GetRGB ( src->format->colorkey, src->format, &r, &g, &b );
+		
+		Uint32 key = SDL_MapRGB ( tmp->format, r, g, b );
+		SDL_FillRect ( tmp, NULL, key );
+		SDL_SetColorKey ( tmp, SDL_SRCCOLORKEY, key );
+	}
+	
 	SDL_BlitSurface ( src, rect, tmp, NULL );
 	
 	return tmp;
@@ -273,7 +749,10 @@ void SDLBase::drawLine(
 				pixel.x = tmp.x( 0 );
 				pixel.y = tmp.x( 1 );
 				
-				SDL_FillRect( screen_, &pixel, rgb );
+				if( compositor_ )
+					compositor_->fill( &pixel, rgb );
+				else
+					SDL_FillRect( screen_, &pixel, rgb );
 				
 				tmp += delta;
 				i++;
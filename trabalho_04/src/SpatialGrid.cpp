@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cmath>
+
+#include "SpatialGrid.hpp"
+
+// a box over more cells than this is put in every bucket instead
+#define SPATIALGRID_SPAN	64
+
+using std::vector;
+
+SpatialGrid::SpatialGrid(float cell, int buckets) :
+cell( ( cell > 0 ) ? cell : 1 ), buckets( ( buckets > 0 ) ? buckets : 1 ), query_( 0 )
+{
+}
+
+void SpatialGrid::clear()
+{
+	// keeps the capacity, so the grid stops allocating after a few frames
+	entries.clear();
+	seen.clear();
+	for( unsigned int b = 0; b < buckets.size(); b++ )
+		buckets[b].clear();
+}
+
+int SpatialGrid::bucket(int i, int j) const
+{
+	unsigned int h = ( (unsigned int) i * 73856093u ) ^ ( (unsigned int) j * 19349663u );
+	return ( h % buckets.size() );
+}
+
+void SpatialGrid::insert(int id, float x0, float y0, float x1, float y1)
+{
+	Entry entry = { id, x0, y0, x1, y1 };
+	int index = entries.size();
+	
+	entries.push_back( entry );
+	seen.push_back( query_ );
+	
+	int i0 = (int) floor( y0 / cell ), i1 = (int) floor( y1 / cell );
+	int j0 = (int) floor( x0 / cell ), j1 = (int) floor( x1 / cell );
+	
+	if( ( i1 - i0 + 1 ) * ( j1 - j0 + 1 ) > SPATIALGRID_SPAN )
+	{
+		for( unsigned int b = 0; b < buckets.size(); b++ )
+			buckets[b].push_back( index );
+		return;
+	}
+	
+	for( int i = i0; i <= i1; i++ )
+	{
+		for( int j = j0; j <= j1; j++ )
+		{
+			vector< int >& cellbucket = buckets[ bucket( i, j ) ];
+			
+			// the cells of a box that share a bucket hold it once
+			if( ( cellbucket.empty() ) || ( cellbucket.back() != index ) )
+				cellbucket.push_back( index );
+		}
+	}
+}
+
+void SpatialGrid::query(float x0, float y0, float x1, float y1, vector< int >& ids)
+{
+	ids.clear();
+	
+	if( !++query_ )
+	{
+		std::fill( seen.begin(), seen.end(), 0 );
+		query_ = 1;
+	}
+	
+	int i0 = (int) floor( y0 / cell ), i1 = (int) floor( y1 / cell );
+	int j0 = (int) floor( x0 / cell ), j1 = (int) floor( x1 / cell );
+	
+	// a query over more cells than there are buckets sees every bucket
+	// anyway
+	found.clear();
+	if( double( i1 - i0 + 1 ) * ( j1 - j0 + 1 ) >= buckets.size() )
+	{
+		for( unsigned int k = 0; k < entries.size(); k++ )
+			found.push_back( k );
+	}
+	else
+	{
+		for( int i = i0; i <= i1; i++ )
+		{
+			for( int j = j0; j <= j1; j++ )
+			{
+				const vector< int >& cellbucket = buckets[ bucket( i, j ) ];
+				
+				for( unsigned int k = 0; k < cellbucket.size(); k++ )
+				{
+					if( seen[ cellbucket[k] ] != query_ )
+					{
+						seen[ cellbucket[k] ] = query_;
+						found.push_back( cellbucket[k] );
+					}
+				}
+			}
+		}
+		std::sort( found.begin(), found.end() );
+	}
+	
+	for( unsigned int k = 0; k < found.size(); k++ )
+	{
+		const Entry& e = entries[ found[k] ];
+		
+		if( ( e.x0 <= x1 ) && ( e.x1 >= x0 ) && ( e.y0 <= y1 ) && ( e.y1 >= y0 ) )
+			ids.push_back( e.id );
+	}
+}
+
+int SpatialGrid::size() const
+{
+	return entries.size();
+}
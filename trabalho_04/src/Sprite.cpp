@@ -3,21 +3,32 @@
 /// @brief Implementations of all methods of the Sprite class
 /// @author Matheus Pimenta
 
+#include <cmath>
+
 #include "Sprite.hpp"
 
+using namespace lalge;
+
 using std::string;
 
 Sprite::Sprite () :
-src ( NULL ), rotozoomed ( NULL ), angle_ ( 0 ), zoomx ( 1 ), zoomy ( 1 )
+src ( NULL ), rotozoomed ( NULL ), transformed ( false ),
+angle_ ( 0 ), zoomx ( 1 ), zoomy ( 1 )
 {
 }
 
 Sprite::Sprite (const string& filename) :
-rotozoomed ( NULL ), angle_ ( 0 ), zoomx ( 1 ), zoomy ( 1 )
+rotozoomed ( NULL ), transformed ( false ), angle_ ( 0 ), zoomx ( 1 ), zoomy ( 1 )
 {
 	load_ ( filename );
 }
 
+Sprite::Sprite (const Atlas::Region& region) :
+rotozoomed ( NULL ), transformed ( false ), angle_ ( 0 ), zoomx ( 1 ), zoomy ( 1 )
+{
+	load_ ( region );
+}
+
 Sprite::~Sprite ()
 {
 	unload ();
@@ -30,15 +41,35 @@ void Sprite::load (const string& filename)
 	load_ ( filename );
 }
 
+void Sprite::load (const Atlas::Region& region)
+{
+	unload ();
+	
+	load_ ( region );
+}
+
 void Sprite::load_ (const string& filename)
 {
 	src = SDLBase::loadIMG ( filename );
 	
-	srcrect_.x = 0;
-	srcrect_.y = 0;
+	region_.x = 0;
+	region_.y = 0;
+	
+	region_.w = src->w;
+	region_.h = src->h;
+	
+	srcrect_ = region_;
+}
+
+void Sprite::load_ (const Atlas::Region& region)
+{
+	src = region.page;
+	
+	// the page is freed by the last of the atlas and its sprites
+	src->refcount++;
 	
-	srcrect_.w = src->w;
-	srcrect_.h = src->h;
+	region_ = region.rect;
+	srcrect_ = region_;
 }
 
 void Sprite::unload ()
@@ -54,14 +85,14 @@ void Sprite::unload ()
 
 void Sprite::clip (int x, int y, int w, int h)
 {
-	srcrect_.x = x;
-	srcrect_.y = y;
+	srcrect_.x = region_.x + x;
+	srcrect_.y = region_.y + y;
 	
 	srcrect_.w = w;
 	srcrect_.h = h;
 	
-	if ( rotozoomed )
-		rotozoom ();
+	// made again only if it's needed
+	discard ();
 }
 
 const SDL_Rect& Sprite::srcrect () const
@@ -71,12 +102,22 @@ const SDL_Rect& Sprite::srcrect () const
 
 int Sprite::srcW () const
 {
-	return src->w;
+	return region_.w;
 }
 
 int Sprite::srcH () const
 {
-	return src->h;
+	return region_.h;
+}
+
+SDL_Surface* Sprite::surface () const
+{
+	return src;
+}
+
+const SDL_Rect& Sprite::region () const
+{
+	return region_;
 }
 
 int Sprite::rectW () const
@@ -93,8 +134,24 @@ void Sprite::render (int x, int y)
 {
 	SDL_Rect dstrect;
 	
-	if ( rotozoomed )
+	if ( ( transformed ) && ( src ) )
 	{
+		Scalar c = cos ( deg2rad ( angle_ ) );
+		Scalar s = sin ( deg2rad ( angle_ ) );
+		
+		// the turn of rotozoomSurfaceXY, counterclockwise in the screen
+		R2LinearOp op = r2lop ( c * zoomx, s * zoomy, -s * zoomx, c * zoomy );
+		
+		if ( SDLBase::renderTransformed (
+			src, srcrect_, op, x + srcrect_.w / 2.0, y + srcrect_.h / 2.0
+		) )
+		{
+			return;
+		}
+		
+		if ( !rotozoomed )
+			rotozoom ();
+		
 		dstrect.x = x + ( srcrect_.w - rotozoomed->w ) / 2;
 		dstrect.y = y + ( srcrect_.h - rotozoomed->h ) / 2;
 		
@@ -124,13 +181,15 @@ void Sprite::rotozoom (float angle, float zoomx, float zoomy, bool force)
 		this->zoomx = zoomx;
 		this->zoomy = zoomy;
 		
-		rotozoom ();
+		discard ();
 	}
+	
+	transformed = true;
 }
 
 void Sprite::rotozoom ()
 {
-	restore ();
+	discard ();
 	
 	if (	( !srcrect_.x ) &&
 		( !srcrect_.y ) &&
@@ -147,7 +206,7 @@ void Sprite::rotozoom ()
 	}
 }
 
-void Sprite::restore ()
+void Sprite::discard ()
 {
 	if ( rotozoomed )
 	{
@@ -156,6 +215,12 @@ void Sprite::restore ()
 	}
 }
 
+void Sprite::restore ()
+{
+	discard ();
+	transformed = false;
+}
+
 float Sprite::angle () const
 {
 	return angle_;
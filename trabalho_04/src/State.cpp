@@ -1,5 +1,9 @@
 #include "State.hpp"
 
+StateArgs::~StateArgs()
+{
+}
+
 State::State() : newstate(0)
 {
 }
@@ -7,3 +11,21 @@ State::State() : newstate(0)
 State::~State()
 {
 }
+
+void State::suspend()
+{
+}
+
+void State::resume()
+{
+}
+
+void State::release()
+{
+	arena.release();
+}
+
+const Arena& State::memory() const
+{
+	return arena;
+}
@@ -1,3 +1,5 @@
+#include <cstdio>
+#include <cstdlib>
 #include <string>
 
 #include "configfile.hpp"
@@ -7,14 +9,35 @@
 
 #include "SDLBase.hpp"
 #include "InputManager.hpp"
+#include "AudioBank.hpp"
+#include "JobSystem.hpp"
+#include "ImageCache.hpp"
+#include "ChunkStream.hpp"
 #include "GameStates.hpp"
 
+// how long the main thread waits for a snapshot before handling the input
+#define PIPELINE_POLL	5
+
 using std::string;
+using std::vector;
 
-StateManager::StateManager(const MainArgs& args) : args(args), quit(false)
+StateManager::StateManager(const MainArgs& args) :
+args(args), quit(false), building(0), ready(1), presenting(2), fresh(false),
+simulation(NULL), simulating(false), pending(0),
+presented(0), dropped(0), latency(0), maxlatency(0)
 {
+	world = SDL_CreateMutex();
+	mailbox = SDL_CreateMutex();
+	published = SDL_CreateCond();
+	
 	initThirdParty();
-	SDLBase::initSDL( args.get( "--path" ) + "conf/SDL.conf" );
+	
+	// "-scale n" draws the game n times smaller than the window
+	int scale = 0;
+	if( args.find( "-scale" ) != -1 )
+		scale = atoi( args.get( "-scale" ).c_str() );
+	SDLBase::initSDL( args.get( "--path" ) + "conf/SDL.conf", scale );
+	
 	initState();
 	InputManager::instance();
 }
@@ -25,40 +48,280 @@ StateManager::~StateManager()
 	closeState();
 	SDLBase::closeSDL();
 	closeThirdParty();
+	
+	SDL_DestroyCond( published );
+	SDL_DestroyMutex( mailbox );
+	SDL_DestroyMutex( world );
 }
 
 void StateManager::initThirdParty()
 {
 	srand( time( NULL ) );
+	
+	// "-jobs n" overrides the number of worker threads (one per core)
+	if( args.find( "-jobs" ) != -1 )
+		JobSystem::init( atoi( args.get( "-jobs" ).c_str() ) );
+	else
+		JobSystem::init();
+	
+	// the stress scenarios need no window and no sound card
+	if( args.find( "-stress" ) != -1 )
+	{
+		putenv( (char*) "SDL_VIDEODRIVER=dummy" );
+		putenv( (char*) "SDL_AUDIODRIVER=dummy" );
+	}
 }
 
 void StateManager::initState()
 {
-	state = new StateSplash();
+	// "-stress [file]" runs the stress scenarios instead of the game
+	if( args.find( "-stress" ) != -1 )
+		state = createState( STATESTRESS );
+	else
+		state = createState( STATESPLASH );
 	state->load( &args );
 }
 
 void StateManager::closeState()
 {
-	state->unload();
-	delete state;
+	StateArgs* st_args = unloadState( state );
+	if( st_args )
+		delete st_args;
+	
+	while( suspended.size() )
+	{
+		st_args = unloadState( suspended.back() );
+		if( st_args )
+			delete st_args;
+		suspended.pop_back();
+	}
+}
+
+StateArgs* StateManager::unloadState(State* which)
+{
+	StateArgs* st_args = which->unload();
+	releaseState( which );
+	delete which;
+	
+	return st_args;
+}
+
+void StateManager::releaseState(State* which)
+{
+	// debugging tool to show the memory used by each state
+	if( args.find( "-arena" ) != -1 )
+	{
+		const Arena& arena = which->memory();
+		
+		printf(
+			"Arena %s: peak %lu bytes, %lu objects, %lu bytes reserved\n",
+			which->name(),
+			(unsigned long) arena.peak(),
+			(unsigned long) arena.objects(),
+			(unsigned long) arena.reserved()
+		);
+	}
+	
+	// debugging tool to show the use of the mixing channels
+	if( args.find( "-audio" ) != -1 )
+	{
+		const AudioBank::Stats& stats = AudioBank::stats();
+		
+		printf(
+			"Audio %s: %u decoded, %u cached, %u plays, %u collapsed, "
+			"%u stolen, %u refused, %d/%d channels busy (peak %d)\n",
+			which->name(),
+			stats.decoded,
+			stats.hits,
+			stats.plays,
+			stats.collapsed,
+			stats.stolen,
+			stats.refused,
+			stats.busy,
+			stats.channels,
+			stats.peak
+		);
+	}
+	
+	// debugging tool to show how the images were converted
+	if( args.find( "-images" ) != -1 )
+	{
+		const vector< SDLBase::ImageInfo >& images = SDLBase::images();
+		
+		for( unsigned int i = 0; i < images.size(); i++ )
+		{
+			printf(
+				"Image %s: %s %dx%d %s",
+				which->name(),
+				images[i].filename.c_str(),
+				images[i].w,
+				images[i].h,
+				SDLBase::opacityName( images[i].opacity )
+			);
+			
+			const int* tiles = images[i].tiles;
+			if( tiles[0] + tiles[1] + tiles[2] + tiles[3] )
+			{
+				printf(
+					", tiles %d empty, %d opaque, %d binary, %d translucent",
+					tiles[ SDLBase::EMPTY ],
+					tiles[ SDLBase::OPAQUE ],
+					tiles[ SDLBase::BINARY ],
+					tiles[ SDLBase::TRANSLUCENT ]
+				);
+			}
+			printf( "\n" );
+		}
+		
+		const ImageCache::Stats& stats = ImageCache::stats();
+		printf(
+			"Image cache %s: %u hits, %u misses, %u decoded in parallel, %u written\n",
+			which->name(),
+			stats.hits,
+			stats.misses,
+			stats.prefetched,
+			stats.written
+		);
+	}
+	SDLBase::clearImages();
+	ImageCache::resetStats();
+	
+	// debugging tool to show how well the map chunks were streamed
+	if( args.find( "-chunks" ) != -1 )
+	{
+		const ChunkStream::Stats& stats = ChunkStream::stats();
+		unsigned int drawn = stats.hits + stats.misses;
+		
+		printf(
+			"Chunks %s: %u requested, %u loaded, %u hits, %u misses (drawn empty), "
+			"%.1f%% hit rate, %u evicted, %u blocking loads\n",
+			which->name(),
+			stats.requested,
+			stats.loaded,
+			stats.hits,
+			stats.misses,
+			drawn ? 100.0 * stats.hits / drawn : 100.0,
+			stats.evicted,
+			stats.blocking
+		);
+	}
+	ChunkStream::resetStats();
+	
+	// debugging tool to show how long the frames take to reach the screen
+	if( args.find( "-latency" ) != -1 )
+	{
+		printf(
+			"Latency %s: %u frames presented, %u dropped, "
+			"%.1f ms average, %u ms max\n",
+			which->name(),
+			presented,
+			dropped,
+			presented ? latency / presented : 0.0,
+			maxlatency
+		);
+	}
+	presented = 0;
+	dropped = 0;
+	latency = 0;
+	maxlatency = 0;
+	
+	// debugging tool to show where the time to show a frame goes
+	if( args.find( "-frames" ) != -1 )
+	{
+		const SDLBase::FrameStats& stats = SDLBase::frameStats();
+		unsigned int frames = stats.frames ? stats.frames : 1;
+		
+		printf(
+			"Frames %s: %dx%d at scale %d, %u frames, %.2f ms drawing, "
+			"%.2f ms upscaling, %.2f ms flipping (average)\n",
+			which->name(),
+			SDLBase::screen()->w,
+			SDLBase::screen()->h,
+			SDLBase::scale(),
+			stats.frames,
+			stats.draw / frames,
+			stats.upscale / frames,
+			stats.flip / frames
+		);
+	}
+	SDLBase::resetFrameStats();
+	
+	// all of the state-lifetime objects are freed at once
+	which->release();
 }
 
 void StateManager::closeThirdParty()
 {
+	JobSystem::close();
 }
 
 void StateManager::run()
 {
+	if( args.find( "-pipeline" ) != -1 )
+	{
+		runPipelined();
+		return;
+	}
+	
 	while( !quit )
 	{
 		SDLBase::delayFrame ();
 		
+		unsigned int tick = SDL_GetTicks();
+		
 		input();
 		
 		update();
 		
-		render();
+		render( tick );
+	}
+}
+
+// The simulation runs on its own thread and the main thread only handles the
+// input and draws the snapshots, because SDL 1.2 must be called from the
+// thread that set the video mode. The world mutex keeps the input handlers
+// away from a simulation step. The state only changes while the simulation
+// thread is stopped.
+void StateManager::runPipelined()
+{
+	startSimulation();
+	
+	while( !quit )
+	{
+		SDL_LockMutex( world );
+		InputManager::instance()->update();
+		SDL_UnlockMutex( world );
+		
+		SDL_LockMutex( mailbox );
+		if( ( !fresh ) && ( simulating ) )
+			SDL_CondWaitTimeout( published, mailbox, PIPELINE_POLL );
+		bool frame = fresh;
+		if( fresh )
+		{
+			int tmp = presenting;
+			presenting = ready;
+			ready = tmp;
+			fresh = false;
+		}
+		bool stopped = !simulating;
+		SDL_UnlockMutex( mailbox );
+		
+		if( frame )
+			present( snapshots[ presenting ] );
+		
+		if( stopped )
+		{
+			SDL_WaitThread( simulation, NULL );
+			simulation = NULL;
+			
+			// the snapshots point to the objects of the old state
+			for( int i = 0; i < 3; i++ )
+				snapshots[ i ].clear();
+			
+			changeState( pending );
+			if( !quit )
+				startSimulation();
+		}
 	}
 }
 
@@ -67,50 +330,216 @@ void StateManager::input()
 	InputManager::instance()->update();
 	
 	int newstate = state->input();
-	if( newstate == STATEQUIT )
-		quit = true;
-	else if( newstate )
+	if( newstate )
 		changeState( newstate );
 }
 
 void StateManager::update()
 {
 	int newstate = state->update();
-	if( newstate == STATEQUIT )
-		quit = true;
-	else if( newstate )
+	if( newstate )
 		changeState( newstate );
 }
 
-void StateManager::render()
+void StateManager::render(unsigned int tick)
 {
 	if( !quit )
 	{
-		state->render();
-		SDLBase::updateScreen ();
+		RenderSnapshot& snap = snapshots[ presenting ];
+		snap.clear();
+		snap.tick = tick;
+		snap.clock = SDLBase::elapsed();
+		state->snapshot( snap );
+		present( snap );
 	}
 }
 
-template <typename newstate_t>
-void StateManager::changeState_()
+void StateManager::startSimulation()
 {
-	StateArgs* st_args = state->unload();
-	delete state;
-	state = new newstate_t();
-	state->load( &args, st_args );
-	if( st_args )
-		delete st_args;
+	simulating = true;
+	pending = 0;
+	
+	simulation = SDL_CreateThread( simulationThread, (void*) this );
+	if( !simulation )
+		throw( mexception( "SDL_CreateThread error" ) );
 }
 
-void StateManager::changeState(int newstate)
+int StateManager::simulationThread(void* data)
 {
-	switch( newstate )
+	( (StateManager*) data )->simulate();
+	
+	return 0;
+}
+
+void StateManager::simulate()
+{
+	int newstate = 0;
+	
+	// runs until the state asks for a change, which the main thread makes
+	while( !newstate )
+	{
+		SDLBase::delayFrame ();
+		
+		SDL_LockMutex( world );
+		
+		RenderSnapshot& snap = snapshots[ building ];
+		snap.clear();
+		snap.tick = SDL_GetTicks();
+		snap.clock = SDLBase::elapsed();
+		
+		newstate = state->input();
+		if( !newstate )
+			newstate = state->update();
+		if( !newstate )
+			state->snapshot( snap );
+		
+		SDL_UnlockMutex( world );
+		
+		if( !newstate )
+			publish();
+	}
+	
+	SDL_LockMutex( mailbox );
+	pending = newstate;
+	simulating = false;
+	SDL_CondSignal( published );
+	SDL_UnlockMutex( mailbox );
+}
+
+void StateManager::publish()
+{
+	SDL_LockMutex( mailbox );
+	
+	// the main thread didn't take the last snapshot, so it's never shown,
+	// but its sounds are still played
+	if( fresh )
 	{
-		case STATESPLASH:	changeState_< StateSplash >();		break;
-		case STATEGAME:		changeState_< StateGame >();		break;
-		case STATEWINLOSE:	changeState_< StateWinLose >();	break;
+		dropped++;
+		snapshots[ building ].takeAudio( snapshots[ ready ] );
+	}
+	
+	int tmp = ready;
+	ready = building;
+	building = tmp;
+	fresh = true;
+	
+	SDL_CondSignal( published );
+	SDL_UnlockMutex( mailbox );
+}
+
+void StateManager::present(RenderSnapshot& snap)
+{
+	AudioBank::nextFrame();
+	
+	snap.present();
+	SDLBase::updateScreen ();
+	
+	unsigned int elapsed = SDL_GetTicks() - snap.tick;
+	
+	presented++;
+	latency += elapsed;
+	if( elapsed > maxlatency )
+		maxlatency = elapsed;
+}
+
+State* StateManager::createState(int id)
+{
+	switch( id )
+	{
+		case STATESPLASH:	return new StateSplash();
+		case STATEGAME:		return new StateGame();
+		case STATEWINLOSE:	return new StateWinLose();
+		case STATESTRESS:	return new StateStress();
 		
 		default:
 			break;
 	}
+	
+	return 0;
+}
+
+void StateManager::changeState(int newstate)
+{
+	if( newstate == STATEQUIT )
+		quit = true;
+	else if( newstate == STATEPOP )
+	{
+		popState();
+		AudioBank::purge();
+	}
+	else if( newstate & STATEPUSH )
+		pushState( newstate & ~STATEPUSH );
+	else
+	{
+		// the old state is unloaded before the new one is loaded, but the
+		// sounds stay in the bank until the purge, so the ones both share
+		// aren't decoded again; purging between the two steps would drop them
+		replaceState( newstate );
+		AudioBank::purge();
+	}
+}
+
+void StateManager::pushState(int id)
+{
+	State* next = createState( id );
+	if( !next )
+		return;
+	
+	state->suspend();
+	suspended.push_back( state );
+	
+	state = next;
+	state->load( &args );
+}
+
+void StateManager::popState()
+{
+	// popping the last state quits, it's closed with the manager
+	if( suspended.empty() )
+	{
+		quit = true;
+		return;
+	}
+	
+	StateArgs* st_args = unloadState( state );
+	if( st_args )
+		delete st_args;
+	
+	state = suspended.back();
+	suspended.pop_back();
+	state->resume();
+}
+
+void StateManager::replaceState(int id)
+{
+	// a suspended state of the same kind is resumed instead of loading a
+	// new one, closing everything above it
+	int depth = int( suspended.size() ) - 1;
+	while( ( depth >= 0 ) && ( suspended[ depth ]->id() != id ) )
+		depth--;
+	
+	if( depth >= 0 )
+	{
+		while( int( suspended.size() ) > depth + 1 )
+		{
+			StateArgs* st_args = unloadState( state );
+			if( st_args )
+				delete st_args;
+			
+			state = suspended.back();
+			suspended.pop_back();
+		}
+		popState();
+		return;
+	}
+	
+	State* next = createState( id );
+	if( !next )
+		return;
+	
+	StateArgs* st_args = unloadState( state );
+	state = next;
+	state->load( &args, st_args );
+	if( st_args )
+		delete st_args;
 }
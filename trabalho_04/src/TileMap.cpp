@@ -1,8 +1,22 @@
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <vector>
 
 #include "simplestructures.hpp"
 
 #include "TileMap.hpp"
+#include "ChunkStream.hpp"
+
+/// @brief Chunks kept in the cache of a chunked map
+#define TILEMAP_CHUNKS	256
+
+/// @brief Seconds of look-ahead of a chunked map
+#define TILEMAP_LOOKAHEAD	0.5
+
+/// @brief A layer is kept as spans of tiles that aren't empty while they
+/// take at most this share of the memory of every tile
+#define TILEMAP_SPARSE	0.75
 
 using std::fstream;
 using std::string;
@@ -10,17 +24,129 @@ using std::string;
 class TileMap::Layer
 {
 private:
-	int** tile_matrix;
+	/// @brief n tiles that aren't empty, from column j, the first one at
+	/// first among the tiles of the row
+	struct Span
+	{
+		int j;
+		int n;
+		int first;
+	};
 	
 	int w_;
 	int h_;
 	
-	void alloc ()
+	/// @brief Tiles row by row, when most of them aren't empty
+	std::vector< int > dense;
+	
+	/// @brief Otherwise, the spans of each row and their tiles, where row
+	/// i goes from span_row[i] to span_row[i + 1], as for tile_row
+	std::vector< Span > spans;
+	std::vector< int > tiles;
+	std::vector< int > span_row;
+	std::vector< int > tile_row;
+	
+	bool sparse;
+	
+	/// @brief Row being edited
+	std::vector< int > scratch;
+	std::vector< Span > scratch_spans;
+	std::vector< int > scratch_tiles;
+	
+	static void encodeRow (
+		const int* row,
+		int w,
+		std::vector< Span >& spans,
+		std::vector< int >& tiles
+	)
+	{
+		int first = 0;
+		
+		for ( int j = 0; j < w; )
+		{
+			if ( row[j] < 0 )
+			{
+				++j;
+				continue;
+			}
+			
+			Span span = { j, 0, first };
+			for ( ; ( j < w ) && ( row[j] >= 0 ); ++j, ++span.n )
+				tiles.push_back ( row[j] );
+			
+			first += span.n;
+			spans.push_back ( span );
+		}
+	}
+	
+	void decodeRow (int i, int* row) const
 	{
-		tile_matrix = new int* [ h_ ];
+		std::fill ( row, row + w_, -1 );
+		
+		if ( span_row[i] == span_row[ i + 1 ] )
+			return;
+		
+		const int* t = &tiles[0] + tile_row[i];
+		for ( int s = span_row[i]; s < span_row[ i + 1 ]; ++s )
+			std::copy ( t + spans[s].first, t + spans[s].first + spans[s].n, row + spans[s].j );
+	}
+	
+	/// @return Whether the spans take much less memory than every tile.
+	bool fitsSparse (unsigned long nspans, unsigned long ntiles) const
+	{
+		unsigned long encoded = (
+			nspans * sizeof ( Span ) +
+			ntiles * sizeof ( int ) +
+			2 * ( h_ + 1 ) * sizeof ( int )
+		);
+		return ( encoded < TILEMAP_SPARSE * w_ * h_ * sizeof ( int ) );
+	}
+	
+	/// Keeps the spans or every tile, whatever fits the layer.
+	void encode (std::vector< int >& all)
+	{
+		spans.clear ();
+		tiles.clear ();
+		span_row.assign ( 1, 0 );
+		tile_row.assign ( 1, 0 );
 		
 		for ( int i = 0; i < h_; ++i )
-			tile_matrix[i] = new int [ w_ ];
+		{
+			encodeRow ( &all[ i * w_ ], w_, spans, tiles );
+			
+			span_row.push_back ( spans.size () );
+			tile_row.push_back ( tiles.size () );
+		}
+		
+		sparse = fitsSparse ( spans.size (), tiles.size () );
+		
+		if ( sparse )
+			std::vector< int > ().swap ( dense );
+		else
+		{
+			dropSpans ();
+			dense.swap ( all );
+		}
+	}
+	
+	void dropSpans ()
+	{
+		std::vector< Span > ().swap ( spans );
+		std::vector< int > ().swap ( tiles );
+		std::vector< int > ().swap ( span_row );
+		std::vector< int > ().swap ( tile_row );
+	}
+	
+	void densify ()
+	{
+		std::vector< int > all ( w_ * h_ );
+		
+		for ( int i = 0; i < h_; ++i )
+			decodeRow ( i, &all[ i * w_ ] );
+		
+		dropSpans ();
+		dense.swap ( all );
+		sparse = false;
 	}
 public:
 	Layer (fstream& f)
@@ -30,50 +156,139 @@ public:
 		f >> h_;
 		f.get ();
 		
-		alloc ();
+		std::vector< int > all ( w_ * h_ );
 		
 		for ( int i = 0; i < h_; ++i )
 		{
 			for ( int j = 0; j < w_; ++j )
 			{
-				f >> tile_matrix[i][j];
+				f >> all[ i * w_ + j ];
 				f.get ();
 				
-				--tile_matrix[i][j];
+				--all[ i * w_ + j ];
 			}
 		}
+		
+		encode ( all );
 	}
 	
 	Layer (int w, int h) : w_ ( w ), h_ ( h )
 	{
-		alloc ();
+		std::vector< int > all ( w_ * h_, -1 );
+		encode ( all );
 	}
 	
-	~Layer ()
+	int get (int i, int j) const
 	{
-		for ( int i = 0; i < h_; ++i )
-			delete[] tile_matrix[i];
+		if ( !sparse )
+			return dense[ i * w_ + j ];
 		
-		delete[] tile_matrix;
+		// the last span of the row that starts up to j
+		int lo = span_row[i], hi = span_row[ i + 1 ];
+		while ( lo < hi )
+		{
+			int mid = ( lo + hi ) / 2;
+			
+			if ( spans[ mid ].j <= j )
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		
+		if ( lo > span_row[i] )
+		{
+			const Span& span = spans[ lo - 1 ];
+			
+			if ( j < span.j + span.n )
+				return tiles[ tile_row[i] + span.first + ( j - span.j ) ];
+		}
+		
+		return -1;
 	}
 	
-	int& at (int i, int j)
+	/// Slower for spans: the row is decoded, encoded again and put back in
+	/// place of the old one.
+	void set (int i, int j, int tile)
 	{
-		return tile_matrix[i][j];
+		if ( !sparse )
+		{
+			dense[ i * w_ + j ] = tile;
+			return;
+		}
+		
+		scratch.resize ( w_ );
+		decodeRow ( i, &scratch[0] );
+		if ( scratch[j] == tile )
+			return;
+		scratch[j] = tile;
+		
+		scratch_spans.clear ();
+		scratch_tiles.clear ();
+		encodeRow ( &scratch[0], w_, scratch_spans, scratch_tiles );
+		
+		int dspans = int ( scratch_spans.size () ) - ( span_row[ i + 1 ] - span_row[i] );
+		int dtiles = int ( scratch_tiles.size () ) - ( tile_row[ i + 1 ] - tile_row[i] );
+		
+		// filled up, so the spans cost more than every tile
+		if ( !fitsSparse ( spans.size () + dspans, tiles.size () + dtiles ) )
+		{
+			densify ();
+			dense[ i * w_ + j ] = tile;
+			return;
+		}
+		
+		spans.erase ( spans.begin () + span_row[i], spans.begin () + span_row[ i + 1 ] );
+		spans.insert ( spans.begin () + span_row[i], scratch_spans.begin (), scratch_spans.end () );
+		tiles.erase ( tiles.begin () + tile_row[i], tiles.begin () + tile_row[ i + 1 ] );
+		tiles.insert ( tiles.begin () + tile_row[i], scratch_tiles.begin (), scratch_tiles.end () );
+		
+		for ( int k = i + 1; k <= h_; ++k )
+		{
+			span_row[k] += dspans;
+			tile_row[k] += dtiles;
+		}
+	}
+	
+	/// @return The tile itself, which can be written in place, or NULL if
+	/// the layer is kept as spans.
+	int* cell (int i, int j)
+	{
+		return ( sparse ? NULL : &dense[ i * w_ + j ] );
 	}
 	
 	void render (TileSet* tileset, float cameraX, float cameraY)
 	{
+		int tw = tileset->tileW (), th = tileset->tileH ();
+		
+		if ( sparse )
+		{
+			// the empty tiles aren't even looked at
+			for ( int i = 0; i < h_; ++i )
+			{
+				if ( span_row[i] == span_row[ i + 1 ] )
+					continue;
+				
+				const int* t = &tiles[0] + tile_row[i];
+				
+				for ( int s = span_row[i]; s < span_row[ i + 1 ]; ++s )
+				{
+					for ( int j = spans[s].j; j < spans[s].j + spans[s].n; ++j )
+						tileset->render ( *t++, ( j * tw ) - cameraX, ( i * th ) - cameraY );
+				}
+			}
+			return;
+		}
+		
 		for ( int i = 0; i < h_; ++i )
 		{
 			for ( int j = 0; j < w_; ++j )
 			{
-				if ( tile_matrix[i][j] >= 0 )
+				if ( dense[ i * w_ + j ] >= 0 )
 				{
 					tileset->render (
-						tile_matrix[i][j],
-						( j * tileset->tileW () ) - cameraX,
-						( i * tileset->tileH () ) - cameraY
+						dense[ i * w_ + j ],
+						( j * tw ) - cameraX,
+						( i * th ) - cameraY
 					);
 				}
 			}
@@ -90,22 +305,50 @@ public:
 		return h_;
 	}
 	
+	unsigned long bytes () const
+	{
+		return (
+			dense.capacity () * sizeof ( int ) +
+			spans.capacity () * sizeof ( Span ) +
+			tiles.capacity () * sizeof ( int ) +
+			( span_row.capacity () + tile_row.capacity () ) * sizeof ( int )
+		);
+	}
+	
 	Layer* clone () const
 	{
-		Layer* ret = new Layer ( w_, h_ );
-		
-		for ( int i = 0; i < h_; ++i )
-		{
-			for ( int j = 0; j < w_; ++j )
-				ret->at ( i, j ) = tile_matrix[i][j];
-		}
-		
-		return ret;
+		return new Layer ( *this );
 	}
 };
 
+TileMap::TileRef::TileRef (Layer* layer, int i, int j, int* tile) :
+layer ( layer ), i ( i ), j ( j ), tile ( tile )
+{
+}
+
+TileMap::TileRef::operator int () const
+{
+	return ( tile ? *tile : layer->get ( i, j ) );
+}
+
+TileMap::TileRef& TileMap::TileRef::operator= (int tile)
+{
+	if ( this->tile )
+		*( this->tile ) = tile;
+	else
+		layer->set ( i, j, tile );
+	
+	return *this;
+}
+
+TileMap::TileRef& TileMap::TileRef::operator= (const TileRef& other)
+{
+	return ( *this = int ( other ) );
+}
+
 TileMap::TileMap (TileSet* tileset, const string& map_path) :
-tileset ( tileset ), data ( NULL ), map_layers ( 0 )
+tileset ( tileset ), data ( NULL ), stream ( NULL ), map_layers ( 0 ),
+revision_ ( 0 )
 {
 	load ( map_path );
 }
@@ -126,6 +369,9 @@ void TileMap::clear ()
 		
 		data = NULL;
 	}
+	
+	delete stream;
+	stream = NULL;
 }
 
 void TileMap::load (const string& map_path)
@@ -139,7 +385,14 @@ void TileMap::reload ()
 {
 	clear ();
 	
-	if ( map_path.size () > 0 )
+	revision_++;
+	
+	if ( ( map_path.size () > 0 ) && ( ChunkStream::isChunked ( map_path ) ) )
+	{
+		stream = new ChunkStream ( map_path, TILEMAP_CHUNKS );
+		map_layers = stream->layers ();
+	}
+	else if ( map_path.size () > 0 )
 	{
 		fstream f ( map_path.c_str () );
 		
@@ -155,31 +408,170 @@ void TileMap::reload ()
 	}
 }
 
-int& TileMap::at (int layer, int i, int j)
+void TileMap::resize (int layers, int w, int h)
 {
+	clear ();
+	
+	map_path = "";
+	map_layers = layers;
+	
+	data = new Layer* [ map_layers ];
+	
+	for ( int k = 0; k < map_layers; ++k )
+		data[k] = new Layer ( w, h );
+	
+	revision_++;
+}
+
+void TileMap::save (const string& path, int side)
+{
+	ChunkStream::write ( path, *this, side );
+}
+
+bool TileMap::streamed () const
+{
+	return ( stream != NULL );
+}
+
+int TileMap::chunkSide () const
+{
+	return ( stream ? stream->side () : 0 );
+}
+
+bool TileMap::peekChunk (int layer, int ci, int cj, std::vector< int >& tiles)
+{
+	return ( ( stream ) && ( layer < map_layers ) && ( stream->peek ( layer, ci, cj, tiles ) ) );
+}
+
+unsigned int TileMap::chunkArrivals () const
+{
+	return ( stream ? stream->arrivals () : 0 );
+}
+
+void TileMap::prefetch (float cameraX, float cameraY, float vx, float vy)
+{
+	if ( ( !stream ) || ( !tileset ) )
+		return;
+	
+	stream->update ();
+	
+	int tw = tileset->tileW (), th = tileset->tileH ();
+	int margin = stream->side ();
+	int screen_w = SDLBase::screen ()->w / tw + 1;
+	int screen_h = SDLBase::screen ()->h / th + 1;
+	
+	for ( int k = 0; k < map_layers; ++k )
+	{
+		int j = (int) floor ( cameraX * ( k + 1 ) / tw );
+		int i = (int) floor ( cameraY * ( k + 1 ) / th );
+		int ahead_j = (int) floor ( ( cameraX + vx * TILEMAP_LOOKAHEAD ) * ( k + 1 ) / tw );
+		int ahead_i = (int) floor ( ( cameraY + vy * TILEMAP_LOOKAHEAD ) * ( k + 1 ) / th );
+		
+		// the screen is asked for last, so it's loaded first
+		stream->request ( k, ahead_i, ahead_j, ahead_i + screen_h, ahead_j + screen_w );
+		stream->request (
+			k, i - margin, j - margin, i + screen_h + margin, j + screen_w + margin
+		);
+	}
+}
+
+TileMap::TileRef TileMap::at (int layer, int i, int j)
+{
+	if ( ( stream ) && ( layer < map_layers ) )
+	{
+		int side = stream->side ();
+		int* chunk = stream->fetch ( layer, i / side, j / side );
+		
+		return TileRef ( NULL, i, j, &chunk[ ( i % side ) * side + ( j % side ) ] );
+	}
+	
 	if ( ( !data ) || ( layer >= map_layers ) )
 		throw ( mexception ( "Trying to access non-allocated tilemap layer" ) );
 	
-	return data[ layer ]->at ( i, j );
+	return TileRef ( data[ layer ], i, j, data[ layer ]->cell ( i, j ) );
+}
+
+void TileMap::set (int layer, int i, int j, int tile)
+{
+	at ( layer, i, j ) = tile;
+	
+	revision_++;
+}
+
+unsigned int TileMap::revision () const
+{
+	return revision_;
+}
+
+void TileMap::tick (unsigned int time)
+{
+	if ( tileset )
+		tileset->tick ( time );
 }
 
 void TileMap::render (float cameraX, float cameraY)
 {
-	if ( ( tileset ) && ( data ) )
-	{
-		for ( int i = 0; i < map_layers; ++i )
-			data[i]->render ( tileset, cameraX, cameraY );
-	}
+	for ( int i = 0; i < map_layers; ++i )
+		renderLayer ( i, cameraX, cameraY );
 }
 
 void TileMap::renderLayer (int layer, float cameraX, float cameraY)
 {
 	if ( ( tileset ) && ( data ) )
 		data[ layer ]->render ( tileset, cameraX, cameraY );
+	else if ( ( tileset ) && ( stream ) )
+		renderChunks ( layer, cameraX, cameraY );
+}
+
+void TileMap::renderChunks (int layer, float cameraX, float cameraY)
+{
+	int tw = tileset->tileW (), th = tileset->tileH ();
+	int side = stream->side ();
+	
+	// only the tiles over the screen
+	int j0 = std::max ( (int) floor ( cameraX / tw ), 0 );
+	int i0 = std::max ( (int) floor ( cameraY / th ), 0 );
+	int j1 = std::min (
+		(int) floor ( ( cameraX + SDLBase::screen ()->w ) / tw ),
+		stream->width ( layer ) - 1
+	);
+	int i1 = std::min (
+		(int) floor ( ( cameraY + SDLBase::screen ()->h ) / th ),
+		stream->height ( layer ) - 1
+	);
+	
+	stream->lockCache ();
+	
+	for ( int ci = i0 / side; ( i0 <= i1 ) && ( ci <= i1 / side ); ++ci )
+	{
+		for ( int cj = j0 / side; ( j0 <= j1 ) && ( cj <= j1 / side ); ++cj )
+		{
+			// not loaded yet, so it's drawn empty for now
+			const int* tiles = stream->chunk ( layer, ci, cj );
+			if ( !tiles )
+				continue;
+			
+			for ( int i = std::max ( i0, ci * side ); i <= std::min ( i1, ci * side + side - 1 ); ++i )
+			{
+				for ( int j = std::max ( j0, cj * side ); j <= std::min ( j1, cj * side + side - 1 ); ++j )
+				{
+					int tile = tiles[ ( i - ci * side ) * side + ( j - cj * side ) ];
+					
+					if ( tile >= 0 )
+						tileset->render ( tile, ( j * tw ) - cameraX, ( i * th ) - cameraY );
+				}
+			}
+		}
+	}
+	
+	stream->unlockCache ();
 }
 
 int TileMap::width (int layer) const
 {
+	if ( ( stream ) && ( layer < map_layers ) )
+		return stream->width ( layer );
+	
 	if ( ( !data ) || ( layer >= map_layers ) )
 		throw ( mexception ( "Trying to access non-allocated tilemap layer" ) );
 	
@@ -188,6 +580,9 @@ int TileMap::width (int layer) const
 
 int TileMap::height (int layer) const
 {
+	if ( ( stream ) && ( layer < map_layers ) )
+		return stream->height ( layer );
+	
 	if ( ( !data ) || ( layer >= map_layers ) )
 		throw ( mexception ( "Trying to access non-allocated tilemap layer" ) );
 	
@@ -198,3 +593,13 @@ int TileMap::layers () const
 {
 	return map_layers;
 }
+
+unsigned long TileMap::bytes () const
+{
+	unsigned long total = 0;
+	
+	for ( int k = 0; ( data ) && ( k < map_layers ); ++k )
+		total += data[k]->bytes ();
+	
+	return total;
+}
@@ -1,5 +1,8 @@
+#include <sstream>
+
 #include "TileSet.hpp"
 
+using std::istringstream;
 using std::string;
 using std::vector;
 
@@ -9,15 +12,20 @@ TileSet::TileSet (const string& filename, int tile_w, int tile_h)
 	this->tile_h = tile_h;
 	
 	tileset = new Sprite ( filename );
+	opaque = NULL;
+	keyed = NULL;
 	
 	tiles = NULL;
 	
 	dstrect = new SDL_Rect;
 	
 	using_single_file = true;
+	time_ = 0;
 	
 	rows = tileset->srcH () / tile_h;
 	cols = tileset->srcW () / tile_w;
+	
+	classify ( filename );
 }
 
 TileSet::TileSet (int rows, int cols, const string& filename)
@@ -26,15 +34,20 @@ TileSet::TileSet (int rows, int cols, const string& filename)
 	this->cols = cols;
 	
 	tileset = new Sprite ( filename );
+	opaque = NULL;
+	keyed = NULL;
 	
 	tiles = NULL;
 	
 	dstrect = new SDL_Rect;
 	
 	using_single_file = true;
+	time_ = 0;
 	
 	tile_w = tileset->srcW () / cols;
 	tile_h = tileset->srcH () / rows;
+	
+	classify ( filename );
 }
 
 TileSet::TileSet (int tile_w, int tile_h)
@@ -45,12 +58,15 @@ TileSet::TileSet (int tile_w, int tile_h)
 	cols = 0;
 	
 	tileset = NULL;
+	opaque = NULL;
+	keyed = NULL;
 	
 	tiles = new vector< Sprite* >;
 	
 	dstrect = NULL;
 	
 	using_single_file = false;
+	time_ = 0;
 }
 
 TileSet::~TileSet ()
@@ -70,6 +86,11 @@ TileSet::~TileSet ()
 	}
 	else
 	{
+		if ( opaque )
+			SDL_FreeSurface ( opaque );
+		if ( keyed )
+			SDL_FreeSurface ( keyed );
+		
 		delete tileset;
 		delete dstrect;
 	}
@@ -81,12 +102,173 @@ void TileSet::addTile (const string& filename)
 		tiles->push_back ( new Sprite ( filename ) );
 }
 
+void TileSet::addTile (const Atlas::Region& region)
+{
+	if ( tiles )
+		tiles->push_back ( new Sprite ( region ) );
+}
+
+void TileSet::classify (const string& filename)
+{
+	SDL_Surface* src = tileset->surface ();
+	SDLBase::Opacity whole = SDLBase::classify ( src );
+	bool anyopaque = false, anybinary = false;
+	
+	for ( int i = 0; i < rows * cols; i++ )
+	{
+		SDL_Rect rect;
+		rect.x = ( i % cols ) * tile_w;
+		rect.y = ( i / cols ) * tile_h;
+		rect.w = tile_w;
+		rect.h = tile_h;
+		
+		opacity.push_back ( SDLBase::classify ( src, &rect ) );
+		SDLBase::noteTile ( filename, opacity.back () );
+		
+		anyopaque = ( ( anyopaque ) || ( opacity.back () == SDLBase::OPAQUE ) );
+		anybinary = ( ( anybinary ) || ( opacity.back () == SDLBase::BINARY ) );
+	}
+	
+	// a sheet is converted for its most expensive tile, so the cheaper
+	// tiles get their own copy of it
+	if ( ( anyopaque ) && ( whole != SDLBase::OPAQUE ) )
+		opaque = SDLBase::displayFormat ( src, SDLBase::OPAQUE );
+	if ( ( anybinary ) && ( whole == SDLBase::TRANSLUCENT ) )
+		keyed = SDLBase::displayFormat ( src, SDLBase::BINARY );
+}
+
+void TileSet::animate (int tile, const vector< int >& frames, unsigned int duration)
+{
+	if ( ( tile < 0 ) || ( tile >= size () ) || ( frames.empty () ) )
+		return;
+	
+	if ( remap.empty () )
+	{
+		for ( int i = 0; i < size (); i++ )
+			remap.push_back ( i );
+		changed_.assign ( size (), false );
+	}
+	
+	Animated animation;
+	animation.tile = tile;
+	animation.frames = frames;
+	animation.duration = ( duration ? duration : 1 );
+	
+	animations.push_back ( animation );
+	remap[ tile ] = frames[0];
+}
+
+void TileSet::load (const Configuration& conf)
+{
+	for (
+		Configuration::Iterator it = conf.beginConfigs ();
+		it.valid ();
+		it.next ()
+	)
+	{
+		const Configuration& sub = it.config ();
+		
+		istringstream ss ( sub.getStr ( "frames", "" ) );
+		vector< int > frames;
+		int frame;
+		
+		while ( ss >> frame )
+		{
+			if ( ( frame >= 0 ) && ( frame < size () ) )
+				frames.push_back ( frame );
+		}
+		
+		animate ( sub.getInt ( "tile", -1 ), frames, sub.getInt ( "duration", 100 ) );
+	}
+}
+
+bool TileSet::tick (unsigned int time)
+{
+	// every layer asks, but the frames are picked once
+	if ( ( animations.empty () ) || ( time == time_ ) )
+		return false;
+	
+	time_ = time;
+	
+	bool any = false;
+	for ( unsigned int i = 0; i < animations.size (); i++ )
+	{
+		const Animated& animation = animations[i];
+		int tile = animation.tile;
+		int frame = animation.frames[
+			( time / animation.duration ) % animation.frames.size ()
+		];
+		
+		changed_[ tile ] = ( remap[ tile ] != frame );
+		remap[ tile ] = frame;
+		any = ( ( any ) || ( changed_[ tile ] ) );
+	}
+	
+	return any;
+}
+
+bool TileSet::animated (int tile) const
+{
+	for ( unsigned int i = 0; i < animations.size (); i++ )
+	{
+		if ( animations[i].tile == tile )
+			return true;
+	}
+	
+	return false;
+}
+
+bool TileSet::changed (int tile) const
+{
+	if ( ( tile < 0 ) || ( tile >= int ( changed_.size () ) ) )
+		return false;
+	
+	return changed_[ tile ];
+}
+
 void TileSet::render (int index, float posX, float posY)
 {
+	if ( ( index >= 0 ) && ( index < int ( remap.size () ) ) )
+		index = remap[ index ];
+	
 	if ( tiles )
 		(*tiles)[ index ]->render ( posX, posY );
-	else
+	else if ( ( index >= 0 ) && ( index < int ( opacity.size () ) ) )
 	{
+		SDL_Surface* copy = NULL;
+		
+		switch ( opacity[ index ] )
+		{
+		case SDLBase::EMPTY:
+			return;
+		
+		case SDLBase::OPAQUE:
+			copy = opaque;
+			break;
+		
+		case SDLBase::BINARY:
+			copy = keyed;
+			break;
+		
+		default:
+			break;
+		}
+		
+		if ( copy )
+		{
+			SDL_Rect srcrect;
+			srcrect.x = ( index % cols ) * tile_w;
+			srcrect.y = ( index / cols ) * tile_h;
+			srcrect.w = tile_w;
+			srcrect.h = tile_h;
+			
+			dstrect->x = posX;
+			dstrect->y = posY;
+			
+			SDLBase::renderSurface ( copy, &srcrect, dstrect );
+			return;
+		}
+		
 		tileset->clip (
 			( index % cols ) * tile_w,
 			( index / cols ) * tile_h,
@@ -111,3 +293,11 @@ int TileSet::tileH () const
 {
 	return tile_h;
 }
+
+int TileSet::size () const
+{
+	if ( tiles )
+		return tiles->size ();
+	
+	return ( rows * cols );
+}
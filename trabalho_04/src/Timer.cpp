@@ -18,7 +18,7 @@ void Timer::start()
 
 void Timer::pause()
 {
-	if( !paused )
+	if( ( !paused ) && ( initialtime != -1 ) )
 	{
 		pausetime = SDL_GetTicks();
 		paused = true;
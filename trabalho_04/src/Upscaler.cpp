@@ -0,0 +1,170 @@
+#include <cstring>
+
+#include "Upscaler.hpp"
+
+#include "JobSystem.hpp"
+#include "simplestructures.hpp"
+
+// rows of the source in each job
+#define UPSCALER_GRAIN	16
+
+namespace
+{
+	// the usual factors are unrolled, so each pixel is read once and
+	// written with plain stores
+	template <class Pixel>
+	void stretch(const Pixel* src, Pixel* dst, int w, int factor)
+	{
+		switch( factor )
+		{
+		case 2:
+			for( int i = 0; i < w; i++ )
+			{
+				Pixel p = src[i];
+				dst[0] = p;
+				dst[1] = p;
+				dst += 2;
+			}
+			break;
+		
+		case 3:
+			for( int i = 0; i < w; i++ )
+			{
+				Pixel p = src[i];
+				dst[0] = p;
+				dst[1] = p;
+				dst[2] = p;
+				dst += 3;
+			}
+			break;
+		
+		default:
+			for( int i = 0; i < w; i++ )
+			{
+				Pixel p = src[i];
+				for( int k = 0; k < factor; k++ )
+					dst[k] = p;
+				dst += factor;
+			}
+			break;
+		}
+	}
+	
+	// 24-bit pixels, one byte at a time
+	void stretch24(const Uint8* src, Uint8* dst, int w, int factor)
+	{
+		for( int i = 0; i < w; i++ )
+		{
+			for( int k = 0; k < factor; k++ )
+			{
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+				dst += 3;
+			}
+			src += 3;
+		}
+	}
+}
+
+Upscaler::Rows::Rows(const Upscaler* upscaler) : upscaler( upscaler )
+{
+}
+
+void Upscaler::Rows::operator()(int beg, int end) const
+{
+	upscaler->widen( beg, end );
+}
+
+Upscaler::Upscaler(SDL_Surface* src, SDL_Surface* dst, int factor) :
+src( src ), dst( dst ), factor_( factor )
+{
+	if( ( !src ) || ( !dst ) || ( factor < 1 ) ||
+		( src->format->BytesPerPixel != dst->format->BytesPerPixel ) ||
+		( src->w * factor > dst->w ) || ( src->h * factor > dst->h ) )
+	{
+		throw( mexception( "Invalid Upscaler" ) );
+	}
+	
+	x0 = ( dst->w - src->w * factor ) / 2;
+	y0 = ( dst->h - src->h * factor ) / 2;
+	
+	// the borders left by a size that isn't a multiple of the factor stay
+	// black
+	SDL_FillRect( dst, NULL, 0 );
+}
+
+void Upscaler::flush(bool parallel)
+{
+	if( SDL_MUSTLOCK( src ) )
+		SDL_LockSurface( src );
+	if( SDL_MUSTLOCK( dst ) )
+		SDL_LockSurface( dst );
+	
+	if( ( parallel ) && ( JobSystem::size() > 1 ) )
+	{
+		Rows rows( this );
+		JobSystem::parallelFor( src->h, UPSCALER_GRAIN, rows );
+	}
+	else
+		widen( 0, src->h );
+	
+	if( SDL_MUSTLOCK( dst ) )
+		SDL_UnlockSurface( dst );
+	if( SDL_MUSTLOCK( src ) )
+		SDL_UnlockSurface( src );
+}
+
+int Upscaler::mapX(int x) const
+{
+	x = ( x - x0 ) / factor_;
+	
+	return ( ( x < 0 ) ? 0 : ( x >= src->w ) ? src->w - 1 : x );
+}
+
+int Upscaler::mapY(int y) const
+{
+	y = ( y - y0 ) / factor_;
+	
+	return ( ( y < 0 ) ? 0 : ( y >= src->h ) ? src->h - 1 : y );
+}
+
+int Upscaler::factor() const
+{
+	return factor_;
+}
+
+void Upscaler::widen(int beg, int end) const
+{
+	int bpp = src->format->BytesPerPixel;
+	int bytes = src->w * factor_ * bpp;
+	
+	for( int y = beg; y < end; y++ )
+	{
+		const Uint8* from = (const Uint8*) src->pixels + y * src->pitch;
+		Uint8* to = (Uint8*) dst->pixels + ( y0 + y * factor_ ) * dst->pitch + x0 * bpp;
+		
+		switch( bpp )
+		{
+		case 1:
+			stretch( from, to, src->w, factor_ );
+			break;
+		
+		case 2:
+			stretch( (const Uint16*) from, (Uint16*) to, src->w, factor_ );
+			break;
+		
+		case 3:
+			stretch24( from, to, src->w, factor_ );
+			break;
+		
+		default:
+			stretch( (const Uint32*) from, (Uint32*) to, src->w, factor_ );
+			break;
+		}
+		
+		// the other rows of the square are the same
+		for( int k = 1; k < factor_; k++ )
+			memcpy( to + k * dst->pitch, to, bytes );
+	}
+}
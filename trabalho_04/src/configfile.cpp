@@ -5,6 +5,8 @@
 
 #include <sstream>
 #include <stack>
+#include <deque>
+#include <algorithm>
 
 #include "configfile.hpp"
 
@@ -17,6 +19,36 @@ using std::ios;
 using std::stringstream;
 using std::vector;
 using std::list;
+using std::deque;
+
+// =============================================================================
+// Interned Variable Names
+// =============================================================================
+
+class ConfigKey
+{
+public:
+	string name;
+	unsigned long int hash;
+	
+	ConfigKey (const string& name, unsigned long int hash) :
+	name ( name ), hash ( hash )
+	{
+	}
+	
+	static unsigned long int hashOf (const char* src, size_t size);
+	
+	static const ConfigKey* find (const string& name);
+	static const ConfigKey* find (const char* src, size_t size);
+	static const ConfigKey* intern (const string& name);
+	static const ConfigKey* intern (const char* src, size_t size);
+private:
+	// function statics, so the pool is ready for global Configurations too
+	static deque< ConfigKey >& pool ();
+	static vector< const ConfigKey* >& table ();
+	
+	static void rehash (size_t size);
+};
 
 // =============================================================================
 // Configuration Class Member (Parser)
@@ -43,10 +75,86 @@ private:
 			W8ING_NAME_OR_BRACE
 		};
 		
+		// slice of the file buffer, so nothing is copied while scanning
+		struct Slice
+		{
+			const char* beg;
+			const char* end;
+			
+			Slice () : beg ( NULL ), end ( NULL )
+			{
+			}
+		};
+		
 		// =============================================================
 		// File Parser Attributes
 		// =============================================================
 		
+		vector< char > buffer_;
+		const char* cur_;
+		const char* end_;
+		stack< Configuration* > dest_;
+		unsigned int line_;
+		State state_;
+		char input_;
+		stack< Slice > names_;
+		Slice value_;
+	public:
+		// =============================================================
+		// File Parser Methods
+		// =============================================================
+		
+		FileParser (const string& filename, Configuration* dest);
+		~FileParser ();
+	private:
+		void read (const string& filename);
+		
+		void parse ();
+		
+		void error (const char* what) const;
+		
+		void insertConfigVar ();
+		void insertDataVar ();
+		
+		void avoidLine ();
+		
+		void changeToW8ingNameState ();
+		
+		void handleLineBreak ();
+		void handleWaitingName ();
+		void handleReadingName ();
+		void handleW8ingEqlsOrBrace ();
+		void handleW8ingOpeningBrace ();
+		void handleWaitingValue ();
+		void handleReadingValue ();
+		void handleW8ingNameOrBrace ();
+		void handleEof ();
+	};
+	
+	// =====================================================================
+	// Stream Parser Class
+	// =====================================================================
+	
+	// the previous reader, a character at a time from the stream, kept so
+	// the benchmarks can compare it with FileParser
+	class StreamParser
+	{
+	private:
+		enum State
+		{
+			WAITING_NAME = 0,
+			READING_NAME,
+			W8ING_EQLS_OR_BRACE,
+			W8ING_OPENING_BRACE,
+			WAITING_VALUE,
+			READING_VALUE,
+			W8ING_NAME_OR_BRACE
+		};
+		
+		// =============================================================
+		// Stream Parser Attributes
+		// =============================================================
+		
 		fstream file_;
 		stack< Configuration* > dest_;
 		unsigned int line_;
@@ -57,14 +165,16 @@ private:
 		string spaces_;
 	public:
 		// =============================================================
-		// File Parser Methods
+		// Stream Parser Methods
 		// =============================================================
 		
-		FileParser (const string& filename, Configuration* dest);
-		~FileParser ();
+		StreamParser (const string& filename, Configuration* dest);
+		~StreamParser ();
 	private:
 		void parse ();
 		
+		void error (const char* what) const;
+		
 		void insertConfigVar ();
 		void insertDataVar ();
 		
@@ -89,9 +199,22 @@ public:
 	
 	static void parseFile (const string& filename, Configuration* dest);
 	
+	static void insertConfig (
+		Configuration* dest,
+		const ConfigKey* key,
+		const Configuration& val
+	);
+	static void insertStr (
+		Configuration* dest,
+		const ConfigKey* key,
+		const char* beg,
+		const char* end
+	);
+	
 	static void parseName (const string& src);
 	
 	static string parseInStr (const string& src);
+	static string parseInStr (const char* beg, const char* end);
 	static string parseInReal (const long double& src);
 	static string parseInInt (const long int& src);
 	static string parseInChar (const char& src);
@@ -102,13 +225,80 @@ public:
 	static char parseOutChar (const string& src);
 };
 
+// =============================================================================
+// Configuration Class Member (Value)
+// =============================================================================
+
+Configuration::Value::Value (const string& raw) :
+raw_ ( raw ), tried_ ( 0 ), valid_ ( 0 ), real_ ( 0 ), int_ ( 0 ), char_ ( 0 )
+{
+}
+
+const string& Configuration::Value::raw () const
+{
+	return raw_;
+}
+
+const string& Configuration::Value::str () const
+{
+	if ( !( tried_ & STR ) )
+	{
+		str_ = Parser::parseOutStr ( raw_ );
+		tried_ |= STR;
+	}
+	
+	return str_;
+}
+
+const long double* Configuration::Value::real () const
+{
+	if ( !( tried_ & REAL ) )
+	{
+		tried_ |= REAL;
+		try {
+			real_ = Parser::parseOutReal ( raw_ );
+			valid_ |= REAL;
+		} catch (mexception&) {}
+	}
+	
+	return ( ( valid_ & REAL ) ? &real_ : NULL );
+}
+
+const long int* Configuration::Value::integer () const
+{
+	if ( !( tried_ & INT ) )
+	{
+		tried_ |= INT;
+		try {
+			int_ = Parser::parseOutInt ( raw_ );
+			valid_ |= INT;
+		} catch (mexception&) {}
+	}
+	
+	return ( ( valid_ & INT ) ? &int_ : NULL );
+}
+
+const char* Configuration::Value::character () const
+{
+	if ( !( tried_ & CHAR ) )
+	{
+		tried_ |= CHAR;
+		try {
+			char_ = Parser::parseOutChar ( raw_ );
+			valid_ |= CHAR;
+		} catch (mexception&) {}
+	}
+	
+	return ( ( valid_ & CHAR ) ? &char_ : NULL );
+}
+
 // =============================================================================
 // Configuration Class Member (Variable)
 // =============================================================================
 
 template <class T>
-Configuration::Variable< T >::Variable (const string& name, const T& value) :
-name_ ( name ), value_ ( value )
+Configuration::Variable< T >::Variable (const ConfigKey* key, const T& value) :
+key_ ( key ), value_ ( value )
 {
 }
 
@@ -117,10 +307,16 @@ Configuration::Variable< T >::~Variable ()
 {
 }
 
+template <class T>
+const ConfigKey* Configuration::Variable< T >::key () const
+{
+	return key_;
+}
+
 template <class T>
 const string& Configuration::Variable< T >::name () const
 {
-	return name_;
+	return key_->name;
 }
 
 template <class T>
@@ -136,113 +332,859 @@ void Configuration::Variable< T >::set (const T& value)
 }
 
 // =============================================================================
-// File Parser Class
+// Configuration Class Member (Table)
 // =============================================================================
 
-Parser::FileParser::FileParser (const string& filename, Configuration* dest)
+template <class T>
+class OrderByName
 {
-	file_.open ( filename.c_str () );
+private:
+	const vector< T >& vars_;
+public:
+	OrderByName (const vector< T >& vars) : vars_ ( vars )
+	{
+	}
 	
-	if ( !file_.is_open () )
-		throw ( Configuration::FileNotFound () );
+	bool operator() (size_t a, size_t b) const
+	{
+		return ( vars_[a].name () < vars_[b].name () );
+	}
+};
+
+template <class T>
+Configuration::Table< T >::Table () : ordered_ ( true )
+{
+}
+
+template <class T>
+void Configuration::Table< T >::rehash (size_t size)
+{
+	slots_.assign ( size, -1 );
 	
-	dest_.push ( dest );
-	names_.push ( string () );
+	for ( size_t i = 0; i < vars_.size (); i++ )
+		place ( i );
+}
+
+template <class T>
+void Configuration::Table< T >::place (size_t pos)
+{
+	size_t mask = slots_.size () - 1;
+	size_t i = vars_[ pos ].key ()->hash & mask;
 	
-	parse ();
+	while ( slots_[i] != -1 )
+		i = ( i + 1 ) & mask;
 	
-	file_.close ();
+	slots_[i] = pos;
 }
 
-Parser::FileParser::~FileParser ()
+template <class T>
+long int Configuration::Table< T >::find (const ConfigKey* key) const
 {
+	if ( ( !key ) || ( !slots_.size () ) )
+		return -1;
+	
+	size_t mask = slots_.size () - 1;
+	
+	for (	size_t i = key->hash & mask;
+		slots_[i] != -1;
+		i = ( i + 1 ) & mask	)
+	{
+		if ( vars_[ slots_[i] ].key () == key )
+			return slots_[i];
+	}
+	
+	return -1;
 }
 
-void Parser::FileParser::parse ()
+template <class T>
+void Configuration::Table< T >::insert (const ConfigKey* key, const T& value)
 {
-	line_ = 1;
-	state_ = WAITING_NAME;
+	// keeping the load factor of the hash index below 1/2
+	if ( ( vars_.size () + 1 ) * 2 > slots_.size () )
+	{
+		vars_.push_back ( Variable< T > ( key, value ) );
+		rehash ( slots_.size () ? slots_.size () * 2 : 8 );
+	}
+	else
+	{
+		vars_.push_back ( Variable< T > ( key, value ) );
+		place ( vars_.size () - 1 );
+	}
 	
-	// avoiding exceptions for empty files by setting eofbit
-	input_ = file_.get ();
+	// sorted input keeps the side index valid, otherwise it's rebuilt on
+	// the next ordered access
+	if ( ordered_ )
+	{
+		if (	( !order_.size () ) ||
+			( vars_[ order_.back () ].name () < key->name )	)
+			order_.push_back ( vars_.size () - 1 );
+		else
+			ordered_ = false;
+	}
+}
+
+template <class T>
+void Configuration::Table< T >::erase (size_t pos)
+{
+	vars_.erase ( vars_.begin () + pos );
 	
-	while ( !file_.eof () )
+	rehash ( slots_.size () );
+	ordered_ = false;
+}
+
+template <class T>
+void Configuration::Table< T >::clear ()
+{
+	vars_.clear ();
+	slots_.clear ();
+	order_.clear ();
+	ordered_ = true;
+}
+
+template <class T>
+size_t Configuration::Table< T >::size () const
+{
+	return vars_.size ();
+}
+
+template <class T>
+Configuration::Variable< T >& Configuration::Table< T >::operator[] (size_t pos)
+{
+	return vars_[ pos ];
+}
+
+template <class T>
+const Configuration::Variable< T >& Configuration::Table< T >::operator[] (size_t pos) const
+{
+	return vars_[ pos ];
+}
+
+template <class T>
+const vector< size_t >& Configuration::Table< T >::order () const
+{
+	if ( !ordered_ )
 	{
-		switch ( state_ )
-		{
-			case WAITING_NAME:
-				handleWaitingName ();
-				break;
-			
-			case READING_NAME:
-				handleReadingName ();
-				break;
-			
-			case W8ING_EQLS_OR_BRACE:
-				handleW8ingEqlsOrBrace ();
-				break;
-			
-			case W8ING_OPENING_BRACE:
-				handleW8ingOpeningBrace ();
-				break;
-			
-			case WAITING_VALUE:
-				handleWaitingValue ();
-				break;
-			
-			case READING_VALUE:
-				handleReadingValue ();
-				break;
-			
-			case W8ING_NAME_OR_BRACE:
-				handleW8ingNameOrBrace ();
-				break;
-			
-			default:
-				break;
-		}
+		order_.resize ( vars_.size () );
+		for ( size_t i = 0; i < vars_.size (); i++ )
+			order_[i] = i;
 		
-		if ( !file_.eof () )
-			input_ = file_.get ();
+		std::sort (
+			order_.begin (),
+			order_.end (),
+			OrderByName< Variable< T > > ( vars_ )
+		);
+		
+		ordered_ = true;
+	}
+	
+	return order_;
+}
+
+template <class T>
+void Configuration::Table< T >::range (
+	const string& prefix,
+	size_t& beg,
+	size_t& end
+) const
+{
+	const vector< size_t >& sorted = order ();
+	size_t top = sorted.size ();
+	
+	// binary search for the first name not less than the prefix
+	beg = 0;
+	while ( beg < top )
+	{
+		size_t mid = ( beg + top ) / 2;
 		
-		if ( file_.eof () )
-			handleEof ();
+		if ( vars_[ sorted[ mid ] ].name () < prefix )
+			beg = mid + 1;
+		else
+			top = mid;
+	}
+	
+	end = beg;
+	while (	( end < sorted.size () ) &&
+		( !vars_[ sorted[ end ] ].name ().compare (
+			0, prefix.size (), prefix
+		) )	)
+	{
+		++end;
+	}
+}
+
+// =============================================================================
+// Configuration Class Member (Node)
+// =============================================================================
+
+class Configuration::Node
+{
+public:
+	Table< Configuration > cvars;
+	Table< Value > vars;
+	unsigned int refs;
+	
+	Node () : refs ( 1 )
+	{
 	}
+	
+	// nested configurations are shared by the copy, so only this level of
+	// the tree is copied
+	Node (const Node& param) :
+	cvars ( param.cvars ), vars ( param.vars ), refs ( 1 )
+	{
+		copied_ += sizeof ( Node );
+		copied_ += cvars.size () * sizeof ( ConfigVariable );
+		copied_ += vars.size () * sizeof ( DataVariable );
+		for ( size_t i = 0; i < vars.size (); i++ )
+			copied_ += vars[i].value ().raw ().size ();
+	}
+};
+
+unsigned long int Configuration::copied_ = 0;
+
+bool Configuration::streamed_ = false;
+
+Configuration::Node* Configuration::mutate ()
+{
+	if ( node_->refs > 1 )
+	{
+		Node* node = new Node ( *node_ );
+		node_->refs--;
+		node_ = node;
+	}
+	
+	return node_;
+}
+
+// =============================================================================
+// Interned Variable Names
+// =============================================================================
+
+unsigned long int ConfigKey::hashOf (const char* src, size_t size)
+{
+	// 32 bits FNV-1a
+	unsigned long int hash = 2166136261UL;
+	
+	for ( size_t i = 0; i < size; i++ )
+	{
+		hash ^= (unsigned char) src[i];
+		hash = ( hash * 16777619UL ) & 0xFFFFFFFFUL;
+	}
+	
+	return hash;
+}
+
+deque< ConfigKey >& ConfigKey::pool ()
+{
+	static deque< ConfigKey > pool_;
+	return pool_;
+}
+
+vector< const ConfigKey* >& ConfigKey::table ()
+{
+	static vector< const ConfigKey* > table_;
+	return table_;
+}
+
+void ConfigKey::rehash (size_t size)
+{
+	deque< ConfigKey >& keys = pool ();
+	vector< const ConfigKey* >& slots = table ();
+	size_t mask = size - 1;
+	
+	slots.assign ( size, (const ConfigKey*) NULL );
+	
+	for ( size_t i = 0; i < keys.size (); i++ )
+	{
+		size_t j = keys[i].hash & mask;
+		
+		while ( slots[j] )
+			j = ( j + 1 ) & mask;
+		
+		slots[j] = &keys[i];
+	}
+}
+
+const ConfigKey* ConfigKey::find (const string& name)
+{
+	return find ( name.data (), name.size () );
+}
+
+const ConfigKey* ConfigKey::find (const char* src, size_t size)
+{
+	vector< const ConfigKey* >& slots = table ();
+	
+	if ( !slots.size () )
+		return NULL;
+	
+	unsigned long int hash = hashOf ( src, size );
+	size_t mask = slots.size () - 1;
+	
+	for ( size_t i = hash & mask; slots[i]; i = ( i + 1 ) & mask )
+	{
+		if (	( slots[i]->hash == hash ) &&
+			( !slots[i]->name.compare ( 0, string::npos, src, size ) )	)
+			return slots[i];
+	}
+	
+	return NULL;
+}
+
+const ConfigKey* ConfigKey::intern (const string& name)
+{
+	return intern ( name.data (), name.size () );
+}
+
+const ConfigKey* ConfigKey::intern (const char* src, size_t size)
+{
+	const ConfigKey* key = find ( src, size );
+	
+	if ( key )
+		return key;
+	
+	deque< ConfigKey >& keys = pool ();
+	
+	// deque never moves its elements when growing at the back
+	keys.push_back ( ConfigKey ( string ( src, size ), hashOf ( src, size ) ) );
+	key = &keys.back ();
+	
+	vector< const ConfigKey* >& slots = table ();
+	
+	if ( keys.size () * 2 > slots.size () )
+		rehash ( slots.size () ? slots.size () * 2 : 64 );
+	else
+	{
+		size_t mask = slots.size () - 1;
+		size_t i = key->hash & mask;
+		
+		while ( slots[i] )
+			i = ( i + 1 ) & mask;
+		
+		slots[i] = key;
+	}
+	
+	return key;
+}
+
+// =============================================================================
+// File Parser Class
+// =============================================================================
+
+Parser::FileParser::FileParser (const string& filename, Configuration* dest)
+{
+	read ( filename );
+	
+	dest_.push ( dest );
+	names_.push ( Slice () );
+	
+	parse ();
+}
+
+Parser::FileParser::~FileParser ()
+{
+	// blocks left open by a parsing error
+	while ( dest_.size () > 1 )
+	{
+		delete dest_.top ();
+		dest_.pop ();
+	}
+}
+
+void Parser::FileParser::read (const string& filename)
+{
+	// the whole file is read at once and scanned in memory
+	fstream file ( filename.c_str (), fstream::in | fstream::binary );
+	
+	if ( !file.is_open () )
+		throw ( Configuration::FileNotFound () );
+	
+	file.seekg ( 0, ios::end );
+	std::streamoff size = file.tellg ();
+	file.seekg ( 0, ios::beg );
+	
+	if ( size > 0 )
+	{
+		buffer_.resize ( size );
+		file.read ( &buffer_[0], size );
+		buffer_.resize ( file.gcount () );
+	}
+	
+	file.close ();
+	
+	cur_ = ( buffer_.size () ? &buffer_[0] : NULL );
+	end_ = cur_ + buffer_.size ();
+}
+
+void Parser::FileParser::parse ()
+{
+	line_ = 1;
+	state_ = WAITING_NAME;
+	
+	while ( cur_ < end_ )
+	{
+		input_ = *cur_++;
+		
+		switch ( state_ )
+		{
+			case WAITING_NAME:
+				handleWaitingName ();
+				break;
+			
+			case READING_NAME:
+				handleReadingName ();
+				break;
+			
+			case W8ING_EQLS_OR_BRACE:
+				handleW8ingEqlsOrBrace ();
+				break;
+			
+			case W8ING_OPENING_BRACE:
+				handleW8ingOpeningBrace ();
+				break;
+			
+			case WAITING_VALUE:
+				handleWaitingValue ();
+				break;
+			
+			case READING_VALUE:
+				handleReadingValue ();
+				break;
+			
+			case W8ING_NAME_OR_BRACE:
+				handleW8ingNameOrBrace ();
+				break;
+			
+			default:
+				break;
+		}
+	}
+	
+	handleEof ();
+}
+
+void Parser::FileParser::error (const char* what) const
+{
+	stringstream ss;
+	ss << what << " line " << line_;
+	throw ( mexception ( ss.str () ) );
+}
+
+void Parser::FileParser::insertConfigVar ()
+{
+	Configuration* tmp = dest_.top ();
+	dest_.pop ();
+	names_.pop ();
+	
+	try {
+		Parser::insertConfig (
+			dest_.top (),
+			ConfigKey::intern (
+				names_.top ().beg,
+				names_.top ().end - names_.top ().beg
+			),
+			*tmp
+		);
+	}
+	catch (Configuration::VarAlreadyExisting& e)
+	{
+		delete tmp;
+		error ( "Configuration variable redefined at" );
+	}
+	
+	delete tmp;
+}
+
+void Parser::FileParser::insertDataVar ()
+{
+	try {
+		Parser::insertStr (
+			dest_.top (),
+			ConfigKey::intern (
+				names_.top ().beg,
+				names_.top ().end - names_.top ().beg
+			),
+			value_.beg,
+			value_.end
+		);
+	}
+	catch (Configuration::VarAlreadyExisting& e)
+	{
+		error ( "Data variable redefined at" );
+	}
+}
+
+void Parser::FileParser::avoidLine ()
+{
+	while ( cur_ < end_ )
+	{
+		input_ = *cur_++;
+		
+		if ( ( input_ == '\r' ) || ( input_ == '\n' ) )
+		{
+			handleLineBreak ();
+			break;
+		}
+	}
+}
+
+void Parser::FileParser::changeToW8ingNameState ()
+{
+	if ( dest_.size () == 1 )
+		state_ = WAITING_NAME;
+	else
+		state_ = W8ING_NAME_OR_BRACE;
+}
+
+void Parser::FileParser::handleLineBreak ()
+{
+	line_++;
+	
+	// avoiding Windows/DOS LF
+	if ( ( input_ == '\r' ) && ( cur_ < end_ ) && ( *cur_ == '\n' ) )
+		++cur_;
+}
+
+void Parser::FileParser::handleWaitingName ()
+{
+	if (	( input_ == '_' ) ||
+		( ( input_ >= 'A' ) && ( input_ <= 'Z' ) ) ||
+		( ( input_ >= 'a' ) && ( input_ <= 'z' ) )	)
+	{
+		names_.top ().beg = cur_ - 1;
+		names_.top ().end = cur_;
+		state_ = READING_NAME;
+	}
+	else if ( input_ == '#' )
+		avoidLine ();
+	else if ( ( input_ == '\r' ) || ( input_ == '\n' ) )
+		handleLineBreak ();
+	else if ( ( input_ != ' ' ) && ( input_ != '\t' ) )
+		error ( "FParserVarNameInvalidToken" );
+}
+
+void Parser::FileParser::handleReadingName ()
+{
+	if (	( input_ == '_' ) ||
+		( ( input_ >= '0' ) && ( input_ <= '9' ) ) ||
+		( ( input_ >= 'A' ) && ( input_ <= 'Z' ) ) ||
+		( ( input_ >= 'a' ) && ( input_ <= 'z' ) )	)
+		names_.top ().end = cur_;
+	else if ( ( input_ == ' ' ) || ( input_ == '\t' ) )
+		state_ = W8ING_EQLS_OR_BRACE;
+	else if ( ( input_ == '\r' ) || ( input_ == '\n' ) )
+	{
+		handleLineBreak ();
+		state_ = W8ING_OPENING_BRACE;
+	}
+	else if ( input_ == '=' )
+		state_ = WAITING_VALUE;
+	else if ( input_ == '{' )
+	{
+		dest_.push ( new Configuration () );
+		names_.push ( Slice () );
+		state_ = W8ING_NAME_OR_BRACE;
+	}
+	else
+		error ( "FParserVarNameInvalidToken" );
+}
+
+void Parser::FileParser::handleW8ingEqlsOrBrace ()
+{
+	if ( input_ == '=' )
+		state_ = WAITING_VALUE;
+	else if ( input_ == '{' )
+	{
+		dest_.push ( new Configuration () );
+		names_.push ( Slice () );
+		state_ = W8ING_NAME_OR_BRACE;
+	}
+	else if ( input_ == '#' )
+	{
+		avoidLine ();
+		state_ = W8ING_OPENING_BRACE;
+	}
+	else if ( ( input_ == '\r' ) || ( input_ == '\n' ) )
+	{
+		handleLineBreak ();
+		state_ = W8ING_OPENING_BRACE;
+	}
+	else if ( ( input_ != ' ' ) && ( input_ != '\t' ) )
+		error ( "FParserValAssignmentMissing" );
+}
+
+void Parser::FileParser::handleW8ingOpeningBrace ()
+{
+	if ( input_ == '{' )
+	{
+		dest_.push ( new Configuration () );
+		names_.push ( Slice () );
+		state_ = W8ING_NAME_OR_BRACE;
+	}
+	else if ( input_ == '#' )
+		avoidLine ();
+	else if ( ( input_ == '\r' ) || ( input_ == '\n' ) )
+		handleLineBreak ();
+	else if ( ( input_ != ' ' ) && ( input_ != '\t' ) )
+		error ( "FParserValAssignmentMissing" );
+}
+
+void Parser::FileParser::handleWaitingValue ()
+{
+	if ( input_ == '#' )
+	{
+		value_ = Slice ();
+		insertDataVar ();
+		
+		avoidLine ();
+		
+		changeToW8ingNameState ();
+	}
+	else if ( ( input_ == '\r' ) || ( input_ == '\n' ) )
+	{
+		value_ = Slice ();
+		insertDataVar ();
+		
+		handleLineBreak ();
+		
+		changeToW8ingNameState ();
+	}
+	else if ( ( input_ != ' ' ) && ( input_ != '\t' ) )
+	{
+		if ( ( input_ == '}' ) && ( dest_.size () > 1 ) )
+		{
+			value_ = Slice ();
+			insertDataVar ();
+			
+			insertConfigVar ();
+			
+			changeToW8ingNameState ();
+		}
+		else
+		{
+			value_.beg = cur_ - 1;
+			value_.end = cur_;
+			
+			state_ = READING_VALUE;
+		}
+	}
+}
+
+void Parser::FileParser::handleReadingValue ()
+{
+	// the value always ends in its last non blank character, so there are
+	// blanks pending only if the current character isn't right after it
+	bool spaces = ( value_.end != cur_ - 1 );
+	
+	if ( ( input_ == ' ' ) || ( input_ == '\t' ) )
+	{
+	}
+	else if ( ( input_ == '\r' ) || ( input_ == '\n' ) )
+	{
+		insertDataVar ();
+		
+		handleLineBreak ();
+		
+		changeToW8ingNameState ();
+	}
+	else if ( input_ == '#' )
+	{
+		if ( spaces )
+		{
+			insertDataVar ();
+			
+			avoidLine ();
+			
+			changeToW8ingNameState ();
+		}
+		else
+			value_.end = cur_;
+	}
+	else if ( input_ == '}' )
+	{
+		// a closing brace at the top level is just part of the value
+		if ( ( spaces ) && ( dest_.size () > 1 ) )
+		{
+			insertDataVar ();
+			
+			insertConfigVar ();
+			
+			avoidLine ();
+			
+			changeToW8ingNameState ();
+		}
+		else
+			value_.end = cur_;
+	}
+	else
+		value_.end = cur_;
+}
+
+void Parser::FileParser::handleW8ingNameOrBrace ()
+{
+	if ( input_ == '}' )
+	{
+		insertConfigVar ();
+		
+		changeToW8ingNameState ();
+	}
+	else
+		handleWaitingName ();
+}
+
+void Parser::FileParser::handleEof ()
+{
+	switch ( state_ )
+	{
+		case READING_NAME:
+		case W8ING_EQLS_OR_BRACE:
+		case W8ING_OPENING_BRACE:
+			error ( "FParserValAssignmentMissing" );
+			break;
+		
+		case WAITING_VALUE:
+			if ( dest_.size () > 1 )
+				error ( "FParserClosingBraceMissing" );
+			value_ = Slice ();
+			insertDataVar ();
+			break;
+		
+		case READING_VALUE:
+			if ( dest_.size () > 1 )
+				error ( "FParserClosingBraceMissing" );
+			insertDataVar ();
+			break;
+		
+		case W8ING_NAME_OR_BRACE:
+			error ( "FParserClosingBraceMissing" );
+			break;
+		
+		default:
+			break;
+	}
+}
+
+// =============================================================================
+// Stream Parser Class
+// =============================================================================
+
+Parser::StreamParser::StreamParser (const string& filename, Configuration* dest)
+{
+	file_.open ( filename.c_str () );
+	
+	if ( !file_.is_open () )
+		throw ( Configuration::FileNotFound () );
+	
+	dest_.push ( dest );
+	names_.push ( string () );
+	
+	parse ();
+	
+	file_.close ();
+}
+
+Parser::StreamParser::~StreamParser ()
+{
+	// blocks left open by a parsing error
+	while ( dest_.size () > 1 )
+	{
+		delete dest_.top ();
+		dest_.pop ();
+	}
+}
+
+void Parser::StreamParser::parse ()
+{
+	line_ = 1;
+	state_ = WAITING_NAME;
+	
+	// avoiding exceptions for empty files by setting eofbit
+	input_ = file_.get ();
+	
+	while ( !file_.eof () )
+	{
+		switch ( state_ )
+		{
+			case WAITING_NAME:
+				handleWaitingName ();
+				break;
+			
+			case READING_NAME:
+				handleReadingName ();
+				break;
+			
+			case W8ING_EQLS_OR_BRACE:
+				handleW8ingEqlsOrBrace ();
+				break;
+			
+			case W8ING_OPENING_BRACE:
+				handleW8ingOpeningBrace ();
+				break;
+			
+			case WAITING_VALUE:
+				handleWaitingValue ();
+				break;
+			
+			case READING_VALUE:
+				handleReadingValue ();
+				break;
+			
+			case W8ING_NAME_OR_BRACE:
+				handleW8ingNameOrBrace ();
+				break;
+			
+			default:
+				break;
+		}
+		
+		if ( !file_.eof () )
+			input_ = file_.get ();
+	}
+	
+	handleEof ();
+}
+
+void Parser::StreamParser::error (const char* what) const
+{
+	stringstream ss;
+	ss << what << " line " << line_;
+	throw ( mexception ( ss.str () ) );
 }
 
-void Parser::FileParser::insertConfigVar ()
+void Parser::StreamParser::insertConfigVar ()
 {
 	Configuration* tmp = dest_.top ();
 	dest_.pop ();
 	names_.pop ();
 	
 	try {
-		dest_.top ()->insertConfig ( names_.top (), *tmp );
+		Parser::insertConfig ( dest_.top (), ConfigKey::intern ( names_.top () ), *tmp );
 	}
 	catch (Configuration::VarAlreadyExisting& e)
 	{
-		string tmp ( "Configuration variable redefined at line " );
-		tmp += ( '0' + line_ );
-		throw ( mexception ( tmp ) );
+		delete tmp;
+		error ( "Configuration variable redefined at" );
 	}
 	
 	delete tmp;
 }
 
-void Parser::FileParser::insertDataVar ()
+void Parser::StreamParser::insertDataVar ()
 {
 	try {
-		dest_.top ()->insertStr ( names_.top (), value_ );
+		Parser::insertStr (
+			dest_.top (),
+			ConfigKey::intern ( names_.top () ),
+			value_.data (),
+			value_.data () + value_.size ()
+		);
 	}
 	catch (Configuration::VarAlreadyExisting& e)
 	{
-		string tmp ( "Data variable redefined at line " );
-		tmp += ( '0' + line_ );
-		throw ( mexception ( tmp ) );
+		error ( "Data variable redefined at" );
 	}
 }
 
-void Parser::FileParser::avoidLine ()
+void Parser::StreamParser::avoidLine ()
 {
 	for ( bool end = false; ( !file_.eof () ) && ( !end ); )
 	{
@@ -256,7 +1198,7 @@ void Parser::FileParser::avoidLine ()
 	}
 }
 
-void Parser::FileParser::changeToW8ingNameState ()
+void Parser::StreamParser::changeToW8ingNameState ()
 {
 	if ( dest_.size () == 1 )
 		state_ = WAITING_NAME;
@@ -264,20 +1206,23 @@ void Parser::FileParser::changeToW8ingNameState ()
 		state_ = W8ING_NAME_OR_BRACE;
 }
 
-void Parser::FileParser::handleLineBreak ()
+void Parser::StreamParser::handleLineBreak ()
 {
 	line_++;
 	
-	// avoiding Windows/DOS LF, or setting eofbit
-	input_ = file_.get ();
-	if ( !file_.eof () )
+	// avoiding Windows/DOS LF
+	if ( input_ == '\r' )
 	{
-		if ( input_ != '\n' )
-			file_.seekg ( -1, ios::cur );
+		input_ = file_.get ();
+		if ( !file_.eof () )
+		{
+			if ( input_ != '\n' )
+				file_.seekg ( -1, ios::cur );
+		}
 	}
 }
 
-void Parser::FileParser::handleWaitingName ()
+void Parser::StreamParser::handleWaitingName ()
 {
 	if (	( input_ == '_' ) ||
 		( ( input_ >= 'A' ) && ( input_ <= 'Z' ) ) ||
@@ -291,14 +1236,10 @@ void Parser::FileParser::handleWaitingName ()
 	else if ( ( input_ == '\r' ) || ( input_ == '\n' ) )
 		handleLineBreak ();
 	else if ( ( input_ != ' ' ) && ( input_ != '\t' ) )
-	{
-		string tmp ( "FParserVarNameInvalidToken line " );
-		tmp += ( '0' + line_ );
-		throw ( mexception ( tmp ) );
-	}
+		error ( "FParserVarNameInvalidToken" );
 }
 
-void Parser::FileParser::handleReadingName ()
+void Parser::StreamParser::handleReadingName ()
 {
 	if (	( input_ == '_' ) ||
 		( ( input_ >= '0' ) && ( input_ <= '9' ) ) ||
@@ -321,14 +1262,10 @@ void Parser::FileParser::handleReadingName ()
 		state_ = W8ING_NAME_OR_BRACE;
 	}
 	else
-	{
-		string tmp ( "FParserVarNameInvalidToken line " );
-		tmp += ( '0' + line_ );
-		throw ( mexception ( tmp ) );
-	}
+		error ( "FParserVarNameInvalidToken" );
 }
 
-void Parser::FileParser::handleW8ingEqlsOrBrace ()
+void Parser::StreamParser::handleW8ingEqlsOrBrace ()
 {
 	if ( input_ == '=' )
 		state_ = WAITING_VALUE;
@@ -349,14 +1286,10 @@ void Parser::FileParser::handleW8ingEqlsOrBrace ()
 		state_ = W8ING_OPENING_BRACE;
 	}
 	else if ( ( input_ != ' ' ) && ( input_ != '\t' ) )
-	{
-		string tmp ( "FParserValAssignmentMissing line " );
-		tmp += ( '0' + line_ );
-		throw ( mexception ( tmp ) );
-	}
+		error ( "FParserValAssignmentMissing" );
 }
 
-void Parser::FileParser::handleW8ingOpeningBrace ()
+void Parser::StreamParser::handleW8ingOpeningBrace ()
 {
 	if ( input_ == '{' )
 	{
@@ -369,14 +1302,10 @@ void Parser::FileParser::handleW8ingOpeningBrace ()
 	else if ( ( input_ == '\r' ) || ( input_ == '\n' ) )
 		handleLineBreak ();
 	else if ( ( input_ != ' ' ) && ( input_ != '\t' ) )
-	{
-		string tmp ( "FParserValAssignmentMissing line " );
-		tmp += ( '0' + line_ );
-		throw ( mexception ( tmp ) );
-	}
+		error ( "FParserValAssignmentMissing" );
 }
 
-void Parser::FileParser::handleWaitingValue ()
+void Parser::StreamParser::handleWaitingValue ()
 {
 	if ( input_ == '#' )
 	{
@@ -417,15 +1346,10 @@ void Parser::FileParser::handleWaitingValue ()
 	}
 }
 
-void Parser::FileParser::handleReadingValue ()
+void Parser::StreamParser::handleReadingValue ()
 {
 	if ( ( input_ == ' ' ) || ( input_ == '\t' ) )
-	{
-		if ( spaces_.size () > 0 )
-			spaces_ += input_;
-		else
-			spaces_ = input_;
-	}
+		spaces_ += input_;
 	else if ( ( input_ == '\r' ) || ( input_ == '\n' ) )
 	{
 		insertDataVar ();
@@ -449,7 +1373,8 @@ void Parser::FileParser::handleReadingValue ()
 	}
 	else if ( input_ == '}' )
 	{
-		if ( spaces_.size () > 0 )
+		// a closing brace at the top level is just part of the value
+		if ( ( spaces_.size () > 0 ) && ( dest_.size () > 1 ) )
 		{
 			insertDataVar ();
 			
@@ -460,20 +1385,21 @@ void Parser::FileParser::handleReadingValue ()
 			changeToW8ingNameState ();
 		}
 		else
-			value_ += input_;
-	}
-	else
-	{
-		if ( spaces_.size () > 0 )
 		{
 			value_ += spaces_;
 			spaces_ = "";
+			value_ += input_;
 		}
+	}
+	else
+	{
+		value_ += spaces_;
+		spaces_ = "";
 		value_ += input_;
 	}
 }
 
-void Parser::FileParser::handleW8ingNameOrBrace ()
+void Parser::StreamParser::handleW8ingNameOrBrace ()
 {
 	if ( input_ == '}' )
 	{
@@ -485,45 +1411,31 @@ void Parser::FileParser::handleW8ingNameOrBrace ()
 		handleWaitingName ();
 }
 
-void Parser::FileParser::handleEof ()
+void Parser::StreamParser::handleEof ()
 {
-	string tmp;
-	
 	switch ( state_ )
 	{
 		case READING_NAME:
 		case W8ING_EQLS_OR_BRACE:
 		case W8ING_OPENING_BRACE:
-			tmp = "FParserValAssignmentMissing line ";
-			tmp += ( '0' + line_ );
-			throw ( mexception ( tmp ) );
+			error ( "FParserValAssignmentMissing" );
 			break;
 		
 		case WAITING_VALUE:
 			if ( dest_.size () > 1 )
-			{
-				tmp = "FParserClosingBraceMissing line ";
-				tmp += ( '0' + line_ );
-				throw ( mexception ( tmp ) );
-			}
+				error ( "FParserClosingBraceMissing" );
 			value_ = "";
 			insertDataVar ();
 			break;
 		
 		case READING_VALUE:
 			if ( dest_.size () > 1 )
-			{
-				tmp = "FParserClosingBraceMissing line ";
-				tmp += ( '0' + line_ );
-				throw ( mexception ( tmp ) );
-			}
+				error ( "FParserClosingBraceMissing" );
 			insertDataVar ();
 			break;
 		
 		case W8ING_NAME_OR_BRACE:
-			tmp = "FParserClosingBraceMissing line ";
-			tmp += ( '0' + line_ );
-			throw ( mexception ( tmp ) );
+			error ( "FParserClosingBraceMissing" );
 			break;
 		
 		default:
@@ -537,7 +1449,35 @@ void Parser::FileParser::handleEof ()
 
 void Parser::parseFile (const string& filename, Configuration* dest)
 {
-	FileParser ( filename, dest );
+	if ( Configuration::streamed_ )
+		StreamParser ( filename, dest );
+	else
+		FileParser ( filename, dest );
+}
+
+void Parser::insertConfig (
+	Configuration* dest,
+	const ConfigKey* key,
+	const Configuration& val
+)
+{
+	if ( dest->node_->cvars.find ( key ) != -1 )
+		throw ( Configuration::VarAlreadyExisting () );
+	
+	dest->mutate ()->cvars.insert ( key, val );
+}
+
+void Parser::insertStr (
+	Configuration* dest,
+	const ConfigKey* key,
+	const char* beg,
+	const char* end
+)
+{
+	if ( dest->node_->vars.find ( key ) != -1 )
+		throw ( Configuration::VarAlreadyExisting () );
+	
+	dest->mutate ()->vars.insert ( key, parseInStr ( beg, end ) );
 }
 
 void Parser::parseName (const string& src)
@@ -564,42 +1504,35 @@ void Parser::parseName (const string& src)
 
 string Parser::parseInStr (const string& src)
 {
-	string s = "";
-	
-	stringstream ss;
-	ss << src;
-	char input = ss.get ();
+	return parseInStr ( src.data (), src.data () + src.size () );
+}
+
+string Parser::parseInStr (const char* beg, const char* end)
+{
+	string s;
+	s.reserve ( end - beg );
 	
-	while ( !ss.eof () )
+	for ( const char* input = beg; input < end; ++input )
 	{
-		if (	( input != '#' ) &&
-			( input != '}' )	)
-		{
-			switch ( input )
-			{
-				case '\t': s += "\\t"; break;
-				case '\r': s += "\\r"; break;
-				case '\n': s += "\\n"; break;
-				case '\0': s += "\\0"; break;
-				default:   s += input; break;
-			}
-		}
-		else if ( input == '#' )
-		{
-			if ( s[ s.size () - 1 ] != '\\' )
-				s += "\\#";
-			else
-				s += '#';
-		}
-		else
+		switch ( *input )
 		{
-			if ( s[ s.size () - 1 ] != '\\' )
-				s += "\\}";
-			else
-				s += '}';
+			case '\t': s += "\\t"; break;
+			case '\r': s += "\\r"; break;
+			case '\n': s += "\\n"; break;
+			case '\0': s += "\\0"; break;
+			
+			case '#':
+			case '}':
+				// already escaped characters are kept as they are
+				if ( ( !s.size () ) || ( s[ s.size () - 1 ] != '\\' ) )
+					s += '\\';
+				s += *input;
+				break;
+			
+			default:
+				s += *input;
+				break;
 		}
-		
-		input = ss.get ();
 	}
 	
 	return s;
@@ -743,12 +1676,43 @@ char Parser::parseOutChar (const string& src)
 // Configuration Methods
 // =============================================================================
 
-Configuration::Configuration ()
+Configuration::Configuration () : node_ ( new Node () )
+{
+}
+
+Configuration::Configuration (const Configuration& param) : node_ ( param.node_ )
 {
+	node_->refs++;
 }
 
 Configuration::~Configuration ()
 {
+	if ( !--node_->refs )
+		delete node_;
+}
+
+Configuration& Configuration::operator= (const Configuration& param)
+{
+	param.node_->refs++;
+	if ( !--node_->refs )
+		delete node_;
+	node_ = param.node_;
+	return *this;
+}
+
+void Configuration::swap (Configuration& param)
+{
+	std::swap ( node_, param.node_ );
+}
+
+unsigned long int Configuration::copiedBytes ()
+{
+	return copied_;
+}
+
+void Configuration::streamedParsing (bool streamed)
+{
+	streamed_ = streamed;
 }
 
 void Configuration::readTxt (const string& filename)
@@ -761,7 +1725,6 @@ void Configuration::readBin_ (fstream& f, Configuration& dest)
 	size_t tmp1, tmp2;
 	char* s;
 	string name;
-	Configuration buf;
 	string value;
 	
 	// reading all Configuration type variables
@@ -776,6 +1739,8 @@ void Configuration::readBin_ (fstream& f, Configuration& dest)
 		name = s;
 		delete[] s;
 		
+		// each nested configuration is read in place and then shared
+		Configuration buf;
 		readBin_ ( f, buf );
 		
 		try {
@@ -835,22 +1800,27 @@ void Configuration::writeTxt_ (fstream& f, unsigned short tab) const
 	for ( unsigned short i = 0; i < tab; i++ )
 		inden += '\t';
 	
+	const vector< size_t >& csorted = node_->cvars.order ();
+	const vector< size_t >& sorted = node_->vars.order ();
+	
 	// writing all the Configuration type variables
-	for ( size_t i = 0; i < cvars.size (); i++ )
+	for ( size_t i = 0; i < csorted.size (); i++ )
 	{
+		const ConfigVariable& cvar = node_->cvars[ csorted[i] ];
+		
 		f << inden;
-		f << cvars[i].name ();
+		f << cvar.name ();
 		f << "\r\n";
 		f << inden;
 		f << "{\r\n";
-		cvars[i].value ().writeTxt_ ( f, tab + 1 );
+		cvar.value ().writeTxt_ ( f, tab + 1 );
 		f << inden;
 		f << "}\r\n";
 		
 		// extra line break to separate blocks, if the last block
 		// written isn't the last variable of its configuration instance
-		if ( !(	( i + 1 == cvars.size () ) &&
-			( !vars.size () )	) )
+		if ( !(	( i + 1 == csorted.size () ) &&
+			( !sorted.size () )	) )
 		{
 			f << inden;
 			f << "\r\n";
@@ -858,12 +1828,12 @@ void Configuration::writeTxt_ (fstream& f, unsigned short tab) const
 	}
 	
 	// writing all the data variables
-	for ( size_t i = 0; i < vars.size (); i++ )
+	for ( size_t i = 0; i < sorted.size (); i++ )
 	{
 		f << inden;
-		f << vars[i].name ();
+		f << node_->vars[ sorted[i] ].name ();
 		f << " = ";
-		f << vars[i].value ();
+		f << node_->vars[ sorted[i] ].value ().raw ();
 		f << "\r\n";
 	}
 }
@@ -882,33 +1852,40 @@ void Configuration::writeBin_ (fstream& f) const
 {
 	size_t tmp1, tmp2;
 	
+	const vector< size_t >& csorted = node_->cvars.order ();
+	const vector< size_t >& sorted = node_->vars.order ();
+	
 	// writing all the Configuration type variables
-	tmp1 = cvars.size ();
+	tmp1 = csorted.size ();
 	f.write ( (const char*) &tmp1, sizeof ( tmp1 ) );
 	for ( size_t i = 0; i < tmp1; i++ )
 	{
+		const ConfigVariable& cvar = node_->cvars[ csorted[i] ];
+		
 		// writing the size and the name itself
-		tmp2 = cvars[i].name ().size ();
+		tmp2 = cvar.name ().size ();
 		f.write ( (const char*) &tmp2, sizeof ( tmp2 ) );
-		f.write ( cvars[i].name ().c_str (), tmp2 );
+		f.write ( cvar.name ().c_str (), tmp2 );
 		
-		cvars[i].value ().writeBin_ ( f );
+		cvar.value ().writeBin_ ( f );
 	}
 	
 	// writing all the data variables
-	tmp1 = vars.size ();
+	tmp1 = sorted.size ();
 	f.write ( (const char*) &tmp1, sizeof ( tmp1 ) );
 	for ( size_t i = 0; i < tmp1; i++ )
 	{
+		const DataVariable& var = node_->vars[ sorted[i] ];
+		
 		// writing the size and the name itself
-		tmp2 = vars[i].name ().size ();
+		tmp2 = var.name ().size ();
 		f.write ( (const char*) &tmp2, sizeof ( tmp2 ) );
-		f.write ( vars[i].name ().c_str (), tmp2 );
+		f.write ( var.name ().c_str (), tmp2 );
 		
 		// writing the size and the value itself
-		tmp2 = vars[i].value ().size ();
+		tmp2 = var.value ().raw ().size ();
 		f.write ( (const char*) &tmp2, sizeof ( tmp2 ) );
-		f.write ( vars[i].value ().c_str (), tmp2 );
+		f.write ( var.value ().raw ().c_str (), tmp2 );
 	}
 }
 
@@ -923,215 +1900,203 @@ void Configuration::writeBin (const string& filename)
 
 void Configuration::clear ()
 {
-	cvars.clear ();
-	vars.clear ();
+	// shared variables are just released, instead of copied and cleared
+	if ( node_->refs > 1 )
+	{
+		node_->refs--;
+		node_ = new Node ();
+	}
+	else
+	{
+		node_->cvars.clear ();
+		node_->vars.clear ();
+	}
 }
 
 size_t Configuration::size () const
 {
-	return ( cvars.size () + vars.size () );
-}
-
-template <class T>
-void Configuration::find (long int& mid, const vector< T >& vec, const string& name) const
-{
-	long int beg = 0;
-	long int end = ( ( (long int) vec.size () ) - 1 );
-	bool found = false;
-	
-	mid = 0;
-	
-	while ( ( beg <= end ) && ( !found ) )
-	{
-		mid = ( beg + end ) / 2;
-		
-		if ( vec[ mid ].name () < name )
-		{
-			beg = mid + 1;
-			mid = beg;
-		}
-		else if ( vec[ mid ].name () > name )
-			end = mid - 1;
-		else
-			found = true;
-	}
-	
-	if ( !found )
-		throw ( VarNotFound () );
+	return ( node_->cvars.size () + node_->vars.size () );
 }
 
 void Configuration::insertConfig (const string& name, const Configuration& val)
 {
-	long int i;
-	
 	if ( &val == this )
 		throw ( mexception ( "Config. inserting itself" ) );
 	
-	try {
-		find ( i, cvars, name );
-		
+	if ( node_->cvars.find ( ConfigKey::find ( name ) ) != -1 )
 		throw ( VarAlreadyExisting () );
-	}
-	catch (VarNotFound& e)
-	{
-		Parser::parseName ( name );
-		
-		cvars.insert
-		(
-			cvars.begin () + i,
-			ConfigVariable ( name, val )
-		);
-	}
+	
+	Parser::parseName ( name );
+	
+	mutate ()->cvars.insert ( ConfigKey::intern ( name ), val );
 }
 
 void Configuration::insertStr (const string& name, const string& val)
 {
-	long int i;
-	
-	try {
-		find ( i, vars, name );
-		
+	if ( node_->vars.find ( ConfigKey::find ( name ) ) != -1 )
 		throw ( VarAlreadyExisting () );
-	}
-	catch (VarNotFound& e)
-	{
-		Parser::parseName ( name );
-		
-		vars.insert
-		(
-			vars.begin () + i,
-			DataVariable ( name, Parser::parseInStr ( val ) )
-		);
-	}
+	
+	Parser::parseName ( name );
+	
+	mutate ()->vars.insert ( ConfigKey::intern ( name ), Parser::parseInStr ( val ) );
 }
 
 void Configuration::insertReal (const string& name, const long double& val)
 {
-	long int i;
-	
-	try {
-		find ( i, vars, name );
-		
+	if ( node_->vars.find ( ConfigKey::find ( name ) ) != -1 )
 		throw ( VarAlreadyExisting () );
-	}
-	catch (VarNotFound& e)
-	{
-		Parser::parseName ( name );
-		
-		vars.insert
-		(
-			vars.begin () + i,
-			DataVariable ( name, Parser::parseInReal ( val ) )
-		);
-	}
+	
+	Parser::parseName ( name );
+	
+	mutate ()->vars.insert ( ConfigKey::intern ( name ), Parser::parseInReal ( val ) );
 }
 
 void Configuration::insertInt (const string& name, const long int& val)
 {
-	long int i;
-	
-	try {
-		find ( i, vars, name );
-		
+	if ( node_->vars.find ( ConfigKey::find ( name ) ) != -1 )
 		throw ( VarAlreadyExisting () );
-	}
-	catch (VarNotFound& e)
-	{
-		Parser::parseName ( name );
-		
-		vars.insert
-		(
-			vars.begin () + i,
-			DataVariable ( name, Parser::parseInInt ( val ) )
-		);
-	}
+	
+	Parser::parseName ( name );
+	
+	mutate ()->vars.insert ( ConfigKey::intern ( name ), Parser::parseInInt ( val ) );
 }
 
 void Configuration::insertChar (const string& name, const char& val)
 {
-	long int i;
-	
-	try {
-		find ( i, vars, name );
-		
+	if ( node_->vars.find ( ConfigKey::find ( name ) ) != -1 )
 		throw ( VarAlreadyExisting () );
-	}
-	catch (VarNotFound& e)
-	{
-		Parser::parseName ( name );
-		
-		vars.insert
-		(
-			vars.begin () + i,
-			DataVariable ( name, Parser::parseInChar ( val ) )
-		);
-	}
+	
+	Parser::parseName ( name );
+	
+	mutate ()->vars.insert ( ConfigKey::intern ( name ), Parser::parseInChar ( val ) );
 }
 
 Configuration Configuration::getConfig (const string& name) const
 {
-	long int i;
+	return getConfigRef ( name );
+}
+
+const Configuration& Configuration::getConfigRef (const string& name) const
+{
+	long int i = node_->cvars.find ( ConfigKey::find ( name ) );
+	
+	if ( i == -1 )
+		throw ( VarNotFound () );
+	
+	return node_->cvars[i].value ();
+}
+
+const Configuration::Value& Configuration::get (const string& name) const
+{
+	const Value* val = find ( name );
 	
-	find ( i, cvars, name );
+	if ( !val )
+		throw ( VarNotFound () );
 	
-	return cvars[i].value ();
+	return *val;
 }
 
-const string& Configuration::get (const string& name) const
+const Configuration::Value* Configuration::find (const string& name) const
 {
-	long int i;
+	long int i = node_->vars.find ( ConfigKey::find ( name ) );
 	
-	find ( i, vars, name );
+	if ( i == -1 )
+		return NULL;
 	
-	return vars[i].value ();
+	return &node_->vars[i].value ();
 }
 
 string Configuration::getStr (const string& name) const
 {
-	return Parser::parseOutStr ( get ( name ) );
+	return get ( name ).str ();
 }
 
 long double Configuration::getReal (const string& name) const
 {
-	return Parser::parseOutReal ( get ( name ) );
+	const long double* val = get ( name ).real ();
+	
+	if ( !val )
+		throw ( mexception ( "StrParserInvConversionReal" ) );
+	
+	return *val;
 }
 
 long int Configuration::getInt (const string& name) const
 {
-	return Parser::parseOutInt ( get ( name ) );
+	const long int* val = get ( name ).integer ();
+	
+	if ( !val )
+		throw ( mexception ( "StrParserInvConversionInt" ) );
+	
+	return *val;
 }
 
 char Configuration::getChar (const string& name) const
 {
-	return Parser::parseOutChar ( get ( name ) );
+	const char* val = get ( name ).character ();
+	
+	if ( !val )
+		throw ( mexception ( "StrParserInvConversionChar" ) );
+	
+	return *val;
+}
+
+string Configuration::getStr (const string& name, const string& def) const
+{
+	const Value* val = find ( name );
+	
+	if ( val )
+	{
+		try {
+			return val->str ();
+		} catch (mexception&) {}
+	}
+	
+	return def;
+}
+
+long double Configuration::getReal (const string& name, long double def) const
+{
+	const Value* val = find ( name );
+	const long double* ret = ( val ? val->real () : NULL );
+	
+	return ( ret ? *ret : def );
+}
+
+long int Configuration::getInt (const string& name, long int def) const
+{
+	const Value* val = find ( name );
+	const long int* ret = ( val ? val->integer () : NULL );
+	
+	return ( ret ? *ret : def );
+}
+
+char Configuration::getChar (const string& name, char def) const
+{
+	const Value* val = find ( name );
+	const char* ret = ( val ? val->character () : NULL );
+	
+	return ( ret ? *ret : def );
 }
 
 template <class var_type, class vec_type>
 list< var_type > Configuration::getList (
 	const string& name,
 	typename getvar< var_type >::type access_method,
-	const vector< vec_type >& vec
+	const Table< vec_type >& vec
 ) const
 {
 	list< var_type > ret;
+	const vector< size_t >& sorted = vec.order ();
+	size_t beg, end;
 	
-	for ( int i = 0; i < (int) vec.size (); ++i )
+	vec.range ( name, beg, end );
+	
+	for ( size_t i = beg; i < end; ++i )
 	{
-		size_t j = 0;
-		
-		while (	(	( j < vec[i].name ().size () ) &&
-				( j < name.size () )	) &&
-			( vec[i].name ()[j] == name[j] )	)
-		{
-			++j;
-		}
-		
-		if ( j == name.size () )
-		{
-			ret.push_back (
-				CALLBACK ( *this, access_method ) ( vec[i].name () )
-			);
-		}
+		ret.push_back (
+			CALLBACK ( *this, access_method ) ( vec[ sorted[i] ].name () )
+		);
 	}
 	
 	return ret;
@@ -1139,108 +2104,175 @@ list< var_type > Configuration::getList (
 
 list< Configuration > Configuration::getConfigList (const string& name) const
 {
-	return getList< Configuration, ConfigVariable > (
+	return getList< Configuration, Configuration > (
 		name,
 		&Configuration::getConfig,
-		cvars
+		node_->cvars
 	);
 }
 
 list< string > Configuration::getStrList (const string& name) const
 {
-	return getList< string, DataVariable > (
+	return getList< string, Value > (
 		name,
 		&Configuration::getStr,
-		vars
+		node_->vars
 	);
 }
 
 list< long double > Configuration::getRealList (const string& name) const
 {
-	return getList< long double, DataVariable > (
+	return getList< long double, Value > (
 		name,
 		&Configuration::getReal,
-		vars
+		node_->vars
 	);
 }
 
 list< long int > Configuration::getIntList (const string& name) const
 {
-	return getList< long int, DataVariable > (
+	return getList< long int, Value > (
 		name,
 		&Configuration::getInt,
-		vars
+		node_->vars
 	);
 }
 
 list< char > Configuration::getCharList (const string& name) const
 {
-	return getList< char, DataVariable > (
+	return getList< char, Value > (
 		name,
 		&Configuration::getChar,
-		vars
+		node_->vars
 	);
 }
 
+Configuration::Iterator Configuration::beginConfigs (const string& prefix) const
+{
+	size_t beg, end;
+	
+	node_->cvars.range ( prefix, beg, end );
+	
+	return Iterator ( this, true, beg, end );
+}
+
+Configuration::Iterator Configuration::beginVars (const string& prefix) const
+{
+	size_t beg, end;
+	
+	node_->vars.range ( prefix, beg, end );
+	
+	return Iterator ( this, false, beg, end );
+}
+
 void Configuration::setConfig (const string& name, const Configuration& val)
 {
-	long int i;
+	long int i = node_->cvars.find ( ConfigKey::find ( name ) );
 	
-	find ( i, cvars, name );
+	if ( i == -1 )
+		throw ( VarNotFound () );
 	
-	cvars[i].set ( val );
+	// shares "val" before detaching, in case it's this instance itself
+	Configuration tmp ( val );
+	mutate ()->cvars[i].set ( tmp );
 }
 
 void Configuration::setStr (const string& name, const string& val)
 {
-	long int i;
+	long int i = node_->vars.find ( ConfigKey::find ( name ) );
 	
-	find ( i, vars, name );
+	if ( i == -1 )
+		throw ( VarNotFound () );
 	
-	vars[i].set ( Parser::parseInStr ( val ) );
+	mutate ()->vars[i].set ( Parser::parseInStr ( val ) );
 }
 
 void Configuration::setReal (const string& name, const long double& val)
 {
-	long int i;
+	long int i = node_->vars.find ( ConfigKey::find ( name ) );
 	
-	find ( i, vars, name );
+	if ( i == -1 )
+		throw ( VarNotFound () );
 	
-	vars[i].set ( Parser::parseInReal ( val ) );
+	mutate ()->vars[i].set ( Parser::parseInReal ( val ) );
 }
 
 void Configuration::setInt (const string& name, const long int& val)
 {
-	long int i;
+	long int i = node_->vars.find ( ConfigKey::find ( name ) );
 	
-	find ( i, vars, name );
+	if ( i == -1 )
+		throw ( VarNotFound () );
 	
-	vars[i].set ( Parser::parseInInt ( val ) );
+	mutate ()->vars[i].set ( Parser::parseInInt ( val ) );
 }
 
 void Configuration::setChar (const string& name, const char& val)
 {
-	long int i;
+	long int i = node_->vars.find ( ConfigKey::find ( name ) );
 	
-	find ( i, vars, name );
+	if ( i == -1 )
+		throw ( VarNotFound () );
 	
-	vars[i].set ( Parser::parseInChar ( val ) );
+	mutate ()->vars[i].set ( Parser::parseInChar ( val ) );
 }
 
 void Configuration::eraseSub (const string& name)
 {
-	long int i;
+	long int i = node_->cvars.find ( ConfigKey::find ( name ) );
 	
-	find ( i, cvars, name );
+	if ( i == -1 )
+		throw ( VarNotFound () );
 	
-	cvars.erase ( cvars.begin () + i );
+	mutate ()->cvars.erase ( i );
 }
 
 void Configuration::erase (const string& name)
 {
-	long int i;
+	long int i = node_->vars.find ( ConfigKey::find ( name ) );
+	
+	if ( i == -1 )
+		throw ( VarNotFound () );
+	
+	mutate ()->vars.erase ( i );
+}
+
+// =============================================================================
+// Configuration Iterator Methods
+// =============================================================================
+
+Configuration::Iterator::Iterator (
+	const Configuration* conf,
+	bool sub,
+	size_t beg,
+	size_t end
+) : conf_ ( conf ), sub_ ( sub ), pos_ ( beg ), end_ ( end )
+{
+}
+
+bool Configuration::Iterator::valid () const
+{
+	return ( pos_ < end_ );
+}
+
+void Configuration::Iterator::next ()
+{
+	if ( pos_ < end_ )
+		++pos_;
+}
+
+const string& Configuration::Iterator::name () const
+{
+	if ( sub_ )
+		return conf_->node_->cvars[ conf_->node_->cvars.order ()[ pos_ ] ].name ();
 	
-	find ( i, vars, name );
+	return conf_->node_->vars[ conf_->node_->vars.order ()[ pos_ ] ].name ();
+}
+
+const Configuration& Configuration::Iterator::config () const
+{
+	if ( !sub_ )
+		throw ( VarNotFound () );
 	
-	vars.erase ( vars.begin () + i );
+	return conf_->node_->cvars[ conf_->node_->cvars.order ()[ pos_ ] ].value ();
 }
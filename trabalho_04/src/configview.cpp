@@ -0,0 +1,609 @@
+/// @ingroup MOD_CONFIGFILE
+/// @file configview.cpp
+/// @brief Implementation of the binary configuration file view
+/// @author Matheus Pimenta
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "configview.hpp"
+
+#include "simplestructures.hpp"
+
+using std::string;
+using std::vector;
+using std::map;
+using std::fstream;
+
+// =============================================================================
+// Binary Layout
+// =============================================================================
+//
+// Header, then the nodes, each aligned to 8 bytes, then a table of null
+// terminated strings (names and unescaped values). Every node is a count of
+// entries, the size of its hash table (a power of two), the entries sorted by
+// name and the hash table itself, holding entry indexes plus one (zero marks
+// an empty slot). Offsets of nodes are relative to the file; offsets of
+// strings are relative to the string table.
+
+// the layout assumes 32 bits unsigned ints and 64 bits doubles
+typedef char ConfigViewCheckUInt[ ( sizeof ( unsigned int ) == 4 ) ? 1 : -1 ];
+typedef char ConfigViewCheckDouble[ ( sizeof ( double ) == 8 ) ? 1 : -1 ];
+
+namespace
+{
+	const char MAGIC[] = { 'H', 'Q', 'C', 'F' };
+	
+	enum
+	{
+		IS_CONFIG = 1,
+		HAS_REAL = 2,
+		HAS_INT = 4,
+		HAS_CHAR = 8
+	};
+	
+	struct Header
+	{
+		char magic[4];
+		unsigned int version;
+		unsigned int size;
+		unsigned int root;
+		unsigned int strings;
+		unsigned int reserved[3];
+	};
+	
+	struct NodeHeader
+	{
+		unsigned int count;
+		unsigned int slots;
+	};
+	
+	// same 32 bits FNV-1a used by Configuration's keys
+	unsigned int hashOf (const char* src, size_t size)
+	{
+		unsigned int hash = 2166136261U;
+		
+		for ( size_t i = 0; i < size; i++ )
+		{
+			hash ^= (unsigned char) src[i];
+			hash *= 16777619U;
+		}
+		
+		return hash;
+	}
+}
+
+struct ConfigView::Entry
+{
+	unsigned int hash;
+	unsigned int name;
+	unsigned int flags;
+	unsigned int value;
+	unsigned int int_lo;
+	unsigned int int_hi;
+	unsigned int chr;
+	unsigned int pad;
+	double real;
+};
+
+struct ConfigView::Mapping
+{
+	const char* data;
+	size_t size;
+	unsigned int refs;
+	bool mapped;
+	vector< char > buffer;
+	
+	Mapping () : data ( NULL ), size ( 0 ), refs ( 1 ), mapped ( false )
+	{
+	}
+	
+	~Mapping ()
+	{
+#ifdef __unix__
+		if ( mapped )
+			munmap ( (void*) data, size );
+#endif
+	}
+	
+	const Header& header () const
+	{
+		return *( (const Header*) data );
+	}
+};
+
+// every node reachable from the root must lie before the string table,
+// with its entries and hash table inside it, and every offset of a
+// string must fall in the string table, which ends with a null
+// character, so no accessor reads past the end of a corrupted file
+bool ConfigView::valid (const char* data, size_t size)
+{
+	const Header* header = (const Header*) data;
+	size_t strsize = size - header->strings;
+	
+	vector< unsigned int > pending;
+	pending.push_back ( header->root );
+	
+	// the writer never shares a node between two entries
+	vector< bool > seen ( header->strings / 8, false );
+	
+	while ( pending.size () )
+	{
+		unsigned int offset = pending.back ();
+		pending.pop_back ();
+		
+		if ( ( offset < sizeof ( Header ) ) || ( offset % 8 ) ||
+			( offset + sizeof ( NodeHeader ) > header->strings ) ||
+			( seen[offset / 8] ) )
+			return false;
+		seen[offset / 8] = true;
+		
+		const NodeHeader* node = (const NodeHeader*) ( data + offset );
+		
+		// the probing stops at an empty slot, so there must be one
+		if ( ( !node->slots ) || ( node->slots & ( node->slots - 1 ) ) ||
+			( node->slots <= node->count ) )
+			return false;
+		
+		size_t end = offset + sizeof ( NodeHeader ) +
+			(size_t) node->count * sizeof ( Entry ) +
+			(size_t) node->slots * sizeof ( unsigned int );
+		if ( end > header->strings )
+			return false;
+		
+		const Entry* entries = (const Entry*) ( node + 1 );
+		const unsigned int* slots = (const unsigned int*) ( entries + node->count );
+		
+		for ( unsigned int i = 0; i < node->slots; i++ )
+		{
+			if ( slots[i] > node->count )
+				return false;
+		}
+		
+		for ( unsigned int i = 0; i < node->count; i++ )
+		{
+			if ( entries[i].name >= strsize )
+				return false;
+			
+			// the children are written after their parents, which
+			// also rules out cycles
+			if ( entries[i].flags & IS_CONFIG )
+			{
+				if ( entries[i].value <= offset )
+					return false;
+				pending.push_back ( entries[i].value );
+			}
+			else if ( entries[i].value >= strsize )
+				return false;
+		}
+	}
+	
+	return true;
+}
+
+// =============================================================================
+// ConfigView Methods
+// =============================================================================
+
+ConfigView::ConfigView () : map_ ( NULL ), node_ ( 0 )
+{
+}
+
+ConfigView::ConfigView (const string& filename) : map_ ( NULL ), node_ ( 0 )
+{
+	open ( filename );
+}
+
+ConfigView::ConfigView (const string& binfile, const string& txtfile) :
+map_ ( NULL ), node_ ( 0 )
+{
+	open ( binfile, txtfile );
+}
+
+ConfigView::ConfigView (const ConfigView& param) :
+map_ ( param.map_ ), node_ ( param.node_ )
+{
+	if ( map_ )
+		map_->refs++;
+}
+
+ConfigView::~ConfigView ()
+{
+	close ();
+}
+
+ConfigView& ConfigView::operator= (const ConfigView& param)
+{
+	if ( param.map_ )
+		param.map_->refs++;
+	close ();
+	map_ = param.map_;
+	node_ = param.node_;
+	return *this;
+}
+
+void ConfigView::open (const string& filename)
+{
+	close ();
+	
+	Mapping* map = new Mapping;
+	
+#ifdef __unix__
+	int fd = ::open ( filename.c_str (), O_RDONLY );
+	if ( fd < 0 )
+	{
+		delete map;
+		throw ( Configuration::FileNotFound () );
+	}
+	
+	struct stat st;
+	if ( ( fstat ( fd, &st ) == 0 ) && ( st.st_size > 0 ) )
+	{
+		void* data = mmap ( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+		if ( data != MAP_FAILED )
+		{
+			map->data = (const char*) data;
+			map->size = st.st_size;
+			map->mapped = true;
+		}
+	}
+	::close ( fd );
+#endif
+	
+	// no mmap available: reads the whole file
+	if ( !map->mapped )
+	{
+		fstream f ( filename.c_str (), fstream::in | fstream::binary );
+		if ( !f.is_open () )
+		{
+			delete map;
+			throw ( Configuration::FileNotFound () );
+		}
+		
+		f.seekg ( 0, fstream::end );
+		map->buffer.resize ( f.tellg () );
+		f.seekg ( 0, fstream::beg );
+		if ( map->buffer.size () )
+			f.read ( &map->buffer[0], map->buffer.size () );
+		map->data = ( map->buffer.size () ? &map->buffer[0] : NULL );
+		map->size = map->buffer.size ();
+	}
+	
+	// validates the header and the string table's termination
+	if ( ( map->size < sizeof ( Header ) ) ||
+		memcmp ( map->header ().magic, MAGIC, sizeof ( MAGIC ) ) ||
+		( map->header ().version != VERSION ) ||
+		( map->header ().size != map->size ) ||
+		( map->header ().strings > map->size ) ||
+		( map->header ().root % 8 ) ||
+		( map->header ().root + sizeof ( NodeHeader ) > map->header ().strings ) ||
+		( ( map->header ().strings < map->size ) && map->data[map->size - 1] ) ||
+		( !valid ( map->data, map->size ) ) )
+	{
+		delete map;
+		throw ( InvalidFormat () );
+	}
+	
+	map_ = map;
+	node_ = map->header ().root;
+}
+
+void ConfigView::close ()
+{
+	if ( map_ && !--map_->refs )
+		delete map_;
+	map_ = NULL;
+	node_ = 0;
+}
+
+const char* ConfigView::at (unsigned int offset) const
+{
+	return ( map_->data + offset );
+}
+
+const ConfigView::Entry* ConfigView::find (const string& name, bool config) const
+{
+	if ( !map_ )
+		return NULL;
+	
+	const NodeHeader* node = (const NodeHeader*) at ( node_ );
+	const Entry* entries = (const Entry*) ( node + 1 );
+	const unsigned int* slots = (const unsigned int*) ( entries + node->count );
+	const char* strings = at ( map_->header ().strings );
+	
+	unsigned int hash = hashOf ( name.c_str (), name.size () );
+	unsigned int mask = node->slots - 1;
+	
+	for ( unsigned int i = hash & mask; slots[i]; i = ( i + 1 ) & mask )
+	{
+		const Entry* entry = &entries[slots[i] - 1];
+		if ( ( entry->hash == hash ) &&
+			( bool ( entry->flags & IS_CONFIG ) == config ) &&
+			!strcmp ( strings + entry->name, name.c_str () ) )
+			return entry;
+	}
+	
+	return NULL;
+}
+
+const ConfigView::Entry* ConfigView::get (const string& name, bool config) const
+{
+	const Entry* entry = find ( name, config );
+	
+	if ( !entry )
+		throw ( Configuration::VarNotFound () );
+	
+	return entry;
+}
+
+size_t ConfigView::size () const
+{
+	if ( !map_ )
+		return 0;
+	
+	return ( (const NodeHeader*) at ( node_ ) )->count;
+}
+
+bool ConfigView::hasConfig (const string& name) const
+{
+	return ( find ( name, true ) != NULL );
+}
+
+bool ConfigView::has (const string& name) const
+{
+	return ( find ( name, false ) != NULL );
+}
+
+ConfigView ConfigView::getConfig (const string& name) const
+{
+	const Entry* entry = get ( name, true );
+	
+	ConfigView view ( *this );
+	view.node_ = entry->value;
+	return view;
+}
+
+const char* ConfigView::getCStr (const string& name) const
+{
+	const Entry* entry = get ( name, false );
+	return ( at ( map_->header ().strings ) + entry->value );
+}
+
+string ConfigView::getStr (const string& name) const
+{
+	return getCStr ( name );
+}
+
+long double ConfigView::getReal (const string& name) const
+{
+	const Entry* entry = get ( name, false );
+	
+	if ( !( entry->flags & HAS_REAL ) )
+		throw ( mexception ( "StrParserInvConversionReal" ) );
+	
+	return entry->real;
+}
+
+long int ConfigView::getInt (const string& name) const
+{
+	const Entry* entry = get ( name, false );
+	
+	if ( !( entry->flags & HAS_INT ) )
+		throw ( mexception ( "StrParserInvConversionInt" ) );
+	
+	// the high word only matters where long int has more than 32 bits
+	unsigned long int val = entry->int_lo;
+	if ( sizeof ( long int ) > 4 )
+		val |= ( (unsigned long int) entry->int_hi << 16 ) << 16;
+	
+	return (long int) val;
+}
+
+char ConfigView::getChar (const string& name) const
+{
+	const Entry* entry = get ( name, false );
+	
+	if ( !( entry->flags & HAS_CHAR ) )
+		throw ( mexception ( "StrParserInvConversionChar" ) );
+	
+	return (char) entry->chr;
+}
+
+// =============================================================================
+// Binary Writer
+// =============================================================================
+
+class ConfigView::Writer
+{
+private:
+	vector< char > out_;
+	vector< char > strings_;
+	map< string, unsigned int > pool_;
+public:
+	unsigned int str (const string& src);
+	unsigned int node (const Configuration& conf);
+	void layout (const Configuration& conf);
+	void build (const Configuration& conf, vector< char >& out);
+	void write (const Configuration& conf, const string& filename);
+};
+
+unsigned int ConfigView::Writer::str (const string& src)
+{
+	map< string, unsigned int >::iterator it = pool_.find ( src );
+	if ( it != pool_.end () )
+		return it->second;
+	
+	unsigned int offset = strings_.size ();
+	strings_.insert ( strings_.end (), src.begin (), src.end () );
+	strings_.push_back ( '\0' );
+	pool_[src] = offset;
+	return offset;
+}
+
+unsigned int ConfigView::Writer::node (const Configuration& conf)
+{
+	vector< ConfigView::Entry > entries;
+	vector< const Configuration* > children;
+	
+	// entries are already sorted by name inside each kind
+	for ( Configuration::Iterator it = conf.beginConfigs (); it.valid (); it.next () )
+	{
+		ConfigView::Entry entry;
+		memset ( &entry, 0, sizeof ( entry ) );
+		entry.hash = hashOf ( it.name ().c_str (), it.name ().size () );
+		entry.name = str ( it.name () );
+		entry.flags = IS_CONFIG;
+		entries.push_back ( entry );
+		children.push_back ( &it.config () );
+	}
+	for ( Configuration::Iterator it = conf.beginVars (); it.valid (); it.next () )
+	{
+		ConfigView::Entry entry;
+		memset ( &entry, 0, sizeof ( entry ) );
+		entry.hash = hashOf ( it.name ().c_str (), it.name ().size () );
+		entry.name = str ( it.name () );
+		entry.value = str ( conf.getStr ( it.name () ) );
+		
+		// stores every conversion the value admits
+		try {
+			entry.real = conf.getReal ( it.name () );
+			entry.flags |= HAS_REAL;
+		} catch (mexception&) {}
+		try {
+			unsigned long int val = conf.getInt ( it.name () );
+			entry.int_lo = val & 0xFFFFFFFFUL;
+			entry.int_hi = ( val >> 16 ) >> 16;
+			if ( ( (long int) val < 0 ) && ( sizeof ( long int ) == 4 ) )
+				entry.int_hi = 0xFFFFFFFFU;
+			entry.flags |= HAS_INT;
+		} catch (mexception&) {}
+		try {
+			entry.chr = (unsigned char) conf.getChar ( it.name () );
+			entry.flags |= HAS_CHAR;
+		} catch (mexception&) {}
+		
+		entries.push_back ( entry );
+	}
+	
+	unsigned int slots = 2;
+	while ( slots < 2 * entries.size () )
+		slots *= 2;
+	
+	out_.resize ( ( out_.size () + 7 ) & ~7UL, 0 );
+	unsigned int offset = out_.size ();
+	out_.resize ( offset + sizeof ( NodeHeader ) +
+		entries.size () * sizeof ( ConfigView::Entry ) +
+		slots * sizeof ( unsigned int ), 0 );
+	
+	NodeHeader header;
+	header.count = entries.size ();
+	header.slots = slots;
+	memcpy ( &out_[offset], &header, sizeof ( header ) );
+	
+	vector< unsigned int > table ( slots, 0 );
+	for ( unsigned int i = 0; i < entries.size (); i++ )
+	{
+		unsigned int j = entries[i].hash & ( slots - 1 );
+		while ( table[j] )
+			j = ( j + 1 ) & ( slots - 1 );
+		table[j] = i + 1;
+	}
+	memcpy ( &out_[offset + sizeof ( NodeHeader ) +
+		entries.size () * sizeof ( ConfigView::Entry )],
+		&table[0], slots * sizeof ( unsigned int ) );
+	
+	// children are appended after this node
+	for ( unsigned int i = 0; i < children.size (); i++ )
+		entries[i].value = node ( *children[i] );
+	
+	if ( entries.size () )
+		memcpy ( &out_[offset + sizeof ( NodeHeader )], &entries[0],
+			entries.size () * sizeof ( ConfigView::Entry ) );
+	
+	return offset;
+}
+
+void ConfigView::Writer::layout (const Configuration& conf)
+{
+	out_.assign ( sizeof ( Header ), 0 );
+	strings_.clear ();
+	pool_.clear ();
+	
+	Header header;
+	memset ( &header, 0, sizeof ( header ) );
+	memcpy ( header.magic, MAGIC, sizeof ( MAGIC ) );
+	header.version = ConfigView::VERSION;
+	header.root = node ( conf );
+	header.strings = out_.size ();
+	header.size = out_.size () + strings_.size ();
+	memcpy ( &out_[0], &header, sizeof ( header ) );
+}
+
+void ConfigView::Writer::build (const Configuration& conf, vector< char >& out)
+{
+	layout ( conf );
+	
+	out.swap ( out_ );
+	out.insert ( out.end (), strings_.begin (), strings_.end () );
+}
+
+void ConfigView::Writer::write (const Configuration& conf, const string& filename)
+{
+	layout ( conf );
+	
+	fstream f ( filename.c_str (), fstream::out | fstream::binary | fstream::trunc );
+	if ( !f.is_open () )
+		throw ( Configuration::FileNotFound () );
+	
+	f.write ( &out_[0], out_.size () );
+	if ( strings_.size () )
+		f.write ( &strings_[0], strings_.size () );
+	f.close ();
+}
+
+void ConfigView::write (const Configuration& src, const string& filename)
+{
+	Writer writer;
+	writer.write ( src, filename );
+}
+
+void ConfigView::convert (const string& txtfile, const string& binfile)
+{
+	Configuration conf;
+	conf.readTxt ( txtfile );
+	write ( conf, binfile );
+}
+
+void ConfigView::open (const string& binfile, const string& txtfile)
+{
+	try {
+		open ( binfile );
+		return;
+	}
+	catch (Configuration::FileNotFound&) {
+	}
+	catch (InvalidFormat&) {
+	}
+	
+	Configuration conf;
+	conf.readTxt ( txtfile );
+	
+	// the same layout, built in memory instead of mapped
+	Mapping* map = new Mapping;
+	Writer writer;
+	writer.build ( conf, map->buffer );
+	map->data = &map->buffer[0];
+	map->size = map->buffer.size ();
+	
+	map_ = map;
+	node_ = map->header ().root;
+}
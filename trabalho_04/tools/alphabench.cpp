@@ -0,0 +1,327 @@
+/// @file alphabench.cpp
+/// @brief Output and throughput of the alpha blending kernels against
+/// SDL_BlitSurface
+/// @author Matheus Pimenta
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <sys/time.h>
+
+#include "SDL.h"
+
+#include "AlphaBlit.hpp"
+
+#include "simplestructures.hpp"
+
+using std::vector;
+
+// sprites blended over the target in each pass
+#define SPRITES	64
+
+static double now ()
+{
+	timeval tv;
+	gettimeofday ( &tv, NULL );
+	return ( tv.tv_sec + tv.tv_usec / 1000000.0 );
+}
+
+static SDL_Surface* surface (int w, int h, Uint32 amask)
+{
+	SDL_Surface* s = SDL_CreateRGBSurface (
+		SDL_SWSURFACE, w, h, 32, 0xFF0000, 0xFF00, 0xFF, amask
+	);
+	if ( !s )
+		throw ( mexception ( "SDL_CreateRGBSurface error" ) );
+	
+	return s;
+}
+
+static Uint32* row (SDL_Surface* s, int y)
+{
+	return (Uint32*) ( (Uint8*) s->pixels + y * s->pitch );
+}
+
+/// @brief Sprites with the alpha of each kind of image of the game
+enum Shape
+{
+	OPAQUE,		///< like the background and most tiles
+	SPRITE,		///< a disc with soft edges and clear corners, like the planets
+	TRANSLUCENT	///< every alpha, like the explosions
+};
+
+static const char* shapes[] = { "opaque", "sprite", "translucent" };
+
+static SDL_Surface* sprite (int side, Shape shape)
+{
+	SDL_Surface* s = surface ( side, side, 0xFF000000 );
+	float r = side / 2.0f;
+	
+	for ( int y = 0; y < side; y++ )
+	{
+		for ( int x = 0; x < side; x++ )
+		{
+			Uint32 rgb = ( ( Uint32 ( rand () ) << 16 ) ^ Uint32 ( rand () ) ) & 0xFFFFFF;
+			int a = 255;
+			
+			if ( shape == SPRITE )
+			{
+				float d = sqrt ( ( x - r ) * ( x - r ) + ( y - r ) * ( y - r ) );
+				a = ( d < r - 4 ) ? 255 : ( d > r ) ? 0 : int ( 255 * ( r - d ) / 4 );
+			}
+			else if ( shape == TRANSLUCENT )
+				a = rand () % 256;
+			
+			row ( s, y )[x] = ( Uint32 ( a ) << 24 ) | rgb;
+		}
+	}
+	
+	SDL_SetAlpha ( s, SDL_SRCALPHA, SDL_ALPHA_OPAQUE );
+	return s;
+}
+
+static void noise (SDL_Surface* s)
+{
+	for ( int y = 0; y < s->h; y++ )
+	{
+		for ( int x = 0; x < s->w; x++ )
+			row ( s, y )[x] = ( ( Uint32 ( rand () ) << 16 ) ^ Uint32 ( rand () ) ) & 0xFFFFFF;
+	}
+}
+
+static void copy (SDL_Surface* from, SDL_Surface* to)
+{
+	for ( int y = 0; y < from->h; y++ )
+		memcpy ( row ( to, y ), row ( from, y ), from->w * 4 );
+}
+
+/// @brief Blends the sprite at each position with the current kernel
+static void blend (SDL_Surface* src, SDL_Surface* dst, const vector< SDL_Rect >& at, bool premultiplied)
+{
+	for ( unsigned int k = 0; k < at.size (); k++ )
+	{
+		for ( int y = 0; y < src->h; y++ )
+		{
+			Uint32* d = row ( dst, at[k].y + y ) + at[k].x;
+			
+			if ( premultiplied )
+				AlphaBlit::blendPremultiplied ( row ( src, y ), d, src->w );
+			else
+				AlphaBlit::blend ( row ( src, y ), d, src->w );
+		}
+	}
+}
+
+/// @brief What the premultiplied blend must give, SDL having nothing like
+/// it: s + d * ( 255 - a ) / 255, with a plain division
+static void over (SDL_Surface* src, SDL_Surface* dst, const vector< SDL_Rect >& at)
+{
+	for ( unsigned int k = 0; k < at.size (); k++ )
+	{
+		for ( int y = 0; y < src->h; y++ )
+		{
+			const Uint32* s = row ( src, y );
+			Uint32* d = row ( dst, at[k].y + y ) + at[k].x;
+			
+			for ( int x = 0; x < src->w; x++ )
+			{
+				Uint32 a = s[x] >> 24;
+				Uint32 out = d[x] & 0xFF000000;
+				
+				if ( !a )
+					continue;
+				
+				for ( int shift = 0; shift < 24; shift += 8 )
+				{
+					Uint32 sc = ( s[x] >> shift ) & 0xFF, dc = ( d[x] >> shift ) & 0xFF;
+					out |= ( ( a == 255 ) ? sc : sc + dc * ( 255 - a ) / 255 ) << shift;
+				}
+				d[x] = out;
+			}
+		}
+	}
+}
+
+/// @return Largest difference of a channel between the surfaces.
+static int compare (SDL_Surface* a, SDL_Surface* b, int& pixels)
+{
+	int worst = 0;
+	pixels = 0;
+	
+	for ( int y = 0; y < a->h; y++ )
+	{
+		for ( int x = 0; x < a->w; x++ )
+		{
+			Uint32 pa = row ( a, y )[x] & 0xFFFFFF, pb = row ( b, y )[x] & 0xFFFFFF;
+			
+			if ( pa == pb )
+				continue;
+			
+			pixels++;
+			for ( int shift = 0; shift < 24; shift += 8 )
+			{
+				int d = abs ( int ( ( pa >> shift ) & 0xFF ) - int ( ( pb >> shift ) & 0xFF ) );
+				if ( d > worst )
+					worst = d;
+			}
+		}
+	}
+	
+	return worst;
+}
+
+int main (int argc, char* argv[])
+{
+	int side = ( argc > 1 ) ? atoi ( argv[1] ) : 96;
+	int passes = ( argc > 2 ) ? atoi ( argv[2] ) : 50;
+	
+	if ( side < 1 )
+		side = 1;
+	if ( passes < 1 )
+		passes = 1;
+	
+	srand ( 1 );
+	
+	bool wrong = false;
+	
+	try {
+		int w = 800, h = 600;
+		SDL_Surface* bg = surface ( w, h, 0 );
+		SDL_Surface* reference = surface ( w, h, 0 );
+		SDL_Surface* target = surface ( w, h, 0 );
+		noise ( bg );
+		
+		vector< SDL_Rect > at;
+		for ( int k = 0; k < SPRITES; k++ )
+		{
+			SDL_Rect r;
+			r.x = rand () % ( w - side + 1 );
+			r.y = rand () % ( h - side + 1 );
+			r.w = side;
+			r.h = side;
+			at.push_back ( r );
+		}
+		
+		printf ( "best kernel for this CPU: %s\n", AlphaBlit::name ( AlphaBlit::kernel () ) );
+		printf ( "%d sprites of %dx%d over %dx%d\n", SPRITES, side, side, w, h );
+		printf ( "shape\tkernel\tstraight_mpx_s\tpremult_mpx_s\tvs_scalar\tvs_sdl\tpremult_vs_exact\n" );
+		
+		for ( int shape = OPAQUE; shape <= TRANSLUCENT; shape++ )
+		{
+			SDL_Surface* src = sprite ( side, Shape ( shape ) );
+			SDL_Surface* premultiplied = surface ( side, side, 0xFF000000 );
+			copy ( src, premultiplied );
+			AlphaBlit::premultiply ( premultiplied );
+			
+			SDL_Surface* exact = surface ( w, h, 0 );
+			copy ( bg, exact );
+			over ( premultiplied, exact, at );
+			
+			// what SDL draws, which every kernel must draw too
+			SDL_Surface* sdl = surface ( w, h, 0 );
+			copy ( bg, sdl );
+			for ( unsigned int k = 0; k < at.size (); k++ )
+			{
+				SDL_Rect r = at[k];
+				SDL_BlitSurface ( src, NULL, sdl, &r );
+			}
+			
+			AlphaBlit::use ( AlphaBlit::SCALAR );
+			copy ( bg, reference );
+			blend ( src, reference, at, false );
+			
+			for ( int k = AlphaBlit::SCALAR; k < AlphaBlit::KERNELS; k++ )
+			{
+				AlphaBlit::Kernel kernel = AlphaBlit::Kernel ( k );
+				if ( !AlphaBlit::use ( kernel ) )
+				{
+					printf ( "%s\t%s\tunsupported\n", shapes[ shape ], AlphaBlit::name ( kernel ) );
+					continue;
+				}
+				
+				copy ( bg, target );
+				blend ( src, target, at, false );
+				
+				int differ;
+				bool same = ( compare ( target, reference, differ ) == 0 );
+				int sdl_diff = compare ( target, sdl, differ );
+				
+				char versus[64];
+				if ( sdl_diff )
+					sprintf ( versus, "%d px DIFFERENT by up to %d", differ, sdl_diff );
+				else
+					sprintf ( versus, "identical" );
+				
+				copy ( bg, target );
+				blend ( premultiplied, target, at, true );
+				
+				int exact_diff = compare ( target, exact, differ );
+				
+				char versus_exact[64];
+				if ( exact_diff )
+					sprintf ( versus_exact, "%d px DIFFERENT by up to %d", differ, exact_diff );
+				else
+					sprintf ( versus_exact, "identical" );
+				
+				wrong = ( ( wrong ) || ( !same ) || ( sdl_diff ) || ( exact_diff ) );
+				
+				double t = now ();
+				for ( int p = 0; p < passes; p++ )
+					blend ( src, target, at, false );
+				double straight = now () - t;
+				
+				t = now ();
+				for ( int p = 0; p < passes; p++ )
+					blend ( premultiplied, target, at, true );
+				double premult = now () - t;
+				
+				double mpx = double ( side ) * side * SPRITES * passes / 1000000;
+				
+				printf (
+					"%s\t%s\t%.1f\t%.1f\t%s\t%s\t%s\n",
+					shapes[ shape ],
+					AlphaBlit::name ( kernel ),
+					mpx / straight,
+					mpx / premult,
+					same ? "identical" : "DIFFERENT",
+					versus,
+					versus_exact
+				);
+			}
+			
+			// and SDL by itself, for scale
+			double t = now ();
+			for ( int p = 0; p < passes; p++ )
+			{
+				for ( unsigned int k = 0; k < at.size (); k++ )
+				{
+					SDL_Rect r = at[k];
+					SDL_BlitSurface ( src, NULL, sdl, &r );
+				}
+			}
+			printf (
+				"%s\tSDL\t%.1f\t-\t-\t-\t-\n",
+				shapes[ shape ],
+				double ( side ) * side * SPRITES * passes / 1000000 / ( now () - t )
+			);
+			
+			SDL_FreeSurface ( exact );
+			SDL_FreeSurface ( sdl );
+			SDL_FreeSurface ( premultiplied );
+			SDL_FreeSurface ( src );
+		}
+		
+		SDL_FreeSurface ( target );
+		SDL_FreeSurface ( reference );
+		SDL_FreeSurface ( bg );
+	}
+	catch (mexception& e) {
+		fprintf ( stderr, "alphabench: %s\n", e.what () );
+		return 1;
+	}
+	
+	return ( wrong ? 1 : 0 );
+}
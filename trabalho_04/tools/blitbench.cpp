@@ -0,0 +1,229 @@
+/// @file blitbench.cpp
+/// @brief Blit cost of the game's images, before and after the opacity
+/// classification
+/// @author Matheus Pimenta
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <sys/time.h>
+
+#include "SDL_image.h"
+
+#include "SDLBase.hpp"
+
+#include "simplestructures.hpp"
+
+using std::string;
+using std::vector;
+
+struct Asset
+{
+	const char* filename;
+	
+	// tile size, or zero for the whole image
+	int tile_w, tile_h;
+};
+
+static const Asset assets[] = {
+	{ "./img/Tileset.png", 75, 75 },
+	{ "./img/bg.png", 0, 0 },
+	{ "./img/NaveSheet.png", 94, 100 },
+	{ "./img/BoomSheet.png", 95, 100 },
+	{ "./img/earth.png", 0, 0 },
+	{ "./img/redplanet.png", 0, 0 },
+	{ "./img/moon.png", 0, 0 },
+	{ "./img/ufo.png", 0, 0 }
+};
+
+static double now ()
+{
+	timeval tv;
+	gettimeofday ( &tv, NULL );
+	return ( tv.tv_sec + tv.tv_usec / 1000000.0 );
+}
+
+// what is blitted for each tile: the surface and its piece
+struct Piece
+{
+	SDL_Surface* src;
+	SDL_Rect rect;
+};
+
+// milliseconds to blit every piece once, averaged over some passes
+static double cost (const vector< Piece >& pieces, int passes)
+{
+	SDL_Surface* screen = SDLBase::screen ();
+	
+	double t = now ();
+	for ( int i = 0; i < passes; i++ )
+	{
+		for ( unsigned int j = 0; j < pieces.size (); j++ )
+		{
+			SDL_Rect srcrect = pieces[j].rect;
+			SDL_Rect dstrect;
+			dstrect.x = ( i * 37 + j * 53 ) % ( screen->w - srcrect.w + 1 );
+			dstrect.y = ( i * 29 + j * 41 ) % ( screen->h - srcrect.h + 1 );
+			
+			SDL_BlitSurface ( pieces[j].src, &srcrect, screen, &dstrect );
+		}
+	}
+	
+	return ( ( now () - t ) * 1000 / passes );
+}
+
+static vector< SDL_Rect > split (SDL_Surface* src, int tile_w, int tile_h)
+{
+	vector< SDL_Rect > rects;
+	
+	if ( ( !tile_w ) || ( !tile_h ) )
+	{
+		tile_w = src->w;
+		tile_h = src->h;
+	}
+	
+	for ( int y = 0; y + tile_h <= src->h; y += tile_h )
+	{
+		for ( int x = 0; x + tile_w <= src->w; x += tile_w )
+		{
+			SDL_Rect rect;
+			rect.x = x;
+			rect.y = y;
+			rect.w = tile_w;
+			rect.h = tile_h;
+			rects.push_back ( rect );
+		}
+	}
+	
+	return rects;
+}
+
+static void bench (const Asset& asset, int passes)
+{
+	SDL_Surface* tmp = IMG_Load ( asset.filename );
+	if ( !tmp )
+		throw ( mexception ( string ( "IMG_Load error: " ) + asset.filename ) );
+	
+	// the old loadIMG
+	SDL_Surface* before = ( tmp->format->Amask ) ?
+		SDL_DisplayFormatAlpha ( tmp ) : SDL_DisplayFormat ( tmp );
+	
+	SDLBase::Opacity opacity = SDLBase::classify ( tmp );
+	SDL_Surface* after = SDLBase::displayFormat ( tmp, opacity );
+	
+	vector< SDL_Rect > rects = split ( tmp, asset.tile_w, asset.tile_h );
+	
+	// copies of the sheet for the tiles cheaper than the whole, like TileSet
+	SDL_Surface* copies[4] = { NULL, NULL, NULL, NULL };
+	int tiles[4] = { 0, 0, 0, 0 };
+	
+	vector< Piece > old_pieces, new_pieces;
+	
+	for ( unsigned int i = 0; i < rects.size (); i++ )
+	{
+		SDLBase::Opacity tile = SDLBase::classify ( tmp, &rects[i] );
+		tiles[tile]++;
+		
+		Piece piece;
+		piece.rect = rects[i];
+		
+		piece.src = before;
+		old_pieces.push_back ( piece );
+		
+		if ( tile == SDLBase::EMPTY )
+			continue;
+		
+		piece.src = after;
+		if ( ( tile < opacity ) && ( rects.size () > 1 ) )
+		{
+			if ( !copies[tile] )
+				copies[tile] = SDLBase::displayFormat ( tmp, tile );
+			piece.src = copies[tile];
+		}
+		new_pieces.push_back ( piece );
+	}
+	
+	double old_ms = cost ( old_pieces, passes );
+	double new_ms = cost ( new_pieces, passes );
+	
+	printf (
+		"%-24s %-12s %10.3f %10.3f",
+		asset.filename,
+		SDLBase::opacityName ( opacity ),
+		old_ms,
+		new_ms
+	);
+	
+	// the same surfaces, RLE accelerated as when the compositor is off
+	bool keyed = false;
+	for ( unsigned int i = 0; i < new_pieces.size (); i++ )
+	{
+		SDL_Surface* s = new_pieces[i].src;
+		if ( s->flags & SDL_SRCCOLORKEY )
+		{
+			if ( !( s->flags & SDL_RLEACCEL ) )
+				SDL_SetColorKey ( s, SDL_SRCCOLORKEY | SDL_RLEACCEL, s->format->colorkey );
+			keyed = true;
+		}
+	}
+	if ( keyed )
+		printf ( " %10.3f", cost ( new_pieces, passes ) );
+	else
+		printf ( " %10s", "-" );
+	
+	if ( rects.size () > 1 )
+	{
+		printf (
+			"   tiles %d empty, %d opaque, %d binary, %d translucent",
+			tiles[ SDLBase::EMPTY ],
+			tiles[ SDLBase::OPAQUE ],
+			tiles[ SDLBase::BINARY ],
+			tiles[ SDLBase::TRANSLUCENT ]
+		);
+	}
+	printf ( "\n" );
+	
+	for ( int i = 0; i < 4; i++ )
+	{
+		if ( copies[i] )
+			SDL_FreeSurface ( copies[i] );
+	}
+	SDL_FreeSurface ( after );
+	SDL_FreeSurface ( before );
+	SDL_FreeSurface ( tmp );
+}
+
+int main (int argc, char* argv[])
+{
+	string conf = ( argc > 1 ) ? argv[1] : "conf/SDL.conf";
+	int passes = ( argc > 2 ) ? atoi ( argv[2] ) : 200;
+	
+	if ( passes < 1 )
+		passes = 1;
+	
+	// no window and no sound card needed
+	putenv ( (char*) "SDL_VIDEODRIVER=dummy" );
+	putenv ( (char*) "SDL_AUDIODRIVER=dummy" );
+	
+	try {
+		SDLBase::initSDL ( conf );
+		
+		printf (
+			"%-24s %-12s %10s %10s %10s   (ms per pass over the tiles)\n",
+			"image", "opacity", "before", "after", "after+rle"
+		);
+		
+		for ( unsigned int i = 0; i < sizeof ( assets ) / sizeof ( assets[0] ); i++ )
+			bench ( assets[i], passes );
+		
+		SDLBase::closeSDL ();
+	}
+	catch (mexception& e) {
+		fprintf ( stderr, "blitbench: %s\n", e.what () );
+		return 1;
+	}
+	
+	return 0;
+}
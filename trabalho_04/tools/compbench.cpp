@@ -0,0 +1,276 @@
+/// @file compbench.cpp
+/// @brief Scaling benchmark of the parallel compositor, and its output
+/// against SDL_BlitSurface
+/// @author Matheus Pimenta
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "SDL.h"
+
+#include "Compositor.hpp"
+#include "JobSystem.hpp"
+
+#include "simplestructures.hpp"
+
+using std::vector;
+
+static double now ()
+{
+	timeval tv;
+	gettimeofday ( &tv, NULL );
+	return ( tv.tv_sec + tv.tv_usec / 1000000.0 );
+}
+
+static SDL_Surface* surface (int w, int h, Uint32 rmask, Uint32 gmask, Uint32 bmask, Uint32 amask)
+{
+	SDL_Surface* s = SDL_CreateRGBSurface ( SDL_SWSURFACE, w, h, 32, rmask, gmask, bmask, amask );
+	if ( !s )
+		throw ( mexception ( "SDL_CreateRGBSurface error" ) );
+	
+	for ( int y = 0; y < h; y++ )
+	{
+		Uint32* row = (Uint32*) ( (Uint8*) s->pixels + y * s->pitch );
+		for ( int x = 0; x < w; x++ )
+			row[x] = ( Uint32 ( rand () ) << 16 ) ^ Uint32 ( rand () );
+	}
+	
+	return s;
+}
+
+// what a frame of the game looks like: a background, sprites with per pixel
+// alpha, sprites with color keys, rotated sprites in another pixel format
+// and the pixels of the dotted lines
+struct Scene
+{
+	SDL_Surface* bg;
+	vector< SDL_Surface* > sprites;
+	vector< SDL_Rect > positions;
+	vector< SDL_Rect > pixels;
+	
+	Scene (int w, int h)
+	{
+		bg = surface ( w, h, 0xFF0000, 0xFF00, 0xFF, 0 );
+		
+		for ( int i = 0; i < 300; i++ )
+		{
+			SDL_Surface* s;
+			
+			if ( i % 6 == 0 )
+			{
+				s = surface ( 48, 48, 0xFF0000, 0xFF00, 0xFF, 0 );
+				SDL_SetColorKey ( s, SDL_SRCCOLORKEY, ( (Uint32*) s->pixels )[0] );
+			}
+			else if ( i % 6 == 1 )
+			{
+				s = surface ( 80, 80, 0xFF, 0xFF00, 0xFF0000, 0xFF000000 );
+				SDL_SetAlpha ( s, SDL_SRCALPHA, SDL_ALPHA_OPAQUE );
+			}
+			else
+			{
+				s = surface ( 64, 64, 0xFF0000, 0xFF00, 0xFF, 0xFF000000 );
+				SDL_SetAlpha ( s, SDL_SRCALPHA, SDL_ALPHA_OPAQUE );
+			}
+			sprites.push_back ( s );
+			
+			// some of them only partially on the screen
+			SDL_Rect r;
+			r.x = rand () % ( w + 64 ) - 32;
+			r.y = rand () % ( h + 64 ) - 32;
+			r.w = 0;
+			r.h = 0;
+			positions.push_back ( r );
+		}
+		
+		for ( int i = 0; i < 3000; i++ )
+		{
+			SDL_Rect r;
+			r.x = rand () % w;
+			r.y = rand () % h;
+			r.w = 1;
+			r.h = 1;
+			pixels.push_back ( r );
+		}
+	}
+	
+	~Scene ()
+	{
+		SDL_FreeSurface ( bg );
+		for ( unsigned int i = 0; i < sprites.size (); i++ )
+			SDL_FreeSurface ( sprites[i] );
+	}
+	
+	void record (Compositor& compositor)
+	{
+		compositor.blit ( bg, NULL, NULL );
+		
+		for ( unsigned int i = 0; i < sprites.size (); i++ )
+		{
+			SDL_Rect r = positions[i];
+			compositor.blit ( sprites[i], NULL, &r );
+		}
+		
+		for ( unsigned int i = 0; i < pixels.size (); i++ )
+		{
+			SDL_Rect r = pixels[i];
+			compositor.fill ( &r, 0xFFFFFF );
+		}
+	}
+	
+	/// @brief Draws the scene with SDL itself, as the game does with
+	/// compositor = 0.
+	void draw (SDL_Surface* target)
+	{
+		SDL_BlitSurface ( bg, NULL, target, NULL );
+		
+		for ( unsigned int i = 0; i < sprites.size (); i++ )
+		{
+			SDL_Rect r = positions[i];
+			SDL_BlitSurface ( sprites[i], NULL, target, &r );
+		}
+		
+		for ( unsigned int i = 0; i < pixels.size (); i++ )
+		{
+			SDL_Rect r = pixels[i];
+			SDL_FillRect ( target, &r, 0xFFFFFF );
+		}
+	}
+};
+
+/// @return Number of pixels whose color differs; the top byte of the
+/// target is padding, which each SDL blitter leaves in its own way.
+static int differ (SDL_Surface* a, SDL_Surface* b)
+{
+	Uint32 rgb = a->format->Rmask | a->format->Gmask | a->format->Bmask;
+	int n = 0;
+	
+	for ( int y = 0; y < a->h; y++ )
+	{
+		const Uint32* pa = (const Uint32*) ( (Uint8*) a->pixels + y * a->pitch );
+		const Uint32* pb = (const Uint32*) ( (Uint8*) b->pixels + y * b->pitch );
+		
+		for ( int x = 0; x < a->w; x++ )
+		{
+			if ( ( pa[x] ^ pb[x] ) & rgb )
+				n++;
+		}
+	}
+	
+	return n;
+}
+
+static void output (char* buf, int n)
+{
+	if ( n )
+		sprintf ( buf, "%d px DIFFERENT", n );
+	else
+		sprintf ( buf, "identical" );
+}
+
+/// @return Whether every output matched SDL.
+static bool bench (int w, int h, int maxthreads, int frames)
+{
+	Scene scene ( w, h );
+	
+	SDL_Surface* reference = surface ( w, h, 0xFF0000, 0xFF00, 0xFF, 0 );
+	SDL_Surface* target = surface ( w, h, 0xFF0000, 0xFF00, 0xFF, 0 );
+	
+	// what SDL draws is what every run of the compositor must draw
+	scene.draw ( reference );
+	
+	int wrong = 0;
+	char buf[64];
+	
+	// serial rendering, the base of the speedups
+	Compositor serial ( target );
+	scene.record ( serial );
+	unsigned int commands = serial.size ();
+	double t = now ();
+	serial.flush ( false );
+	double base = now () - t;
+	for ( int i = 1; i < frames; i++ )
+	{
+		scene.record ( serial );
+		t = now ();
+		serial.flush ( false );
+		base += now () - t;
+	}
+	base /= frames;
+	
+	int n = differ ( reference, target );
+	wrong += n;
+	output ( buf, n );
+	
+	Compositor compositor ( target );
+	
+	printf ( "%dx%d, %u commands, %d bands\n", w, h, commands, compositor.bands () );
+	printf ( "%-8s %10s %8s   %s\n", "threads", "ms/frame", "speedup", "vs_sdl" );
+	printf ( "%-8s %10.3f %8.2f   %s\n", "serial", base * 1000, 1.0, buf );
+	
+	for ( int threads = 1; threads <= maxthreads; threads++ )
+	{
+		JobSystem::init ( threads - 1 );
+		
+		double elapsed = 0;
+		for ( int i = 0; i < frames; i++ )
+		{
+			scene.record ( compositor );
+			t = now ();
+			compositor.flush ();
+			elapsed += now () - t;
+		}
+		elapsed /= frames;
+		
+		JobSystem::close ();
+		
+		n = differ ( reference, target );
+		wrong += n;
+		output ( buf, n );
+		
+		printf (
+			"%-8d %10.3f %8.2f   %s\n",
+			threads,
+			elapsed * 1000,
+			base / elapsed,
+			buf
+		);
+	}
+	printf ( "\n" );
+	
+	SDL_FreeSurface ( target );
+	SDL_FreeSurface ( reference );
+	
+	return ( !wrong );
+}
+
+int main (int argc, char* argv[])
+{
+	int maxthreads = ( argc > 1 ) ? atoi ( argv[1] ) : 0;
+	int frames = ( argc > 2 ) ? atoi ( argv[2] ) : 50;
+	
+	if ( maxthreads < 1 )
+		maxthreads = sysconf ( _SC_NPROCESSORS_ONLN );
+	if ( maxthreads < 1 )
+		maxthreads = 1;
+	if ( frames < 1 )
+		frames = 1;
+	
+	srand ( 1 );
+	
+	bool right;
+	
+	try {
+		right = bench ( 800, 600, maxthreads, frames );
+		right = ( bench ( 1920, 1080, maxthreads, frames ) && ( right ) );
+	}
+	catch (mexception& e) {
+		fprintf ( stderr, "compbench: %s\n", e.what () );
+		return 1;
+	}
+	
+	return ( right ? 0 : 1 );
+}
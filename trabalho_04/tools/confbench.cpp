@@ -0,0 +1,105 @@
+/// @ingroup MOD_CONFIGFILE
+/// @file confbench.cpp
+/// @brief Benchmark of copies of nested configurations
+/// @author Matheus Pimenta
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sys/time.h>
+
+#include "configfile.hpp"
+
+#include "simplestructures.hpp"
+
+using std::string;
+
+static double now ()
+{
+	timeval tv;
+	gettimeofday ( &tv, NULL );
+	return ( tv.tv_sec + tv.tv_usec / 1000000.0 );
+}
+
+static void report (const char* what, double t, unsigned long int copied)
+{
+	printf ( "%-24s %10.6f s %12lu bytes copied\n", what, now () - t,
+		Configuration::copiedBytes () - copied );
+}
+
+// "depth" levels nested in blocks named "sub", each with "entries / depth"
+// variables
+static void generate (const string& filename, int depth, int entries)
+{
+	std::fstream f ( filename.c_str (), std::fstream::out | std::fstream::trunc );
+	
+	for ( int level = 0; level < depth; level++ )
+	{
+		for ( int i = 0; i < entries / depth; i++ )
+			f << "var_" << i << " = " << i << "\n";
+		if ( level < depth - 1 )
+			f << "sub\n{\n";
+	}
+	for ( int level = 1; level < depth; level++ )
+		f << "}\n";
+}
+
+int main (int argc, char* argv[])
+{
+	int depth = ( argc > 1 ) ? atoi ( argv[1] ) : 10;
+	int entries = ( argc > 2 ) ? atoi ( argv[2] ) : 100000;
+	string filename = ( argc > 3 ) ? argv[3] : "confbench.conf";
+	
+	generate ( filename, depth, entries );
+	printf ( "depth %d, %d entries\n", depth, entries );
+	
+	try {
+		Configuration conf;
+		
+		double t = now ();
+		unsigned long int copied = Configuration::copiedBytes ();
+		conf.readTxt ( filename );
+		report ( "readTxt", t, copied );
+		
+		// copies of every level down to the deepest one
+		t = now ();
+		copied = Configuration::copiedBytes ();
+		Configuration cur = conf;
+		for ( int level = 1; level < depth; level++ )
+			cur = cur.getConfig ( "sub" );
+		report ( "getConfig chain", t, copied );
+		
+		// copy of the whole tree, then a change in its deepest level
+		t = now ();
+		copied = Configuration::copiedBytes ();
+		Configuration tree = conf;
+		std::vector< Configuration > path ( 1, tree );
+		for ( int level = 1; level < depth; level++ )
+			path.push_back ( path.back ().getConfig ( "sub" ) );
+		path.back ().setInt ( "var_0", -1 );
+		for ( int level = depth - 1; level > 0; level-- )
+			path[level - 1].setConfig ( "sub", path[level] );
+		tree = path[0];
+		report ( "deep modification", t, copied );
+		
+		t = now ();
+		copied = Configuration::copiedBytes ();
+		Configuration other = conf;
+		other.insertInt ( "extra", 0 );
+		report ( "copy and insert at top", t, copied );
+	}
+	catch (Configuration::FileNotFound& e) {
+		fprintf ( stderr, "confbench: file not found\n" );
+		return 1;
+	}
+	catch (mexception& e) {
+		fprintf ( stderr, "confbench: %s\n", e.what () );
+		return 1;
+	}
+	
+	remove ( filename.c_str () );
+	return 0;
+}
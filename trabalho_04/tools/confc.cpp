@@ -0,0 +1,78 @@
+/// @ingroup MOD_CONFIGFILE
+/// @file confc.cpp
+/// @brief Converter from text configuration files to the binary layout
+/// @author Matheus Pimenta
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <sys/time.h>
+
+#include "configview.hpp"
+
+#include "simplestructures.hpp"
+
+using std::string;
+
+static double now ()
+{
+	timeval tv;
+	gettimeofday ( &tv, NULL );
+	return ( tv.tv_sec + tv.tv_usec / 1000000.0 );
+}
+
+// times opening the file plus the first lookup of a variable, both from the
+// text file (parsing everything) and from the converted binary file
+static void bench (const string& txtfile, const string& binfile, const string& name, int times)
+{
+	double t = now ();
+	for ( int i = 0; i < times; i++ )
+	{
+		Configuration conf;
+		conf.readTxt ( txtfile );
+		conf.getStr ( name );
+	}
+	double txt = ( now () - t ) / times;
+	
+	t = now ();
+	for ( int i = 0; i < times; i++ )
+	{
+		ConfigView view ( binfile );
+		view.getCStr ( name );
+	}
+	double bin = ( now () - t ) / times;
+	
+	printf ( "%s: text %.6f s, binary %.6f s (%d runs)\n", name.c_str (), txt, bin, times );
+}
+
+int main (int argc, char* argv[])
+{
+	if ( ( argc == 3 ) || ( ( argc >= 5 ) && !strcmp ( argv[1], "-bench" ) ) )
+	{
+		try {
+			if ( argc == 3 )
+				ConfigView::convert ( argv[1], argv[2] );
+			else
+				bench ( argv[2], argv[3], argv[4], ( argc > 5 ) ? atoi ( argv[5] ) : 1 );
+		}
+		catch (Configuration::FileNotFound&) {
+			fprintf ( stderr, "confc: file not found\n" );
+			return 1;
+		}
+		catch (Configuration::VarNotFound&) {
+			fprintf ( stderr, "confc: variable not found\n" );
+			return 1;
+		}
+		catch (mexception& e) {
+			fprintf ( stderr, "confc: %s\n", e.what () );
+			return 1;
+		}
+		return 0;
+	}
+	
+	fprintf ( stderr, "usage: confc <text file> <binary file>\n" );
+	fprintf ( stderr, "       confc -bench <text file> <binary file> <var> [runs]\n" );
+	return 1;
+}
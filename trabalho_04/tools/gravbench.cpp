@@ -0,0 +1,185 @@
+/// @file gravbench.cpp
+/// @brief Throughput and accuracy of the Barnes-Hut gravity against the
+/// exact all-pairs sum
+/// @author Matheus Pimenta
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <sys/time.h>
+
+#include "Gravity.hpp"
+#include "JobSystem.hpp"
+
+using std::vector;
+
+// bodies whose exact pull is summed to measure the error
+#define SAMPLE	1000
+
+// above this, the all-pairs time is extrapolated from the sample
+#define BRUTE_MAX	20000
+
+static double now ()
+{
+	timeval tv;
+	gettimeofday ( &tv, NULL );
+	return ( tv.tv_sec + tv.tv_usec / 1000000.0 );
+}
+
+static float uniform ()
+{
+	return ( float ( rand () ) / float ( RAND_MAX ) );
+}
+
+/// @param gravity Solver to be filled.
+/// @param n Number of bodies.
+/// @brief Clusters of bodies around a few centers, denser in the middle,
+/// over a square as wide as the game's world
+static void spawn (Gravity& gravity, int n)
+{
+	const int clusters = 8;
+	float cx[ clusters ], cy[ clusters ];
+	
+	for ( int k = 0; k < clusters; k++ )
+	{
+		cx[k] = uniform () * 4000;
+		cy[k] = uniform () * 4000;
+	}
+	
+	gravity.clear ();
+	for ( int i = 0; i < n; i++ )
+	{
+		int k = rand () % clusters;
+		float angle = uniform () * 6.2831853f;
+		float radius = 600 * uniform () * uniform ();
+		
+		gravity.add (
+			cx[k] + radius * cos ( angle ),
+			cy[k] + radius * sin ( angle ),
+			1 + 9 * uniform ()
+		);
+	}
+}
+
+/// @brief Runs every mode on n bodies and prints one row per opening angle
+static void bench (int n, const vector< float >& thetas, int rounds)
+{
+	Gravity gravity ( 0.5f, 1000, 10 );
+	spawn ( gravity, n );
+	
+	int sample = ( n < SAMPLE ) ? n : SAMPLE;
+	
+	// the exact pulls of the sample, which the tree is measured against
+	gravity.build ();
+	double t = now ();
+	gravity.brute ( 0, sample );
+	double brute_ms = ( now () - t ) * 1000 * n / sample;
+	bool estimated = true;
+	
+	vector< float > ex ( sample ), ey ( sample );
+	for ( int i = 0; i < sample; i++ )
+	{
+		ex[i] = gravity.accelX ( i );
+		ey[i] = gravity.accelY ( i );
+	}
+	
+	if ( n <= BRUTE_MAX )
+	{
+		t = now ();
+		gravity.brute ( false );
+		brute_ms = ( now () - t ) * 1000;
+		estimated = false;
+	}
+	
+	for ( unsigned int k = 0; k < thetas.size (); k++ )
+	{
+		gravity.setTheta ( thetas[k] );
+		
+		t = now ();
+		for ( int r = 0; r < rounds; r++ )
+			gravity.build ();
+		double build_ms = ( now () - t ) * 1000 / rounds;
+		
+		gravity.resetStats ();
+		t = now ();
+		for ( int r = 0; r < rounds; r++ )
+			gravity.solve ( false );
+		double serial_ms = ( now () - t ) * 1000 / rounds;
+		double pulls = double ( gravity.stats ().interactions ) / rounds / n;
+		
+		t = now ();
+		for ( int r = 0; r < rounds; r++ )
+			gravity.solve ( true );
+		double parallel_ms = ( now () - t ) * 1000 / rounds;
+		
+		// relative error of the pull of each body of the sample
+		double sum = 0, worst = 0;
+		for ( int i = 0; i < sample; i++ )
+		{
+			double dx = gravity.accelX ( i ) - ex[i];
+			double dy = gravity.accelY ( i ) - ey[i];
+			double norm = ex[i] * ex[i] + ey[i] * ey[i];
+			double err = ( norm > 0 ) ? sqrt ( ( dx * dx + dy * dy ) / norm ) : 0;
+			
+			sum += err * err;
+			if ( err > worst )
+				worst = err;
+		}
+		
+		printf (
+			"%7d\t%.2f\t%d\t%u\t%.1f\t%.3f\t%.3f\t%.3f\t%.3f%s\t%.1f\t%.2e\t%.2e\n",
+			n,
+			thetas[k],
+			gravity.stats ().depth,
+			gravity.stats ().nodes,
+			pulls,
+			build_ms,
+			serial_ms,
+			parallel_ms,
+			brute_ms,
+			estimated ? "*" : "",
+			brute_ms / ( build_ms + serial_ms ),
+			sqrt ( sum / sample ),
+			worst
+		);
+		fflush ( stdout );
+	}
+}
+
+int main (int argc, char* argv[])
+{
+	int maximum = ( argc > 1 ) ? atoi ( argv[1] ) : 100000;
+	int rounds = ( argc > 2 ) ? atoi ( argv[2] ) : 5;
+	
+	if ( rounds < 1 )
+		rounds = 1;
+	
+	vector< float > thetas;
+	if ( argc > 3 )
+	{
+		for ( int i = 3; i < argc; i++ )
+			thetas.push_back ( atof ( argv[i] ) );
+	}
+	else
+	{
+		thetas.push_back ( 0.3f );
+		thetas.push_back ( 0.5f );
+		thetas.push_back ( 0.8f );
+	}
+	
+	srand ( 1 );
+	JobSystem::init ();
+	
+	printf ( "%d workers, brute force on one thread, * extrapolated from %d bodies\n",
+		JobSystem::size (), SAMPLE );
+	printf ( "bodies\ttheta\tdepth\tnodes\tpulls\tbuild_ms\ttree_ms\ttree_mt_ms\tbrute_ms\tspeedup\trms_err\tmax_err\n" );
+	
+	for ( int n = 1000; n <= maximum; n *= 10 )
+		bench ( n, thetas, rounds );
+	
+	JobSystem::close ();
+	
+	return 0;
+}
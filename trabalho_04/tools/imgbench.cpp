@@ -0,0 +1,137 @@
+/// @file imgbench.cpp
+/// @brief Time to load the game's images at startup, with the image cache
+/// cold and warm
+/// @author Matheus Pimenta
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <sys/time.h>
+
+#include "SDLBase.hpp"
+#include "ImageCache.hpp"
+#include "JobSystem.hpp"
+
+#include "simplestructures.hpp"
+
+using std::string;
+using std::vector;
+
+static const char* assets[] = {
+	"./img/stateMenu.jpg",
+	"./img/stateWin.jpg",
+	"./img/stateLose.jpg",
+	"./img/bg.png",
+	"./img/Tileset.png",
+	"./img/BoomSheet.png",
+	"./img/NaveSheet.png",
+	"./img/NaveTurnSheet.png"
+};
+
+static double now ()
+{
+	timeval tv;
+	gettimeofday ( &tv, NULL );
+	return ( tv.tv_sec + tv.tv_usec / 1000000.0 );
+}
+
+/// @param dir Directory of the cache, or empty for none.
+/// @param prefetch Whether the images are decoded in parallel first.
+/// @param cold Whether the cache is emptied before each round.
+/// @return Milliseconds to load every asset, averaged over the rounds.
+/// @brief Loads the assets as a state would
+static double run (const string& dir, bool prefetch, bool cold, int rounds)
+{
+	vector< string > filenames (
+		assets, assets + sizeof ( assets ) / sizeof ( assets[0] )
+	);
+	
+	double elapsed = 0;
+	
+	for ( int i = 0; i < rounds; i++ )
+	{
+		ImageCache::close ();
+		ImageCache::init ( dir );
+		if ( cold )
+			ImageCache::clear ();
+		ImageCache::resetStats ();
+		
+		vector< SDL_Surface* > surfaces;
+		
+		double t = now ();
+		if ( prefetch )
+			ImageCache::prefetch ( filenames );
+		for ( unsigned int j = 0; j < filenames.size (); j++ )
+			surfaces.push_back ( SDLBase::loadIMG ( filenames[j] ) );
+		elapsed += now () - t;
+		
+		for ( unsigned int j = 0; j < surfaces.size (); j++ )
+			SDL_FreeSurface ( surfaces[j] );
+		SDLBase::clearImages ();
+	}
+	
+	return ( elapsed * 1000 / rounds );
+}
+
+static void report (const char* name, double ms)
+{
+	const ImageCache::Stats& stats = ImageCache::stats ();
+	
+	printf (
+		"%-10s %10.3f ms   %u hits, %u misses, %u decoded in parallel, %u written\n",
+		name,
+		ms,
+		stats.hits,
+		stats.misses,
+		stats.prefetched,
+		stats.written
+	);
+}
+
+int main (int argc, char* argv[])
+{
+	string conf = ( argc > 1 ) ? argv[1] : "conf/SDL.conf";
+	string dir = ( argc > 2 ) ? argv[2] : "./cache";
+	int rounds = ( argc > 3 ) ? atoi ( argv[3] ) : 10;
+	
+	if ( rounds < 1 )
+		rounds = 1;
+	
+	// no window and no sound card needed
+	putenv ( (char*) "SDL_VIDEODRIVER=dummy" );
+	putenv ( (char*) "SDL_AUDIODRIVER=dummy" );
+	
+	try {
+		JobSystem::init ();
+		SDLBase::initSDL ( conf );
+		
+		printf ( "%d images, %d workers\n",
+			int ( sizeof ( assets ) / sizeof ( assets[0] ) ), JobSystem::size () );
+		
+		// the old startup: each image decoded and converted in turn
+		double ms = run ( "", false, false, rounds );
+		report ( "decode", ms );
+		
+		ms = run ( "", true, false, rounds );
+		report ( "parallel", ms );
+		
+		// decoded in parallel and written to the cache
+		ms = run ( dir, true, true, rounds );
+		report ( "cold", ms );
+		
+		// every image mapped from its blob
+		ms = run ( dir, true, false, rounds );
+		report ( "warm", ms );
+		
+		SDLBase::closeSDL ();
+		JobSystem::close ();
+	}
+	catch (mexception& e) {
+		fprintf ( stderr, "imgbench: %s\n", e.what () );
+		return 1;
+	}
+	
+	return 0;
+}
@@ -0,0 +1,73 @@
+/// @file mapc.cpp
+/// @brief Converter from text tile maps to chunked ones, which are streamed
+/// instead of read at once
+/// @author Matheus Pimenta
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "TileMap.hpp"
+#include "ChunkStream.hpp"
+
+#include "simplestructures.hpp"
+
+// tiles of img/Tileset.png, which the random maps are made of
+#define TILES	36
+
+int main (int argc, char* argv[])
+{
+	bool random = ( ( argc >= 6 ) && !strcmp ( argv[1], "-random" ) );
+	
+	if ( ( argc != 3 ) && ( argc != 4 ) && ( !random ) )
+	{
+		fprintf ( stderr, "usage: mapc <text map> <chunked map> [side]\n" );
+		fprintf ( stderr, "       mapc -random <w> <h> <layers> <chunked map> [side] [density]\n" );
+		return 1;
+	}
+	
+	try {
+		if ( random )
+		{
+			int w = atoi ( argv[2] ), h = atoi ( argv[3] ), layers = atoi ( argv[4] );
+			int side = ( argc > 6 ) ? atoi ( argv[6] ) : 32;
+			int density = ( argc > 7 ) ? atoi ( argv[7] ) : 10;
+			
+			if ( ( w < 1 ) || ( h < 1 ) || ( layers < 1 ) )
+			{
+				fprintf ( stderr, "mapc: the map must have at least one tile\n" );
+				return 1;
+			}
+			
+			srand ( 1 );
+			
+			// sparse, as the real maps are, so the empty chunks are skipped
+			TileMap map ( NULL );
+			map.resize ( layers, w, h );
+			for ( int k = 0; k < layers; k++ )
+			{
+				for ( int i = 0; i < h; i++ )
+				{
+					for ( int j = 0; j < w; j++ )
+					{
+						if ( rand () % 100 < density )
+							map.at ( k, i, j ) = rand () % TILES;
+					}
+				}
+			}
+			
+			map.save ( argv[5], side );
+		}
+		else
+		{
+			TileMap map ( NULL, argv[1] );
+			map.save ( argv[2], ( argc > 3 ) ? atoi ( argv[3] ) : 32 );
+		}
+	}
+	catch (mexception& e) {
+		fprintf ( stderr, "mapc: %s\n", e.what () );
+		return 1;
+	}
+	
+	return 0;
+}
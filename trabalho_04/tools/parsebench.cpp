@@ -0,0 +1,202 @@
+/// @ingroup MOD_CONFIGFILE
+/// @file parsebench.cpp
+/// @brief Benchmark of the text configuration parser, scanning the file in
+/// memory against reading it a character at a time from the stream
+/// @author Matheus Pimenta
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <sys/time.h>
+
+#include "configfile.hpp"
+
+#include "simplestructures.hpp"
+
+using std::string;
+
+// variables in each block, and blocks nested inside each other
+#define BLOCK_VARS	64
+#define BLOCK_DEPTH	4
+
+static double now ()
+{
+	timeval tv;
+	gettimeofday ( &tv, NULL );
+	return ( tv.tv_sec + tv.tv_usec / 1000000.0 );
+}
+
+/// @param f Stream of the configuration file.
+/// @param i Number of the variable, which picks its kind.
+/// @param tab Indentation of the variable.
+/// @brief Writes one variable, with the syntax seen in the game's files
+static void variable (std::fstream& f, unsigned long int i, int tab)
+{
+	f << string ( tab, '\t' );
+	
+	switch ( i % 8 )
+	{
+		case 0:
+			f << "int_" << i << " = " << long ( rand () ) - RAND_MAX / 2 << "\n";
+			break;
+		
+		case 1:
+			f << "real_" << i << "\t=\t" << rand () / 1000.0 << "\n";
+			break;
+		
+		case 2:
+			f << "path_" << i << " = ./img/sprite_" << i << ".png # a comment\n";
+			break;
+		
+		case 3:
+			f << "text_" << i << " = some words with  blanks\tinside\n";
+			break;
+		
+		case 4:
+			f << "# a line of comment before the variable\n";
+			f << string ( tab, '\t' ) << "hash_" << i << " = v#" << i << "#\n";
+			break;
+		
+		case 5:
+			f << "crlf_" << i << " = " << i << "\r\n";
+			break;
+		
+		case 6:
+			f << "empty_" << i << " =\n";
+			break;
+		
+		default:
+			f << "char_" << i << " = " << char ( 'a' + i % 26 ) << "   \n";
+			break;
+	}
+}
+
+/// @param filename Name of the configuration file.
+/// @param size Size of the file, in bytes.
+/// @return Number of variables written.
+/// @brief Blocks of variables, nested a few levels deep, until "size" bytes
+static unsigned long int generate (const string& filename, unsigned long int size)
+{
+	std::fstream f (
+		filename.c_str (),
+		std::fstream::out | std::fstream::trunc | std::fstream::binary
+	);
+	
+	unsigned long int vars = 0;
+	
+	for ( unsigned long int block = 0; (unsigned long int) f.tellp () < size; block++ )
+	{
+		for ( int depth = 0; depth < BLOCK_DEPTH; depth++ )
+		{
+			for ( int i = 0; i < BLOCK_VARS / BLOCK_DEPTH; i++ )
+				variable ( f, vars++, depth );
+			
+			f << string ( depth, '\t' ) << "block_" << block << "_" << depth;
+			f << ( ( depth % 2 ) ? "\n" + string ( depth, '\t' ) + "{\n" : " {\n" );
+		}
+		for ( int depth = BLOCK_DEPTH - 1; depth >= 0; depth-- )
+		{
+			variable ( f, vars++, depth + 1 );
+			f << string ( depth, '\t' ) << "}\n";
+		}
+	}
+	
+	return vars;
+}
+
+/// @param filename Name of the configuration file.
+/// @param streamed Whether the stream parser is used.
+/// @param passes Number of times the file is parsed.
+/// @param dest Storage for the last configuration parsed.
+/// @return Fastest pass, in seconds.
+/// @brief Times the parser over the same file
+static double measure (
+	const string& filename,
+	bool streamed,
+	int passes,
+	Configuration& dest
+)
+{
+	double best = 0;
+	
+	Configuration::streamedParsing ( streamed );
+	for ( int pass = 0; pass < passes; pass++ )
+	{
+		Configuration conf;
+		
+		double t = now ();
+		conf.readTxt ( filename );
+		t = now () - t;
+		
+		if ( ( !pass ) || ( t < best ) )
+			best = t;
+		
+		dest = conf;
+	}
+	Configuration::streamedParsing ( false );
+	
+	return best;
+}
+
+/// @brief Reads a whole file
+static string slurp (const string& filename)
+{
+	std::ifstream f ( filename.c_str (), std::ifstream::binary );
+	std::stringstream ss;
+	ss << f.rdbuf ();
+	return ss.str ();
+}
+
+int main (int argc, char* argv[])
+{
+	int megabytes = ( argc > 1 ) ? atoi ( argv[1] ) : 50;
+	int passes = ( argc > 2 ) ? atoi ( argv[2] ) : 3;
+	string filename = ( argc > 3 ) ? argv[3] : "parsebench.conf";
+	
+	if ( megabytes < 1 )
+		megabytes = 1;
+	if ( passes < 1 )
+		passes = 1;
+	
+	srand ( 1 );
+	unsigned long int vars = generate ( filename, megabytes * 1024UL * 1024UL );
+	printf ( "%d MB, %lu variables, best of %d passes\n", megabytes, vars, passes );
+	printf ( "parser\tseconds\tMB_s\tspeedup\n" );
+	
+	int ret = 0;
+	
+	try {
+		Configuration buffered, streamed;
+		
+		double tstream = measure ( filename, true, passes, streamed );
+		printf ( "stream\t%.3f\t%.1f\t%.2f\n", tstream, megabytes / tstream, 1.0 );
+		
+		double tbuffer = measure ( filename, false, passes, buffered );
+		printf ( "buffer\t%.3f\t%.1f\t%.2f\n", tbuffer, megabytes / tbuffer, tstream / tbuffer );
+		
+		// both parsers must read the same variables
+		buffered.writeTxt ( filename + ".buffer" );
+		streamed.writeTxt ( filename + ".stream" );
+		if ( slurp ( filename + ".buffer" ) != slurp ( filename + ".stream" ) )
+		{
+			fprintf ( stderr, "parsebench: the parsers read different variables\n" );
+			ret = 1;
+		}
+		remove ( ( filename + ".buffer" ).c_str () );
+		remove ( ( filename + ".stream" ).c_str () );
+	}
+	catch (Configuration::FileNotFound& e) {
+		fprintf ( stderr, "parsebench: file not found\n" );
+		ret = 1;
+	}
+	catch (mexception& e) {
+		fprintf ( stderr, "parsebench: %s\n", e.what () );
+		ret = 1;
+	}
+	
+	remove ( filename.c_str () );
+	return ret;
+}
@@ -0,0 +1,96 @@
+/// @file partbench.cpp
+/// @brief Headless benchmark of the particle system
+/// @author Matheus Pimenta
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/time.h>
+
+#include "ParticleSystem.hpp"
+
+#include "simplestructures.hpp"
+
+using namespace lalge;
+
+#define FRAME_DT	( 1.0f / 60 )
+
+static double now ()
+{
+	timeval tv;
+	gettimeofday ( &tv, NULL );
+	return ( tv.tv_sec + tv.tv_usec / 1000000.0 );
+}
+
+int main (int argc, char* argv[])
+{
+	int target = ( argc > 1 ) ? atoi ( argv[1] ) : 50000;
+	int frames = ( argc > 2 ) ? atoi ( argv[2] ) : 600;
+	
+	if ( target < 1 )
+		target = 1;
+	if ( frames < 1 )
+		frames = 1;
+	
+	srand ( 1 );
+	
+	// sparks like the debris of the explosions, without a sheet
+	Emitter spark;
+	spark.name = "spark";
+	spark.rows = 1;
+	spark.cols = 8;
+	spark.count = 50;
+	spark.life = 1;
+	spark.lifevar = 0.25f;
+	spark.speed = 100;
+	spark.speedvar = 40;
+	spark.spread = 360;
+	spark.gravity = 50;
+	spark.sheet = NULL;
+	
+	// room for the particles that died but weren't dropped by the tail yet
+	ParticleSystem particles ( target + target / 2 );
+	int fx = particles.add ( spark );
+	
+	// bursts per frame that keep the target alive on average
+	float rate = target * FRAME_DT / ( spark.life * spark.count );
+	float pending = 0;
+	
+	// the first second fills the system
+	int warmup = int ( spark.life / FRAME_DT );
+	
+	double elapsed = 0, worst = 0;
+	long int alive = 0;
+	
+	for ( int i = 0; i < warmup + frames; i++ )
+	{
+		double t = now ();
+		
+		for ( pending += rate; pending >= 1; pending -= 1 )
+		{
+			particles.emit ( fx, r2vec (
+				rand () % 1920,
+				rand () % 1080
+			) );
+		}
+		particles.update ( FRAME_DT );
+		
+		t = now () - t;
+		
+		if ( i >= warmup )
+		{
+			elapsed += t;
+			if ( t > worst )
+				worst = t;
+			alive += particles.alive ();
+		}
+	}
+	
+	printf ( "%-12s %ld\n", "alive", alive / frames );
+	printf ( "%-12s %.3f ms\n", "frame", elapsed * 1000 / frames );
+	printf ( "%-12s %.3f ms\n", "worst", worst * 1000 );
+	printf ( "%-12s %.3f ms\n", "budget", FRAME_DT * 1000 );
+	printf ( "%-12s %u\n", "overwritten", particles.overwritten () );
+	
+	return 0;
+}
@@ -0,0 +1,132 @@
+/// @file pathbench.cpp
+/// @brief Path queries per second on large random maps
+/// @author Matheus Pimenta
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <sys/time.h>
+
+#include "PathFinder.hpp"
+
+#include "simplestructures.hpp"
+
+using std::vector;
+
+static double now ()
+{
+	timeval tv;
+	gettimeofday ( &tv, NULL );
+	return ( tv.tv_sec + tv.tv_usec / 1000000.0 );
+}
+
+/// @param finder Grid to be searched.
+/// @param from Cells where the queries start.
+/// @param to Cells where the queries end.
+/// @param cached Whether the cache is kept between the queries.
+/// @brief Runs the queries and prints their rate
+static void bench (
+	const char* name,
+	PathFinder& finder,
+	const vector< int >& from,
+	const vector< int >& to,
+	bool cached
+)
+{
+	vector< int > cells;
+	
+	finder.clearCache ();
+	finder.resetStats ();
+	
+	double t = now ();
+	for ( unsigned int i = 0; i < from.size (); i++ )
+	{
+		if ( !cached )
+			finder.clearCache ();
+		finder.search ( from[i], to[i], cells );
+	}
+	t = now () - t;
+	
+	const PathFinder::Stats& stats = finder.stats ();
+	
+	printf (
+		"%-8s %10.0f queries/s %10.3f ms/query %10.0f expanded/query %6u hits %6u failed\n",
+		name,
+		from.size () / t,
+		t * 1000 / from.size (),
+		double ( stats.expanded ) / from.size (),
+		stats.hits,
+		stats.failures
+	);
+}
+
+int main (int argc, char* argv[])
+{
+	int size = ( argc > 1 ) ? atoi ( argv[1] ) : 512;
+	int queries = ( argc > 2 ) ? atoi ( argv[2] ) : 1000;
+	int density = ( argc > 3 ) ? atoi ( argv[3] ) : 25;
+	
+	if ( size < 2 )
+		size = 2;
+	if ( queries < 1 )
+		queries = 1;
+	
+	srand ( 1 );
+	
+	PathFinder finder ( size, size, 75, 75 );
+	
+	// scattered rocks and some long walls, so the paths must turn
+	for ( int i = 0; i < size; i++ )
+	{
+		for ( int j = 0; j < size; j++ )
+		{
+			if ( rand () % 100 < density / 2 )
+				finder.setBlocked ( i, j, true );
+		}
+	}
+	for ( int k = 0; k < size * density / 1000; k++ )
+	{
+		int i = rand () % size, j = rand () % size;
+		int length = rand () % ( size / 4 + 1 );
+		bool vertical = rand () % 2;
+		
+		for ( int l = 0; l < length; l++ )
+			finder.setBlocked ( i + ( vertical ? l : 0 ), j + ( vertical ? 0 : l ), true );
+	}
+	
+	vector< int > from, to;
+	while ( int ( from.size () ) < queries )
+	{
+		int a = rand () % ( size * size );
+		int b = rand () % ( size * size );
+		
+		if ( ( finder.isBlocked ( a / size, a % size ) ) ||
+			( finder.isBlocked ( b / size, b % size ) ) )
+		{
+			continue;
+		}
+		
+		from.push_back ( a );
+		to.push_back ( b );
+	}
+	
+	// a few destinations asked over and over, as the clicks of a player
+	vector< int > from_again, to_again;
+	for ( int i = 0; i < queries; i++ )
+	{
+		from_again.push_back ( from[ i % 16 ] );
+		to_again.push_back ( to[ i % 16 ] );
+	}
+	
+	printf ( "%dx%d map, %d%% density, %d queries\n", size, size, density, queries );
+	
+	finder.setJumps ( false );
+	bench ( "astar", finder, from, to, false );
+	
+	finder.setJumps ( true );
+	bench ( "jps", finder, from, to, false );
+	bench ( "cached", finder, from_again, to_again, true );
+	
+	return 0;
+}
@@ -0,0 +1,212 @@
+/// @file scalebench.cpp
+/// @brief Frame times of the compositor and the integer upscaler at each
+/// scale of the screen to the window
+/// @author Matheus Pimenta
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <sys/time.h>
+
+#include "SDL.h"
+
+#include "Compositor.hpp"
+#include "JobSystem.hpp"
+#include "Upscaler.hpp"
+
+#include "simplestructures.hpp"
+
+using std::vector;
+
+// scales measured, from the window itself to a screen that many times
+// smaller
+#define MAXSCALE	4
+
+static double now ()
+{
+	timeval tv;
+	gettimeofday ( &tv, NULL );
+	return ( tv.tv_sec + tv.tv_usec / 1000000.0 );
+}
+
+static Uint32* row (SDL_Surface* s, int y)
+{
+	return (Uint32*) ( (Uint8*) s->pixels + y * s->pitch );
+}
+
+static SDL_Surface* surface (int w, int h, Uint32 amask)
+{
+	SDL_Surface* s = SDL_CreateRGBSurface (
+		SDL_SWSURFACE, w, h, 32, 0xFF0000, 0xFF00, 0xFF, amask
+	);
+	if ( !s )
+		throw ( mexception ( "SDL_CreateRGBSurface error" ) );
+	
+	for ( int y = 0; y < h; y++ )
+	{
+		for ( int x = 0; x < w; x++ )
+			row ( s, y )[x] = ( Uint32 ( rand () ) << 16 ) ^ Uint32 ( rand () );
+	}
+	
+	return s;
+}
+
+// a frame of the game at the size of the screen: the background and sprites
+// with per pixel alpha and color keys, of the same size in any screen, as the
+// images of the game are
+struct Scene
+{
+	SDL_Surface* bg;
+	vector< SDL_Surface* > sprites;
+	vector< SDL_Rect > positions;
+	
+	Scene (int w, int h)
+	{
+		bg = surface ( w, h, 0 );
+		
+		// as many as in 300 for each 800x600 of screen
+		int n = 300 * w / 800 * h / 600;
+		for ( int i = 0; i < n; i++ )
+		{
+			SDL_Surface* s;
+			
+			if ( i % 4 == 0 )
+			{
+				s = surface ( 48, 48, 0 );
+				SDL_SetColorKey ( s, SDL_SRCCOLORKEY, row ( s, 0 )[0] );
+			}
+			else
+			{
+				s = surface ( 64, 64, 0xFF000000 );
+				SDL_SetAlpha ( s, SDL_SRCALPHA, SDL_ALPHA_OPAQUE );
+			}
+			sprites.push_back ( s );
+			
+			SDL_Rect r;
+			r.x = rand () % ( w + 64 ) - 32;
+			r.y = rand () % ( h + 64 ) - 32;
+			r.w = 0;
+			r.h = 0;
+			positions.push_back ( r );
+		}
+	}
+	
+	~Scene ()
+	{
+		SDL_FreeSurface ( bg );
+		for ( unsigned int i = 0; i < sprites.size (); i++ )
+			SDL_FreeSurface ( sprites[i] );
+	}
+	
+	void record (Compositor& compositor)
+	{
+		compositor.blit ( bg, NULL, NULL );
+		
+		for ( unsigned int i = 0; i < sprites.size (); i++ )
+		{
+			SDL_Rect r = positions[i];
+			compositor.blit ( sprites[i], NULL, &r );
+		}
+	}
+};
+
+/// @return Whether each pixel of the screen became its square in the window.
+static bool check (SDL_Surface* screen, SDL_Surface* window, int scale)
+{
+	int x0 = ( window->w - screen->w * scale ) / 2;
+	int y0 = ( window->h - screen->h * scale ) / 2;
+	
+	for ( int y = 0; y < screen->h * scale; y++ )
+	{
+		for ( int x = 0; x < screen->w * scale; x++ )
+		{
+			if ( row ( window, y0 + y )[ x0 + x ] != row ( screen, y / scale )[ x / scale ] )
+				return false;
+		}
+	}
+	
+	return true;
+}
+
+int main (int argc, char* argv[])
+{
+	int w = ( argc > 1 ) ? atoi ( argv[1] ) : 1920;
+	int h = ( argc > 2 ) ? atoi ( argv[2] ) : 1080;
+	int frames = ( argc > 3 ) ? atoi ( argv[3] ) : 50;
+	
+	if ( frames < 1 )
+		frames = 1;
+	
+	srand ( 1 );
+	
+	bool wrong = false;
+	
+	try {
+		if ( ( w < MAXSCALE ) || ( h < MAXSCALE ) )
+			throw ( mexception ( "window too small" ) );
+		
+		JobSystem::init ();
+		
+		SDL_Surface* window = surface ( w, h, 0 );
+		
+		printf ( "window %dx%d, %d threads, %d frames\n", w, h, JobSystem::size (), frames );
+		printf ( "scale\tscreen\tsprites\tdraw_ms\tupscale_ms\tframe_ms\toutput\n" );
+		
+		for ( int scale = 1; scale <= MAXSCALE; scale++ )
+		{
+			int sw = w / scale, sh = h / scale;
+			
+			// the window itself when there's nothing to scale
+			SDL_Surface* screen = ( scale > 1 ) ? surface ( sw, sh, 0 ) : window;
+			Upscaler* upscaler = ( scale > 1 ) ? new Upscaler ( screen, window, scale ) : NULL;
+			
+			Scene scene ( sw, sh );
+			Compositor compositor ( screen );
+			
+			double draw = 0, upscale = 0;
+			for ( int i = 0; i < frames; i++ )
+			{
+				scene.record ( compositor );
+				
+				double t = now ();
+				compositor.flush ();
+				draw += now () - t;
+				
+				if ( upscaler )
+				{
+					t = now ();
+					upscaler->flush ();
+					upscale += now () - t;
+				}
+			}
+			
+			bool same = ( ( !upscaler ) || ( check ( screen, window, scale ) ) );
+			wrong = ( ( wrong ) || ( !same ) );
+			
+			printf (
+				"%d\t%dx%d\t%u\t%.3f\t%.3f\t%.3f\t%s\n",
+				scale,
+				sw, sh,
+				(unsigned int) scene.sprites.size (),
+				draw * 1000 / frames,
+				upscale * 1000 / frames,
+				( draw + upscale ) * 1000 / frames,
+				same ? "exact" : "WRONG"
+			);
+			
+			delete upscaler;
+			if ( screen != window )
+				SDL_FreeSurface ( screen );
+		}
+		
+		SDL_FreeSurface ( window );
+		JobSystem::close ();
+	}
+	catch (mexception& e) {
+		fprintf ( stderr, "scalebench: %s\n", e.what () );
+		return 1;
+	}
+	
+	return ( wrong ? 1 : 0 );
+}